@@ -18,6 +18,7 @@
 
 extern ssize_t opt_dirty_decay_ms;
 extern ssize_t opt_muzzy_decay_ms;
+extern bool    opt_dirty_decay_predictive;
 
 extern percpu_arena_mode_t opt_percpu_arena;
 extern const char *const   percpu_arena_mode_names[];
@@ -38,6 +39,9 @@ extern pac_thp_t huge_arena_pac_thp;
  */
 extern uint32_t arena_bin_offsets[SC_NBINS];
 
+/* Set once the first scratch arena is created; see arena_is_scratch_ptr(). */
+extern bool arena_scratch_enabled_do_not_access_directly;
+
 void arena_basic_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
     const char **dss, ssize_t *dirty_decay_ms, ssize_t *muzzy_decay_ms,
     size_t *nactive, size_t *ndirty, size_t *nmuzzy);
@@ -81,7 +85,8 @@ void arena_slab_dalloc(tsdn_t *tsdn, arena_t *arena, edata_t *slab);
 void  arena_dalloc_small(tsdn_t *tsdn, void *ptr);
 void  arena_ptr_array_flush(tsd_t *tsd, szind_t binind,
      cache_bin_ptr_array_t *arr, unsigned nflush, bool small,
-     arena_t *stats_arena, cache_bin_stats_t merge_stats);
+     arena_t *stats_arena, cache_bin_stats_t merge_stats,
+     bool use_percpu_cache);
 bool  arena_ralloc_no_move(tsdn_t *tsdn, void *ptr, size_t oldsize, size_t size,
      size_t extra, bool zero, size_t *newsize);
 void *arena_ralloc(tsdn_t *tsdn, arena_t *arena, void *ptr, size_t oldsize,
@@ -4,6 +4,7 @@
 #include "jemalloc/internal/jemalloc_preamble.h"
 #include "jemalloc/internal/arena_externs.h"
 #include "jemalloc/internal/arena_structs.h"
+#include "jemalloc/internal/bin_regions.h"
 #include "jemalloc/internal/bin_inlines.h"
 #include "jemalloc/internal/div.h"
 #include "jemalloc/internal/emap.h"
@@ -198,7 +199,12 @@ arena_malloc(tsdn_t *tsdn, arena_t *arena, size_t size, szind_t ind, bool zero,
     bool slab, tcache_t *tcache, bool slow_path) {
 	assert(!tsdn_null(tsdn) || tcache == NULL);
 
-	if (likely(tcache != NULL)) {
+	/*
+	 * Objects of scratch arenas must never be handed out through a thread
+	 * cache: they'd outlive arena.<i>.reset there.
+	 */
+	if (likely(tcache != NULL)
+	    && (arena == NULL || likely(!arena_is_scratch(arena)))) {
 		if (likely(slab)) {
 			assert(sz_can_use_slab(size));
 			return tcache_alloc_small(tsdn_tsd(tsdn), arena, tcache,
@@ -224,6 +230,15 @@ JEMALLOC_ALWAYS_INLINE size_t
 arena_salloc(tsdn_t *tsdn, const void *ptr) {
 	assert(ptr != NULL);
 	emap_alloc_ctx_t alloc_ctx;
+	if (bin_regions_lookup(ptr, &alloc_ctx.szind)) {
+		if (config_debug) {
+			emap_alloc_ctx_t rtree_ctx;
+			emap_alloc_ctx_lookup(
+			    tsdn, &arena_emap_global, ptr, &rtree_ctx);
+			assert(rtree_ctx.szind == alloc_ctx.szind);
+		}
+		return sz_index2size(alloc_ctx.szind);
+	}
 	emap_alloc_ctx_lookup(tsdn, &arena_emap_global, ptr, &alloc_ctx);
 	assert(alloc_ctx.szind != SC_NSIZES);
 
@@ -347,9 +362,9 @@ arena_tcache_dalloc_small_safety_check(tsdn_t *tsdn, void *ptr) {
 	size_t regind = bin_slab_regind_impl(&div_info, binind, edata, ptr);
 	slab_data_t      *slab_data = edata_slab_data_get(edata);
 	const bin_info_t *bin_info = &bin_infos[binind];
-	assert(edata_nfree_get(edata) < bin_info->nregs);
-	if (unlikely(!bitmap_get(
-	        slab_data->bitmap, &bin_info->bitmap_info, regind))) {
+	assert(edata_nfree_get(edata) < bin_slab_nregs(bin_info, edata));
+	if (unlikely(!bitmap_get(slab_data->bitmap,
+	        bin_slab_bitmap_info(bin_info, edata), regind))) {
 		safety_check_fail(
 		    "Invalid deallocation detected: the pointer being freed (%p) not "
 		    "currently active, possibly caused by double free bugs.\n",
@@ -359,13 +374,28 @@ arena_tcache_dalloc_small_safety_check(tsdn_t *tsdn, void *ptr) {
 	return false;
 }
 
+/*
+ * Whether ptr came from a scratch arena.  Such objects must never be freed into
+ * a thread cache either, which would hand them out again (see arena_malloc());
+ * they take the tcache-less paths, which drop them.  Only looks ptr up once a
+ * scratch arena exists.
+ */
+JEMALLOC_ALWAYS_INLINE bool
+arena_is_scratch_ptr(tsdn_t *tsdn, const void *ptr) {
+	if (likely(!arena_scratch_enabled())) {
+		return false;
+	}
+	edata_t *edata = emap_edata_lookup(tsdn, &arena_emap_global, ptr);
+	return arena_is_scratch(arena_get_from_edata(edata));
+}
+
 JEMALLOC_ALWAYS_INLINE void
 arena_dalloc(tsdn_t *tsdn, void *ptr, tcache_t *tcache,
     emap_alloc_ctx_t *caller_alloc_ctx, bool slow_path) {
 	assert(!tsdn_null(tsdn) || tcache == NULL);
 	assert(ptr != NULL);
 
-	if (unlikely(tcache == NULL)) {
+	if (unlikely(tcache == NULL) || arena_is_scratch_ptr(tsdn, ptr)) {
 		arena_dalloc_no_tcache(tsdn, ptr);
 		return;
 	}
@@ -450,7 +480,7 @@ arena_sdalloc(tsdn_t *tsdn, void *ptr, size_t size, tcache_t *tcache,
 	assert(ptr != NULL);
 	assert(size <= SC_LARGE_MAXCLASS);
 
-	if (unlikely(tcache == NULL)) {
+	if (unlikely(tcache == NULL) || arena_is_scratch_ptr(tsdn, ptr)) {
 		arena_sdalloc_no_tcache(tsdn, ptr, size);
 		return;
 	}
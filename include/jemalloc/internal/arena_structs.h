@@ -82,6 +82,9 @@ struct arena_s {
 	 */
 	unsigned ind;
 
+	/* See arena_config_t.  Read-only after initialization. */
+	bool scratch;
+
 	/*
 	 * Base allocator, from which arena metadata are allocated.
 	 *
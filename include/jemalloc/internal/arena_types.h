@@ -51,6 +51,14 @@ struct arena_config_s {
 	 * Use extent hooks for metadata (base) allocations when true.
 	 */
 	bool metadata_use_hooks;
+
+	/*
+	 * Scratch arenas bump-allocate their extents and treat deallocation of
+	 * small objects as a no-op; that memory is only reclaimed, wholesale,
+	 * by arena.<i>.reset.  Neither allocation from nor deallocation to a
+	 * scratch arena goes through a thread cache, whatever the flags.
+	 */
+	bool scratch;
 };
 
 typedef struct arena_config_s arena_config_t;
@@ -6,9 +6,33 @@
 #include "jemalloc/internal/bin_stats.h"
 #include "jemalloc/internal/bin_types.h"
 #include "jemalloc/internal/edata.h"
+#include "jemalloc/internal/mpsc_queue.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/ql.h"
 #include "jemalloc/internal/sc.h"
 
+#define BIN_REMOTE_FREE_MAX_DEFAULT 256
+
+extern bool   opt_bin_remote_free;
+extern size_t opt_bin_remote_free_max;
+extern bool   opt_slab_size_auto;
+
+/*
+ * Remote frees.  When enabled, a thread flushing regions to a bin other than
+ * its own pushes them onto the bin's lock-free inbox instead of acquiring the
+ * bin lock.  The freed region itself serves as the queue node, so only size
+ * classes large enough to hold a bin_remote_free_t are eligible.  Whoever next
+ * holds the bin lock drains the inbox back into the slabs.
+ */
+typedef struct bin_remote_free_s bin_remote_free_t;
+typedef ql_head(bin_remote_free_t) bin_remote_free_list_t;
+struct bin_remote_free_s {
+	ql_elm(bin_remote_free_t) link;
+	/* The slab containing this region. */
+	edata_t *slab;
+};
+typedef mpsc_queue(bin_remote_free_t) bin_remote_free_queue_t;
+
 /*
  * A bin contains a set of extents that are currently being used for slab
  * allocations.
@@ -41,6 +65,27 @@ struct bin_s {
 
 	/* List used to track full slabs. */
 	edata_list_active_t slabs_full;
+
+	/*
+	 * Regions freed remotely and not yet returned to their slabs.  Pushes
+	 * are lock-free; popping requires lock ownership.
+	 */
+	bin_remote_free_queue_t remote_frees;
+	/*
+	 * Number of regions pushed onto remote_frees but not yet drained.  Only
+	 * used to bound the inbox size, so it may transiently lag the queue.
+	 */
+	atomic_zu_t nremote_pending;
+
+	/*
+	 * Slab size auto-tuning (opt.slab_size_auto): new slabs span
+	 * bin_info->slab_size << slab_lg_scale bytes.  Written with lock
+	 * ownership, but read without it when allocating a slab.
+	 */
+	atomic_u_t slab_lg_scale;
+	/* Slabs allocated and deallocated in the current tuning window. */
+	unsigned slab_tune_nalloc;
+	unsigned slab_tune_ndalloc;
 };
 
 /* A set of sharded bins of the same size class. */
@@ -95,6 +140,34 @@ bool  bin_refill_slabcur_no_fresh_slab(tsdn_t *tsdn, bool is_auto,
 void *bin_malloc_no_fresh_slab(tsdn_t *tsdn, bool is_auto, bin_t *bin,
     szind_t binind);
 
+/* Remote frees. */
+static inline bool
+bin_remote_free_eligible(szind_t binind) {
+	return opt_bin_remote_free
+	    && bin_infos[binind].reg_size >= sizeof(bin_remote_free_t);
+}
+static inline void
+bin_remote_free_list_append(
+    bin_remote_free_list_t *list, void *ptr, edata_t *slab) {
+	bin_remote_free_t *node = (bin_remote_free_t *)ptr;
+	ql_elm_new(node, link);
+	node->slab = slab;
+	ql_tail_insert(list, node, link);
+}
+bool     bin_remote_free_push(
+        bin_t *bin, bin_remote_free_list_t *list, size_t nregs);
+unsigned bin_remote_free_drain_locked(tsdn_t *tsdn, bool is_auto, bin_t *bin,
+    szind_t binind, edata_list_active_t *empty_slabs);
+void     bin_remote_free_discard_locked(tsdn_t *tsdn, bin_t *bin);
+
+/* Slab size auto-tuning. */
+static inline unsigned
+bin_slab_lg_scale_get(bin_t *bin) {
+	return atomic_load_u(&bin->slab_lg_scale, ATOMIC_RELAXED);
+}
+void bin_slab_size_tune(tsdn_t *tsdn, bin_t *bin, szind_t binind,
+    unsigned nalloc, unsigned ndalloc);
+
 /* Slab queries. */
 void *bin_current_slab_addr(tsdn_t *tsdn, bin_t *bin);
 
@@ -125,6 +198,16 @@ bin_stats_merge(tsdn_t *tsdn, bin_stats_data_t *dst_bin_stats, bin_t *bin) {
 	stats->reslabs += bin->stats.reslabs;
 	stats->curslabs += bin->stats.curslabs;
 	stats->nonfull_slabs += bin->stats.nonfull_slabs;
+	stats->curslabs_huge += bin->stats.curslabs_huge;
+	stats->curslabs_nregs += bin->stats.curslabs_nregs;
+	/* Shards tune independently; report the largest scale. */
+	unsigned slab_lg_scale = bin_slab_lg_scale_get(bin);
+	if (slab_lg_scale > stats->slab_lg_scale) {
+		stats->slab_lg_scale = slab_lg_scale;
+	}
+	stats->nslab_grows += bin->stats.nslab_grows;
+	stats->nslab_shrinks += bin->stats.nslab_shrinks;
+	stats->nremote_frees += bin->stats.nremote_frees;
 	malloc_mutex_unlock(tsdn, &bin->lock);
 }
 
@@ -23,6 +23,12 @@
  *   | region nregs-1     |
  *   \--------------------/
  */
+/*
+ * With opt.slab_size_auto, a slab may span up to 2^BIN_SLAB_LG_SCALE_MAX times
+ * slab_size bytes, holding as many times nregs regions.
+ */
+#define BIN_SLAB_LG_SCALE_MAX 3
+
 typedef struct bin_info_s bin_info_t;
 struct bin_info_s {
 	/* Size of regions in a slab for this bin's size class. */
@@ -37,15 +43,28 @@ struct bin_info_s {
 	/* Number of sharded bins in each arena for this size class. */
 	uint32_t n_shards;
 
+	/* Whether slabs come from hugepage-backed regions; see pa_shard_t. */
+	bool huge;
+
+	/* Largest slab scale that keeps nregs within the bitmap capacity. */
+	unsigned slab_lg_scale_max;
+
 	/*
 	 * Metadata used to manipulate bitmaps for slabs associated with this
-	 * bin.
+	 * bin, indexed by slab scale.
 	 */
-	bitmap_info_t bitmap_info;
+	bitmap_info_t bitmap_info[BIN_SLAB_LG_SCALE_MAX + 1];
 };
 
 extern bin_info_t bin_infos[SC_NBINS];
 
+/* Size classes selected through the huge_bins option. */
+extern bool opt_huge_bins[SC_NBINS];
+
+/* Parses a huge_bins setting; returns true on error. */
+bool bin_info_huge_parse(const char *settings, size_t len);
+/* Whether any size class has hugepage-backed slabs. */
+bool bin_info_huge_any(void);
 void bin_info_boot(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS]);
 
 #endif /* JEMALLOC_INTERNAL_BIN_INFO_H */
@@ -22,6 +22,17 @@ struct bin_dalloc_locked_info_s {
 	uint64_t   ndalloc;
 };
 
+/* Number of regions in a slab, which may be scaled up from bin_info's. */
+static inline uint32_t
+bin_slab_nregs(const bin_info_t *bin_info, const edata_t *slab) {
+	return bin_info->nregs << edata_slab_lg_scale_get(slab);
+}
+
+static inline const bitmap_info_t *
+bin_slab_bitmap_info(const bin_info_t *bin_info, const edata_t *slab) {
+	return &bin_info->bitmap_info[edata_slab_lg_scale_get(slab)];
+}
+
 /* Find the region index of a pointer within a slab. */
 JEMALLOC_ALWAYS_INLINE size_t
 bin_slab_regind_impl(const div_info_t *div_info, szind_t binind,
@@ -40,7 +51,7 @@ bin_slab_regind_impl(const div_info_t *div_info, szind_t binind,
 
 	/* Avoid doing division with a variable divisor. */
 	regind = div_compute(div_info, diff);
-	assert(regind < bin_infos[binind].nregs);
+	assert(regind < bin_slab_nregs(&bin_infos[binind], slab));
 	return regind;
 }
 
@@ -76,11 +87,13 @@ bin_dalloc_locked_step(tsdn_t *tsdn, bool is_auto, bin_t *bin,
 	size_t            regind = bin_slab_regind(info, binind, slab, ptr);
 	slab_data_t      *slab_data = edata_slab_data_get(slab);
 
-	assert(edata_nfree_get(slab) < bin_info->nregs);
+	const bitmap_info_t *bitmap_info = bin_slab_bitmap_info(bin_info, slab);
+
+	assert(edata_nfree_get(slab) < bin_slab_nregs(bin_info, slab));
 	/* Freeing an unallocated pointer can cause assertion failure. */
-	assert(bitmap_get(slab_data->bitmap, &bin_info->bitmap_info, regind));
+	assert(bitmap_get(slab_data->bitmap, bitmap_info, regind));
 
-	bitmap_unset(slab_data->bitmap, &bin_info->bitmap_info, regind);
+	bitmap_unset(slab_data->bitmap, bitmap_info, regind);
 	edata_nfree_inc(slab);
 
 	if (config_stats) {
@@ -88,7 +101,7 @@ bin_dalloc_locked_step(tsdn_t *tsdn, bool is_auto, bin_t *bin,
 	}
 
 	unsigned nfree = edata_nfree_get(slab);
-	if (nfree == bin_info->nregs) {
+	if (nfree == bin_slab_nregs(bin_info, slab)) {
 		bin_dalloc_locked_handle_newly_empty(
 		    tsdn, is_auto, slab, bin);
 		return true;
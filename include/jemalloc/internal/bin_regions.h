@@ -0,0 +1,72 @@
+#ifndef JEMALLOC_INTERNAL_BIN_REGIONS_H
+#define JEMALLOC_INTERNAL_BIN_REGIONS_H
+
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/sc.h"
+
+/*
+ * With opt.bin_regions, one contiguous range of virtual address space is
+ * reserved at startup and cut into SC_NBINS regions of 2^opt_lg_bin_region
+ * bytes each, one per small size class.  Slabs of a size class are only ever
+ * carved from its own region (see pa_bin_regions_alloc()), so the size class
+ * of a small object follows from its address alone:
+ *
+ *   szind = (ptr - bin_regions_base) >> opt_lg_bin_region
+ *
+ * This lets free() and malloc_usable_size() skip the rtree lookup for objects
+ * in the regions.  A region that runs out simply stops growing; its slabs then
+ * come from the regular allocators, and those objects take the rtree path.
+ */
+
+/*
+ * Bounds on opt_lg_bin_region.  The default reserves 4 GiB per size class; the
+ * reservation is address space only until slabs are carved from it.
+ */
+#define BIN_REGIONS_LG_REGION_MIN 24
+#define BIN_REGIONS_LG_REGION_MAX 40
+#define BIN_REGIONS_LG_REGION_DEFAULT 32
+
+extern bool     opt_bin_regions;
+extern unsigned opt_lg_bin_region;
+
+/*
+ * Set once by bin_regions_boot().  The flag is all that the free fast path
+ * reads when bin regions are off; the bounds are 0 then.
+ */
+extern bool      bin_regions_enabled_do_not_access_directly;
+extern uintptr_t bin_regions_base;
+extern size_t    bin_regions_size;
+
+/* Reserves the regions; must precede the first arena.  Returns true on error. */
+bool bin_regions_boot(void);
+
+/*
+ * Carves size bytes for a slab off the region of szind.  Sets *zeroed if the
+ * memory is known to be zero.  Returns NULL once the region is used up.
+ */
+void *bin_regions_slab_alloc(szind_t szind, size_t size, bool *zeroed);
+
+static inline bool
+bin_regions_enabled(void) {
+	return bin_regions_enabled_do_not_access_directly;
+}
+
+/*
+ * Sets *szind to the size class of ptr and returns true if ptr lies in the bin
+ * regions.  Only meaningful for pointers to live allocations.
+ */
+JEMALLOC_ALWAYS_INLINE bool
+bin_regions_lookup(const void *ptr, szind_t *szind) {
+	if (likely(!bin_regions_enabled())) {
+		return false;
+	}
+	/* Wraps around for pointers below the base. */
+	uintptr_t offset = (uintptr_t)ptr - bin_regions_base;
+	if (offset >= bin_regions_size) {
+		return false;
+	}
+	*szind = (szind_t)(offset >> opt_lg_bin_region);
+	return true;
+}
+
+#endif /* JEMALLOC_INTERNAL_BIN_REGIONS_H */
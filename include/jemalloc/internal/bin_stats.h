@@ -48,6 +48,26 @@ struct bin_stats_s {
 
 	/* Current size of nonfull slabs heap in this bin. */
 	size_t nonfull_slabs;
+
+	/* Current number of slabs carved from hugepage-backed regions. */
+	size_t curslabs_huge;
+
+	/* Total number of regions in the current slabs. */
+	size_t curslabs_nregs;
+
+	/*
+	 * opt.slab_size_auto state: the scale applied to slab_size for new
+	 * slabs, and the number of times it was raised or lowered.
+	 */
+	unsigned slab_lg_scale;
+	uint64_t nslab_grows;
+	uint64_t nslab_shrinks;
+
+	/*
+	 * Number of deallocations which reached this bin through the remote
+	 * free inbox rather than under the bin lock.  Counted when drained.
+	 */
+	uint64_t nremote_frees;
 };
 
 typedef struct bin_stats_data_s bin_stats_data_t;
@@ -7,6 +7,17 @@
 
 #define DECAY_UNBOUNDED_TIME_TO_PURGE ((uint64_t) - 1)
 
+/*
+ * Predictive decay keeps enough unused pages to serve the peak per-epoch
+ * demand for this many epochs, i.e. a tenth of the decay time.
+ */
+#define DECAY_FORECAST_HORIZON (SMOOTHSTEP_NSTEPS / 10)
+/*
+ * The demand peak fades by 1/2^DECAY_FORECAST_LG_FADE every epoch, which halves
+ * it in about a fifth of the decay time.
+ */
+#define DECAY_FORECAST_LG_FADE 6
+
 /*
  * The decay_t computes the number of pages we should purge at any given time.
  * Page allocators inform a decay object when pages enter a decay-able state
@@ -81,6 +92,18 @@ struct decay_s {
 	 */
 	size_t backlog[SMOOTHSTEP_NSTEPS];
 
+	/*
+	 * Demand forecast for predictive decay; see decay_forecast_update.
+	 * nalloc is the allocation count reported at forecast_epoch,
+	 * demand_peak the recent peak of pages allocated per epoch, and
+	 * forecast_limit the resulting number of pages to keep.
+	 */
+	bool     forecast_started;
+	nstime_t forecast_epoch;
+	size_t   nalloc;
+	size_t   demand_peak;
+	size_t   forecast_limit;
+
 	/* Peak number of pages in associated extents.  Used for debug only. */
 	uint64_t ceil_npages;
 };
@@ -103,6 +126,15 @@ decay_npages_limit_get(const decay_t *decay) {
 	return decay->npages_limit;
 }
 
+/*
+ * The number of unused pages predictive decay keeps, as of the last
+ * decay_forecast_update.
+ */
+static inline size_t
+decay_forecast_limit_get(const decay_t *decay) {
+	return decay->forecast_limit;
+}
+
 /* How many unused dirty pages were generated during the last epoch. */
 static inline size_t
 decay_epoch_npages_delta(const decay_t *decay) {
@@ -175,6 +207,15 @@ uint64_t decay_npages_purge_in(
 bool decay_maybe_advance_epoch(
     decay_t *decay, nstime_t *new_time, size_t current_npages);
 
+/*
+ * Feeds predictive decay with the cumulative number of pages allocated from
+ * the associated page allocator, sampled right after an epoch advance.  The
+ * per-epoch demand since the previous sample raises the demand peak, which
+ * otherwise fades, and the forecast limit becomes enough pages to serve that
+ * peak for DECAY_FORECAST_HORIZON epochs.
+ */
+void decay_forecast_update(decay_t *decay, size_t nalloc);
+
 /*
  * Calculates wait time until a number of pages in the interval
  * [0.5 * npages_threshold .. 1.5 * npages_threshold] should be purged.
@@ -41,6 +41,17 @@ enum extent_state_e {
 };
 typedef enum extent_state_e extent_state_t;
 
+/*
+ * How long an unused extent has sat in its ecache, in passes of the cold
+ * demotion scan (see opt.cold_age_ms).
+ */
+enum extent_cold_e {
+	EXTENT_COLD_FRESH = 0, /* Inserted since the last scan. */
+	EXTENT_COLD_IDLE = 1,  /* Seen by the last scan. */
+	EXTENT_COLD_DEMOTED = 2 /* Already advised cold. */
+};
+typedef enum extent_cold_e extent_cold_t;
+
 enum extent_head_state_e {
 	EXTENT_NOT_HEAD,
 	EXTENT_IS_HEAD /* See comments in ehooks_default_merge_impl(). */
@@ -113,8 +124,12 @@ struct edata_s {
 	 * s: bin_shard
 	 * h: is_head
 	 * n: pinned
+	 * u: huge_bin
+	 * l: slab_lg_scale
+	 * k: cold
+	 * r: remapped
 	 *
-	 * 00000000 ... 0nhsssss ssffffff ffffiiii iiiitttg zpcbaaaa aaaaaaaa
+	 * 00000000 ... 000rkkll unhsssss ssffffff ffffiiii iiiitttg zpcbaaaa aaaaaaaa
 	 *
 	 * arena_ind: Arena from which this extent came, or all 1 bits if
 	 *            unassociated.
@@ -152,6 +167,17 @@ struct edata_s {
 	 * is_head: see comments in ehooks_default_merge_impl().
 	 *
 	 * pinned: true if the alloc hook signaled non-reclaimable backing.
+	 *
+	 * huge_bin: true if the slab was carved from a hugepage-backed region
+	 *           of its pa_shard_t, to which it returns once freed.
+	 *
+	 * slab_lg_scale: the slab spans bin_infos[szind].slab_size <<
+	 *                slab_lg_scale bytes (see opt.slab_size_auto).
+	 *
+	 * cold: an extent_cold_t, for unused extents only.
+	 *
+	 * remapped: true if the extent holds pages moved by pages_remap(), to
+	 *           be released by pages_remap_release() once it's freed.
 	 */
 	uint64_t e_bits;
 #define MASK(CURRENT_FIELD_WIDTH, CURRENT_FIELD_SHIFT)                         \
@@ -223,7 +249,30 @@ struct edata_s {
 #define EDATA_BITS_PINNED_MASK                                                 \
 	MASK(EDATA_BITS_PINNED_WIDTH, EDATA_BITS_PINNED_SHIFT)
 
-#if (EDATA_BITS_PINNED_SHIFT + EDATA_BITS_PINNED_WIDTH > 64)
+#define EDATA_BITS_HUGE_BIN_WIDTH 1
+#define EDATA_BITS_HUGE_BIN_SHIFT                                              \
+	(EDATA_BITS_PINNED_WIDTH + EDATA_BITS_PINNED_SHIFT)
+#define EDATA_BITS_HUGE_BIN_MASK                                               \
+	MASK(EDATA_BITS_HUGE_BIN_WIDTH, EDATA_BITS_HUGE_BIN_SHIFT)
+
+#define EDATA_BITS_SLAB_LG_SCALE_WIDTH 2
+#define EDATA_BITS_SLAB_LG_SCALE_SHIFT                                         \
+	(EDATA_BITS_HUGE_BIN_WIDTH + EDATA_BITS_HUGE_BIN_SHIFT)
+#define EDATA_BITS_SLAB_LG_SCALE_MASK                                          \
+	MASK(EDATA_BITS_SLAB_LG_SCALE_WIDTH, EDATA_BITS_SLAB_LG_SCALE_SHIFT)
+
+#define EDATA_BITS_COLD_WIDTH 2
+#define EDATA_BITS_COLD_SHIFT                                                  \
+	(EDATA_BITS_SLAB_LG_SCALE_WIDTH + EDATA_BITS_SLAB_LG_SCALE_SHIFT)
+#define EDATA_BITS_COLD_MASK MASK(EDATA_BITS_COLD_WIDTH, EDATA_BITS_COLD_SHIFT)
+
+#define EDATA_BITS_REMAPPED_WIDTH 1
+#define EDATA_BITS_REMAPPED_SHIFT                                              \
+	(EDATA_BITS_COLD_WIDTH + EDATA_BITS_COLD_SHIFT)
+#define EDATA_BITS_REMAPPED_MASK                                               \
+	MASK(EDATA_BITS_REMAPPED_WIDTH, EDATA_BITS_REMAPPED_SHIFT)
+
+#if (EDATA_BITS_REMAPPED_SHIFT + EDATA_BITS_REMAPPED_WIDTH > 64)
 #error "edata_t e_bits overflow"
 #endif
 
@@ -245,12 +294,23 @@ struct edata_s {
 		size_t e_bsize;
 	};
 
-	/*
-	 * If this edata is a user allocation from an HPA, it comes out of some
-	 * pageslab (we don't yet support hugepage allocations that don't fit
-	 * into pageslabs).  This tracks it.
-	 */
-	hpdata_t *e_ps;
+	union {
+		/*
+		 * If this edata is a user allocation from an HPA, it comes out
+		 * of some pageslab (we don't yet support hugepage allocations
+		 * that don't fit into pageslabs).  This tracks it.
+		 */
+		hpdata_t *e_ps;
+		/*
+		 * PAC extents that aren't zeroed as a whole instead track how
+		 * many of their leading and trailing pages are known to be
+		 * zero, so that zeroing can skip them.
+		 */
+		struct {
+			uint32_t lead;
+			uint32_t trail;
+		} e_zero_npages;
+	};
 
 	/*
 	 * Serial number.  These are not necessarily unique; splitting an extent
@@ -462,6 +522,28 @@ edata_ps_get(const edata_t *edata) {
 	return edata->e_ps;
 }
 
+static inline size_t
+edata_zero_lead_npages_get(const edata_t *edata) {
+	if (edata_zeroed_get(edata)) {
+		return edata_size_get(edata) >> LG_PAGE;
+	}
+	if (edata_pai_get(edata) != EXTENT_PAI_PAC) {
+		return 0;
+	}
+	return edata->e_zero_npages.lead;
+}
+
+static inline size_t
+edata_zero_trail_npages_get(const edata_t *edata) {
+	if (edata_zeroed_get(edata)) {
+		return edata_size_get(edata) >> LG_PAGE;
+	}
+	if (edata_pai_get(edata) != EXTENT_PAI_PAC) {
+		return 0;
+	}
+	return edata->e_zero_npages.trail;
+}
+
 static inline void *
 edata_before_get(const edata_t *edata) {
 	return (void *)((byte_t *)edata_base_get(edata) - PAGE);
@@ -567,6 +649,55 @@ edata_pinned_set(edata_t *edata, bool pinned) {
 	    | ((uint64_t)pinned << EDATA_BITS_PINNED_SHIFT);
 }
 
+static inline bool
+edata_huge_bin_get(const edata_t *edata) {
+	return (bool)((edata->e_bits & EDATA_BITS_HUGE_BIN_MASK)
+	    >> EDATA_BITS_HUGE_BIN_SHIFT);
+}
+
+static inline void
+edata_huge_bin_set(edata_t *edata, bool huge_bin) {
+	edata->e_bits = (edata->e_bits & ~EDATA_BITS_HUGE_BIN_MASK)
+	    | ((uint64_t)huge_bin << EDATA_BITS_HUGE_BIN_SHIFT);
+}
+
+static inline unsigned
+edata_slab_lg_scale_get(const edata_t *edata) {
+	return (unsigned)((edata->e_bits & EDATA_BITS_SLAB_LG_SCALE_MASK)
+	    >> EDATA_BITS_SLAB_LG_SCALE_SHIFT);
+}
+
+static inline void
+edata_slab_lg_scale_set(edata_t *edata, unsigned lg_scale) {
+	assert(lg_scale < (1U << EDATA_BITS_SLAB_LG_SCALE_WIDTH));
+	edata->e_bits = (edata->e_bits & ~EDATA_BITS_SLAB_LG_SCALE_MASK)
+	    | ((uint64_t)lg_scale << EDATA_BITS_SLAB_LG_SCALE_SHIFT);
+}
+
+static inline extent_cold_t
+edata_cold_get(const edata_t *edata) {
+	return (extent_cold_t)((edata->e_bits & EDATA_BITS_COLD_MASK)
+	    >> EDATA_BITS_COLD_SHIFT);
+}
+
+static inline void
+edata_cold_set(edata_t *edata, extent_cold_t cold) {
+	edata->e_bits = (edata->e_bits & ~EDATA_BITS_COLD_MASK)
+	    | ((uint64_t)cold << EDATA_BITS_COLD_SHIFT);
+}
+
+static inline bool
+edata_remapped_get(const edata_t *edata) {
+	return (bool)((edata->e_bits & EDATA_BITS_REMAPPED_MASK)
+	    >> EDATA_BITS_REMAPPED_SHIFT);
+}
+
+static inline void
+edata_remapped_set(edata_t *edata, bool remapped) {
+	edata->e_bits = (edata->e_bits & ~EDATA_BITS_REMAPPED_MASK)
+	    | ((uint64_t)remapped << EDATA_BITS_REMAPPED_SHIFT);
+}
+
 static inline void
 edata_hook_flags_init(edata_t *edata, unsigned alloc_flags) {
 	edata_pinned_set(edata,
@@ -644,6 +775,27 @@ edata_zeroed_set(edata_t *edata, bool zeroed) {
 	    | ((uint64_t)zeroed << EDATA_BITS_ZEROED_SHIFT);
 }
 
+/*
+ * Records that the first lead and the last trail pages of a PAC extent are
+ * known to be zero; the extent counts as zeroed once these cover all of it.
+ */
+static inline void
+edata_zero_npages_set(edata_t *edata, size_t lead, size_t trail) {
+	assert(edata_pai_get(edata) == EXTENT_PAI_PAC);
+	size_t npages = edata_size_get(edata) >> LG_PAGE;
+	assert(lead <= npages && trail <= npages);
+	bool zeroed = (lead + trail >= npages);
+	if (zeroed) {
+		lead = 0;
+		trail = 0;
+	}
+	edata_zeroed_set(edata, zeroed);
+	edata->e_zero_npages.lead = (uint32_t)(
+	    lead > UINT32_MAX ? UINT32_MAX : lead);
+	edata->e_zero_npages.trail = (uint32_t)(
+	    trail > UINT32_MAX ? UINT32_MAX : trail);
+}
+
 static inline void
 edata_committed_set(edata_t *edata, bool committed) {
 	edata->e_bits = (edata->e_bits & ~EDATA_BITS_COMMITTED_MASK)
@@ -725,8 +877,15 @@ edata_init(edata_t *edata, unsigned arena_ind, void *addr, size_t size,
 	edata_zeroed_set(edata, zeroed);
 	edata_committed_set(edata, committed);
 	edata_pai_set(edata, pai);
+	/* HPA extents overwrite this with their pageslab afterwards. */
+	edata->e_zero_npages.lead = 0;
+	edata->e_zero_npages.trail = 0;
 	edata_is_head_set(edata, is_head == EXTENT_IS_HEAD);
 	edata_hook_flags_init(edata, 0);
+	edata_huge_bin_set(edata, false);
+	edata_slab_lg_scale_set(edata, 0);
+	edata_cold_set(edata, EXTENT_COLD_FRESH);
+	edata_remapped_set(edata, false);
 	if (config_prof) {
 		edata_prof_tctx_set(edata, NULL);
 	}
@@ -753,6 +912,10 @@ edata_binit(
 	 */
 	edata_pai_set(edata, EXTENT_PAI_PAC);
 	edata_hook_flags_init(edata, 0);
+	edata_huge_bin_set(edata, false);
+	edata_slab_lg_scale_set(edata, 0);
+	edata_cold_set(edata, EXTENT_COLD_FRESH);
+	edata_remapped_set(edata, false);
 }
 
 static inline int
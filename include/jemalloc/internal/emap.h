@@ -97,6 +97,12 @@ void emap_register_interior(
 
 void emap_deregister_boundary(tsdn_t *tsdn, emap_t *emap, edata_t *edata);
 void emap_deregister_interior(tsdn_t *tsdn, emap_t *emap, edata_t *edata);
+/*
+ * Clears every mapping in [addr, addr + size), whatever extents registered
+ * them; pages that were never registered are skipped.  The caller must make
+ * sure nothing in the range is in use.
+ */
+void emap_deregister_range(tsdn_t *tsdn, emap_t *emap, void *addr, size_t size);
 
 typedef struct emap_prepare_s emap_prepare_t;
 struct emap_prepare_s {
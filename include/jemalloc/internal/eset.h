@@ -47,6 +47,12 @@ struct eset_s {
 
 	/* LRU of all extents in heaps. */
 	edata_list_inactive_t lru;
+	/*
+	 * Where an incremental walk over lru (see pac_cold_demote()) resumes,
+	 * or NULL to start over from the head.  eset_remove() moves it past
+	 * the extents it takes out.
+	 */
+	edata_t *lru_cursor;
 
 	/* Page sum for all extents in heaps. */
 	atomic_zu_t npages;
@@ -51,6 +51,25 @@ struct hpa_shard_nonderived_stats_s {
 	 */
 	uint64_t ndehugifies;
 
+	/*
+	 * Budgeted MADV_COLLAPSE calls (see opts.collapse_budget_us), how many
+	 * of them failed, and the total and worst time spent in them.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t ncollapses;
+	uint64_t ncollapse_failures;
+	uint64_t collapse_ns;
+	uint64_t collapse_max_ns;
+
+	/*
+	 * Allocations that touched a page of a hugepage purged since it was
+	 * last active, counted once per purge of that hugepage.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t nrefaults;
+
 	/*
 	 * Distribution of the min number of extents we will try to allocate
 	 * from a single hpa_alloc() call.
@@ -114,6 +133,27 @@ struct hpa_shard_stats_s {
 	sec_stats_t                  secstats;
 };
 
+/*
+ * Pages of one hpdata set aside for a CPU, out of which allocations of up to
+ * opts.resv_max_alloc are carved under the reservation's own mutex rather
+ * than the shard's.  The hpdata counts the whole reservation as active; what
+ * is left of it goes back when it runs out, or on a flush.
+ */
+#define HPA_RESV_NPAGES 64
+#define HPA_RESV_NSLOTS_MAX 64
+/* Edatas a reservation keeps on hand for the extents it carves. */
+#define HPA_RESV_NEDATAS 16
+typedef struct hpa_resv_s hpa_resv_t;
+struct hpa_resv_s {
+	malloc_mutex_t mtx;
+	/* The hpdata [cur, end) is reserved in; NULL if there is none. */
+	hpdata_t *ps;
+	byte_t   *cur;
+	byte_t   *end;
+	edata_list_inactive_t edatas;
+	size_t                nedatas;
+};
+
 typedef struct hpa_shard_s hpa_shard_t;
 struct hpa_shard_s {
 	/* The central allocator we get our hugepages from. */
@@ -151,6 +191,14 @@ struct hpa_shard_s {
 	 */
 	uint64_t age_counter;
 
+	/*
+	 * Logical clock stamped on a hugepage whenever it serves an allocation
+	 * or a deallocation; orders hugepages for opts.purge_lru.
+	 *
+	 * Guarded by mtx.
+	 */
+	uint64_t activity_counter;
+
 	/* The arena ind we're associated with. */
 	unsigned ind;
 
@@ -188,6 +236,29 @@ struct hpa_shard_s {
 	 * hpa_dalloc) activity in the shard.
 	 */
 	nstime_t last_time_work_attempted;
+
+	/*
+	 * Start of the current one-second collapse budget window, and the time
+	 * spent collapsing in it (which may run over, and is then carried into
+	 * the next window).
+	 *
+	 * Guarded by mtx.
+	 */
+	nstime_t collapse_window_start;
+	uint64_t collapse_window_ns;
+
+	/*
+	 * Spans with no extent allocated out of them, threaded through their
+	 * first hpdatas (which, being kept out of the psset's alloc containers,
+	 * leave their empty-list linkage unused).  Their hugepages stay in the
+	 * psset, to be purged.  Adjacent free spans of the same origin are
+	 * always merged.  Guarded by mtx.
+	 */
+	hpdata_empty_list_t spans_free;
+
+	/* The per-CPU reservations; nresv is 0 if they are disabled. */
+	hpa_resv_t *resv;
+	unsigned    nresv;
 };
 
 bool hpa_hugepage_size_exceeds_limit(void);
@@ -6,8 +6,12 @@
 #include "jemalloc/internal/hpa_hooks.h"
 #include "jemalloc/internal/hpdata.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/numa.h"
 #include "jemalloc/internal/tsd_types.h"
 
+/* Eden for pageslabs of no particular NUMA node. */
+#define HPA_CENTRAL_NODE_ANY NUMA_NODES_MAX
+
 typedef struct hpa_central_s hpa_central_t;
 struct hpa_central_s {
 	/*
@@ -19,12 +23,14 @@ struct hpa_central_s {
 	/*
 	 * Either NULL (if empty), or some integer multiple of a
 	 * hugepage-aligned number of hugepages.  We carve them off one at a
-	 * time to satisfy new pageslab requests.
+	 * time to satisfy new pageslab requests.  With NUMA-aware arenas, each
+	 * node has an eden of its own, bound to the node once, when mapped;
+	 * the HPA_CENTRAL_NODE_ANY one serves everyone else.
 	 *
 	 * Guarded by grow_mtx.
 	 */
-	void  *eden;
-	size_t eden_len;
+	void  *eden[HPA_CENTRAL_NODE_ANY + 1];
+	size_t eden_len[HPA_CENTRAL_NODE_ANY + 1];
 	/* Source for metadata. */
 	base_t *base;
 
@@ -35,7 +41,17 @@ struct hpa_central_s {
 bool hpa_central_init(
     hpa_central_t *central, base_t *base, const hpa_hooks_t *hooks);
 
+/*
+ * Extracts a pageslab from the eden of the given NUMA node (or of
+ * HPA_CENTRAL_NODE_ANY).
+ */
 hpdata_t *hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
-    uint64_t age, bool hugify_eager, bool *oom);
+    unsigned node, uint64_t age, bool hugify_eager, bool *oom);
+/*
+ * Extracts nhp contiguous hugepages as a span (see hpdata_span_get), returning
+ * the first of nhp contiguous hpdatas.
+ */
+hpdata_t *hpa_central_extract_span(tsdn_t *tsdn, hpa_central_t *central,
+    size_t nhp, unsigned node, uint64_t age, bool hugify_eager, bool *oom);
 
 #endif /* JEMALLOC_INTERNAL_HPA_CENTRAL_H */
@@ -18,4 +18,10 @@ struct hpa_hooks_s {
 
 extern const hpa_hooks_t hpa_hooks_default;
 
+/*
+ * Whether pages that hooks purged (or never touched) are known to read as
+ * zero.
+ */
+bool hpa_hooks_purge_zeroes(const hpa_hooks_t *hooks);
+
 #endif /* JEMALLOC_INTERNAL_HPA_HOOKS_H */
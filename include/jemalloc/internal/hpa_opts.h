@@ -152,6 +152,37 @@ struct hpa_shard_opts_s {
 	 * hpa_hugify_style_t for options).
 	 */
 	hpa_hugify_style_t hugify_style;
+
+	/*
+	 * Microseconds per second that may be spent in MADV_COLLAPSE.  When
+	 * nonzero, hugification candidates are collapsed synchronously, best
+	 * candidates (most active pages, then longest waiting) first, for as
+	 * long as the budget lasts; the rest wait for the next second.  0
+	 * keeps the candidates in FIFO order with no limit.
+	 */
+	uint64_t collapse_budget_us;
+
+	/*
+	 * Allocations above slab_max_alloc but no larger than this are served
+	 * from spans of contiguous, hugepage-aligned hugepages rather than
+	 * falling back to the PAC.  Each hugepage of a span is purged and
+	 * hugified like any other, and a freed span is kept to back later
+	 * allocations of the same number of hugepages.  0 disables spans.
+	 */
+	size_t span_max_alloc;
+
+	/*
+	 * Allocations of at most this many bytes are carved out of per-CPU
+	 * reservations of HPA_RESV_NPAGES pages, taking the shard mutex only
+	 * to refill them.  0 disables the reservations.
+	 */
+	size_t resv_max_alloc;
+
+	/*
+	 * Purge the least recently active hugepages first, rather than the
+	 * dirtiest ones.
+	 */
+	bool purge_lru;
 };
 
 /* clang-format off */
@@ -183,7 +214,15 @@ struct hpa_shard_opts_s {
 	/* min_purge_delay_ms */             				\
 	0,  								\
 	/* hugify_style */                				\
-	hpa_hugify_style_lazy						\
+	hpa_hugify_style_lazy,						\
+	/* collapse_budget_us */					\
+	0,								\
+	/* span_max_alloc */						\
+	0,								\
+	/* resv_max_alloc */						\
+	0,								\
+	/* purge_lru */							\
+	false								\
 }
 /* clang-format on */
 
@@ -158,4 +158,11 @@ hpa_batch_empty(hpa_purge_batch_t *b) {
 void hpa_purge_batch(
     hpa_hooks_t *hooks, hpa_purge_item_t *batch, size_t batch_sz);
 
+/*
+ * Shard bookkeeping once a batch has been purged; called with the shard lock
+ * held.  Lives in hpa.c.
+ */
+void hpa_purge_batch_finish(tsdn_t *tsdn, hpa_shard_t *shard,
+    hpa_purge_item_t *items, size_t nitems, size_t ndirty);
+
 #endif /* JEMALLOC_INTERNAL_HPA_UTILS_H */
@@ -5,8 +5,8 @@
 #include "jemalloc/internal/fb.h"
 #include "jemalloc/internal/nstime.h"
 #include "jemalloc/internal/pages.h"
-#include "jemalloc/internal/ph.h"
 #include "jemalloc/internal/ql.h"
+#include "jemalloc/internal/rb.h"
 #include "jemalloc/internal/typed_list.h"
 
 /*
@@ -22,12 +22,29 @@
  */
 
 /*
- * The max enumeration num should not exceed 2^16 - 1, see comments in edata.h
- * for ESET_ENUMERATE_MAX_NUM for more details.
+ * A summary of the free page ranges of an hpdata: a segment tree whose leaves
+ * are the groups of its active page bitmap.  Each node holds the number of free
+ * pages at the start and the end of the pages it covers, and the longest free
+ * range within them; an update touching k groups costs O(k + log(ngroups)),
+ * and finding the first free range of a given length walks down from the root.
+ * Node i has children 2i and 2i + 1; the root is node 1.
  */
-#define PSSET_ENUMERATE_MAX_NUM 32
+#define HPDATA_FR_NLEAVES FB_NGROUPS(HUGEPAGE_PAGES)
+#if LG_HUGEPAGE - LG_PAGE < 16
+typedef uint16_t hpdata_fr_len_t;
+#else
+typedef uint32_t hpdata_fr_len_t;
+#endif
+typedef struct hpdata_fr_node_s hpdata_fr_node_t;
+struct hpdata_fr_node_s {
+	hpdata_fr_len_t prefix;
+	hpdata_fr_len_t suffix;
+	hpdata_fr_len_t longest;
+};
+
 typedef struct hpdata_s hpdata_t;
-ph_structs(hpdata_age_heap, hpdata_t, PSSET_ENUMERATE_MAX_NUM)
+typedef rb_tree(hpdata_t) hpdata_age_tree_t;
+typedef rb_tree(hpdata_t) hpdata_lru_tree_t;
 struct hpdata_s {
 	/*
 	 * We likewise follow the edata convention of mangling names and forcing
@@ -69,6 +86,23 @@ struct hpdata_s {
 	 */
 	bool h_purge_allowed;
 
+	/*
+	 * With opts.purge_lru, the psset also keeps purgeable hpdatas in
+	 * least-recently-active order.  h_last_active is when the hpa last
+	 * allocated from or freed into the hugepage (measured in hpa shard
+	 * operations); h_lru_key is the value the hpdata was filed under, which
+	 * may lag behind until the next update.
+	 */
+	uint64_t h_last_active;
+	uint64_t h_lru_key;
+	bool     h_in_psset_lru_container;
+
+	/*
+	 * Set when a purge gives pages back to the OS, cleared once an
+	 * allocation touches pages of the hugepage again.
+	 */
+	bool h_purged;
+
 	/* And with hugifying. */
 	bool h_hugify_allowed;
 	/* When we became a hugification candidate. */
@@ -92,7 +126,7 @@ struct hpdata_s {
 
 	union {
 		/* When nonempty (and also nonfull), used by the psset bins. */
-		hpdata_age_heap_link_t age_link;
+		rb_node(hpdata_t) age_link;
 		/*
 		 * When empty (or not corresponding to any hugepage), list
 		 * linkage.
@@ -104,16 +138,24 @@ struct hpdata_s {
 	 * Linkage for the psset to track candidates for purging and hugifying.
 	 */
 	ql_elm(hpdata_t) ql_link_purge;
+	rb_node(hpdata_t) lru_link;
 	ql_elm(hpdata_t) ql_link_hugify;
 
 	/* The length of the largest contiguous sequence of inactive pages. */
 	size_t h_longest_free_range;
+	/*
+	 * The largest h_longest_free_range in the subtree of the psset bin this
+	 * hpdata roots.
+	 */
+	size_t h_subtree_longest_free_range;
 
 	/* Number of active pages. */
 	size_t h_nactive;
 
 	/* A bitmap with bits set in the active pages. */
 	fb_group_t active_pages[FB_NGROUPS(HUGEPAGE_PAGES)];
+	/* The free ranges of active_pages; see hpdata_fr_node_t. */
+	hpdata_fr_node_t h_free_ranges[2 * HPDATA_FR_NLEAVES];
 
 	/*
 	 * Number of dirty or active pages, and a bitmap tracking them.  One
@@ -130,13 +172,33 @@ struct hpdata_s {
 
 	/* True if the extent was huge and empty last time when it was purged */
 	bool h_purged_when_empty_and_huge;
+
+	/*
+	 * Set if the hugepage is part of a span: a run of contiguous hugepages
+	 * carved out together to back a single multi-hugepage extent.  Points
+	 * to the first hpdata of the span, whose hpdatas are laid out
+	 * contiguously; h_span_nhp (only meaningful in the first one) is their
+	 * number.  Span hugepages only ever back their span's extent, so they
+	 * never enter the psset's alloc containers.
+	 *
+	 * The h_span_origin_nhp hpdatas starting at h_span_origin were carved
+	 * out together, and are always tiled by spans.  Free spans get split
+	 * and merged within those bounds (see hpa_span_reuse() and
+	 * hpa_span_free()), which moves h_span around; the origin never
+	 * changes once set.
+	 */
+	hpdata_t *h_span;
+	size_t    h_span_nhp;
+	hpdata_t *h_span_origin;
+	size_t    h_span_origin_nhp;
 };
 
 TYPED_LIST(hpdata_empty_list, hpdata_t, ql_link_empty)
 TYPED_LIST(hpdata_purge_list, hpdata_t, ql_link_purge)
 TYPED_LIST(hpdata_hugify_list, hpdata_t, ql_link_hugify)
 
-ph_proto(, hpdata_age_heap, hpdata_t)
+rb_summarized_proto(, hpdata_age_tree_, hpdata_age_tree_t, hpdata_t)
+rb_proto(, hpdata_lru_tree_, hpdata_lru_tree_t, hpdata_t)
 
 static inline void *
 hpdata_addr_get(const hpdata_t *hpdata) {
@@ -196,6 +258,47 @@ hpdata_purge_allowed_set(hpdata_t *hpdata, bool purge_allowed) {
 	hpdata->h_purge_allowed = purge_allowed;
 }
 
+static inline uint64_t
+hpdata_last_active_get(const hpdata_t *hpdata) {
+	return hpdata->h_last_active;
+}
+
+static inline void
+hpdata_last_active_set(hpdata_t *hpdata, uint64_t last_active) {
+	hpdata->h_last_active = last_active;
+}
+
+static inline uint64_t
+hpdata_lru_key_get(const hpdata_t *hpdata) {
+	return hpdata->h_lru_key;
+}
+
+static inline void
+hpdata_lru_key_set(hpdata_t *hpdata, uint64_t lru_key) {
+	hpdata->h_lru_key = lru_key;
+}
+
+static inline bool
+hpdata_in_psset_lru_container_get(const hpdata_t *hpdata) {
+	return hpdata->h_in_psset_lru_container;
+}
+
+static inline void
+hpdata_in_psset_lru_container_set(hpdata_t *hpdata, bool in_container) {
+	assert(in_container != hpdata->h_in_psset_lru_container);
+	hpdata->h_in_psset_lru_container = in_container;
+}
+
+static inline bool
+hpdata_purged_get(const hpdata_t *hpdata) {
+	return hpdata->h_purged;
+}
+
+static inline void
+hpdata_purged_set(hpdata_t *hpdata, bool purged) {
+	hpdata->h_purged = purged;
+}
+
 static inline bool
 hpdata_hugify_allowed_get(const hpdata_t *hpdata) {
 	return hpdata->h_hugify_allowed;
@@ -289,6 +392,11 @@ hpdata_longest_free_range_set(hpdata_t *hpdata, size_t longest_free_range) {
 	hpdata->h_longest_free_range = longest_free_range;
 }
 
+static inline size_t
+hpdata_subtree_longest_free_range_get(const hpdata_t *hpdata) {
+	return hpdata->h_subtree_longest_free_range;
+}
+
 static inline size_t
 hpdata_nactive_get(const hpdata_t *hpdata) {
 	return hpdata->h_nactive;
@@ -299,6 +407,12 @@ hpdata_ntouched_get(const hpdata_t *hpdata) {
 	return hpdata->h_ntouched;
 }
 
+/* Copies out which of the pageslab's pages have been touched. */
+static inline void
+hpdata_touched_pages_copy(const hpdata_t *hpdata, fb_group_t *touched) {
+	memcpy(touched, hpdata->touched_pages, sizeof(hpdata->touched_pages));
+}
+
 static inline size_t
 hpdata_ndirty_get(const hpdata_t *hpdata) {
 	return hpdata->h_ntouched - hpdata->h_nactive;
@@ -319,6 +433,52 @@ hpdata_time_purge_allowed_get(const hpdata_t *hpdata) {
 	return &hpdata->h_time_purge_allowed;
 }
 
+static inline hpdata_t *
+hpdata_span_get(const hpdata_t *hpdata) {
+	return hpdata->h_span;
+}
+
+static inline size_t
+hpdata_span_nhp_get(const hpdata_t *hpdata) {
+	assert(hpdata->h_span == hpdata);
+	return hpdata->h_span_nhp;
+}
+
+static inline void
+hpdata_span_nhp_set(hpdata_t *hpdata, size_t nhp) {
+	assert(hpdata->h_span == hpdata);
+	hpdata->h_span_nhp = nhp;
+}
+
+static inline hpdata_t *
+hpdata_span_origin_get(const hpdata_t *hpdata) {
+	return hpdata->h_span_origin;
+}
+
+static inline size_t
+hpdata_span_origin_nhp_get(const hpdata_t *hpdata) {
+	return hpdata->h_span_origin_nhp;
+}
+
+/* Makes hpdata part of the span of nhp hugepages starting at span. */
+static inline void
+hpdata_span_set(hpdata_t *hpdata, hpdata_t *span, size_t nhp) {
+	assert(hpdata->h_span == NULL);
+	assert(!hpdata->h_in_psset);
+	hpdata->h_span = span;
+	hpdata->h_span_nhp = nhp;
+	hpdata->h_span_origin = span;
+	hpdata->h_span_origin_nhp = nhp;
+}
+
+/* Moves hpdata over to another span of the same origin. */
+static inline void
+hpdata_span_move(hpdata_t *hpdata, hpdata_t *span) {
+	assert(hpdata->h_span != NULL);
+	assert(span->h_span_origin == hpdata->h_span_origin);
+	hpdata->h_span = span;
+}
+
 static inline bool
 hpdata_purged_when_empty_and_huge_get(const hpdata_t *hpdata) {
 	return hpdata->h_purged_when_empty_and_huge;
@@ -444,27 +604,6 @@ struct hpdata_alloc_offset_s {
 	 * the allocation. They are in the range [index, index + npages).
 	 */
 	size_t index;
-
-	/*
-	 * The length of the free bit range on the active bitmap,
-	 * starting at index, before setting the bits in the range
-	 * [index, index + npages).
-	 * It is used to determine whether one of the allocations
-	 * used up the longest free range on the active bitmap.
-	 * If it did, we might have to update the longest free range
-	 * metadata on the hpdata.
-	 */
-	size_t len_before;
-
-	/*
-	 * The length of the longest free range in the range [0, index).
-	 * When we need to update the longest free range on the hpdata,
-	 * the new value is either longest_len (the max up to index),
-	 * len_before - npages (what's left after we carve up the free
-	 * range starting at index), or the max in the range
-	 * [index + len_before, HUGEPAGE_PAGES), whichever is greater.
-	 */
-	size_t longest_len;
 };
 
 /*
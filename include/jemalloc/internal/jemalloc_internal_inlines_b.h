@@ -107,4 +107,14 @@ arena_is_auto(const arena_t *arena) {
 	return (arena_ind_get(arena) < manual_arena_base);
 }
 
+static inline bool
+arena_is_scratch(const arena_t *arena) {
+	return arena->scratch;
+}
+
+static inline bool
+arena_scratch_enabled(void) {
+	return arena_scratch_enabled_do_not_access_directly;
+}
+
 #endif /* JEMALLOC_INTERNAL_INLINES_B_H */
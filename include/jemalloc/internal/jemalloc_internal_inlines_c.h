@@ -4,6 +4,7 @@
 #include "jemalloc/internal/jemalloc_preamble.h"
 #include "jemalloc/internal/arena_externs.h"
 #include "jemalloc/internal/arena_inlines_b.h"
+#include "jemalloc/internal/bin_regions.h"
 #include "jemalloc/internal/emap.h"
 #include "jemalloc/internal/jemalloc_init.h"
 #include "jemalloc/internal/jemalloc_internal_types.h"
@@ -478,7 +479,20 @@ free_fastpath(void *ptr, size_t size, bool size_hint) {
 
 	emap_alloc_ctx_t alloc_ctx JEMALLOC_CC_SILENCE_INIT({0, 0, false});
 	size_t                     usize;
-	if (!size_hint) {
+	if (!size_hint && bin_regions_lookup(ptr, &alloc_ctx.szind)) {
+		/*
+		 * The address gives the size class away, as sdallocx()'s size
+		 * does.  Sampled objects are never carved from bin regions, so
+		 * only the UAF alignment check applies.
+		 */
+		if (unlikely(free_fastpath_nonfast_aligned(ptr,
+		        /* check_prof */ false))) {
+			return false;
+		}
+		assert(alloc_ctx.szind < SC_NBINS);
+		alloc_ctx.slab = true;
+		usize = sz_index2size(alloc_ctx.szind);
+	} else if (!size_hint) {
 		bool err = emap_alloc_ctx_try_lookup_fast(
 		    tsd, &arena_emap_global, ptr, &alloc_ctx);
 
@@ -534,6 +548,10 @@ free_fastpath(void *ptr, size_t size, bool size_hint) {
 		/* See the comment in isfree. */
 		return true;
 	}
+	if (unlikely(arena_is_scratch_ptr(tsd_tsdn(tsd), ptr))) {
+		/* The slow path drops it rather than caching it. */
+		return false;
+	}
 
 	tcache_t    *tcache = tcache_get_from_ind(tsd, TCACHE_IND_AUTOMATIC,
 	       /* slow */ false, /* is_alloc */ false);
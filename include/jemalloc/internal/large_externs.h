@@ -4,6 +4,10 @@
 #include "jemalloc/internal/jemalloc_preamble.h"
 #include "jemalloc/internal/edata.h"
 
+#define REALLOC_REMAP_THRESHOLD_DEFAULT (((size_t)1) << 22) /* 4 MB */
+
+extern size_t opt_realloc_remap_threshold;
+
 void *large_malloc(tsdn_t *tsdn, arena_t *arena, size_t usize, bool zero);
 void *large_palloc(
     tsdn_t *tsdn, arena_t *arena, size_t usize, size_t alignment, bool zero);
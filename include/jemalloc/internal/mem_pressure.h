@@ -0,0 +1,83 @@
+#ifndef JEMALLOC_INTERNAL_MEM_PRESSURE_H
+#define JEMALLOC_INTERNAL_MEM_PRESSURE_H
+
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/atomic.h"
+
+/*
+ * System memory pressure, sampled periodically by the first background thread
+ * from the "some" line of /proc/pressure/memory (PSI) and from the cgroup v2
+ * memory.current of the process' cgroup, relative to its memory.high (or
+ * memory.max).  The dirty and muzzy page budgets of decay, and the HPA dirty
+ * page budget, are scaled by the current level: doubled when there is ample
+ * headroom, halved under moderate pressure, and dropped entirely under high
+ * pressure, so that unused pages go back to the system before it has to
+ * reclaim (or OOM-kill) on its own.
+ *
+ * Without background threads, or where neither source is available, the level
+ * stays at mem_pressure_normal and the budgets are left alone.
+ */
+
+typedef enum {
+	mem_pressure_headroom,
+	mem_pressure_normal,
+	mem_pressure_moderate,
+	mem_pressure_high
+} mem_pressure_t;
+
+/* PSI "some" avg10 thresholds, in hundredths of a percent of stalled time. */
+#define MEM_PRESSURE_PSI_HEADROOM 10
+#define MEM_PRESSURE_PSI_MODERATE 100
+#define MEM_PRESSURE_PSI_HIGH 1000
+/* cgroup memory.current thresholds, in percent of the cgroup limit. */
+#define MEM_PRESSURE_CGROUP_HEADROOM 50
+#define MEM_PRESSURE_CGROUP_MODERATE 80
+#define MEM_PRESSURE_CGROUP_HIGH 95
+
+/* Minimum time between two samples. */
+#define MEM_PRESSURE_INTERVAL_NS UINT64_C(1000000000)
+
+extern bool opt_pressure_purge;
+
+/* Synchronization: atomic; holds a mem_pressure_t. */
+extern atomic_u_t mem_pressure_level;
+
+/* Locates the cgroup files; never fails, but may leave them unavailable. */
+void mem_pressure_boot(void);
+/* Called by the background thread; samples at most once per interval. */
+void mem_pressure_update(void);
+
+/*
+ * Parses the "some avg10=" value of a PSI file into hundredths of a percent.
+ * Returns true on error.
+ */
+bool mem_pressure_psi_parse(const char *buf, uint64_t *avg10);
+/* A limit of 0 means the cgroup has none (or could not be read). */
+mem_pressure_t mem_pressure_compute(
+    uint64_t psi_avg10, uint64_t usage, uint64_t limit);
+
+static inline mem_pressure_t
+mem_pressure_get(void) {
+	if (!opt_pressure_purge) {
+		return mem_pressure_normal;
+	}
+	return (mem_pressure_t)atomic_load_u(
+	    &mem_pressure_level, ATOMIC_RELAXED);
+}
+
+/* Scales a dirty or muzzy page budget by the current memory pressure. */
+static inline size_t
+mem_pressure_npages_limit(size_t npages) {
+	switch (mem_pressure_get()) {
+	case mem_pressure_headroom:
+		return (npages > SIZE_MAX / 2) ? SIZE_MAX : npages * 2;
+	case mem_pressure_normal:
+		return npages;
+	case mem_pressure_moderate:
+		return npages / 2;
+	default:
+		return 0;
+	}
+}
+
+#endif /* JEMALLOC_INTERNAL_MEM_PRESSURE_H */
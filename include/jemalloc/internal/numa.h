@@ -0,0 +1,54 @@
+#ifndef JEMALLOC_INTERNAL_NUMA_H
+#define JEMALLOC_INTERNAL_NUMA_H
+
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/assert.h"
+
+/*
+ * NUMA-aware arenas.  Nodes are numbered here by their position in the list of
+ * online nodes, so that offline node ids never get arenas.  Automatic arena i
+ * belongs to node (i % numa_nnodes); a thread picks among the arenas of the
+ * node it is running on when it is first bound to an arena, and memory freshly
+ * mapped for an arena is given a preferred-node memory policy for that node
+ * before it is first touched.  The policy is set once per mapping: on each
+ * mapping the default extent hooks make, and on each eden the HPA central
+ * allocator maps (it keeps one eden per node).  Threads are not rebound when
+ * they migrate across nodes later on.
+ *
+ * Manual arenas, and arenas with custom extent hooks, are left alone.
+ */
+
+/* Nodes beyond this are not supported; one word of node mask suffices. */
+#define NUMA_NODES_MAX 64
+
+extern bool opt_numa;
+/* Number of online nodes; read-only after numa_boot(). */
+extern unsigned numa_nnodes;
+
+static inline bool
+numa_enabled(void) {
+	return opt_numa;
+}
+
+static inline unsigned
+numa_arena_node(unsigned arena_ind) {
+	assert(numa_enabled());
+	return arena_ind % numa_nnodes;
+}
+
+/*
+ * Parses a node list in the format of /sys/devices/system/node/online (e.g.
+ * "0-1,3") into the ids of the nodes, in increasing order; returns their
+ * number, or 0 on error.
+ */
+unsigned numa_nodes_parse(const char *list, unsigned nodes[NUMA_NODES_MAX]);
+/* Disables opt_numa when the system or configuration does not support it. */
+bool numa_boot(void);
+/* Node the calling thread is currently running on. */
+unsigned numa_node_get(void);
+/* Binds a fresh, untouched mapping to a node. */
+void numa_node_bind(unsigned node, void *addr, size_t size);
+/* Binds a fresh, untouched mapping of an automatic arena to its node. */
+void numa_arena_bind(unsigned arena_ind, void *addr, size_t size);
+
+#endif /* JEMALLOC_INTERNAL_NUMA_H */
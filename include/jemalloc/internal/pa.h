@@ -3,6 +3,7 @@
 
 #include "jemalloc/internal/jemalloc_preamble.h"
 #include "jemalloc/internal/base.h"
+#include "jemalloc/internal/bin_info.h"
 #include "jemalloc/internal/decay.h"
 #include "jemalloc/internal/ecache.h"
 #include "jemalloc/internal/edata_cache.h"
@@ -12,6 +13,25 @@
 #include "jemalloc/internal/pac.h"
 #include "jemalloc/internal/sec.h"
 
+/* Granularity at which scratch shards reserve address space from the PAC. */
+#define PA_SCRATCH_REG_SIZE ((size_t)2 << 20)
+/* Number of edata_t's in each block of a scratch shard's edata pool. */
+#define PA_SCRATCH_EDATA_NBLOCK 255
+
+/* Largest extent, in pages, that the zero pool serves. */
+#define PA_ZERO_POOL_NPAGES_MAX 32
+/* Most extents of one size the zero pool prepares per pass. */
+#define PA_ZERO_POOL_FILL_MAX 16
+
+/* Freed bin region slabs per size class kept unpurged for reuse. */
+#define PA_BIN_REGIONS_NDIRTY_MAX 4
+
+/* Freed huge bin slabs per size class kept for reuse. */
+#define PA_HUGE_BINS_NFREE_MAX 4
+
+/* Upper bound on the bytes held by each shard's zero pool; 0 disables it. */
+extern size_t opt_zero_pool_max;
+
 /*
  * The page allocator; responsible for acquiring pages of memory for
  * allocations.  It dispatches each page-level allocation request to either
@@ -39,6 +59,16 @@ typedef struct pa_shard_stats_s pa_shard_stats_t;
 struct pa_shard_stats_s {
 	/* Number of edata_t structs allocated by base, but not being used. */
 	size_t edata_avail; /* Derived. */
+	/* Bytes of pre-zeroed extents waiting in the zero pool. */
+	size_t zero_pool_bytes; /* Derived. */
+	/* Zeroed large allocations served from, or missed by, the zero pool. */
+	uint64_t zero_pool_nhits;   /* Derived. */
+	uint64_t zero_pool_nmisses; /* Derived. */
+	/* Bytes of bin region slabs, and of those the unpurged free ones. */
+	size_t bin_regions_bytes;       /* Derived. */
+	size_t bin_regions_dirty_bytes; /* Derived. */
+	/* Bytes of free huge bin slabs kept for reuse. */
+	size_t huge_bins_dirty_bytes; /* Derived. */
 	/*
 	 * Stats specific to the PAC.  For now, these are the only stats that
 	 * exist, but there will eventually be other page allocators.  Things
@@ -63,6 +93,8 @@ struct pa_shard_stats_s {
  * that's not fundamental; its' just an artifact of a partial refactoring, and
  * its accesses could be straightforwardly moved inside the decay module).
  */
+typedef struct pa_scratch_edata_block_s pa_scratch_edata_block_t;
+
 typedef struct pa_shard_s pa_shard_t;
 struct pa_shard_s {
 	/* The central PA this shard is associated with. */
@@ -91,6 +123,86 @@ struct pa_shard_s {
 	 */
 	bool ever_used_hpa;
 
+	/*
+	 * Scratch shards carve all their unguarded extents off the front of
+	 * scratch_reg, a region reserved from the PAC, instead of searching the
+	 * ecaches for each one.  The regions are out of the emap while they are
+	 * carved, and their extents never go back to the PAC one by one:
+	 * freeing one only drops its emap entries, and its memory and edata_t
+	 * stay with the shard.  The edata_t's are bump-allocated too, from
+	 * blocks that are never given back.  Reset clears each region's emap
+	 * range, hands the region back to the PAC whole and rewinds the edata_t
+	 * blocks, without visiting the extents carved from it.  Read-only after
+	 * initialization.
+	 */
+	bool scratch;
+	malloc_mutex_t scratch_mtx;
+	/* Synchronization: scratch_mtx. */
+	edata_t *scratch_reg;
+	/* Bytes carved off the front of scratch_reg so far. */
+	size_t scratch_reg_used;
+	/* Regions carved up before scratch_reg. */
+	edata_list_active_t scratch_regs_full;
+	/* First edata_t block, and the one edata_t's are taken from. */
+	pa_scratch_edata_block_t *scratch_edata_first;
+	pa_scratch_edata_block_t *scratch_edata_cur;
+	/* edata_t's taken from scratch_edata_cur so far. */
+	unsigned scratch_edata_used;
+
+	/*
+	 * Slabs of the size classes with bin_infos[].huge set are carved from
+	 * HUGEPAGE-aligned regions reserved from the PAC and advised for
+	 * transparent huge pages.  Up to PA_HUGE_BINS_NFREE_MAX freed slabs
+	 * per size class are kept on huge_bins_free for the next slab of their
+	 * size class, so that the common case neither purges nor splits up
+	 * the regions; the rest go back to the PAC, and its decay, like any
+	 * other extent.  huge_bins is read-only after initialization.
+	 */
+	bool huge_bins;
+	malloc_mutex_t huge_bins_mtx;
+	/* Synchronization: huge_bins_mtx. */
+	edata_t *huge_bins_reg;
+	edata_list_active_t huge_bins_free[SC_NBINS];
+	unsigned huge_bins_nfree[SC_NBINS];
+	size_t huge_bins_dirty_bytes;
+
+	/*
+	 * Zeroed large allocations of up to PA_ZERO_POOL_NPAGES_MAX pages are
+	 * served from zero_pool_free, indexed by page count, when possible.
+	 * The background thread refills each list with extents it has already
+	 * zeroed (and thereby faulted in), sized after the misses counted in
+	 * zero_pool_demand since its last pass.  zero_pool is read-only after
+	 * initialization.
+	 */
+	bool zero_pool;
+	malloc_mutex_t zero_pool_mtx;
+	/* Synchronization: zero_pool_mtx. */
+	edata_list_active_t zero_pool_free[PA_ZERO_POOL_NPAGES_MAX];
+	uint32_t zero_pool_demand[PA_ZERO_POOL_NPAGES_MAX];
+	size_t zero_pool_bytes;
+	uint64_t zero_pool_nhits;
+	uint64_t zero_pool_nmisses;
+
+	/*
+	 * With bin regions (see bin_regions.h), slabs are carved from the
+	 * region of their size class.  A freed slab is kept on
+	 * bin_regions_free, since region memory must not be handed to the PAC
+	 * for other uses.  There is one list per size class and slab size (see
+	 * opt.slab_size_auto), indexed by the slab's lg scale over the size
+	 * class's default slab size.  The first bin_regions_ndirty slabs of a
+	 * list are still dirty; slabs freed beyond PA_BIN_REGIONS_NDIRTY_MAX of
+	 * those are purged and appended instead.  bin_regions is read-only
+	 * after initialization.
+	 */
+	bool bin_regions;
+	malloc_mutex_t bin_regions_mtx;
+	/* Synchronization: bin_regions_mtx. */
+	edata_list_active_t
+	    bin_regions_free[SC_NBINS][BIN_SLAB_LG_SCALE_MAX + 1];
+	unsigned bin_regions_ndirty[SC_NBINS][BIN_SLAB_LG_SCALE_MAX + 1];
+	size_t bin_regions_bytes;
+	size_t bin_regions_dirty_bytes;
+
 	/* Allocates from a PAC. */
 	pac_t pac;
 
@@ -145,6 +257,17 @@ bool pa_shard_enable_hpa(tsdn_t *tsdn, pa_shard_t *shard,
  */
 void pa_shard_disable_hpa(tsdn_t *tsdn, pa_shard_t *shard);
 
+/* Turns the shard into a scratch shard; must precede any allocation. */
+bool pa_shard_enable_scratch(tsdn_t *tsdn, pa_shard_t *shard);
+/* Serves huge bin slabs from hugepages; must precede any allocation. */
+bool pa_shard_enable_huge_bins(tsdn_t *tsdn, pa_shard_t *shard);
+/* Keeps pre-zeroed large extents around; must precede any allocation. */
+bool pa_shard_enable_zero_pool(tsdn_t *tsdn, pa_shard_t *shard);
+/* Carves slabs from the bin regions; must precede any allocation. */
+bool pa_shard_enable_bin_regions(tsdn_t *tsdn, pa_shard_t *shard);
+/* Prepares zeroed extents for the sizes that missed in the zero pool. */
+void pa_shard_zero_pool_fill(tsdn_t *tsdn, pa_shard_t *shard);
+
 /*
  * This does the PA-specific parts of arena reset (i.e. freeing all active
  * allocations).
@@ -192,7 +315,8 @@ ssize_t pa_decay_ms_get(pa_shard_t *shard, extent_state_t state);
  *
  * Morally, this should do both PAC decay and the HPA deferred work.  For now,
  * though, the arena, background thread, and PAC modules are tightly interwoven
- * in a way that's tricky to extricate, so we only do the HPA-specific parts.
+ * in a way that's tricky to extricate, so we only do the HPA-specific parts
+ * (and refill the zero pool).
  */
 void pa_shard_set_deferral_allowed(
     tsdn_t *tsdn, pa_shard_t *shard, bool deferral_allowed);
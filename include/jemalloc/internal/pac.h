@@ -19,6 +19,14 @@
  * - Can use efficient OS-level zeroing primitives for demand-filled pages.
  */
 
+/* Maximum number of extents advised cold per demotion scan. */
+#define PAC_COLD_BATCH 64
+/* Maximum number of extents a demotion scan looks at under the lock. */
+#define PAC_COLD_SCAN_MAX 256
+
+extern ssize_t opt_cold_age_ms;
+extern bool    opt_cold_pageout;
+
 /* How "eager" decay/purging should be. */
 enum pac_purge_eagerness_e {
 	PAC_PURGE_ALWAYS,
@@ -84,6 +92,9 @@ struct pac_stats_s {
 
 	/* VM space had to be leaked (undocumented).  Normally 0. */
 	atomic_zu_t abandoned_vm;
+
+	/* Number of unused dirty bytes advised cold (cumulative). */
+	atomic_zu_t cold_demoted;
 };
 
 typedef struct pac_s pac_t;
@@ -129,6 +140,24 @@ struct pac_s {
 
 	/* Extent serial number generator state. */
 	atomic_zu_t extent_sn_next;
+
+	/*
+	 * Cumulative number of pages allocated, maintained only with
+	 * opt_dirty_decay_predictive.
+	 */
+	atomic_zu_t nalloc_pages;
+
+	/*
+	 * Start time of the last cold demotion sweep over ecache_dirty, if
+	 * cold_scanned.  A sweep takes as many scans as it needs to get
+	 * through the LRU; cold_sweeping is set while one is underway.
+	 *
+	 * Synchronization: ecache_dirty.mtx; cold_sweeping is also read
+	 * without it.
+	 */
+	bool       cold_scanned;
+	nstime_t   cold_scan_time;
+	atomic_b_t cold_sweeping;
 };
 
 typedef struct pac_thp_s pac_thp_t;
@@ -171,6 +200,11 @@ bool pac_shrink(tsdn_t *tsdn, pac_t *pac, edata_t *edata, size_t old_size,
 void pac_dalloc(tsdn_t *tsdn, pac_t *pac, edata_t *edata,
     bool *deferred_work_generated);
 uint64_t pac_time_until_deferred_work(tsdn_t *tsdn, pac_t *pac);
+/*
+ * Advises unused dirty extents that have been idle for opt_cold_age_ms cold.
+ * Called by background threads.
+ */
+void pac_cold_demote(tsdn_t *tsdn, pac_t *pac);
 
 static inline size_t
 pac_mapped(const pac_t *pac) {
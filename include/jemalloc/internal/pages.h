@@ -129,10 +129,16 @@ bool  pages_commit(void *addr, size_t size);
 bool  pages_decommit(void *addr, size_t size);
 bool  pages_purge_lazy(void *addr, size_t size);
 bool  pages_purge_forced(void *addr, size_t size);
+bool  pages_purge_forced_zeroes(void);
 bool pages_purge_process_madvise(void *vec, size_t ven_len, size_t total_bytes);
 bool pages_huge(void *addr, size_t size);
 bool pages_nohuge(void *addr, size_t size);
 bool pages_collapse(void *addr, size_t size);
+bool pages_cold(void *addr, size_t size, bool pageout);
+bool pages_remap(void *old_addr, void *new_addr, size_t size);
+void pages_remap_trim(void *addr, size_t size);
+void pages_remap_release(void *addr, size_t size);
+size_t pages_remap_nmaps_avail_get(void);
 bool pages_dontdump(void *addr, size_t size);
 bool pages_dodump(void *addr, size_t size);
 bool pages_boot(void);
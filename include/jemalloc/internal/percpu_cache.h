@@ -0,0 +1,82 @@
+#ifndef JEMALLOC_INTERNAL_PERCPU_CACHE_H
+#define JEMALLOC_INTERNAL_PERCPU_CACHE_H
+
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/base.h"
+#include "jemalloc/internal/cache_bin.h"
+#include "jemalloc/internal/sc.h"
+
+/*
+ * Per-CPU caches sit between the thread caches and the arena bins.  A tcache
+ * refill takes objects from the cache of the CPU the thread is running on
+ * before going to the bins, and a tcache flush leaves objects there before
+ * returning them to their slabs.  All threads running on a CPU share one set of
+ * stacks, sized like the small bins of a default thread cache, so the thread
+ * caches themselves are shrunk to PERCPU_CACHE_TCACHE_NCACHED_MAX slots per
+ * small size class in this mode.
+ *
+ * Where the C library registers an rseq area and membarrier(2) can restart
+ * rseq critical sections, the stacks are pushed and popped inside restartable
+ * sequences, without locks or atomic read-modify-write instructions.  Anyone
+ * else touching a CPU's stacks (GC passes, flushes) first marks them stopped,
+ * which makes the critical sections back off to the bins, and then fences any
+ * section already past that check with membarrier(2).  Without rseq, each
+ * per-CPU cache is protected by a mutex instead.
+ *
+ * Cached objects are aged out by percpu_cache_gc(), run from tcache GC events
+ * and by the background thread: every pass returns 3/4 of what went unused in
+ * each stack since the previous pass, as tcache GC does.  A decay of all pages
+ * (arena.<i>.purge and friends) flushes the per-CPU caches altogether.
+ *
+ * Only objects from automatic arenas are ever cached, so that arena.<i>.reset
+ * and friends on manual arenas need not know about this layer.
+ */
+
+/* Thread cache slots per small size class when per-CPU caches are enabled. */
+#define PERCPU_CACHE_TCACHE_NCACHED_MAX 16
+
+/* Minimum time between two GC passes over the per-CPU caches. */
+#define PERCPU_CACHE_GC_INTERVAL_NS ((uint64_t)100 * KQU(1000000))
+
+extern bool opt_percpu_cache;
+
+/* Set at boot; the per-CPU caches are never torn down afterwards. */
+extern bool percpu_cache_enabled_do_not_access_directly;
+
+static inline bool
+percpu_cache_enabled(void) {
+	return percpu_cache_enabled_do_not_access_directly;
+}
+
+/* Resets opt_percpu_cache where CPUs cannot be told apart. */
+void percpu_cache_boot0(void);
+/* Records the stack sizes, i.e. the default thread cache sizes. */
+void percpu_cache_ncached_max_init(const cache_bin_info_t *infos);
+bool percpu_cache_boot1(tsdn_t *tsdn, base_t *base);
+
+/*
+ * Takes up to nmax objects of size class binind from the current CPU's cache.
+ * nrequests is the caller's pending request count, which gets accounted to the
+ * per-CPU cache (and eventually merged into the bins) in place of the bin the
+ * objects would otherwise have come from.
+ */
+cache_bin_sz_t percpu_cache_fill(tsdn_t *tsdn, szind_t binind, void **ptrs,
+    cache_bin_sz_t nmax, uint64_t nrequests);
+/*
+ * Stores a prefix of the n objects of size class binind in the current CPU's
+ * cache, as far as it has room.  Returns the length of that prefix.
+ */
+cache_bin_sz_t percpu_cache_dalloc(
+    tsdn_t *tsdn, szind_t binind, void **ptrs, cache_bin_sz_t n);
+/* Ages out unused objects, at most once per PERCPU_CACHE_GC_INTERVAL_NS. */
+void percpu_cache_gc(tsd_t *tsd);
+/* Returns every cached object to its arena. */
+void percpu_cache_flush_all(tsd_t *tsd);
+/* Bytes currently cached across all CPUs. */
+size_t percpu_cache_bytes_get(tsdn_t *tsdn);
+
+void percpu_cache_prefork(tsdn_t *tsdn);
+void percpu_cache_postfork_parent(tsdn_t *tsdn);
+void percpu_cache_postfork_child(tsdn_t *tsdn);
+
+#endif /* JEMALLOC_INTERNAL_PERCPU_CACHE_H */
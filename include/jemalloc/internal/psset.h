@@ -86,9 +86,9 @@ typedef struct psset_s psset_t;
 struct psset_s {
 	/*
 	 * The pageslabs, quantized by the size class of the largest contiguous
-	 * free run of pages in a pageslab.
+	 * free run of pages in a pageslab, and ordered by age within a bin.
 	 */
-	hpdata_age_heap_t pageslabs[PSSET_NPSIZES];
+	hpdata_age_tree_t pageslabs[PSSET_NPSIZES];
 	/* Bitmap for which set bits correspond to non-empty heaps. */
 	fb_group_t    pageslab_bitmap[FB_NGROUPS(PSSET_NPSIZES)];
 	psset_stats_t stats;
@@ -105,11 +105,19 @@ struct psset_s {
 	hpdata_purge_list_t to_purge[PSSET_NPURGE_LISTS];
 	/* Bitmap for which set bits correspond to non-empty purge lists. */
 	fb_group_t purge_bitmap[FB_NGROUPS(PSSET_NPURGE_LISTS)];
+	/*
+	 * The same slabs, least recently active first (see
+	 * hpdata_last_active_get), if purge_lru_enabled.
+	 */
+	bool              purge_lru_enabled;
+	hpdata_lru_tree_t purge_lru;
 	/* Slabs which are available to be hugified. */
 	hpdata_hugify_list_t to_hugify;
 };
 
 void psset_init(psset_t *psset);
+/* Makes the psset order slabs for psset_pick_purge_lru; precedes inserts. */
+void psset_purge_lru_enable(psset_t *psset);
 void psset_stats_accum(psset_stats_t *dst, psset_stats_t *src);
 
 /*
@@ -126,9 +134,16 @@ hpdata_t *psset_pick_alloc(psset_t *psset, size_t size);
  * is NULL then time is not considered.
  */
 hpdata_t *psset_pick_purge(psset_t *psset, const nstime_t *now);
+/*
+ * The same, but picking the least recently active slab, regardless of how
+ * dirty it is.
+ */
+hpdata_t *psset_pick_purge_lru(psset_t *psset, const nstime_t *now);
 
 /* Pick one to hugify. */
 hpdata_t *psset_pick_hugify(psset_t *psset);
+/* The hugification candidate after ps, in the order they became eligible. */
+hpdata_t *psset_next_hugify(psset_t *psset, hpdata_t *ps);
 
 void psset_insert(psset_t *psset, hpdata_t *ps);
 void psset_remove(psset_t *psset, hpdata_t *ps);
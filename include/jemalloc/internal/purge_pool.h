@@ -0,0 +1,53 @@
+#ifndef JEMALLOC_INTERNAL_PURGE_POOL_H
+#define JEMALLOC_INTERNAL_PURGE_POOL_H
+
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/hpa_utils.h"
+#include "jemalloc/internal/tsd_types.h"
+
+/*
+ * A pool of worker threads that carries out HPA purges on behalf of all
+ * shards.  hpa_purge still picks the hugepages to purge under the shard lock,
+ * but rather than dropping the lock and making the madvise calls itself, it
+ * queues the batch here and moves on; a worker purges the batch and then does
+ * the shard bookkeeping.  Queued hugepages stay unavailable for allocation, as
+ * they would during an inline purge.  When the queue is full (or the pool is
+ * not running) callers purge inline as before.
+ *
+ * opt_purge_budget bounds the bytes the workers purge together per tick of
+ * PURGE_POOL_TICK_NS, to keep them from saturating the kernel's mmap lock.
+ */
+
+#define PURGE_POOL_NTHREADS_MAX 16
+#define PURGE_POOL_NJOBS 32
+#define PURGE_POOL_TICK_NS (10 * 1000 * 1000)
+
+extern unsigned opt_purge_threads;
+extern size_t   opt_purge_budget;
+
+/* Starts the workers; called once the allocator is initialized. */
+bool purge_pool_boot(tsd_t *tsd);
+
+/*
+ * Hands a batch of hugepages prepared by hpa_purge over to the workers.
+ * Returns true if the pool could not take it, in which case the caller purges
+ * it inline.
+ */
+bool purge_pool_submit(tsdn_t *tsdn, hpa_shard_t *shard,
+    hpa_purge_item_t *items, size_t nitems, size_t ndirty);
+
+/*
+ * Completes every batch of the shard that is queued or being purged; must be
+ * called without the shard lock held before the shard goes away.
+ */
+void purge_pool_drain(tsdn_t *tsdn, hpa_shard_t *shard);
+
+/* Number of batches purged by the workers so far. */
+uint64_t purge_pool_njobs_get(void);
+
+void purge_pool_prefork0(tsdn_t *tsdn);
+void purge_pool_prefork1(tsdn_t *tsdn);
+void purge_pool_postfork_parent(tsdn_t *tsdn);
+void purge_pool_postfork_child(tsdn_t *tsdn);
+
+#endif /* JEMALLOC_INTERNAL_PURGE_POOL_H */
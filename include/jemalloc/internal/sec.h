@@ -30,6 +30,8 @@ struct sec_bin_stats_s {
 	size_t ndalloc_noflush;
 	/* Number of fills that hit max_bytes */
 	size_t noverfills;
+	/* Number of times the bin mutex was found held when locking it */
+	size_t nlock_contended;
 };
 typedef struct sec_stats_s sec_stats_t;
 struct sec_stats_s {
@@ -38,6 +40,9 @@ struct sec_stats_s {
 
 	/* Totals of bin_stats. */
 	sec_bin_stats_t total;
+
+	/* Per-shard totals of bin_stats; only the first nshards are used. */
+	sec_bin_stats_t shards[SEC_NSHARDS_MAX];
 };
 
 static inline void
@@ -47,6 +52,7 @@ sec_bin_stats_init(sec_bin_stats_t *stats) {
 	stats->nhits = 0;
 	stats->ndalloc_noflush = 0;
 	stats->noverfills = 0;
+	stats->nlock_contended = 0;
 }
 
 static inline void
@@ -56,12 +62,16 @@ sec_bin_stats_accum(sec_bin_stats_t *dst, sec_bin_stats_t *src) {
 	dst->ndalloc_flush += src->ndalloc_flush;
 	dst->ndalloc_noflush += src->ndalloc_noflush;
 	dst->noverfills += src->noverfills;
+	dst->nlock_contended += src->nlock_contended;
 }
 
 static inline void
 sec_stats_accum(sec_stats_t *dst, sec_stats_t *src) {
 	dst->bytes += src->bytes;
 	sec_bin_stats_accum(&dst->total, &src->total);
+	for (unsigned i = 0; i < SEC_NSHARDS_MAX; i++) {
+		sec_bin_stats_accum(&dst->shards[i], &src->shards[i]);
+	}
 }
 
 /* A collections of free extents, all of the same size. */
@@ -78,6 +88,22 @@ struct sec_bin_s {
 	size_t              bytes_cur;
 	edata_list_active_t freelist;
 	sec_bin_stats_t     stats;
+
+	/*
+	 * Exceeding this many cached bytes causes us to flush; opts.max_bytes
+	 * unless the sec is adaptive.
+	 */
+	size_t bytes_max;
+
+	/*
+	 * Adaptive mode only: what the bin observed since the start of its
+	 * current epoch.  bytes_lowwater is the least bytes_cur got, i.e. the
+	 * cached bytes nobody needed.
+	 */
+	size_t   bytes_lowwater;
+	uint32_t epoch_nops;
+	uint32_t epoch_nmisses;
+	uint32_t epoch_nflushes;
 };
 
 typedef struct sec_s sec_t;
@@ -85,6 +111,8 @@ struct sec_s {
 	sec_opts_t opts;
 	sec_bin_t *bins;
 	pszind_t   npsizes;
+	/* Adaptive mode only: the part of the byte budget no bin holds. */
+	atomic_zu_t bytes_unassigned;
 };
 
 static inline bool
@@ -106,6 +134,9 @@ sec_size_supported(sec_t *sec, size_t size) {
 /* Attempt to fill the SEC up to max_bytes / SEC_MAX_BYTES_DIV */
 #define SEC_MAX_BYTES_DIV 4
 
+/* Number of allocs and dallocs after which an adaptive bin is resized. */
+#define SEC_ADAPT_EPOCH_NOPS 256
+
 /*
  * Calculate the min and max number of extents we will try to allocate
  * when expanding the SEC. We will attempt to allocate at least min
@@ -13,8 +13,8 @@ struct sec_opts_s {
 	/*
 	 * We don't necessarily always use all the shards; requests are
 	 * distributed across shards [0, nshards - 1).  Once thread picks a
-	 * shard it will always use that one.  If this value is set to 0 sec is
-	 * not used.
+	 * shard it will always use that one, unless percpu is set.  If this
+	 * value is set to 0 sec is not used.
 	 */
 	size_t nshards;
 	/*
@@ -27,8 +27,25 @@ struct sec_opts_s {
 	 * until we are 1/4 below max_bytes.
 	 */
 	size_t max_bytes;
+	/*
+	 * Index shards by the CPU the caller is running on rather than by
+	 * thread.  nshards is then sized to the number of CPUs (capped at
+	 * SEC_NSHARDS_MAX) when the sec is initialized.  Ignored on platforms
+	 * without sched_getcpu(), where the per-thread assignment is kept.
+	 */
+	bool percpu;
+	/*
+	 * Size each bin from its own traffic instead of capping all of them at
+	 * max_bytes.  The sec then holds a budget of max_bytes per bin, which
+	 * bins that keep cached extents unused give back and bins that flush
+	 * extents they later miss on take from.
+	 */
+	bool adaptive;
 };
 
+/* Shards are indexed by a uint8_t, and per-shard stats are kept up to this. */
+#define SEC_NSHARDS_MAX 64
+
 #define SEC_OPTS_NSHARDS_DEFAULT 2
 #define SEC_OPTS_MAX_ALLOC_DEFAULT ((32 * 1024) < PAGE ? PAGE : (32 * 1024))
 #define SEC_OPTS_MAX_BYTES_DEFAULT                                             \
@@ -38,6 +55,6 @@ struct sec_opts_s {
 
 #define SEC_OPTS_DEFAULT                                                       \
 	{SEC_OPTS_NSHARDS_DEFAULT, SEC_OPTS_MAX_ALLOC_DEFAULT,                 \
-	    SEC_OPTS_MAX_BYTES_DEFAULT}
+	    SEC_OPTS_MAX_BYTES_DEFAULT, false, false}
 
 #endif /* JEMALLOC_INTERNAL_SEC_OPTS_H */
@@ -19,6 +19,9 @@ extern size_t   opt_tcache_gc_incr_bytes;
 extern size_t   opt_tcache_gc_delay_bytes;
 extern unsigned opt_lg_tcache_flush_small_div;
 extern unsigned opt_lg_tcache_flush_large_div;
+extern bool     opt_tcache_adaptive;
+extern size_t   opt_tcache_adaptive_budget;
+extern size_t   opt_tcache_global_budget;
 
 /*
  * Number of tcache bins.  There are SC_NBINS small-object bins, plus 0 or more
@@ -61,10 +64,17 @@ bool tcache_bin_info_default_init(
 bool tcache_bins_ncached_max_write(tsd_t *tsd, char *settings, size_t len);
 bool tcache_bin_ncached_max_read(
     tsd_t *tsd, size_t bin_size, cache_bin_sz_t *ncached_max);
+/* Default ncached_max of bin ind; valid once tcache_boot has run. */
+cache_bin_sz_t tcache_ncached_max_default_get(szind_t ind);
 void tcache_arena_reassociate(
     tsdn_t *tsdn, tcache_slow_t *tcache_slow, arena_t *arena);
 tcache_t *tcache_create_explicit(tsd_t *tsd);
+void      tcache_budget_enforce(tsdn_t *tsdn);
+bool      tcache_reclaim_pending(tsd_t *tsd);
+void      tcache_reclaim(tsd_t *tsd);
 bool      thread_tcache_max_set(tsd_t *tsd, size_t tcache_max);
+void      thread_tcache_adaptive_set(tsd_t *tsd, bool adaptive);
+void      thread_tcache_adaptive_budget_set(tsd_t *tsd, size_t budget);
 void      tcache_cleanup(tsd_t *tsd);
 bool      tcaches_create(tsd_t *tsd, base_t *base, unsigned *r_ind);
 void      tcaches_flush(tsd_t *tsd, unsigned ind);
@@ -179,6 +179,22 @@ tcache_alloc_large(tsd_t *tsd, arena_t *arena, tcache_t *tcache, size_t size,
 	return ret;
 }
 
+/*
+ * Number of items a full small bin keeps when a deallocation overflows it.
+ * Also counts the overflow for the adaptive controller.
+ */
+JEMALLOC_ALWAYS_INLINE unsigned
+tcache_small_overflow_remain(
+    tcache_slow_t *tcache_slow, cache_bin_t *bin, szind_t binind) {
+	if (tcache_slow->adaptive) {
+		if (tcache_slow->bin_noverflows[binind] < UINT8_MAX) {
+			tcache_slow->bin_noverflows[binind]++;
+		}
+		return tcache_slow->bin_flush_remain[binind];
+	}
+	return cache_bin_ncached_max_get(bin) >> opt_lg_tcache_flush_small_div;
+}
+
 JEMALLOC_ALWAYS_INLINE void
 tcache_dalloc_small(
     tsd_t *tsd, tcache_t *tcache, void *ptr, szind_t binind, bool slow_path) {
@@ -206,8 +222,8 @@ tcache_dalloc_small(
 			arena_dalloc_small(tsd_tsdn(tsd), ptr);
 			return;
 		}
-		cache_bin_sz_t max = cache_bin_ncached_max_get(bin);
-		unsigned       remain = max >> opt_lg_tcache_flush_small_div;
+		unsigned remain = tcache_small_overflow_remain(
+		    tcache->tcache_slow, bin, binind);
 		tcache_bin_flush_small(tsd, tcache, bin, binind, remain);
 		bool ret = cache_bin_dalloc_easy(bin, ptr);
 		assert(ret);
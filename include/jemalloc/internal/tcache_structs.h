@@ -2,11 +2,13 @@
 #define JEMALLOC_INTERNAL_TCACHE_STRUCTS_H
 
 #include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/atomic.h"
 #include "jemalloc/internal/cache_bin.h"
 #include "jemalloc/internal/ql.h"
 #include "jemalloc/internal/sc.h"
 #include "jemalloc/internal/tcache_types.h"
 #include "jemalloc/internal/ticker.h"
+#include "jemalloc/internal/tsd_types.h"
 
 /*
  * The tcache state is split into the slow and hot path data.  Each has a
@@ -45,6 +47,40 @@ struct tcache_slow_s {
 	 * actually flushing.
 	 */
 	uint8_t bin_flush_delay_items[SC_NBINS];
+	/*
+	 * Adaptive sizing of small bin fills and full-bin flushes; see
+	 * tcache_adaptive_update().  When enabled, bin_nfill and
+	 * bin_flush_remain take the place of bin_fill_ctl and
+	 * opt_lg_tcache_flush_small_div.
+	 */
+	bool adaptive;
+	/* Upper bound on the sum of bin_nfill[i] * size of class i. */
+	size_t adaptive_budget;
+	/* The current value of that sum. */
+	size_t         adaptive_fill_bytes;
+	cache_bin_sz_t bin_nfill[SC_NBINS];
+	cache_bin_sz_t bin_flush_remain[SC_NBINS];
+	/* Refills and full-bin flushes in the current GC window; saturating. */
+	uint8_t bin_nrefills[SC_NBINS];
+	uint8_t bin_noverflows[SC_NBINS];
+	/*
+	 * Enforcement of opt_tcache_global_budget; see tcache_budget_enforce().
+	 * The background thread sets reclaim_requested and diverts the owner
+	 * to the slow path, where the owner flushes the whole tcache.
+	 * ngc_events is bumped by the owner on every GC event, so that the
+	 * background thread can tell idle tcaches from busy ones.  The
+	 * remaining fields are only accessed by the background thread, with
+	 * the arena's tcache list locked.
+	 */
+	atomic_b_t   reclaim_requested;
+	atomic_u32_t ngc_events;
+	uint32_t     reclaim_ngc_events_seen;
+	bool         reclaim_idle;
+	/*
+	 * The thread whose TSD this tcache is embedded in; NULL for explicit
+	 * tcaches, which have no owner thread to do the flushing.
+	 */
+	tsd_t *owner;
 	/*
 	 * The start of the allocation containing the dynamic allocation for
 	 * either the cache bins alone, or the cache bin memory as well as this
@@ -47,6 +47,7 @@ typedef struct te_ctx_s {
 void te_assert_invariants_debug(tsd_t *tsd);
 void te_event_trigger(tsd_t *tsd, te_ctx_t *ctx);
 void te_recompute_fast_threshold(tsd_t *tsd);
+void te_wakeup(tsd_t *tsd);
 void tsd_te_init(tsd_t *tsd);
 void te_adjust_thresholds_helper(tsd_t *tsd, te_ctx_t *ctx, uint64_t wait);
 
@@ -213,6 +214,11 @@ te_event_advance(tsd_t *tsd, size_t usize, bool is_alloc) {
 	} else {
 		te_event_trigger(tsd, &ctx);
 	}
+	/* Another thread may have zeroed the threshold to get us here. */
+	if (unlikely(te_ctx_next_event_fast_get(&ctx) == 0U)
+	    && opt_tcache_global_budget != 0 && tsd_nominal(tsd)) {
+		te_wakeup(tsd);
+	}
 }
 
 JEMALLOC_ALWAYS_INLINE void
@@ -23,6 +23,10 @@
 	    const list_type##_t *list, el_type *item) {                        \
 		return ql_next(&list->head, item, linkage);                    \
 	}                                                                      \
+	static inline el_type *list_type##_prev(                               \
+	    const list_type##_t *list, el_type *item) {                        \
+		return ql_prev(&list->head, item, linkage);                    \
+	}                                                                      \
 	static inline void list_type##_append(                                 \
 	    list_type##_t *list, el_type *item) {                              \
 		ql_elm_new(item, linkage);                                     \
@@ -33,6 +37,11 @@
 		ql_elm_new(item, linkage);                                     \
 		ql_head_insert(&list->head, item, linkage);                    \
 	}                                                                      \
+	static inline void list_type##_insert_after(                           \
+	    el_type *after, el_type *item) {                                   \
+		ql_elm_new(item, linkage);                                     \
+		ql_after_insert(after, item, linkage);                         \
+	}                                                                      \
 	static inline void list_type##_replace(                                \
 	    list_type##_t *list, el_type *to_remove, el_type *to_insert) {     \
 		ql_elm_new(to_insert, linkage);                                \
@@ -47,10 +47,15 @@ enum witness_rank_e {
 	WITNESS_RANK_CACHE_BIN_ARRAY_DESCRIPTOR_QL,
 
 	WITNESS_RANK_SEC_BIN,
+	WITNESS_RANK_HPA_SHARD_RESV,
 
 	WITNESS_RANK_EXTENT_GROW,
 	WITNESS_RANK_HPA_SHARD_GROW = WITNESS_RANK_EXTENT_GROW,
 	WITNESS_RANK_SAN_BUMP_ALLOC = WITNESS_RANK_EXTENT_GROW,
+	WITNESS_RANK_PA_SCRATCH = WITNESS_RANK_EXTENT_GROW,
+	WITNESS_RANK_PA_HUGE_BINS = WITNESS_RANK_EXTENT_GROW,
+	WITNESS_RANK_PA_ZERO_POOL = WITNESS_RANK_EXTENT_GROW,
+	WITNESS_RANK_PA_BIN_REGIONS = WITNESS_RANK_EXTENT_GROW,
 
 	WITNESS_RANK_EXTENTS,
 	WITNESS_RANK_HPA_SHARD = WITNESS_RANK_EXTENTS,
@@ -78,6 +83,8 @@ enum witness_rank_e {
 	WITNESS_RANK_PROF_STATS = WITNESS_RANK_LEAF,
 	WITNESS_RANK_PROF_THREAD_ACTIVE_INIT = WITNESS_RANK_LEAF,
 	WITNESS_RANK_THREAD_EVENTS_USER = WITNESS_RANK_LEAF,
+	WITNESS_RANK_PERCPU_CACHE = WITNESS_RANK_LEAF,
+	WITNESS_RANK_PURGE_POOL = WITNESS_RANK_LEAF,
 };
 typedef enum witness_rank_e witness_rank_t;
 
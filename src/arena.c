@@ -8,6 +8,7 @@
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/san.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/percpu_cache.h"
 #include "jemalloc/internal/rtree.h"
 #include "jemalloc/internal/safety_check.h"
 #include "jemalloc/internal/util.h"
@@ -27,6 +28,7 @@ percpu_arena_mode_t opt_percpu_arena = PERCPU_ARENA_DEFAULT;
 
 ssize_t opt_dirty_decay_ms = DIRTY_DECAY_MS_DEFAULT;
 ssize_t opt_muzzy_decay_ms = MUZZY_DECAY_MS_DEFAULT;
+bool    opt_dirty_decay_predictive = false;
 
 static atomic_zd_t dirty_decay_ms_default;
 static atomic_zd_t muzzy_decay_ms_default;
@@ -42,6 +44,8 @@ size_t oversize_threshold = OVERSIZE_THRESHOLD_DEFAULT;
 uint32_t        arena_bin_offsets[SC_NBINS];
 static unsigned nbins_total;
 
+bool arena_scratch_enabled_do_not_access_directly = false;
+
 /*
  * a0 is used to handle huge requests before malloc init completes. After
  * that, the huge_arena_ind is updated to point to the actual huge arena,
@@ -56,6 +60,7 @@ pac_thp_t huge_arena_pac_thp = {.thp_madvise = false,
 const arena_config_t arena_config_default = {
     /* .extent_hooks = */ (extent_hooks_t *)&ehooks_default_extent_hooks,
     /* .metadata_use_hooks = */ true,
+    /* .scratch = */ false,
 };
 
 /******************************************************************************/
@@ -158,6 +163,8 @@ arena_stats_merge(tsdn_t *tsdn, arena_t *arena, unsigned *nthreads,
 
 	pa_shard_stats_merge(tsdn, &arena->pa_shard, &astats->pa_shard_stats,
 	    estats, hpastats, &astats->resident);
+	/* Bin region slabs are mapped outside of the PAC. */
+	astats->mapped += astats->pa_shard_stats.bin_regions_bytes;
 
 	LOCKEDINT_MTX_UNLOCK(tsdn, arena->stats.mtx);
 
@@ -389,21 +396,22 @@ arena_extent_alloc_large(
 	szind_t szind = sz_size2index(usize);
 	size_t  esize = usize + sz_large_pad;
 
-	bool guarded = san_large_extent_decide_guard(
-	    tsdn, arena_get_ehooks(arena), esize, alignment);
+	/* Scratch extents are dropped wholesale on reset; see pa_alloc(). */
+	bool guarded = !arena_is_scratch(arena)
+	    && san_large_extent_decide_guard(
+	        tsdn, arena_get_ehooks(arena), esize, alignment);
 
 	/*
-	 * - if usize >= opt_calloc_madvise_threshold,
-	 *     - pa_alloc(..., zero_override = zero, ...)
-	 * - otherwise,
-	 *     - pa_alloc(..., zero_override = false, ...)
-	 *     - use memset() to zero out memory if zero == true.
+	 * The page allocators know which pages are already zero, and only zero
+	 * the rest (choosing between memset() and madvise() by
+	 * opt_calloc_madvise_threshold).
 	 */
-	bool zero_override = zero && (usize >= opt_calloc_madvise_threshold);
 	edata_t *edata = pa_alloc(tsdn, &arena->pa_shard, esize, alignment,
-	    /* slab */ false, szind, zero_override, guarded,
-	    &deferred_work_generated);
+	    /* slab */ false, szind, zero, guarded, &deferred_work_generated);
 
+	if (deferred_work_generated) {
+		arena_handle_deferred_work(tsdn, arena);
+	}
 	if (edata == NULL) {
 		return NULL;
 	}
@@ -414,17 +422,6 @@ arena_extent_alloc_large(
 	if (sz_large_pad != 0) {
 		arena_cache_oblivious_randomize(tsdn, arena, edata, alignment);
 	}
-	/*
-	 * This branch should be put after the randomization so that the addr
-	 * returned by edata_addr_get() has already be randomized,
-	 * if cache_oblivious is enabled.
-	 */
-	if (zero && !zero_override && !edata_zeroed_get(edata)) {
-		void  *addr = edata_addr_get(edata);
-		size_t usize = edata_usize_get(edata);
-		memset(addr, 0, usize);
-	}
-
 	return edata;
 }
 
@@ -549,6 +546,10 @@ arena_decay(tsdn_t *tsdn, arena_t *arena, bool is_background_thread, bool all) {
 		 * as possible", including flushing any caches (for situations
 		 * like thread death, or manual purge calls).
 		 */
+		if (percpu_cache_enabled() && !tsdn_null(tsdn)
+		    && arena_is_auto(arena)) {
+			percpu_cache_flush_all(tsdn_tsd(tsdn));
+		}
 		pa_shard_flush(tsdn, &arena->pa_shard);
 	}
 	if (arena_decay_dirty(tsdn, arena, is_background_thread, all)) {
@@ -642,12 +643,30 @@ arena_slab_dalloc(tsdn_t *tsdn, arena_t *arena, edata_t *slab) {
 	}
 }
 
+/* Deallocates slabs emptied by bin_remote_free_drain_locked(). */
+static void
+arena_slab_dalloc_list(tsdn_t *tsdn, edata_list_active_t *slabs) {
+	edata_t *slab;
+	while ((slab = edata_list_active_first(slabs)) != NULL) {
+		edata_list_active_remove(slabs, slab);
+		arena_slab_dalloc(tsdn, arena_get_from_edata(slab), slab);
+	}
+}
+
 static void
 arena_bin_reset(tsd_t *tsd, arena_t *arena, bin_t *bin) {
 	edata_t *slab;
 
 	malloc_mutex_lock(tsd_tsdn(tsd), &bin->lock);
+	/* Every slab is about to go away; pending remote frees with them. */
+	bin_remote_free_discard_locked(tsd_tsdn(tsd), bin);
 
+	if (arena_is_scratch(arena)) {
+		/* The slabs go back with the regions they were carved from. */
+		bin->slabcur = NULL;
+		edata_heap_new(&bin->slabs_nonfull);
+		edata_list_active_init(&bin->slabs_full);
+	}
 	if (bin->slabcur != NULL) {
 		slab = bin->slabcur;
 		bin->slabcur = NULL;
@@ -670,10 +689,39 @@ arena_bin_reset(tsd_t *tsd, arena_t *arena, bin_t *bin) {
 	if (config_stats) {
 		bin->stats.curregs = 0;
 		bin->stats.curslabs = 0;
+		bin->stats.curslabs_huge = 0;
+		bin->stats.curslabs_nregs = 0;
+		bin->stats.nonfull_slabs = 0;
 	}
 	malloc_mutex_unlock(tsd_tsdn(tsd), &bin->lock);
 }
 
+/*
+ * Accounts for the deallocation of every large extent of the arena at once,
+ * as if each had gone through arena_extent_dalloc_large_prep().
+ */
+static void
+arena_large_reset_stats(tsdn_t *tsdn, arena_t *arena) {
+	cassert(config_stats);
+
+	LOCKEDINT_MTX_LOCK(tsdn, arena->stats.mtx);
+	for (szind_t i = 0; i < SC_NSIZES - SC_NBINS; i++) {
+		arena_stats_large_t *lstats = &arena->stats.lstats[i];
+		uint64_t nmalloc = locked_read_u64(
+		    tsdn, LOCKEDINT_MTX(arena->stats.mtx), &lstats->nmalloc);
+		uint64_t ndalloc = locked_read_u64(
+		    tsdn, LOCKEDINT_MTX(arena->stats.mtx), &lstats->ndalloc);
+		assert(nmalloc >= ndalloc);
+		locked_inc_u64(tsdn, LOCKEDINT_MTX(arena->stats.mtx),
+		    &lstats->ndalloc, nmalloc - ndalloc);
+		uint64_t active_bytes = locked_read_u64(tsdn,
+		    LOCKEDINT_MTX(arena->stats.mtx), &lstats->active_bytes);
+		locked_dec_u64(tsdn, LOCKEDINT_MTX(arena->stats.mtx),
+		    &lstats->active_bytes, active_bytes);
+	}
+	LOCKEDINT_MTX_UNLOCK(tsdn, arena->stats.mtx);
+}
+
 void
 arena_prof_promote(tsdn_t *tsdn, void *ptr, size_t usize, size_t bumped_usize) {
 	cassert(config_prof);
@@ -730,7 +778,8 @@ arena_dalloc_promoted_impl(
 	}
 	szind_t bumped_ind = sz_size2index(bumped_usize);
 	if (bumped_usize >= SC_LARGE_MINCLASS && tcache != NULL
-	    && tcache_can_cache_large(tcache, bumped_ind)) {
+	    && tcache_can_cache_large(tcache, bumped_ind)
+	    && !arena_is_scratch(arena_get_from_edata(edata))) {
 		tcache_dalloc_large(
 		    tsdn_tsd(tsdn), tcache, ptr, bumped_ind, slow_path);
 	} else {
@@ -764,6 +813,16 @@ arena_reset(tsd_t *tsd, arena_t *arena) {
 	/* Large allocations. */
 	malloc_mutex_lock(tsd_tsdn(tsd), &arena->large_mtx);
 
+	/*
+	 * Scratch extents go back with their regions, so only their list and
+	 * stats need dropping; sampled ones still need prof_free() each.
+	 */
+	if (arena_is_scratch(arena) && !(config_prof && opt_prof)) {
+		edata_list_active_init(&arena->large);
+		if (config_stats) {
+			arena_large_reset_stats(tsd_tsdn(tsd), arena);
+		}
+	}
 	for (edata_t *edata = edata_list_active_first(&arena->large);
 	    edata != NULL; edata = edata_list_active_first(&arena->large)) {
 		void  *ptr = edata_base_get(edata);
@@ -799,6 +858,11 @@ arena_reset(tsd_t *tsd, arena_t *arena) {
 			arena_bin_reset(tsd, arena, arena_get_bin(arena, i, j));
 		}
 	}
+	/*
+	 * In scratch arenas, nothing above visits individual extents (unless
+	 * profiling); their memory, emap entries and edata_t's go back below, a
+	 * whole region at a time.
+	 */
 	pa_shard_reset(tsd_tsdn(tsd), &arena->pa_shard);
 }
 
@@ -930,9 +994,12 @@ arena_slab_alloc(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	witness_assert_depth_to_rank(
 	    tsdn_witness_tsdp_get(tsdn), WITNESS_RANK_CORE, 0);
 
-	bool guarded = san_slab_extent_decide_guard(
-	    tsdn, arena_get_ehooks(arena));
-	edata_t *slab = pa_alloc(tsdn, &arena->pa_shard, bin_info->slab_size,
+	bool guarded = !arena_is_scratch(arena)
+	    && san_slab_extent_decide_guard(tsdn, arena_get_ehooks(arena));
+	unsigned lg_scale = bin_slab_lg_scale_get(
+	    arena_get_bin(arena, binind, binshard));
+	edata_t *slab = pa_alloc(tsdn, &arena->pa_shard,
+	    bin_info->slab_size << lg_scale,
 	    /* alignment */ PAGE, /* slab */ true, /* szind */ binind,
 	    /* zero */ false, guarded, &deferred_work_generated);
 
@@ -947,8 +1014,10 @@ arena_slab_alloc(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 
 	/* Initialize slab internals. */
 	slab_data_t *slab_data = edata_slab_data_get(slab);
-	edata_nfree_binshard_set(slab, bin_info->nregs, binshard);
-	bitmap_init(slab_data->bitmap, &bin_info->bitmap_info, false);
+	edata_slab_lg_scale_set(slab, lg_scale);
+	edata_nfree_binshard_set(slab, bin_slab_nregs(bin_info, slab), binshard);
+	bitmap_init(slab_data->bitmap, bin_slab_bitmap_info(bin_info, slab),
+	    false);
 
 	return slab;
 }
@@ -991,11 +1060,30 @@ arena_ptr_array_fill_small(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	bool           alloc_and_retry = false;
 	bool           is_auto = arena_is_auto(arena);
 	cache_bin_sz_t filled = 0;
+	/*
+	 * Objects taken from the per-CPU cache were never returned to their
+	 * bins, so they must not be counted again in the bin stats below.
+	 */
+	cache_bin_sz_t percpu_filled = 0;
+	if (is_auto && percpu_cache_enabled()) {
+		percpu_filled = percpu_cache_fill(tsdn, binind, arr->ptr,
+		    nfill_max, merge_stats.nrequests);
+		filled = percpu_filled;
+		if (filled >= nfill_min) {
+			return filled;
+		}
+		if (filled > 0) {
+			merge_stats.nrequests = 0;
+		}
+	}
 	unsigned       binshard;
 	bin_t         *bin = bin_choose(tsdn, arena, binind, &binshard);
+	edata_list_active_t empty_slabs;
+	edata_list_active_init(&empty_slabs);
 
 label_refill:
 	malloc_mutex_lock(tsdn, &bin->lock);
+	bin_remote_free_drain_locked(tsdn, is_auto, bin, binind, &empty_slabs);
 
 	while (filled < nfill_min) {
 		/* Try batch-fill from slabcur first. */
@@ -1049,9 +1137,9 @@ label_refill:
 	} /* while (filled < nfill_min) loop. */
 
 	if (config_stats && !alloc_and_retry) {
-		bin->stats.nmalloc += filled;
+		bin->stats.nmalloc += filled - percpu_filled;
 		bin->stats.nrequests += merge_stats.nrequests;
-		bin->stats.curregs += filled;
+		bin->stats.curregs += filled - percpu_filled;
 		bin->stats.nfills++;
 	}
 
@@ -1075,10 +1163,12 @@ label_refill:
 
 	/* Release if allocated but not used. */
 	if (fresh_slab != NULL) {
-		assert(edata_nfree_get(fresh_slab) == bin_info->nregs);
+		assert(edata_nfree_get(fresh_slab)
+		    == bin_slab_nregs(bin_info, fresh_slab));
 		arena_slab_dalloc(tsdn, arena, fresh_slab);
 		fresh_slab = NULL;
 	}
+	arena_slab_dalloc_list(tsdn, &empty_slabs);
 
 	arena_decay_tick(tsdn, arena);
 	return filled;
@@ -1089,15 +1179,15 @@ arena_fill_small_fresh(tsdn_t *tsdn, arena_t *arena, szind_t binind,
     void **ptrs, size_t nfill, bool zero) {
 	assert(binind < SC_NBINS);
 	const bin_info_t *bin_info = &bin_infos[binind];
-	const size_t      nregs = bin_info->nregs;
-	assert(nregs > 0);
-	const size_t usize = bin_info->reg_size;
+	const size_t      usize = bin_info->reg_size;
 
 	const bool manual_arena = !arena_is_auto(arena);
 	unsigned   binshard;
 	bin_t     *bin = bin_choose(tsdn, arena, binind, &binshard);
 
 	size_t              nslab = 0;
+	size_t              nslab_huge = 0;
+	size_t              nslab_regs = 0;
 	size_t              filled = 0;
 	edata_t            *slab = NULL;
 	edata_list_active_t fulls;
@@ -1107,8 +1197,13 @@ arena_fill_small_fresh(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	    && (slab = arena_slab_alloc(
 	            tsdn, arena, binind, binshard, bin_info))
 	        != NULL) {
+		size_t nregs = bin_slab_nregs(bin_info, slab);
 		assert((size_t)edata_nfree_get(slab) == nregs);
 		++nslab;
+		nslab_regs += nregs;
+		if (edata_huge_bin_get(slab)) {
+			++nslab_huge;
+		}
 		size_t batch = nfill - filled;
 		if (batch > nregs) {
 			batch = nregs;
@@ -1144,9 +1239,12 @@ arena_fill_small_fresh(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	if (config_stats) {
 		bin->stats.nslabs += nslab;
 		bin->stats.curslabs += nslab;
+		bin->stats.curslabs_huge += nslab_huge;
+		bin->stats.curslabs_nregs += nslab_regs;
 		bin->stats.nmalloc += filled;
 		bin->stats.nrequests += filled;
 		bin->stats.curregs += filled;
+		bin_slab_size_tune(tsdn, bin, binind, (unsigned)nslab, 0);
 	}
 	malloc_mutex_unlock(tsdn, &bin->lock);
 
@@ -1162,8 +1260,11 @@ arena_malloc_small(tsdn_t *tsdn, arena_t *arena, szind_t binind, bool zero) {
 	bool              is_auto = arena_is_auto(arena);
 	unsigned          binshard;
 	bin_t *bin = bin_choose(tsdn, arena, binind, &binshard);
+	edata_list_active_t empty_slabs;
+	edata_list_active_init(&empty_slabs);
 
 	malloc_mutex_lock(tsdn, &bin->lock);
+	bin_remote_free_drain_locked(tsdn, is_auto, bin, binind, &empty_slabs);
 	edata_t *fresh_slab = NULL;
 	void    *ret = bin_malloc_no_fresh_slab(tsdn, is_auto, bin, binind);
 	if (ret == NULL) {
@@ -1179,6 +1280,7 @@ arena_malloc_small(tsdn_t *tsdn, arena_t *arena, szind_t binind, bool zero) {
 			if (fresh_slab == NULL) {
 				/* OOM */
 				malloc_mutex_unlock(tsdn, &bin->lock);
+				arena_slab_dalloc_list(tsdn, &empty_slabs);
 				return NULL;
 			}
 			ret = bin_malloc_with_fresh_slab(
@@ -1196,6 +1298,7 @@ arena_malloc_small(tsdn_t *tsdn, arena_t *arena, szind_t binind, bool zero) {
 	if (fresh_slab != NULL) {
 		arena_slab_dalloc(tsdn, arena, fresh_slab);
 	}
+	arena_slab_dalloc_list(tsdn, &empty_slabs);
 	if (zero) {
 		memset(ret, 0, usize);
 	}
@@ -1257,23 +1360,33 @@ arena_dalloc_bin(tsdn_t *tsdn, arena_t *arena, edata_t *edata, void *ptr) {
 	unsigned binshard = edata_binshard_get(edata);
 	bin_t   *bin = arena_get_bin(arena, binind, binshard);
 
+	edata_list_active_t empty_slabs;
+	edata_list_active_init(&empty_slabs);
+
 	malloc_mutex_lock(tsdn, &bin->lock);
 	bin_dalloc_locked_info_t info;
 	bin_dalloc_locked_begin(&info, binind);
 	bool ret = bin_dalloc_locked_step(
 	    tsdn, arena_is_auto(arena), bin, &info, binind, edata, ptr);
 	bin_dalloc_locked_finish(tsdn, bin, &info);
+	bin_remote_free_drain_locked(
+	    tsdn, arena_is_auto(arena), bin, binind, &empty_slabs);
 	malloc_mutex_unlock(tsdn, &bin->lock);
 
 	if (ret) {
 		arena_slab_dalloc(tsdn, arena, edata);
 	}
+	arena_slab_dalloc_list(tsdn, &empty_slabs);
 }
 
 void
 arena_dalloc_small(tsdn_t *tsdn, void *ptr) {
 	edata_t *edata = emap_edata_lookup(tsdn, &arena_emap_global, ptr);
 	arena_t *arena = arena_get_from_edata(edata);
+	if (unlikely(arena_is_scratch(arena))) {
+		/* Reclaimed along with everything else by arena_reset(). */
+		return;
+	}
 
 	arena_dalloc_bin(tsdn, arena, edata, ptr);
 	arena_decay_tick(tsdn, arena);
@@ -1311,11 +1424,47 @@ arena_ptr_array_flush_size_check_fail(cache_bin_ptr_array_t *arr, szind_t szind,
 	assert(found_mismatch);
 }
 
+/*
+ * Moves the objects from automatic arenas into the current CPU's cache, as far
+ * as it has room, and compacts the rest to the front of the arrays.  Returns
+ * the number of objects left to flush.
+ */
+static cache_bin_sz_t
+arena_ptr_array_flush_percpu_cache(tsdn_t *tsdn, szind_t binind,
+    cache_bin_ptr_array_t *arr, emap_batch_lookup_result_t *item_edata,
+    cache_bin_sz_t nflush) {
+	/* Gather the candidates at the front. */
+	cache_bin_sz_t nauto = 0;
+	for (cache_bin_sz_t i = 0; i < nflush; i++) {
+		if (!arena_is_auto(arena_get_from_edata(item_edata[i].edata))) {
+			continue;
+		}
+		void                      *ptr = arr->ptr[i];
+		emap_batch_lookup_result_t edata = item_edata[i];
+		arr->ptr[i] = arr->ptr[nauto];
+		item_edata[i] = item_edata[nauto];
+		arr->ptr[nauto] = ptr;
+		item_edata[nauto] = edata;
+		nauto++;
+	}
+	cache_bin_sz_t nstored = percpu_cache_dalloc(
+	    tsdn, binind, arr->ptr, nauto);
+	cache_bin_sz_t nleft = nflush - nstored;
+	memmove(arr->ptr, arr->ptr + nstored, nleft * sizeof(void *));
+	memmove(item_edata, item_edata + nstored,
+	    nleft * sizeof(emap_batch_lookup_result_t));
+	return nleft;
+}
+
 JEMALLOC_ALWAYS_INLINE void
 arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
     cache_bin_ptr_array_t *arr, emap_batch_lookup_result_t *item_edata,
     cache_bin_sz_t nflush, arena_t *stats_arena,
-    cache_bin_stats_t **merge_stats) {
+    cache_bin_stats_t **merge_stats, bool use_percpu_cache) {
+	if (use_percpu_cache && percpu_cache_enabled()) {
+		nflush = arena_ptr_array_flush_percpu_cache(
+		    tsdn, binind, arr, item_edata, nflush);
+	}
 	/*
 	 * The slabs where we freed the last remaining object in the slab (and
 	 * so need to free the slab itself).
@@ -1323,6 +1472,17 @@ arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
 	 */
 	unsigned dalloc_count = 0;
 	VARIABLE_ARRAY(edata_t *, dalloc_slabs, nflush + 1);
+	/* Slabs emptied while draining remote frees. */
+	edata_list_active_t drained_slabs;
+	edata_list_active_init(&drained_slabs);
+	/*
+	 * Objects headed for a bin other than this thread's own may bypass the
+	 * bin lock via the remote free inbox.
+	 */
+	bin_t *own_bin = (stats_arena != NULL
+	                     && bin_remote_free_eligible(binind))
+	    ? bin_choose(tsdn, stats_arena, binind, NULL)
+	    : NULL;
 	/*
 	 * We're about to grab a bunch of locks.  If one of them happens to be
 	 * the one guarding the arena-level stats counters we flush our
@@ -1398,6 +1558,37 @@ arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
 			}
 		}
 
+		if (unlikely(arena_is_scratch(cur_arena))) {
+			/* Scratch objects stay put until the arena is reset. */
+			continue;
+		}
+		if (stats_arena == NULL) {
+			/* Credit the arena the objects go back to. */
+			stats_arena = cur_arena;
+		}
+
+		bool remote = (own_bin != NULL && cur_bin != own_bin);
+		if (remote) {
+			bin_remote_free_list_t list;
+			ql_new(&list);
+			for (unsigned i = prev_flush_start; i < flush_start;
+			    i++) {
+				bin_remote_free_list_append(
+				    &list, arr->ptr[i], item_edata[i].edata);
+			}
+			bool drain = bin_remote_free_push(
+			    cur_bin, &list, flush_start - prev_flush_start);
+			arena_decay_ticks(
+			    tsdn, cur_arena, flush_start - prev_flush_start);
+			if (!drain) {
+				continue;
+			}
+			/*
+			 * The inbox is over its limit; take the lock after all
+			 * and return everything pending to the slabs.
+			 */
+		}
+
 		/* Actually do the flushing. */
 		malloc_mutex_lock(tsdn, &cur_bin->lock);
 
@@ -1419,7 +1610,9 @@ arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
 		/* Init only to avoid used-uninitialized warning. */
 		bin_dalloc_locked_info_t dalloc_bin_info = {0};
 		bin_dalloc_locked_begin(&dalloc_bin_info, binind);
-		for (unsigned i = prev_flush_start; i < flush_start; i++) {
+		/* Objects already pushed remotely get drained below instead. */
+		unsigned dalloc_end = remote ? prev_flush_start : flush_start;
+		for (unsigned i = prev_flush_start; i < dalloc_end; i++) {
 			void    *ptr = arr->ptr[i];
 			edata_t *edata = item_edata[i].edata;
 			if (bin_dalloc_locked_step(tsdn,
@@ -1433,10 +1626,14 @@ arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
 
 		bin_dalloc_locked_finish(
 		    tsdn, cur_bin, &dalloc_bin_info);
+		bin_remote_free_drain_locked(tsdn, arena_is_auto(cur_arena),
+		    cur_bin, binind, &drained_slabs);
 		malloc_mutex_unlock(tsdn, &cur_bin->lock);
 
-		arena_decay_ticks(
-		    tsdn, cur_arena, flush_start - prev_flush_start);
+		if (!remote) {
+			arena_decay_ticks(
+			    tsdn, cur_arena, flush_start - prev_flush_start);
+		}
 	}
 
 	/* Handle all deferred slab dalloc. */
@@ -1444,6 +1641,7 @@ arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
 		edata_t *slab = dalloc_slabs[i];
 		arena_slab_dalloc(tsdn, arena_get_from_edata(slab), slab);
 	}
+	arena_slab_dalloc_list(tsdn, &drained_slabs);
 
 	if (config_stats && *merge_stats != NULL) {
 		/*
@@ -1451,6 +1649,7 @@ arena_ptr_array_flush_impl_small(tsdn_t *tsdn, szind_t binind,
 		 * thread's arena, so the stats didn't get merged.
 		 * Manually do so now.
 		 */
+		assert(stats_arena != NULL);
 		bin_t *bin = bin_choose(tsdn, stats_arena, binind, NULL);
 		malloc_mutex_lock(tsdn, &bin->lock);
 		bin->stats.nflushes++;
@@ -1548,7 +1747,8 @@ arena_ptr_array_flush_impl_large(tsdn_t *tsdn, szind_t binind,
 JEMALLOC_ALWAYS_INLINE void
 arena_ptr_array_flush_impl(tsd_t *tsd, szind_t binind,
     cache_bin_ptr_array_t *arr, unsigned nflush, bool small,
-    arena_t *stats_arena, cache_bin_stats_t **merge_stats) {
+    arena_t *stats_arena, cache_bin_stats_t **merge_stats,
+    bool use_percpu_cache) {
 	/*
 	 * A couple lookup calls take tsdn; declare it once for convenience
 	 * instead of calling tsd_tsdn(tsd) all the time.
@@ -1585,7 +1785,8 @@ arena_ptr_array_flush_impl(tsd_t *tsd, szind_t binind,
 	 */
 	if (small) {
 		return arena_ptr_array_flush_impl_small(tsdn, binind, arr,
-		    item_edata, nflush, stats_arena, merge_stats);
+		    item_edata, nflush, stats_arena, merge_stats,
+		    use_percpu_cache);
 	} else {
 		return arena_ptr_array_flush_impl_large(tsdn, binind, arr,
 		    item_edata, nflush, stats_arena, merge_stats);
@@ -1595,12 +1796,15 @@ arena_ptr_array_flush_impl(tsd_t *tsd, szind_t binind,
 /*
  * In practice, pointers are flushed back to their original allocation arenas,
  * so multiple arenas may be involved here. The input stats_arena simply
- * indicates where the cache stats should be merged into.
+ * indicates where the cache stats should be merged into; a NULL stats_arena
+ * (small objects only, nflush > 0) merges them into the arena of the first
+ * object flushed.  With use_percpu_cache, small objects may stop at the
+ * per-CPU cache instead.
  */
 void
 arena_ptr_array_flush(tsd_t *tsd, szind_t binind, cache_bin_ptr_array_t *arr,
     unsigned nflush, bool small, arena_t *stats_arena,
-    cache_bin_stats_t merge_stats) {
+    cache_bin_stats_t merge_stats, bool use_percpu_cache) {
 	assert(arr != NULL && arr->ptr != NULL);
 	/*
      * The input cache bin stats represent a snapshot taken when the pointer
@@ -1621,7 +1825,8 @@ arena_ptr_array_flush(tsd_t *tsd, szind_t binind, cache_bin_ptr_array_t *arr,
 		(&ptrs_batch)->n = (cache_bin_sz_t)nflush_batch;
 		(&ptrs_batch)->ptr = arr->ptr + nflushed;
 		arena_ptr_array_flush_impl(tsd, binind, &ptrs_batch,
-		    nflush_batch, small, stats_arena, &stats);
+		    nflush_batch, small, stats_arena, &stats,
+		    use_percpu_cache);
 		nflushed += nflush_batch;
 	} while (nflushed < nflush);
 	assert(nflush == nflushed);
@@ -1912,6 +2117,29 @@ arena_new(tsdn_t *tsdn, unsigned ind, const arena_config_t *config) {
 		}
 	}
 
+	if (config->scratch) {
+		if (pa_shard_enable_scratch(tsdn, &arena->pa_shard)) {
+			goto label_error;
+		}
+		arena_scratch_enabled_do_not_access_directly = true;
+	}
+	arena->scratch = config->scratch;
+	if (bin_info_huge_any() && !config->scratch) {
+		if (pa_shard_enable_huge_bins(tsdn, &arena->pa_shard)) {
+			goto label_error;
+		}
+	}
+	if (opt_zero_pool_max != 0 && !config->scratch) {
+		if (pa_shard_enable_zero_pool(tsdn, &arena->pa_shard)) {
+			goto label_error;
+		}
+	}
+	if (bin_regions_enabled() && !config->scratch) {
+		if (pa_shard_enable_bin_regions(tsdn, &arena->pa_shard)) {
+			goto label_error;
+		}
+	}
+
 	arena->base = base;
 	/* Set arena before creating background threads. */
 	arena_set(ind, arena);
@@ -1930,8 +2158,10 @@ arena_new(tsdn_t *tsdn, unsigned ind, const arena_config_t *config) {
 	 *   them in that case).
 	 * - Arena 0 initialization.  In this case, we're mid-bootstrapping,
 	 *   and so background_thread_enabled is not yet initialized.
+	 * - Scratch arenas, which carve their extents out of PAC regions.
 	 */
-	if (opt_hpa && ehooks_are_default(base_ehooks_get(base)) && ind != 0) {
+	if (opt_hpa && ehooks_are_default(base_ehooks_get(base)) && ind != 0
+	    && !config->scratch) {
 		hpa_shard_opts_t hpa_shard_opts = opt_hpa_opts;
 		hpa_shard_opts.deferral_allowed = background_thread_enabled();
 		if (pa_shard_enable_hpa(tsdn, &arena->pa_shard, &hpa_shard_opts,
@@ -5,6 +5,7 @@
 #include "jemalloc/internal/jemalloc_init.h"
 #include "jemalloc/internal/malloc_io.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/numa.h"
 #include "jemalloc/internal/sz.h"
 
 JEMALLOC_ALIGNED(CACHELINE)
@@ -234,6 +235,21 @@ arena_choose_hard(tsd_t *tsd, bool internal) {
 		unsigned i, j, choose[2], first_null;
 		bool     is_new_arena[2];
 
+		/*
+		 * With NUMA-aware arenas, only the arenas of the current node
+		 * are candidates: every numa_nnodes-th one, starting from the
+		 * node number.
+		 */
+		unsigned first = 0;
+		unsigned stride = 1;
+		if (numa_enabled()) {
+			unsigned node = numa_node_get();
+			if (node < narenas_auto) {
+				first = node;
+				stride = numa_nnodes;
+			}
+		}
+
 		/*
 		 * Determine binding for both non-internal and internal
 		 * allocation.
@@ -243,28 +259,27 @@ arena_choose_hard(tsd_t *tsd, bool internal) {
 		 */
 
 		for (j = 0; j < 2; j++) {
-			choose[j] = 0;
+			choose[j] = first;
 			is_new_arena[j] = false;
 		}
 
 		first_null = narenas_auto;
 		malloc_mutex_lock(tsd_tsdn(tsd), &arenas_lock);
 		assert(arena_get(tsd_tsdn(tsd), 0, false) != NULL);
-		for (i = 1; i < narenas_auto; i++) {
-			if (arena_get(tsd_tsdn(tsd), i, false) != NULL) {
+		for (i = first; i < narenas_auto; i += stride) {
+			arena_t *arena = arena_get(tsd_tsdn(tsd), i, false);
+			if (arena != NULL) {
 				/*
 				 * Choose the first arena that has the lowest
 				 * number of threads assigned to it.
 				 */
 				for (j = 0; j < 2; j++) {
-					if (arena_nthreads_get(
-					        arena_get(
-					            tsd_tsdn(tsd), i, false),
-					        !!j)
-					    < arena_nthreads_get(
-					        arena_get(tsd_tsdn(tsd),
-					            choose[j], false),
-					        !!j)) {
+					arena_t *chosen = arena_get(
+					    tsd_tsdn(tsd), choose[j], false);
+					if (chosen == NULL
+					    || arena_nthreads_get(arena, !!j)
+					        < arena_nthreads_get(
+					            chosen, !!j)) {
 						choose[j] = i;
 					}
 				}
@@ -283,10 +298,13 @@ arena_choose_hard(tsd_t *tsd, bool internal) {
 		}
 
 		for (j = 0; j < 2; j++) {
-			if (arena_nthreads_get(
-			        arena_get(tsd_tsdn(tsd), choose[j], false), !!j)
-			        == 0
-			    || first_null == narenas_auto) {
+			arena_t *chosen = arena_get(
+			    tsd_tsdn(tsd), choose[j], false);
+			/* Only NULL if the node has no arena initialized yet. */
+			assert(chosen != NULL || first_null != narenas_auto);
+			if (chosen != NULL
+			    && (arena_nthreads_get(chosen, !!j) == 0
+			        || first_null == narenas_auto)) {
 				/*
 				 * Use an unloaded arena, or the least loaded
 				 * arena if all arenas are already initialized.
@@ -2,6 +2,8 @@
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
 #include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/mem_pressure.h"
+#include "jemalloc/internal/percpu_cache.h"
 
 JEMALLOC_DIAGNOSTIC_DISABLE_SPURIOUS
 
@@ -160,6 +162,8 @@ set_current_thread_affinity(int cpu) {
 #	define BILLION UINT64_C(1000000000)
 /* Minimal sleep interval 100 ms. */
 #	define BACKGROUND_THREAD_MIN_INTERVAL_NS (BILLION / 10)
+/* How often the tcache budget is checked, when one is set. */
+#	define BACKGROUND_THREAD_TCACHE_BUDGET_INTERVAL_NS BILLION
 
 static int
 background_thread_cond_wait(
@@ -256,6 +260,10 @@ background_work_sleep_once(
 	unsigned narenas = narenas_total_get();
 	bool     slept_indefinitely = background_thread_indefinite_sleep(info);
 
+	/* Memory pressure is process-wide; the first thread samples it. */
+	if (ind == 0) {
+		mem_pressure_update();
+	}
 	for (unsigned i = ind; i < narenas; i += max_background_threads) {
 		arena_t *arena = arena_get(tsdn, i, false);
 		if (!arena) {
@@ -279,6 +287,36 @@ background_work_sleep_once(
 			ns_until_deferred = ns_arena_deferred;
 		}
 	}
+	/* The tcache budget is process-wide; the first thread handles it. */
+	if (ind == 0 && config_stats && opt_tcache_global_budget != 0) {
+		tcache_budget_enforce(tsdn);
+		if (ns_until_deferred
+		    > BACKGROUND_THREAD_TCACHE_BUDGET_INTERVAL_NS) {
+			ns_until_deferred =
+			    BACKGROUND_THREAD_TCACHE_BUDGET_INTERVAL_NS;
+		}
+	}
+	/*
+	 * Age the per-CPU caches, which idle threads never get to.  Flushing
+	 * may end up waking background threads, so drop our own lock for it.
+	 */
+	if (ind == 0 && percpu_cache_enabled()) {
+		malloc_mutex_unlock(tsdn, &info->mtx);
+		percpu_cache_gc(tsdn_tsd(tsdn));
+		malloc_mutex_lock(tsdn, &info->mtx);
+		/* A stop or pause request may have come in meanwhile. */
+		if (info->state != background_thread_started) {
+			return;
+		}
+		if (percpu_cache_bytes_get(tsdn) != 0
+		    && ns_until_deferred > PERCPU_CACHE_GC_INTERVAL_NS) {
+			ns_until_deferred = PERCPU_CACHE_GC_INTERVAL_NS;
+		}
+	}
+	/* Keep sampling memory pressure, and reacting to it. */
+	if (opt_pressure_purge && ns_until_deferred > MEM_PRESSURE_INTERVAL_NS) {
+		ns_until_deferred = MEM_PRESSURE_INTERVAL_NS;
+	}
 
 	uint64_t sleep_ns;
 	if (ns_until_deferred == BACKGROUND_THREAD_DEFERRED_MAX) {
@@ -334,7 +372,7 @@ background_threads_disable_single(tsd_t *tsd, background_thread_info_t *info) {
 
 static void *background_thread_entry(void *ind_arg);
 
-static int
+int
 background_thread_create_signals_masked(pthread_t *thread,
     const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg) {
 	/*
@@ -792,6 +830,7 @@ background_thread_stats_read(tsdn_t *tsdn, background_thread_stats_t *stats) {
 #	undef BACKGROUND_THREAD_NPAGES_THRESHOLD
 #	undef BILLION
 #	undef BACKGROUND_THREAD_MIN_INTERVAL_NS
+#	undef BACKGROUND_THREAD_TCACHE_BUDGET_INTERVAL_NS
 
 /*
  * When lazy lock is enabled, we need to make sure setting isthreaded before
@@ -3,9 +3,30 @@
 
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/bin.h"
+#include "jemalloc/internal/bin_inlines.h"
 #include "jemalloc/internal/sc.h"
 #include "jemalloc/internal/witness.h"
 
+#if LG_SIZEOF_PTR == 3 && defined(__AVX2__)
+#	include <immintrin.h>
+#	define BIN_SLAB_RUN_AVX2
+#elif LG_SIZEOF_PTR == 3 && defined(__SSE2__)
+#	include <emmintrin.h>
+#	define BIN_SLAB_RUN_SSE2
+#endif
+
+bool   opt_bin_remote_free = false;
+size_t opt_bin_remote_free_max = BIN_REMOTE_FREE_MAX_DEFAULT;
+bool   opt_slab_size_auto = false;
+
+/* Number of slab allocations and deallocations between tuning decisions. */
+#define BIN_SLAB_TUNE_WINDOW 16
+
+mpsc_queue_proto(static inline, bin_remote_free_queue_, bin_remote_free_queue_t,
+    bin_remote_free_t, bin_remote_free_list_t)
+mpsc_queue_gen(static inline, bin_remote_free_queue_, bin_remote_free_queue_t,
+    bin_remote_free_t, bin_remote_free_list_t, link)
+
 bool
 bin_update_shard_size(unsigned bin_shard_sizes[SC_NBINS], size_t start_size,
     size_t end_size, size_t nshards) {
@@ -47,6 +68,11 @@ bin_init(bin_t *bin) {
 	bin->slabcur = NULL;
 	edata_heap_new(&bin->slabs_nonfull);
 	edata_list_active_init(&bin->slabs_full);
+	bin_remote_free_queue_new(&bin->remote_frees);
+	atomic_store_zu(&bin->nremote_pending, 0, ATOMIC_RELAXED);
+	atomic_store_u(&bin->slab_lg_scale, 0, ATOMIC_RELAXED);
+	bin->slab_tune_nalloc = 0;
+	bin->slab_tune_ndalloc = 0;
 	if (config_stats) {
 		memset(&bin->stats, 0, sizeof(bin_stats_t));
 	}
@@ -75,57 +101,105 @@ bin_slab_reg_alloc(edata_t *slab, const bin_info_t *bin_info) {
 	size_t       regind;
 
 	assert(edata_nfree_get(slab) > 0);
-	assert(!bitmap_full(slab_data->bitmap, &bin_info->bitmap_info));
+	assert(!bitmap_full(
+	    slab_data->bitmap, bin_slab_bitmap_info(bin_info, slab)));
 
-	regind = bitmap_sfu(slab_data->bitmap, &bin_info->bitmap_info);
+	regind = bitmap_sfu(
+	    slab_data->bitmap, bin_slab_bitmap_info(bin_info, slab));
 	ret = (void *)((byte_t *)edata_addr_get(slab)
 	    + (uintptr_t)(bin_info->reg_size * regind));
 	edata_nfree_dec(slab);
 	return ret;
 }
 
+/*
+ * Writes the addresses of the n consecutive regions starting at regind.  Fresh
+ * and mostly empty slabs hand out long runs of free regions, for which the
+ * address arithmetic is done a vector register at a time.
+ */
+static inline void
+bin_slab_reg_run_ptrs(void **ptrs, uintptr_t base, uintptr_t regsize,
+    size_t regind, size_t n) {
+	uintptr_t addr = base + regsize * regind;
+	size_t    i = 0;
+#if defined(BIN_SLAB_RUN_AVX2)
+	if (n >= 4) {
+		__m256i cur = _mm256_set_epi64x((long long)(addr + 3 * regsize),
+		    (long long)(addr + 2 * regsize), (long long)(addr + regsize),
+		    (long long)addr);
+		__m256i step = _mm256_set1_epi64x((long long)(4 * regsize));
+		for (; i + 4 <= n; i += 4) {
+			_mm256_storeu_si256((__m256i *)&ptrs[i], cur);
+			cur = _mm256_add_epi64(cur, step);
+		}
+		addr += regsize * i;
+	}
+#elif defined(BIN_SLAB_RUN_SSE2)
+	if (n >= 2) {
+		__m128i cur = _mm_set_epi64x(
+		    (long long)(addr + regsize), (long long)addr);
+		__m128i step = _mm_set1_epi64x((long long)(2 * regsize));
+		for (; i + 2 <= n; i += 2) {
+			_mm_storeu_si128((__m128i *)&ptrs[i], cur);
+			cur = _mm_add_epi64(cur, step);
+		}
+		addr += regsize * i;
+	}
+#endif
+	for (; i < n; i++) {
+		/* NOLINTNEXTLINE(performance-no-int-to-ptr) */
+		ptrs[i] = (void *)addr;
+		addr += regsize;
+	}
+}
+
 void
 bin_slab_reg_alloc_batch(
     edata_t *slab, const bin_info_t *bin_info, unsigned cnt, void **ptrs) {
 	slab_data_t *slab_data = edata_slab_data_get(slab);
 
 	assert(edata_nfree_get(slab) >= cnt);
-	assert(!bitmap_full(slab_data->bitmap, &bin_info->bitmap_info));
+	assert(!bitmap_full(
+	    slab_data->bitmap, bin_slab_bitmap_info(bin_info, slab)));
 
-#if (!defined JEMALLOC_INTERNAL_POPCOUNTL) || (defined BITMAP_USE_TREE)
+#ifdef BITMAP_USE_TREE
+	const bitmap_info_t *bitmap_info = bin_slab_bitmap_info(bin_info, slab);
 	for (unsigned i = 0; i < cnt; i++) {
-		size_t regind = bitmap_sfu(
-		    slab_data->bitmap, &bin_info->bitmap_info);
+		size_t regind = bitmap_sfu(slab_data->bitmap, bitmap_info);
 		*(ptrs + i) = (void *)((uintptr_t)edata_addr_get(slab)
 		    + (uintptr_t)(bin_info->reg_size * regind));
 	}
 #else
-	unsigned group = 0;
-	bitmap_t g = slab_data->bitmap[group];
-	unsigned i = 0;
+	/*
+	 * Load from memory locations only once, outside the hot loop below.
+	 */
+	uintptr_t base = (uintptr_t)edata_addr_get(slab);
+	uintptr_t regsize = (uintptr_t)bin_info->reg_size;
+	unsigned  group = 0;
+	bitmap_t  g = slab_data->bitmap[group];
+	unsigned  i = 0;
 	while (i < cnt) {
 		while (g == 0) {
 			g = slab_data->bitmap[++group];
 		}
 		size_t shift = group << LG_BITMAP_GROUP_NBITS;
-		size_t pop = popcount_lu(g);
-		if (pop > (cnt - i)) {
-			pop = cnt - i;
-		}
-
-		/*
-		 * Load from memory locations only once, outside the
-		 * hot loop below.
-		 */
-		uintptr_t base = (uintptr_t)edata_addr_get(slab);
-		uintptr_t regsize = (uintptr_t)bin_info->reg_size;
-		while (pop--) {
-			size_t bit = cfs_lu(&g);
-			size_t regind = shift + bit;
-			/* NOLINTNEXTLINE(performance-no-int-to-ptr) */
-			*(ptrs + i) = (void *)(base + regsize * regind);
-
-			i++;
+		/* Take each run of set (free) bits in the group at once. */
+		while (g != 0 && i < cnt) {
+			size_t   bit = ffs_lu(g);
+			bitmap_t rest = g >> bit;
+			size_t   run = (rest == ~(bitmap_t)0)
+			      ? BITMAP_GROUP_NBITS - bit
+			      : ffs_lu(~rest);
+			if (run > cnt - i) {
+				run = cnt - i;
+			}
+			bin_slab_reg_run_ptrs(
+			    ptrs + i, base, regsize, shift + bit, run);
+			bitmap_t mask = (run == BITMAP_GROUP_NBITS)
+			    ? ~(bitmap_t)0
+			    : (((bitmap_t)1 << run) - 1) << bit;
+			g &= ~mask;
+			i += (unsigned)run;
 		}
 		slab_data->bitmap[group] = g;
 	}
@@ -199,7 +273,7 @@ bin_dissociate_slab(bool is_auto, edata_t *slab, bin_t *bin) {
 		 * slab only contains one region, then it never gets inserted
 		 * into the non-full slabs heap.
 		 */
-		if (bin_info->nregs == 1) {
+		if (bin_slab_nregs(bin_info, slab) == 1) {
 			bin_slabs_full_remove(is_auto, bin, slab);
 		} else {
 			bin_slabs_nonfull_remove(bin, slab);
@@ -239,7 +313,14 @@ bin_dalloc_slab_prepare(tsdn_t *tsdn, edata_t *slab, bin_t *bin) {
 
 	assert(slab != bin->slabcur);
 	if (config_stats) {
+		szind_t binind = edata_szind_get(slab);
 		bin->stats.curslabs--;
+		bin->stats.curslabs_nregs -= bin_slab_nregs(
+		    &bin_infos[binind], slab);
+		if (edata_huge_bin_get(slab)) {
+			bin->stats.curslabs_huge--;
+		}
+		bin_slab_size_tune(tsdn, bin, binind, 0, 1);
 	}
 }
 
@@ -267,10 +348,17 @@ bin_refill_slabcur_with_fresh_slab(tsdn_t *tsdn, bin_t *bin,
 	assert(fresh_slab != NULL);
 
 	/* A new slab from arena_slab_alloc() */
-	assert(edata_nfree_get(fresh_slab) == bin_infos[binind].nregs);
+	assert(edata_nfree_get(fresh_slab)
+	    == bin_slab_nregs(&bin_infos[binind], fresh_slab));
 	if (config_stats) {
 		bin->stats.nslabs++;
 		bin->stats.curslabs++;
+		bin->stats.curslabs_nregs += bin_slab_nregs(
+		    &bin_infos[binind], fresh_slab);
+		if (edata_huge_bin_get(fresh_slab)) {
+			bin->stats.curslabs_huge++;
+		}
+		bin_slab_size_tune(tsdn, bin, binind, 1, 0);
 	}
 	bin->slabcur = fresh_slab;
 }
@@ -315,6 +403,80 @@ bin_malloc_no_fresh_slab(tsdn_t *tsdn, bool is_auto, bin_t *bin,
 	return bin_slab_reg_alloc(bin->slabcur, &bin_infos[binind]);
 }
 
+/*
+ * Pushes the regions in list (nregs of them) onto the bin's inbox, leaving list
+ * empty.  Returns true if the inbox has grown past opt_bin_remote_free_max, in
+ * which case the caller should acquire the bin lock and drain it.
+ */
+bool
+bin_remote_free_push(bin_t *bin, bin_remote_free_list_t *list, size_t nregs) {
+	assert(!ql_empty(list));
+	/*
+	 * Count before publishing, so that a concurrent drain never observes
+	 * more regions than have been accounted for.
+	 */
+	size_t npending = atomic_fetch_add_zu(
+	                      &bin->nremote_pending, nregs, ATOMIC_RELAXED)
+	    + nregs;
+	bin_remote_free_queue_push_batch(&bin->remote_frees, list);
+	return npending > opt_bin_remote_free_max;
+}
+
+/*
+ * Returns all remotely freed regions to their slabs.  Slabs which become empty
+ * are appended to empty_slabs; the caller deallocates them after dropping the
+ * bin lock.  Returns the number of regions drained.
+ */
+unsigned
+bin_remote_free_drain_locked(tsdn_t *tsdn, bool is_auto, bin_t *bin,
+    szind_t binind, edata_list_active_t *empty_slabs) {
+	malloc_mutex_assert_owner(tsdn, &bin->lock);
+
+	bin_remote_free_list_t list;
+	ql_new(&list);
+	bin_remote_free_queue_pop_batch(&bin->remote_frees, &list);
+	if (ql_empty(&list)) {
+		return 0;
+	}
+
+	bin_dalloc_locked_info_t info;
+	bin_dalloc_locked_begin(&info, binind);
+	unsigned           ndrained = 0;
+	bin_remote_free_t *node;
+	while ((node = ql_first(&list)) != NULL) {
+		/* The node is the region; unlink it before freeing it. */
+		ql_remove(&list, node, link);
+		edata_t *slab = node->slab;
+		assert(edata_szind_get(slab) == binind);
+		if (bin_dalloc_locked_step(
+		        tsdn, is_auto, bin, &info, binind, slab, (void *)node)) {
+			edata_list_active_append(empty_slabs, slab);
+		}
+		ndrained++;
+	}
+	bin_dalloc_locked_finish(tsdn, bin, &info);
+	if (config_stats) {
+		bin->stats.nremote_frees += ndrained;
+	}
+	atomic_fetch_sub_zu(&bin->nremote_pending, ndrained, ATOMIC_RELAXED);
+
+	return ndrained;
+}
+
+/*
+ * Drops the inbox contents without touching the regions; only valid when every
+ * slab of the bin is being released wholesale (i.e. arena reset).
+ */
+void
+bin_remote_free_discard_locked(tsdn_t *tsdn, bin_t *bin) {
+	malloc_mutex_assert_owner(tsdn, &bin->lock);
+
+	bin_remote_free_list_t list;
+	ql_new(&list);
+	bin_remote_free_queue_pop_batch(&bin->remote_frees, &list);
+	atomic_store_zu(&bin->nremote_pending, 0, ATOMIC_RELAXED);
+}
+
 bin_t *
 bin_choose(tsdn_t *tsdn, arena_t *arena, szind_t binind,
     unsigned *binshard_p) {
@@ -331,6 +493,50 @@ bin_choose(tsdn_t *tsdn, arena_t *arena, szind_t binind,
 	return arena_get_bin(arena, binind, binshard);
 }
 
+void
+bin_slab_size_tune(tsdn_t *tsdn, bin_t *bin, szind_t binind, unsigned nalloc,
+    unsigned ndalloc) {
+	malloc_mutex_assert_owner(tsdn, &bin->lock);
+	/* Utilization is only known from the stats counters. */
+	if (!config_stats || !opt_slab_size_auto) {
+		return;
+	}
+	const bin_info_t *bin_info = &bin_infos[binind];
+	if (bin_info->huge || bin_info->slab_lg_scale_max == 0) {
+		return;
+	}
+	bin->slab_tune_nalloc += nalloc;
+	bin->slab_tune_ndalloc += ndalloc;
+	if (bin->slab_tune_nalloc + bin->slab_tune_ndalloc
+	    < BIN_SLAB_TUNE_WINDOW) {
+		return;
+	}
+
+	unsigned lg_scale = bin_slab_lg_scale_get(bin);
+	size_t   curslabs = bin->stats.curslabs;
+	size_t   nonfull = bin->stats.nonfull_slabs;
+	/*
+	 * Slabs are being created often while nearly all of them are full:
+	 * bigger slabs amortize the extent allocations.  Live regions spread
+	 * thinly over many non-full slabs instead mean fragmentation, which
+	 * smaller slabs limit.  Move one step at a time either way.
+	 */
+	if (bin->slab_tune_nalloc >= BIN_SLAB_TUNE_WINDOW / 2
+	    && nonfull * 4 <= curslabs
+	    && lg_scale < bin_info->slab_lg_scale_max) {
+		lg_scale++;
+		bin->stats.nslab_grows++;
+	} else if (nonfull * 4 > curslabs
+	    && bin->stats.curregs * 2 < bin->stats.curslabs_nregs
+	    && lg_scale > 0) {
+		lg_scale--;
+		bin->stats.nslab_shrinks++;
+	}
+	atomic_store_u(&bin->slab_lg_scale, lg_scale, ATOMIC_RELAXED);
+	bin->slab_tune_nalloc = 0;
+	bin->slab_tune_ndalloc = 0;
+}
+
 void *
 bin_current_slab_addr(tsdn_t *tsdn, bin_t *bin) {
 	malloc_mutex_lock(tsdn, &bin->lock);
@@ -5,6 +5,8 @@
 
 bin_info_t bin_infos[SC_NBINS];
 
+bool opt_huge_bins[SC_NBINS];
+
 static void
 bin_infos_init(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
     bin_info_t infos[SC_NBINS]) {
@@ -17,10 +19,62 @@ bin_infos_init(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 		bin_info->nregs = (uint32_t)(bin_info->slab_size
 		    / bin_info->reg_size);
 		bin_info->n_shards = bin_shard_sizes[i];
-		bitmap_info_t bitmap_info = BITMAP_INFO_INITIALIZER(
-		    bin_info->nregs);
-		bin_info->bitmap_info = bitmap_info;
+		bin_info->huge = opt_huge_bins[i];
+		bin_info->slab_lg_scale_max = 0;
+		for (unsigned lg_scale = 0; lg_scale <= BIN_SLAB_LG_SCALE_MAX;
+		    lg_scale++) {
+			size_t nregs = (size_t)bin_info->nregs << lg_scale;
+			if (nregs > BITMAP_MAXBITS) {
+				break;
+			}
+			bitmap_info_t bitmap_info = BITMAP_INFO_INITIALIZER(
+			    nregs);
+			bin_info->bitmap_info[lg_scale] = bitmap_info;
+			bin_info->slab_lg_scale_max = lg_scale;
+		}
+	}
+}
+
+/*
+ * Settings look like bin_shards, "start-end:flag|...", where a nonzero flag
+ * selects every small size class between start and end and a zero flag
+ * deselects them again.  Sizes beyond SC_SMALL_MAXCLASS are ignored.
+ */
+bool
+bin_info_huge_parse(const char *settings, size_t len) {
+	do {
+		size_t size_start, size_end, flag;
+		if (multi_setting_parse_next(
+		        &settings, &len, &size_start, &size_end, &flag)) {
+			return true;
+		}
+		if (size_start > size_end) {
+			return true;
+		}
+		if (size_start > SC_SMALL_MAXCLASS) {
+			continue;
+		}
+		if (size_end > SC_SMALL_MAXCLASS) {
+			size_end = SC_SMALL_MAXCLASS;
+		}
+		/* May get called before sz_init (during malloc_conf_init). */
+		szind_t bin_start = sz_size2index_compute(size_start);
+		szind_t bin_end = sz_size2index_compute(size_end);
+		for (szind_t i = bin_start; i <= bin_end; i++) {
+			opt_huge_bins[i] = (flag != 0);
+		}
+	} while (len > 0);
+	return false;
+}
+
+bool
+bin_info_huge_any(void) {
+	for (unsigned i = 0; i < SC_NBINS; i++) {
+		if (bin_infos[i].huge) {
+			return true;
+		}
 	}
+	return false;
 }
 
 void
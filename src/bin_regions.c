@@ -0,0 +1,80 @@
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/bin_regions.h"
+#include "jemalloc/internal/conf.h"
+#include "jemalloc/internal/malloc_io.h"
+#include "jemalloc/internal/pages.h"
+
+bool     opt_bin_regions = false;
+unsigned opt_lg_bin_region = BIN_REGIONS_LG_REGION_DEFAULT;
+
+bool      bin_regions_enabled_do_not_access_directly = false;
+uintptr_t bin_regions_base = 0;
+size_t    bin_regions_size = 0;
+
+/* Whether the reservation is usable as is, or needs pages_commit() first. */
+static bool bin_regions_committed;
+/* Bytes carved off the front of each region so far. */
+static atomic_zu_t bin_regions_next[SC_NBINS];
+
+bool
+bin_regions_boot(void) {
+	if (!opt_bin_regions) {
+		return false;
+	}
+#if LG_SIZEOF_PTR < 3
+	malloc_printf("<jemalloc>: Bin regions need a 64-bit address space; "
+	    "%s.\n", opt_abort_conf ? "aborting" : "disabling");
+	if (opt_abort_conf) {
+		malloc_abort_invalid_conf();
+	}
+	opt_bin_regions = false;
+	return false;
+#else
+	size_t size = (size_t)SC_NBINS << opt_lg_bin_region;
+	bool   commit = false;
+	void  *addr = pages_map(NULL, size, PAGE, &commit);
+	if (addr == NULL) {
+		/* Running without the regions beats failing to start. */
+		malloc_printf("<jemalloc>: Failed to reserve %zu bytes for bin "
+		    "regions; disabling.\n", size);
+		opt_bin_regions = false;
+		return false;
+	}
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		atomic_store_zu(&bin_regions_next[i], 0, ATOMIC_RELAXED);
+	}
+	bin_regions_committed = commit;
+	bin_regions_base = (uintptr_t)addr;
+	bin_regions_size = size;
+	bin_regions_enabled_do_not_access_directly = true;
+	return false;
+#endif
+}
+
+void *
+bin_regions_slab_alloc(szind_t szind, size_t size, bool *zeroed) {
+	assert(bin_regions_enabled());
+	assert(szind < SC_NBINS);
+	assert((size & PAGE_MASK) == 0);
+
+	size_t region_size = ZU(1) << opt_lg_bin_region;
+	size_t offset = atomic_load_zu(&bin_regions_next[szind], ATOMIC_RELAXED);
+	do {
+		if (offset + size > region_size) {
+			return NULL;
+		}
+	} while (!atomic_compare_exchange_weak_zu(&bin_regions_next[szind],
+	    &offset, offset + size, ATOMIC_RELAXED, ATOMIC_RELAXED));
+
+	void *addr = (void *)(bin_regions_base
+	    + ((uintptr_t)szind << opt_lg_bin_region) + offset);
+	if (!bin_regions_committed && pages_commit(addr, size)) {
+		/* The address range is lost, but stays out of everyone's way. */
+		return NULL;
+	}
+	/* Nothing was ever written to the region beyond the cursor. */
+	*zeroed = true;
+	return addr;
+}
@@ -3,13 +3,18 @@
 
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/atomic.h"
+#include "jemalloc/internal/bin_regions.h"
 #include "jemalloc/internal/extent_dss.h"
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/fxp.h"
 #include "jemalloc/internal/log.h"
 #include "jemalloc/internal/malloc_io.h"
+#include "jemalloc/internal/mem_pressure.h"
 #include "jemalloc/internal/mutex.h"
 #include "jemalloc/internal/nstime.h"
+#include "jemalloc/internal/numa.h"
+#include "jemalloc/internal/percpu_cache.h"
+#include "jemalloc/internal/purge_pool.h"
 #include "jemalloc/internal/safety_check.h"
 #include "jemalloc/internal/san.h"
 #include "jemalloc/internal/sc.h"
@@ -414,7 +419,21 @@ validate_hpa_settings(void) {
 		    "but MADV_COLLAPSE support was not detected at build "
 		    "time.");
 	}
+	if (opt_hpa_opts.collapse_budget_us != 0) {
+		had_conf_error = true;
+		malloc_printf(
+		    "<jemalloc>: hpa_collapse_budget_us config option is set, "
+		    "but MADV_COLLAPSE support was not detected at build "
+		    "time.");
+	}
 #endif
+	if (opt_hpa_opts.collapse_budget_us != 0 && !opt_background_thread) {
+		had_conf_error = true;
+		malloc_printf(
+		    "<jemalloc>: hpa_collapse_budget_us config option is set, "
+		    "but background_thread is disabled; hugepages are only "
+		    "collapsed by background threads.");
+	}
 }
 
 static void
@@ -654,6 +673,24 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 				} while (vlen_left > 0);
 				CONF_CONTINUE;
 			}
+			if (CONF_MATCH("huge_bins")) {
+				if (bin_info_huge_parse(v, vlen)) {
+					CONF_ERROR(
+					    "Invalid settings for huge_bins",
+					    k, klen, v, vlen);
+				}
+				CONF_CONTINUE;
+			}
+			CONF_HANDLE_BOOL(opt_bin_regions, "bin_regions")
+			CONF_HANDLE_UNSIGNED(opt_lg_bin_region, "lg_bin_region",
+			    BIN_REGIONS_LG_REGION_MIN, BIN_REGIONS_LG_REGION_MAX,
+			    CONF_CHECK_MIN, CONF_CHECK_MAX, /* clip */ false)
+			CONF_HANDLE_BOOL(opt_bin_remote_free, "bin_remote_free")
+			CONF_HANDLE_SIZE_T(opt_bin_remote_free_max,
+			    "bin_remote_free_max", 0, SIZE_T_MAX,
+			    CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX,
+			    /* clip */ false)
+			CONF_HANDLE_BOOL(opt_slab_size_auto, "slab_size_auto")
 			if (CONF_MATCH("tcache_ncached_max")) {
 				bool err = tcache_bin_info_default_init(
 				    v, vlen);
@@ -673,6 +710,13 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			    NSTIME_SEC_MAX * KQU(1000) < QU(SSIZE_MAX)
 			        ? NSTIME_SEC_MAX * KQU(1000)
 			        : SSIZE_MAX);
+			CONF_HANDLE_BOOL(opt_dirty_decay_predictive,
+			    "dirty_decay_predictive")
+			CONF_HANDLE_SSIZE_T(opt_cold_age_ms, "cold_age_ms", -1,
+			    NSTIME_SEC_MAX * KQU(1000) < QU(SSIZE_MAX)
+			        ? NSTIME_SEC_MAX * KQU(1000)
+			        : SSIZE_MAX);
+			CONF_HANDLE_BOOL(opt_cold_pageout, "cold_pageout")
 			CONF_HANDLE_SSIZE_T(opt_muzzy_decay_ms,
 			    "muzzy_decay_ms", -1,
 			    NSTIME_SEC_MAX * KQU(1000) < QU(SSIZE_MAX)
@@ -786,6 +830,15 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			CONF_HANDLE_UNSIGNED(opt_lg_tcache_flush_large_div,
 			    "lg_tcache_flush_large_div", 1, 16, CONF_CHECK_MIN,
 			    CONF_CHECK_MAX, /* clip */ true)
+			CONF_HANDLE_BOOL(opt_tcache_adaptive, "tcache_adaptive")
+			CONF_HANDLE_SIZE_T(opt_tcache_adaptive_budget,
+			    "tcache_adaptive_budget", 0, SIZE_T_MAX,
+			    CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX,
+			    /* clip */ false)
+			CONF_HANDLE_SIZE_T(opt_tcache_global_budget,
+			    "tcache_global_budget", 0, SIZE_T_MAX,
+			    CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX,
+			    /* clip */ false)
 			CONF_HANDLE_UNSIGNED(opt_debug_double_free_max_scan,
 			    "debug_double_free_max_scan", 0, UINT_MAX,
 			    CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX,
@@ -806,6 +859,13 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			CONF_HANDLE_SIZE_T(opt_oversize_threshold,
 			    "oversize_threshold", 0, SC_LARGE_MAXCLASS,
 			    CONF_DONT_CHECK_MIN, CONF_CHECK_MAX, false)
+			CONF_HANDLE_SIZE_T(opt_realloc_remap_threshold,
+			    "realloc_remap_threshold", 0, SIZE_T_MAX,
+			    CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX,
+			    /* clip */ false)
+			CONF_HANDLE_SIZE_T(opt_zero_pool_max, "zero_pool_max",
+			    0, SIZE_T_MAX, CONF_DONT_CHECK_MIN,
+			    CONF_DONT_CHECK_MAX, /* clip */ false)
 			CONF_HANDLE_SIZE_T(opt_lg_extent_max_active_fit,
 			    "lg_extent_max_active_fit", 0,
 			    (sizeof(size_t) << 3), CONF_DONT_CHECK_MIN,
@@ -834,6 +894,9 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 				}
 				CONF_CONTINUE;
 			}
+			CONF_HANDLE_BOOL(opt_percpu_cache, "percpu_cache")
+			CONF_HANDLE_BOOL(opt_pressure_purge, "pressure_purge")
+			CONF_HANDLE_BOOL(opt_numa, "numa")
 			CONF_HANDLE_BOOL(
 			    opt_background_thread, "background_thread");
 			CONF_HANDLE_SIZE_T(opt_max_background_threads,
@@ -844,6 +907,12 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			CONF_HANDLE_SIZE_T(opt_hpa_opts.slab_max_alloc,
 			    "hpa_slab_max_alloc", PAGE, HUGEPAGE,
 			    CONF_CHECK_MIN, CONF_CHECK_MAX, true);
+			CONF_HANDLE_SIZE_T(opt_hpa_opts.span_max_alloc,
+			    "hpa_span_max_alloc", 0, SC_LARGE_MAXCLASS,
+			    CONF_DONT_CHECK_MIN, CONF_CHECK_MAX, true);
+			CONF_HANDLE_SIZE_T(opt_hpa_opts.resv_max_alloc,
+			    "hpa_resv_max_alloc", 0, HPA_RESV_NPAGES * PAGE,
+			    CONF_DONT_CHECK_MIN, CONF_CHECK_MAX, true);
 
 			/*
 			 * Accept either a ratio-based or an exact hugification
@@ -873,6 +942,13 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 
 			CONF_HANDLE_BOOL(
 			    opt_hpa_opts.hugify_sync, "hpa_hugify_sync");
+			CONF_HANDLE_BOOL(
+			    opt_hpa_opts.purge_lru, "hpa_purge_lru");
+
+			/* At most the whole of every second. */
+			CONF_HANDLE_UINT64_T(opt_hpa_opts.collapse_budget_us,
+			    "hpa_collapse_budget_us", 0, 1000 * 1000,
+			    CONF_DONT_CHECK_MIN, CONF_CHECK_MAX, true);
 
 			CONF_HANDLE_UINT64_T(opt_hpa_opts.min_purge_interval_ms,
 			    "hpa_min_purge_interval_ms", 0, 0,
@@ -944,8 +1020,12 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 				CONF_CONTINUE;
 			}
 			CONF_HANDLE_SIZE_T(opt_hpa_sec_opts.nshards,
-			    "hpa_sec_nshards", 0, 0, CONF_CHECK_MIN,
-			    CONF_DONT_CHECK_MAX, true);
+			    "hpa_sec_nshards", 0, SEC_NSHARDS_MAX,
+			    CONF_CHECK_MIN, CONF_CHECK_MAX, true);
+			CONF_HANDLE_BOOL(
+			    opt_hpa_sec_opts.percpu, "hpa_sec_percpu")
+			CONF_HANDLE_BOOL(
+			    opt_hpa_sec_opts.adaptive, "hpa_sec_adaptive")
 			CONF_HANDLE_SIZE_T(opt_hpa_sec_opts.max_alloc,
 			    "hpa_sec_max_alloc", PAGE,
 			    USIZE_GROW_SLOW_THRESHOLD, CONF_CHECK_MIN,
@@ -953,6 +1033,11 @@ malloc_conf_init_helper(sc_data_t *sc_data, unsigned bin_shard_sizes[SC_NBINS],
 			CONF_HANDLE_SIZE_T(opt_hpa_sec_opts.max_bytes,
 			    "hpa_sec_max_bytes", SEC_OPTS_MAX_BYTES_DEFAULT, 0,
 			    CONF_CHECK_MIN, CONF_DONT_CHECK_MAX, true);
+			CONF_HANDLE_UNSIGNED(opt_purge_threads, "purge_threads",
+			    0, PURGE_POOL_NTHREADS_MAX, CONF_DONT_CHECK_MIN,
+			    CONF_CHECK_MAX, true);
+			CONF_HANDLE_SIZE_T(opt_purge_budget, "purge_budget", 0,
+			    0, CONF_DONT_CHECK_MIN, CONF_DONT_CHECK_MAX, false);
 
 			if (CONF_MATCH("slab_sizes")) {
 				if (CONF_MATCH_VALUE("default")) {
@@ -2,18 +2,23 @@
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
 #include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/bin_regions.h"
 #include "jemalloc/internal/ctl.h"
 #include "jemalloc/internal/extent_dss.h"
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/inspect.h"
+#include "jemalloc/internal/mem_pressure.h"
 #include "jemalloc/internal/mutex.h"
 #include "jemalloc/internal/nstime.h"
+#include "jemalloc/internal/numa.h"
 #include "jemalloc/internal/peak_event.h"
+#include "jemalloc/internal/percpu_cache.h"
 #include "jemalloc/internal/prof_data.h"
 #include "jemalloc/internal/prof_log.h"
 #include "jemalloc/internal/prof_recent.h"
 #include "jemalloc/internal/prof_stats.h"
 #include "jemalloc/internal/prof_sys.h"
+#include "jemalloc/internal/purge_pool.h"
 #include "jemalloc/internal/safety_check.h"
 #include "jemalloc/internal/sc.h"
 #include "jemalloc/internal/util.h"
@@ -67,6 +72,8 @@ CTL_PROTO(background_thread)
 CTL_PROTO(max_background_threads)
 CTL_PROTO(thread_tcache_enabled)
 CTL_PROTO(thread_tcache_max)
+CTL_PROTO(thread_tcache_adaptive)
+CTL_PROTO(thread_tcache_adaptive_budget)
 CTL_PROTO(thread_tcache_flush)
 CTL_PROTO(thread_tcache_ncached_max_write)
 CTL_PROTO(thread_tcache_ncached_max_read_sizeclass)
@@ -103,9 +110,13 @@ CTL_PROTO(opt_experimental_hpa_enforce_hugify)
 CTL_PROTO(opt_confirm_conf)
 CTL_PROTO(opt_hpa)
 CTL_PROTO(opt_hpa_slab_max_alloc)
+CTL_PROTO(opt_hpa_span_max_alloc)
+CTL_PROTO(opt_hpa_resv_max_alloc)
 CTL_PROTO(opt_hpa_hugification_threshold)
 CTL_PROTO(opt_hpa_hugify_delay_ms)
 CTL_PROTO(opt_hpa_hugify_sync)
+CTL_PROTO(opt_hpa_purge_lru)
+CTL_PROTO(opt_hpa_collapse_budget_us)
 CTL_PROTO(opt_hpa_min_purge_interval_ms)
 CTL_PROTO(opt_experimental_hpa_max_purge_nhp)
 CTL_PROTO(opt_hpa_purge_threshold)
@@ -115,17 +126,34 @@ CTL_PROTO(opt_hpa_dirty_mult)
 CTL_PROTO(opt_hpa_sec_nshards)
 CTL_PROTO(opt_hpa_sec_max_alloc)
 CTL_PROTO(opt_hpa_sec_max_bytes)
+CTL_PROTO(opt_hpa_sec_percpu)
+CTL_PROTO(opt_hpa_sec_adaptive)
+CTL_PROTO(opt_purge_threads)
+CTL_PROTO(opt_purge_budget)
 CTL_PROTO(opt_huge_arena_pac_thp)
 CTL_PROTO(opt_metadata_thp)
 CTL_PROTO(opt_retain)
 CTL_PROTO(opt_dss)
 CTL_PROTO(opt_narenas)
+CTL_PROTO(opt_bin_regions)
+CTL_PROTO(opt_lg_bin_region)
+CTL_PROTO(opt_bin_remote_free)
+CTL_PROTO(opt_bin_remote_free_max)
+CTL_PROTO(opt_slab_size_auto)
 CTL_PROTO(opt_percpu_arena)
+CTL_PROTO(opt_percpu_cache)
+CTL_PROTO(opt_pressure_purge)
+CTL_PROTO(opt_numa)
 CTL_PROTO(opt_oversize_threshold)
+CTL_PROTO(opt_realloc_remap_threshold)
+CTL_PROTO(opt_zero_pool_max)
 CTL_PROTO(opt_background_thread)
 CTL_PROTO(opt_mutex_max_spin)
 CTL_PROTO(opt_max_background_threads)
 CTL_PROTO(opt_dirty_decay_ms)
+CTL_PROTO(opt_dirty_decay_predictive)
+CTL_PROTO(opt_cold_age_ms)
+CTL_PROTO(opt_cold_pageout)
 CTL_PROTO(opt_muzzy_decay_ms)
 CTL_PROTO(opt_stats_print)
 CTL_PROTO(opt_stats_print_opts)
@@ -147,6 +175,9 @@ CTL_PROTO(opt_tcache_gc_incr_bytes)
 CTL_PROTO(opt_tcache_gc_delay_bytes)
 CTL_PROTO(opt_lg_tcache_flush_small_div)
 CTL_PROTO(opt_lg_tcache_flush_large_div)
+CTL_PROTO(opt_tcache_adaptive)
+CTL_PROTO(opt_tcache_adaptive_budget)
+CTL_PROTO(opt_tcache_global_budget)
 CTL_PROTO(opt_thp)
 CTL_PROTO(opt_lg_extent_max_active_fit)
 CTL_PROTO(opt_prof)
@@ -194,6 +225,7 @@ CTL_PROTO(arenas_bin_i_size)
 CTL_PROTO(arenas_bin_i_nregs)
 CTL_PROTO(arenas_bin_i_slab_size)
 CTL_PROTO(arenas_bin_i_nshards)
+CTL_PROTO(arenas_bin_i_huge)
 INDEX_PROTO(arenas_bin_i)
 CTL_PROTO(arenas_lextent_i_size)
 INDEX_PROTO(arenas_lextent_i)
@@ -247,6 +279,11 @@ CTL_PROTO(stats_arenas_i_bins_j_nslabs)
 CTL_PROTO(stats_arenas_i_bins_j_nreslabs)
 CTL_PROTO(stats_arenas_i_bins_j_curslabs)
 CTL_PROTO(stats_arenas_i_bins_j_nonfull_slabs)
+CTL_PROTO(stats_arenas_i_bins_j_curslabs_huge)
+CTL_PROTO(stats_arenas_i_bins_j_slab_size)
+CTL_PROTO(stats_arenas_i_bins_j_nslab_grows)
+CTL_PROTO(stats_arenas_i_bins_j_nslab_shrinks)
+CTL_PROTO(stats_arenas_i_bins_j_nremote_frees)
 INDEX_PROTO(stats_arenas_i_bins_j)
 CTL_PROTO(stats_arenas_i_lextents_j_nmalloc)
 CTL_PROTO(stats_arenas_i_lextents_j_ndalloc)
@@ -273,6 +310,11 @@ CTL_PROTO(stats_arenas_i_hpa_shard_npurges)
 CTL_PROTO(stats_arenas_i_hpa_shard_nhugifies)
 CTL_PROTO(stats_arenas_i_hpa_shard_nhugify_failures)
 CTL_PROTO(stats_arenas_i_hpa_shard_ndehugifies)
+CTL_PROTO(stats_arenas_i_hpa_shard_ncollapses)
+CTL_PROTO(stats_arenas_i_hpa_shard_ncollapse_failures)
+CTL_PROTO(stats_arenas_i_hpa_shard_nrefaults)
+CTL_PROTO(stats_arenas_i_hpa_shard_collapse_ns)
+CTL_PROTO(stats_arenas_i_hpa_shard_collapse_max_ns)
 
 /* Set of stats for non-hugified and hugified slabs. */
 CTL_PROTO(stats_arenas_i_hpa_shard_slabs_npageslabs_nonhuge)
@@ -331,6 +373,12 @@ CTL_PROTO(stats_arenas_i_mapped)
 CTL_PROTO(stats_arenas_i_retained)
 CTL_PROTO(stats_arenas_i_pinned)
 CTL_PROTO(stats_arenas_i_extent_avail)
+CTL_PROTO(stats_arenas_i_zero_pool_bytes)
+CTL_PROTO(stats_arenas_i_bin_regions_bytes)
+CTL_PROTO(stats_arenas_i_bin_regions_dirty_bytes)
+CTL_PROTO(stats_arenas_i_huge_bins_dirty_bytes)
+CTL_PROTO(stats_arenas_i_zero_pool_hits)
+CTL_PROTO(stats_arenas_i_zero_pool_misses)
 CTL_PROTO(stats_arenas_i_dirty_npurge)
 CTL_PROTO(stats_arenas_i_dirty_nmadvise)
 CTL_PROTO(stats_arenas_i_dirty_purged)
@@ -346,12 +394,18 @@ CTL_PROTO(stats_arenas_i_tcache_bytes)
 CTL_PROTO(stats_arenas_i_tcache_stashed_bytes)
 CTL_PROTO(stats_arenas_i_resident)
 CTL_PROTO(stats_arenas_i_abandoned_vm)
+CTL_PROTO(stats_arenas_i_cold_demoted)
 CTL_PROTO(stats_arenas_i_hpa_sec_bytes)
 CTL_PROTO(stats_arenas_i_hpa_sec_hits)
 CTL_PROTO(stats_arenas_i_hpa_sec_misses)
 CTL_PROTO(stats_arenas_i_hpa_sec_dalloc_flush)
 CTL_PROTO(stats_arenas_i_hpa_sec_dalloc_noflush)
 CTL_PROTO(stats_arenas_i_hpa_sec_overfills)
+CTL_PROTO(stats_arenas_i_hpa_sec_lock_contended)
+CTL_PROTO(stats_arenas_i_hpa_sec_shards_j_hits)
+CTL_PROTO(stats_arenas_i_hpa_sec_shards_j_misses)
+CTL_PROTO(stats_arenas_i_hpa_sec_shards_j_lock_contended)
+INDEX_PROTO(stats_arenas_i_hpa_sec_shards_j)
 INDEX_PROTO(stats_arenas_i)
 CTL_PROTO(stats_allocated)
 CTL_PROTO(stats_active)
@@ -367,6 +421,8 @@ CTL_PROTO(stats_mapped)
 CTL_PROTO(stats_retained)
 CTL_PROTO(stats_pinned)
 CTL_PROTO(stats_zero_reallocs)
+CTL_PROTO(stats_percpu_cache_bytes)
+CTL_PROTO(stats_realloc_remap_mappings)
 CTL_PROTO(approximate_stats_active)
 CTL_PROTO(experimental_hooks_prof_backtrace)
 CTL_PROTO(experimental_hooks_prof_dump)
@@ -381,6 +437,8 @@ INDEX_PROTO(experimental_arenas_i)
 CTL_PROTO(experimental_prof_recent_alloc_max)
 CTL_PROTO(experimental_prof_recent_alloc_dump)
 CTL_PROTO(experimental_batch_alloc)
+CTL_PROTO(experimental_batch_free)
+CTL_PROTO(experimental_percpu_cache_flush)
 CTL_PROTO(experimental_arenas_create_ext)
 
 #define MUTEX_STATS_CTL_PROTO_GEN(n)                                           \
@@ -430,6 +488,8 @@ static const ctl_named_node_t thread_tcache_ncached_max_node[] = {
 static const ctl_named_node_t thread_tcache_node[] = {
     {NAME("enabled"), CTL(thread_tcache_enabled)},
     {NAME("max"), CTL(thread_tcache_max)},
+    {NAME("adaptive"), CTL(thread_tcache_adaptive)},
+    {NAME("adaptive_budget"), CTL(thread_tcache_adaptive_budget)},
     {NAME("flush"), CTL(thread_tcache_flush)},
     {NAME("ncached_max"), CHILD(named, thread_tcache_ncached_max)}};
 
@@ -483,9 +543,13 @@ static const ctl_named_node_t opt_node[] = {{NAME("abort"), CTL(opt_abort)},
         CTL(opt_experimental_hpa_enforce_hugify)},
     {NAME("confirm_conf"), CTL(opt_confirm_conf)}, {NAME("hpa"), CTL(opt_hpa)},
     {NAME("hpa_slab_max_alloc"), CTL(opt_hpa_slab_max_alloc)},
+    {NAME("hpa_span_max_alloc"), CTL(opt_hpa_span_max_alloc)},
+    {NAME("hpa_resv_max_alloc"), CTL(opt_hpa_resv_max_alloc)},
     {NAME("hpa_hugification_threshold"), CTL(opt_hpa_hugification_threshold)},
     {NAME("hpa_hugify_delay_ms"), CTL(opt_hpa_hugify_delay_ms)},
     {NAME("hpa_hugify_sync"), CTL(opt_hpa_hugify_sync)},
+    {NAME("hpa_purge_lru"), CTL(opt_hpa_purge_lru)},
+    {NAME("hpa_collapse_budget_us"), CTL(opt_hpa_collapse_budget_us)},
     {NAME("hpa_min_purge_interval_ms"), CTL(opt_hpa_min_purge_interval_ms)},
     {NAME("experimental_hpa_max_purge_nhp"),
         CTL(opt_experimental_hpa_max_purge_nhp)},
@@ -496,16 +560,33 @@ static const ctl_named_node_t opt_node[] = {{NAME("abort"), CTL(opt_abort)},
     {NAME("hpa_sec_nshards"), CTL(opt_hpa_sec_nshards)},
     {NAME("hpa_sec_max_alloc"), CTL(opt_hpa_sec_max_alloc)},
     {NAME("hpa_sec_max_bytes"), CTL(opt_hpa_sec_max_bytes)},
+    {NAME("hpa_sec_percpu"), CTL(opt_hpa_sec_percpu)},
+    {NAME("hpa_sec_adaptive"), CTL(opt_hpa_sec_adaptive)},
+    {NAME("purge_threads"), CTL(opt_purge_threads)},
+    {NAME("purge_budget"), CTL(opt_purge_budget)},
     {NAME("huge_arena_pac_thp"), CTL(opt_huge_arena_pac_thp)},
     {NAME("metadata_thp"), CTL(opt_metadata_thp)},
     {NAME("retain"), CTL(opt_retain)}, {NAME("dss"), CTL(opt_dss)},
     {NAME("narenas"), CTL(opt_narenas)},
+    {NAME("bin_regions"), CTL(opt_bin_regions)},
+    {NAME("lg_bin_region"), CTL(opt_lg_bin_region)},
+    {NAME("bin_remote_free"), CTL(opt_bin_remote_free)},
+    {NAME("bin_remote_free_max"), CTL(opt_bin_remote_free_max)},
+    {NAME("slab_size_auto"), CTL(opt_slab_size_auto)},
     {NAME("percpu_arena"), CTL(opt_percpu_arena)},
+    {NAME("percpu_cache"), CTL(opt_percpu_cache)},
+    {NAME("pressure_purge"), CTL(opt_pressure_purge)},
+    {NAME("numa"), CTL(opt_numa)},
     {NAME("oversize_threshold"), CTL(opt_oversize_threshold)},
+    {NAME("realloc_remap_threshold"), CTL(opt_realloc_remap_threshold)},
+    {NAME("zero_pool_max"), CTL(opt_zero_pool_max)},
     {NAME("mutex_max_spin"), CTL(opt_mutex_max_spin)},
     {NAME("background_thread"), CTL(opt_background_thread)},
     {NAME("max_background_threads"), CTL(opt_max_background_threads)},
     {NAME("dirty_decay_ms"), CTL(opt_dirty_decay_ms)},
+    {NAME("dirty_decay_predictive"), CTL(opt_dirty_decay_predictive)},
+    {NAME("cold_age_ms"), CTL(opt_cold_age_ms)},
+    {NAME("cold_pageout"), CTL(opt_cold_pageout)},
     {NAME("muzzy_decay_ms"), CTL(opt_muzzy_decay_ms)},
     {NAME("stats_print"), CTL(opt_stats_print)},
     {NAME("stats_print_opts"), CTL(opt_stats_print_opts)},
@@ -525,6 +606,9 @@ static const ctl_named_node_t opt_node[] = {{NAME("abort"), CTL(opt_abort)},
     {NAME("tcache_gc_delay_bytes"), CTL(opt_tcache_gc_delay_bytes)},
     {NAME("lg_tcache_flush_small_div"), CTL(opt_lg_tcache_flush_small_div)},
     {NAME("lg_tcache_flush_large_div"), CTL(opt_lg_tcache_flush_large_div)},
+    {NAME("tcache_adaptive"), CTL(opt_tcache_adaptive)},
+    {NAME("tcache_adaptive_budget"), CTL(opt_tcache_adaptive_budget)},
+    {NAME("tcache_global_budget"), CTL(opt_tcache_global_budget)},
     {NAME("thp"), CTL(opt_thp)},
     {NAME("lg_extent_max_active_fit"), CTL(opt_lg_extent_max_active_fit)},
     {NAME("prof"), CTL(opt_prof)}, {NAME("prof_prefix"), CTL(opt_prof_prefix)},
@@ -578,7 +662,8 @@ static const ctl_named_node_t arenas_bin_i_node[] = {
     {NAME("size"), CTL(arenas_bin_i_size)},
     {NAME("nregs"), CTL(arenas_bin_i_nregs)},
     {NAME("slab_size"), CTL(arenas_bin_i_slab_size)},
-    {NAME("nshards"), CTL(arenas_bin_i_nshards)}};
+    {NAME("nshards"), CTL(arenas_bin_i_nshards)},
+    {NAME("huge"), CTL(arenas_bin_i_huge)}};
 static const ctl_named_node_t super_arenas_bin_i_node[] = {
     {NAME(""), CHILD(named, arenas_bin_i)}};
 
@@ -682,6 +767,11 @@ static const ctl_named_node_t stats_arenas_i_bins_j_node[] = {
     {NAME("nreslabs"), CTL(stats_arenas_i_bins_j_nreslabs)},
     {NAME("curslabs"), CTL(stats_arenas_i_bins_j_curslabs)},
     {NAME("nonfull_slabs"), CTL(stats_arenas_i_bins_j_nonfull_slabs)},
+    {NAME("curslabs_huge"), CTL(stats_arenas_i_bins_j_curslabs_huge)},
+    {NAME("slab_size"), CTL(stats_arenas_i_bins_j_slab_size)},
+    {NAME("nslab_grows"), CTL(stats_arenas_i_bins_j_nslab_grows)},
+    {NAME("nslab_shrinks"), CTL(stats_arenas_i_bins_j_nslab_shrinks)},
+    {NAME("nremote_frees"), CTL(stats_arenas_i_bins_j_nremote_frees)},
     {NAME("mutex"), CHILD(named, stats_arenas_i_bins_j_mutex)}};
 
 static const ctl_named_node_t super_stats_arenas_i_bins_j_node[] = {
@@ -817,6 +907,11 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_node[] = {
     {NAME("nhugifies"), CTL(stats_arenas_i_hpa_shard_nhugifies)},
     {NAME("nhugify_failures"), CTL(stats_arenas_i_hpa_shard_nhugify_failures)},
     {NAME("ndehugifies"), CTL(stats_arenas_i_hpa_shard_ndehugifies)},
+    {NAME("ncollapses"), CTL(stats_arenas_i_hpa_shard_ncollapses)},
+    {NAME("ncollapse_failures"), CTL(stats_arenas_i_hpa_shard_ncollapse_failures)},
+    {NAME("nrefaults"), CTL(stats_arenas_i_hpa_shard_nrefaults)},
+    {NAME("collapse_ns"), CTL(stats_arenas_i_hpa_shard_collapse_ns)},
+    {NAME("collapse_max_ns"), CTL(stats_arenas_i_hpa_shard_collapse_max_ns)},
 
     {NAME("alloc"), CHILD(indexed, stats_arenas_i_hpa_shard_alloc)},
 
@@ -825,6 +920,18 @@ static const ctl_named_node_t stats_arenas_i_hpa_shard_node[] = {
     {NAME("nonfull_slabs"),
         CHILD(indexed, stats_arenas_i_hpa_shard_nonfull_slabs)}};
 
+static const ctl_named_node_t stats_arenas_i_hpa_sec_shards_j_node[] = {
+    {NAME("hits"), CTL(stats_arenas_i_hpa_sec_shards_j_hits)},
+    {NAME("misses"), CTL(stats_arenas_i_hpa_sec_shards_j_misses)},
+    {NAME("lock_contended"),
+        CTL(stats_arenas_i_hpa_sec_shards_j_lock_contended)}};
+
+static const ctl_named_node_t super_stats_arenas_i_hpa_sec_shards_j_node[] = {
+    {NAME(""), CHILD(named, stats_arenas_i_hpa_sec_shards_j)}};
+
+static const ctl_indexed_node_t stats_arenas_i_hpa_sec_shards_node[] = {
+    {INDEX(stats_arenas_i_hpa_sec_shards_j)}};
+
 static const ctl_named_node_t stats_arenas_i_node[] = {
     {NAME("nthreads"), CTL(stats_arenas_i_nthreads)},
     {NAME("uptime"), CTL(stats_arenas_i_uptime)},
@@ -838,6 +945,14 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
     {NAME("retained"), CTL(stats_arenas_i_retained)},
     {NAME("pinned"), CTL(stats_arenas_i_pinned)},
     {NAME("extent_avail"), CTL(stats_arenas_i_extent_avail)},
+    {NAME("zero_pool_bytes"), CTL(stats_arenas_i_zero_pool_bytes)},
+    {NAME("bin_regions_bytes"), CTL(stats_arenas_i_bin_regions_bytes)},
+    {NAME("bin_regions_dirty_bytes"),
+        CTL(stats_arenas_i_bin_regions_dirty_bytes)},
+    {NAME("huge_bins_dirty_bytes"),
+        CTL(stats_arenas_i_huge_bins_dirty_bytes)},
+    {NAME("zero_pool_hits"), CTL(stats_arenas_i_zero_pool_hits)},
+    {NAME("zero_pool_misses"), CTL(stats_arenas_i_zero_pool_misses)},
     {NAME("dirty_npurge"), CTL(stats_arenas_i_dirty_npurge)},
     {NAME("dirty_nmadvise"), CTL(stats_arenas_i_dirty_nmadvise)},
     {NAME("dirty_purged"), CTL(stats_arenas_i_dirty_purged)},
@@ -853,6 +968,7 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
     {NAME("tcache_stashed_bytes"), CTL(stats_arenas_i_tcache_stashed_bytes)},
     {NAME("resident"), CTL(stats_arenas_i_resident)},
     {NAME("abandoned_vm"), CTL(stats_arenas_i_abandoned_vm)},
+    {NAME("cold_demoted"), CTL(stats_arenas_i_cold_demoted)},
     {NAME("hpa_sec_bytes"), CTL(stats_arenas_i_hpa_sec_bytes)},
     {NAME("hpa_sec_hits"), CTL(stats_arenas_i_hpa_sec_hits)},
     {NAME("hpa_sec_misses"), CTL(stats_arenas_i_hpa_sec_misses)},
@@ -860,6 +976,9 @@ static const ctl_named_node_t stats_arenas_i_node[] = {
         CTL(stats_arenas_i_hpa_sec_dalloc_noflush)},
     {NAME("hpa_sec_dalloc_flush"), CTL(stats_arenas_i_hpa_sec_dalloc_flush)},
     {NAME("hpa_sec_overfills"), CTL(stats_arenas_i_hpa_sec_overfills)},
+    {NAME("hpa_sec_lock_contended"),
+        CTL(stats_arenas_i_hpa_sec_lock_contended)},
+    {NAME("hpa_sec_shards"), CHILD(indexed, stats_arenas_i_hpa_sec_shards)},
     {NAME("small"), CHILD(named, stats_arenas_i_small)},
     {NAME("large"), CHILD(named, stats_arenas_i_large)},
     {NAME("bins"), CHILD(indexed, stats_arenas_i_bins)},
@@ -907,6 +1026,8 @@ static const ctl_named_node_t stats_node[] = {
     {NAME("mutexes"), CHILD(named, stats_mutexes)},
     {NAME("arenas"), CHILD(indexed, stats_arenas)},
     {NAME("zero_reallocs"), CTL(stats_zero_reallocs)},
+    {NAME("percpu_cache_bytes"), CTL(stats_percpu_cache_bytes)},
+    {NAME("realloc_remap_mappings"), CTL(stats_realloc_remap_mappings)},
 };
 
 static const ctl_named_node_t experimental_hooks_node[] = {
@@ -941,7 +1062,9 @@ static const ctl_named_node_t experimental_node[] = {
     {NAME("arenas"), CHILD(indexed, experimental_arenas)},
     {NAME("arenas_create_ext"), CTL(experimental_arenas_create_ext)},
     {NAME("prof_recent"), CHILD(named, experimental_prof_recent)},
-    {NAME("batch_alloc"), CTL(experimental_batch_alloc)}};
+    {NAME("batch_alloc"), CTL(experimental_batch_alloc)},
+    {NAME("batch_free"), CTL(experimental_batch_free)},
+    {NAME("percpu_cache_flush"), CTL(experimental_percpu_cache_flush)}};
 
 static const ctl_named_node_t root_node[] = {{NAME("version"), CTL(version)},
     {NAME("epoch"), CTL(epoch)},
@@ -1144,7 +1267,20 @@ ctl_arena_stats_sdmerge(
 			    astats->astats.pa_shard_stats.pac_stats.pinned;
 			sdstats->astats.pa_shard_stats.edata_avail +=
 			    astats->astats.pa_shard_stats.edata_avail;
+			sdstats->astats.pa_shard_stats.zero_pool_bytes +=
+			    astats->astats.pa_shard_stats.zero_pool_bytes;
+			sdstats->astats.pa_shard_stats.bin_regions_bytes +=
+			    astats->astats.pa_shard_stats.bin_regions_bytes;
+			sdstats->astats.pa_shard_stats.bin_regions_dirty_bytes +=
+			    astats->astats.pa_shard_stats
+			        .bin_regions_dirty_bytes;
+			sdstats->astats.pa_shard_stats.huge_bins_dirty_bytes +=
+			    astats->astats.pa_shard_stats.huge_bins_dirty_bytes;
 		}
+		sdstats->astats.pa_shard_stats.zero_pool_nhits +=
+		    astats->astats.pa_shard_stats.zero_pool_nhits;
+		sdstats->astats.pa_shard_stats.zero_pool_nmisses +=
+		    astats->astats.pa_shard_stats.zero_pool_nmisses;
 
 		ctl_accum_locked_u64(&sdstats->astats.pa_shard_stats.pac_stats
 		                         .decay_dirty.npurge,
@@ -1220,6 +1356,9 @@ ctl_arena_stats_sdmerge(
 		ctl_accum_atomic_zu(
 		    &sdstats->astats.pa_shard_stats.pac_stats.abandoned_vm,
 		    &astats->astats.pa_shard_stats.pac_stats.abandoned_vm);
+		ctl_accum_atomic_zu(
+		    &sdstats->astats.pa_shard_stats.pac_stats.cold_demoted,
+		    &astats->astats.pa_shard_stats.pac_stats.cold_demoted);
 
 		sdstats->astats.tcache_bytes += astats->astats.tcache_bytes;
 		sdstats->astats.tcache_stashed_bytes +=
@@ -1245,12 +1384,23 @@ ctl_arena_stats_sdmerge(
 			merged->nflushes += bstats->nflushes;
 			merged->nslabs += bstats->nslabs;
 			merged->reslabs += bstats->reslabs;
+			merged->nremote_frees += bstats->nremote_frees;
+			merged->nslab_grows += bstats->nslab_grows;
+			merged->nslab_shrinks += bstats->nslab_shrinks;
+			if (bstats->slab_lg_scale > merged->slab_lg_scale) {
+				merged->slab_lg_scale = bstats->slab_lg_scale;
+			}
 			if (!destroyed) {
 				merged->curslabs += bstats->curslabs;
 				merged->nonfull_slabs += bstats->nonfull_slabs;
+				merged->curslabs_huge += bstats->curslabs_huge;
+				merged->curslabs_nregs +=
+				    bstats->curslabs_nregs;
 			} else {
 				assert(bstats->curslabs == 0);
 				assert(bstats->nonfull_slabs == 0);
+				assert(bstats->curslabs_huge == 0);
+				assert(bstats->curslabs_nregs == 0);
 			}
 			malloc_mutex_prof_merge(&sdstats->bstats[i].mutex_data,
 			    &astats->bstats[i].mutex_data);
@@ -2190,6 +2340,9 @@ CTL_RO_NL_GEN(
     opt_hpa_hugification_threshold, opt_hpa_opts.hugification_threshold, size_t)
 CTL_RO_NL_GEN(opt_hpa_hugify_delay_ms, opt_hpa_opts.hugify_delay_ms, uint64_t)
 CTL_RO_NL_GEN(opt_hpa_hugify_sync, opt_hpa_opts.hugify_sync, bool)
+CTL_RO_NL_GEN(opt_hpa_purge_lru, opt_hpa_opts.purge_lru, bool)
+CTL_RO_NL_GEN(
+    opt_hpa_collapse_budget_us, opt_hpa_opts.collapse_budget_us, uint64_t)
 CTL_RO_NL_GEN(
     opt_hpa_min_purge_interval_ms, opt_hpa_opts.min_purge_interval_ms, uint64_t)
 CTL_RO_NL_GEN(opt_experimental_hpa_max_purge_nhp,
@@ -2205,24 +2358,44 @@ CTL_RO_NL_GEN(opt_hpa_hugify_style,
  */
 CTL_RO_NL_GEN(opt_hpa_dirty_mult, opt_hpa_opts.dirty_mult, fxp_t)
 CTL_RO_NL_GEN(opt_hpa_slab_max_alloc, opt_hpa_opts.slab_max_alloc, size_t)
+CTL_RO_NL_GEN(opt_hpa_span_max_alloc, opt_hpa_opts.span_max_alloc, size_t)
+CTL_RO_NL_GEN(opt_hpa_resv_max_alloc, opt_hpa_opts.resv_max_alloc, size_t)
 
 /* HPA SEC options */
 CTL_RO_NL_GEN(opt_hpa_sec_nshards, opt_hpa_sec_opts.nshards, size_t)
 CTL_RO_NL_GEN(opt_hpa_sec_max_alloc, opt_hpa_sec_opts.max_alloc, size_t)
 CTL_RO_NL_GEN(opt_hpa_sec_max_bytes, opt_hpa_sec_opts.max_bytes, size_t)
+CTL_RO_NL_GEN(opt_hpa_sec_percpu, opt_hpa_sec_opts.percpu, bool)
+CTL_RO_NL_GEN(opt_hpa_sec_adaptive, opt_hpa_sec_opts.adaptive, bool)
+CTL_RO_NL_GEN(opt_purge_threads, opt_purge_threads, unsigned)
+CTL_RO_NL_GEN(opt_purge_budget, opt_purge_budget, size_t)
 CTL_RO_NL_GEN(opt_huge_arena_pac_thp, opt_huge_arena_pac_thp, bool)
 CTL_RO_NL_GEN(
     opt_metadata_thp, metadata_thp_mode_names[opt_metadata_thp], const char *)
 CTL_RO_NL_GEN(opt_retain, opt_retain, bool)
 CTL_RO_NL_GEN(opt_dss, opt_dss, const char *)
 CTL_RO_NL_GEN(opt_narenas, opt_narenas, unsigned)
+CTL_RO_NL_GEN(opt_bin_regions, opt_bin_regions, bool)
+CTL_RO_NL_GEN(opt_lg_bin_region, opt_lg_bin_region, unsigned)
+CTL_RO_NL_GEN(opt_bin_remote_free, opt_bin_remote_free, bool)
+CTL_RO_NL_GEN(opt_bin_remote_free_max, opt_bin_remote_free_max, size_t)
+CTL_RO_NL_GEN(opt_slab_size_auto, opt_slab_size_auto, bool)
 CTL_RO_NL_GEN(
     opt_percpu_arena, percpu_arena_mode_names[opt_percpu_arena], const char *)
+CTL_RO_NL_GEN(opt_percpu_cache, opt_percpu_cache, bool)
+CTL_RO_NL_GEN(opt_pressure_purge, opt_pressure_purge, bool)
+CTL_RO_NL_GEN(opt_numa, opt_numa, bool)
 CTL_RO_NL_GEN(opt_mutex_max_spin, opt_mutex_max_spin, int64_t)
 CTL_RO_NL_GEN(opt_oversize_threshold, opt_oversize_threshold, size_t)
+CTL_RO_NL_GEN(
+    opt_realloc_remap_threshold, opt_realloc_remap_threshold, size_t)
+CTL_RO_NL_GEN(opt_zero_pool_max, opt_zero_pool_max, size_t)
 CTL_RO_NL_GEN(opt_background_thread, opt_background_thread, bool)
 CTL_RO_NL_GEN(opt_max_background_threads, opt_max_background_threads, size_t)
 CTL_RO_NL_GEN(opt_dirty_decay_ms, opt_dirty_decay_ms, ssize_t)
+CTL_RO_NL_GEN(opt_dirty_decay_predictive, opt_dirty_decay_predictive, bool)
+CTL_RO_NL_GEN(opt_cold_age_ms, opt_cold_age_ms, ssize_t)
+CTL_RO_NL_GEN(opt_cold_pageout, opt_cold_pageout, bool)
 CTL_RO_NL_GEN(opt_muzzy_decay_ms, opt_muzzy_decay_ms, ssize_t)
 CTL_RO_NL_GEN(opt_stats_print, opt_stats_print, bool)
 CTL_RO_NL_GEN(opt_stats_print_opts, opt_stats_print_opts, const char *)
@@ -2249,6 +2422,9 @@ CTL_RO_NL_GEN(
     opt_lg_tcache_flush_small_div, opt_lg_tcache_flush_small_div, unsigned)
 CTL_RO_NL_GEN(
     opt_lg_tcache_flush_large_div, opt_lg_tcache_flush_large_div, unsigned)
+CTL_RO_NL_GEN(opt_tcache_adaptive, opt_tcache_adaptive, bool)
+CTL_RO_NL_GEN(opt_tcache_adaptive_budget, opt_tcache_adaptive_budget, size_t)
+CTL_RO_NL_GEN(opt_tcache_global_budget, opt_tcache_global_budget, size_t)
 CTL_RO_NL_GEN(opt_thp, thp_mode_names[opt_thp], const char *)
 CTL_RO_NL_GEN(
     opt_lg_extent_max_active_fit, opt_lg_extent_max_active_fit, size_t)
@@ -2476,6 +2652,54 @@ label_return:
 	return ret;
 }
 
+static int
+thread_tcache_adaptive_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int  ret;
+	bool oldval;
+
+	oldval = tsd_tcache_slowp_get(tsd)->adaptive;
+	READ(oldval, bool);
+
+	if (newp != NULL) {
+		if (newlen != sizeof(bool)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		bool adaptive = oldval;
+		WRITE(adaptive, bool);
+		thread_tcache_adaptive_set(tsd, adaptive);
+	}
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
+static int
+thread_tcache_adaptive_budget_ctl(tsd_t *tsd, const size_t *mib,
+    size_t miblen, void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int    ret;
+	size_t oldval;
+
+	oldval = tsd_tcache_slowp_get(tsd)->adaptive_budget;
+	READ(oldval, size_t);
+
+	if (newp != NULL) {
+		if (newlen != sizeof(size_t)) {
+			ret = EINVAL;
+			goto label_return;
+		}
+		size_t budget = oldval;
+		WRITE(budget, size_t);
+		thread_tcache_adaptive_budget_set(tsd, budget);
+	}
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
 static int
 thread_tcache_flush_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
     void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
@@ -3277,6 +3501,7 @@ CTL_RO_NL_GEN(arenas_bin_i_size, bin_infos[mib[2]].reg_size, size_t)
 CTL_RO_NL_GEN(arenas_bin_i_nregs, bin_infos[mib[2]].nregs, uint32_t)
 CTL_RO_NL_GEN(arenas_bin_i_slab_size, bin_infos[mib[2]].slab_size, size_t)
 CTL_RO_NL_GEN(arenas_bin_i_nshards, bin_infos[mib[2]].n_shards, uint32_t)
+CTL_RO_NL_GEN(arenas_bin_i_huge, bin_infos[mib[2]].huge, bool)
 static const ctl_named_node_t *
 arenas_bin_i_index(tsdn_t *tsdn, const size_t *mib, size_t miblen, size_t i) {
 	if (i >= SC_NBINS) {
@@ -3761,6 +3986,10 @@ CTL_RO_CGEN(config_stats, stats_background_thread_run_interval,
 
 CTL_RO_CGEN(config_stats, stats_zero_reallocs,
     atomic_load_zu(&zero_realloc_count, ATOMIC_RELAXED), size_t)
+CTL_RO_CGEN(config_stats, stats_percpu_cache_bytes,
+    percpu_cache_bytes_get(tsd_tsdn(tsd)), size_t)
+CTL_RO_CGEN(config_stats, stats_realloc_remap_mappings,
+    pages_remap_nmaps_avail_get(), size_t)
 
 /*
  * approximate_stats.active returns a result that is informative itself,
@@ -3820,6 +4049,21 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_pinned,
     arenas_i(mib[2])->astats->astats.pa_shard_stats.pac_stats.pinned, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_extent_avail,
     arenas_i(mib[2])->astats->astats.pa_shard_stats.edata_avail, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_zero_pool_bytes,
+    arenas_i(mib[2])->astats->astats.pa_shard_stats.zero_pool_bytes, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bin_regions_bytes,
+    arenas_i(mib[2])->astats->astats.pa_shard_stats.bin_regions_bytes, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bin_regions_dirty_bytes,
+    arenas_i(mib[2])->astats->astats.pa_shard_stats.bin_regions_dirty_bytes,
+    size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_huge_bins_dirty_bytes,
+    arenas_i(mib[2])->astats->astats.pa_shard_stats.huge_bins_dirty_bytes,
+    size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_zero_pool_hits,
+    arenas_i(mib[2])->astats->astats.pa_shard_stats.zero_pool_nhits, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_zero_pool_misses,
+    arenas_i(mib[2])->astats->astats.pa_shard_stats.zero_pool_nmisses,
+    uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_dirty_npurge,
     locked_read_u64_unsynchronized(&arenas_i(mib[2])
@@ -3869,6 +4113,11 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_abandoned_vm,
         &arenas_i(mib[2])->astats->astats.pa_shard_stats.pac_stats.abandoned_vm,
         ATOMIC_RELAXED),
     size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_cold_demoted,
+    atomic_load_zu(
+        &arenas_i(mib[2])->astats->astats.pa_shard_stats.pac_stats.cold_demoted,
+        ATOMIC_RELAXED),
+    size_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_bytes,
     arenas_i(mib[2])->astats->hpastats.secstats.bytes, size_t)
@@ -3882,6 +4131,24 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_dalloc_noflush,
     arenas_i(mib[2])->astats->hpastats.secstats.total.ndalloc_noflush, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_overfills,
     arenas_i(mib[2])->astats->hpastats.secstats.total.noverfills, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_lock_contended,
+    arenas_i(mib[2])->astats->hpastats.secstats.total.nlock_contended, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_shards_j_hits,
+    arenas_i(mib[2])->astats->hpastats.secstats.shards[mib[4]].nhits, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_shards_j_misses,
+    arenas_i(mib[2])->astats->hpastats.secstats.shards[mib[4]].nmisses, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_sec_shards_j_lock_contended,
+    arenas_i(mib[2])->astats->hpastats.secstats.shards[mib[4]].nlock_contended,
+    size_t)
+
+static const ctl_named_node_t *
+stats_arenas_i_hpa_sec_shards_j_index(
+    tsdn_t *tsdn, const size_t *mib, size_t miblen, size_t j) {
+	if (j >= SEC_NSHARDS_MAX) {
+		return NULL;
+	}
+	return super_stats_arenas_i_hpa_sec_shards_j_node;
+}
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_small_allocated,
     arenas_i(mib[2])->astats->allocated_small, size_t)
@@ -4027,6 +4294,20 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_curslabs,
     arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.curslabs, size_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nonfull_slabs,
     arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.nonfull_slabs, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_curslabs_huge,
+    arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.curslabs_huge, size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_slab_size,
+    bin_infos[mib[4]].slab_size
+        << arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.slab_lg_scale,
+    size_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nslab_grows,
+    arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.nslab_grows, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nslab_shrinks,
+    arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.nslab_shrinks,
+    uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_bins_j_nremote_frees,
+    arenas_i(mib[2])->astats->bstats[mib[4]].stats_data.nremote_frees,
+    uint64_t)
 
 static const ctl_named_node_t *
 stats_arenas_i_bins_j_index(
@@ -4122,6 +4403,16 @@ CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nhugify_failures,
     uint64_t)
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ndehugifies,
     arenas_i(mib[2])->astats->hpastats.nonderived_stats.ndehugifies, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ncollapses,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.ncollapses, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_ncollapse_failures,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.ncollapse_failures, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_nrefaults,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.nrefaults, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_collapse_ns,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.collapse_ns, uint64_t)
+CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_collapse_max_ns,
+    arenas_i(mib[2])->astats->hpastats.nonderived_stats.collapse_max_ns, uint64_t)
 
 CTL_RO_CGEN(config_stats, stats_arenas_i_hpa_shard_alloc_j_min_extents,
     arenas_i(mib[2])
@@ -4648,6 +4939,46 @@ label_return:
 	return ret;
 }
 
+/*
+ * Takes the same packet as batch_alloc; a size of 0 means the sizes are
+ * unknown and get looked up per pointer.
+ */
+static int
+experimental_batch_free_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
+    void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+
+	batch_alloc_packet_t batch_free_packet;
+	WRITEONLY();
+	ASSURED_WRITE(batch_free_packet, batch_alloc_packet_t);
+	batch_free(batch_free_packet.ptrs, batch_free_packet.num,
+	    batch_free_packet.size, batch_free_packet.flags);
+
+	ret = 0;
+
+label_return:
+	return ret;
+}
+
+static int
+experimental_percpu_cache_flush_ctl(tsd_t *tsd, const size_t *mib,
+    size_t miblen, void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
+	int ret;
+
+	if (!percpu_cache_enabled()) {
+		ret = EFAULT;
+		goto label_return;
+	}
+
+	NEITHER_READ_NOR_WRITE();
+
+	percpu_cache_flush_all(tsd);
+
+	ret = 0;
+label_return:
+	return ret;
+}
+
 static int
 prof_stats_bins_i_live_ctl(tsd_t *tsd, const size_t *mib, size_t miblen,
     void *oldp, size_t *oldlenp, void *newp, size_t newlen) {
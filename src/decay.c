@@ -41,6 +41,9 @@ decay_reinit(decay_t *decay, nstime_t *cur_time, ssize_t decay_ms) {
 	decay_deadline_init(decay);
 	decay->nunpurged = 0;
 	memset(decay->backlog, 0, SMOOTHSTEP_NSTEPS * sizeof(size_t));
+	decay->forecast_started = false;
+	decay->demand_peak = 0;
+	decay->forecast_limit = decay->npages_limit;
 }
 
 bool
@@ -209,6 +212,50 @@ decay_maybe_advance_epoch(
 	return true;
 }
 
+void
+decay_forecast_update(decay_t *decay, size_t nalloc) {
+	if (!decay->forecast_started) {
+		/* Nothing to compare against yet; just take the baseline. */
+		decay->forecast_started = true;
+		nstime_copy(&decay->forecast_epoch, &decay->epoch);
+		decay->nalloc = nalloc;
+		return;
+	}
+	uint64_t nepochs = 1;
+	if (nstime_compare(&decay->epoch, &decay->forecast_epoch) > 0) {
+		nstime_t delta;
+		nstime_copy(&delta, &decay->epoch);
+		nstime_subtract(&delta, &decay->forecast_epoch);
+		nepochs = nstime_divide(&delta, &decay->interval);
+		if (nepochs == 0) {
+			nepochs = 1;
+		}
+	}
+	nstime_copy(&decay->forecast_epoch, &decay->epoch);
+	/* The count may wrap around; unsigned subtraction copes with that. */
+	size_t demand = (size_t)((nalloc - decay->nalloc) / nepochs);
+	decay->nalloc = nalloc;
+
+	/* Rounding up, so that small peaks fade as well. */
+	size_t fade = (ZU(1) << DECAY_FORECAST_LG_FADE) - 1;
+	for (uint64_t i = 0; i < nepochs && decay->demand_peak > 0; i++) {
+		if (i == SMOOTHSTEP_NSTEPS) {
+			/* Idle for a whole decay time; forget the peak. */
+			decay->demand_peak = 0;
+			break;
+		}
+		decay->demand_peak -= (decay->demand_peak + fade)
+		    >> DECAY_FORECAST_LG_FADE;
+	}
+	if (demand > decay->demand_peak) {
+		decay->demand_peak = demand;
+	}
+	decay->forecast_limit = (decay->demand_peak
+	                            > SIZE_MAX / DECAY_FORECAST_HORIZON)
+	    ? SIZE_MAX
+	    : decay->demand_peak * DECAY_FORECAST_HORIZON;
+}
+
 /*
  * Calculate how many pages should be purged after 'interval'.
  *
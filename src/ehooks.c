@@ -3,6 +3,7 @@
 
 #include "jemalloc/internal/ehooks.h"
 #include "jemalloc/internal/extent_mmap.h"
+#include "jemalloc/internal/numa.h"
 
 void
 ehooks_init(ehooks_t *ehooks, extent_hooks_t *extent_hooks, unsigned ind) {
@@ -64,6 +65,9 @@ ehooks_default_alloc_impl(tsdn_t *tsdn, void *new_addr, size_t size,
 	if (have_madvise_huge && ret) {
 		pages_set_thp_state(ret, size);
 	}
+	if (numa_enabled() && ret != NULL) {
+		numa_arena_bind(arena_ind, ret, size);
+	}
 	return ret;
 }
 
@@ -250,6 +250,40 @@ emap_deregister_interior(tsdn_t *tsdn, emap_t *emap, edata_t *edata) {
 	}
 }
 
+void
+emap_deregister_range(tsdn_t *tsdn, emap_t *emap, void *addr, size_t size) {
+	EMAP_DECLARE_RTREE_CTX;
+
+	assert(((uintptr_t)addr & PAGE_MASK) == 0 && (size & PAGE_MASK) == 0);
+	rtree_contents_t contents;
+	contents.edata = NULL;
+	contents.metadata.szind = SC_NSIZES;
+	contents.metadata.slab = false;
+	contents.metadata.is_head = false;
+	contents.metadata.state = (extent_state_t)0;
+
+	uintptr_t leaf_mask = (ZU(1) << rtree_leaf_maskbits()) - 1;
+	uintptr_t end = (uintptr_t)addr + size;
+	uintptr_t cur = (uintptr_t)addr;
+	while (cur < end) {
+		uintptr_t leaf_end = (cur | leaf_mask) + 1;
+		if (leaf_end > end || leaf_end == 0) {
+			leaf_end = end;
+		}
+		/* Leaves nothing was ever registered in may not exist. */
+		rtree_leaf_elm_t *elm = rtree_leaf_elm_lookup(tsdn,
+		    &emap->rtree, rtree_ctx, cur, /* dependent */ false,
+		    /* init_missing */ false);
+		if (elm != NULL) {
+			for (; cur < leaf_end; cur += PAGE, elm++) {
+				rtree_leaf_elm_write(
+				    tsdn, &emap->rtree, elm, contents);
+			}
+		}
+		cur = leaf_end;
+	}
+}
+
 void
 emap_remap(
     tsdn_t *tsdn, emap_t *emap, edata_t *edata, szind_t szind, bool slab) {
@@ -28,6 +28,7 @@ eset_init(eset_t *eset, extent_state_t state) {
 	}
 	fb_init(eset->bitmap, ESET_NPSIZES);
 	edata_list_inactive_init(&eset->lru);
+	eset->lru_cursor = NULL;
 	eset->state = state;
 }
 
@@ -147,6 +148,10 @@ eset_remove(eset_t *eset, edata_t *edata) {
 		}
 	}
 	if (!edata_pinned_get(edata)) {
+		if (eset->lru_cursor == edata) {
+			eset->lru_cursor = edata_list_inactive_next(
+			    &eset->lru, edata);
+		}
 		edata_list_inactive_remove(&eset->lru, edata);
 	}
 	size_t npages = size >> LG_PAGE;
@@ -52,6 +52,8 @@ static edata_t *extent_alloc_retained(tsdn_t *tsdn, pac_t *pac,
     bool zero, bool *commit, bool guarded);
 static bool     extent_decommit_wrapper(tsdn_t *tsdn, ehooks_t *ehooks,
         edata_t *edata, size_t offset, size_t length);
+static void     extent_zero_dirty(
+        tsdn_t *tsdn, ehooks_t *ehooks, edata_t *edata);
 
 /******************************************************************************/
 
@@ -153,7 +155,7 @@ ecache_dalloc(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks, ecache_t *ecache,
 	    tsdn_witness_tsdp_get(tsdn), WITNESS_RANK_CORE, 0);
 
 	edata_addr_set(edata, edata_base_get(edata));
-	edata_zeroed_set(edata, false);
+	edata_zero_npages_set(edata, 0, 0);
 
 	extent_record(tsdn, pac, ehooks, ecache, edata);
 }
@@ -268,6 +270,8 @@ extent_deactivate_locked_impl(
 	assert(edata_arena_ind_get(edata) == ecache_ind_get(ecache));
 
 	emap_update_edata_state(tsdn, pac->emap, edata, ecache->state);
+	/* Coalesced and split extents start over toward cold demotion. */
+	edata_cold_set(edata, EXTENT_COLD_FRESH);
 	eset_t *eset = edata_guarded_get(edata) ? &ecache->guarded_eset
 	                                        : &ecache->eset;
 	eset_insert(eset, edata);
@@ -856,8 +860,7 @@ extent_grow_retained(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks, size_t size,
 		extent_gdump_add(tsdn, edata);
 	}
 	if (zero && !edata_zeroed_get(edata)) {
-		ehooks_zero(
-		    tsdn, ehooks, edata_base_get(edata), edata_size_get(edata));
+		extent_zero_dirty(tsdn, ehooks, edata);
 	}
 	return edata;
 label_err:
@@ -1238,7 +1241,8 @@ extent_dalloc_wrapper(
 	} else {
 		zeroed = false;
 	}
-	edata_zeroed_set(edata, zeroed);
+	edata_zero_npages_set(
+	    edata, zeroed ? edata_size_get(edata) >> LG_PAGE : 0, 0);
 
 	extent_dalloc_wrapper_finish(tsdn, pac, ehooks, edata);
 }
@@ -1381,7 +1385,18 @@ extent_split_impl(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks, edata_t *edata,
 		goto label_error_b;
 	}
 
+	/* Hand each half the known-zero pages that fall within it. */
+	size_t zero_lead = edata_zero_lead_npages_get(edata);
+	size_t zero_trail = edata_zero_trail_npages_get(edata);
+	size_t npages_a = size_a >> LG_PAGE;
+	size_t npages_b = size_b >> LG_PAGE;
 	edata_size_set(edata, size_a);
+	edata_zero_npages_set(edata, min_zu(zero_lead, npages_a),
+	    zero_trail > npages_b ? min_zu(zero_trail - npages_b, npages_a)
+	                          : 0);
+	edata_zero_npages_set(trail,
+	    zero_lead > npages_a ? min_zu(zero_lead - npages_a, npages_b) : 0,
+	    min_zu(zero_trail, npages_b));
 	emap_split_commit(
 	    tsdn, pac->emap, &prepare, edata, size_a, trail, size_b);
 
@@ -1436,11 +1451,18 @@ extent_merge_impl(tsdn_t *tsdn, pac_t *pac, ehooks_t *ehooks, edata_t *a,
 	assert(edata_state_get(a) == extent_state_active
 	    || edata_state_get(a) == extent_state_merging);
 	edata_state_set(a, extent_state_active);
+	/* Known-zero runs at the inner ends join up if one side is zeroed. */
+	size_t zero_lead = edata_zeroed_get(a)
+	    ? edata_zero_lead_npages_get(a) + edata_zero_lead_npages_get(b)
+	    : edata_zero_lead_npages_get(a);
+	size_t zero_trail = edata_zeroed_get(b)
+	    ? edata_zero_trail_npages_get(b) + edata_zero_trail_npages_get(a)
+	    : edata_zero_trail_npages_get(b);
 	edata_size_set(a, edata_size_get(a) + edata_size_get(b));
 	edata_sn_set(a,
 	    (edata_sn_get(a) < edata_sn_get(b)) ? edata_sn_get(a)
 	                                        : edata_sn_get(b));
-	edata_zeroed_set(a, edata_zeroed_get(a) && edata_zeroed_get(b));
+	edata_zero_npages_set(a, zero_lead, zero_trail);
 
 	assert(edata_pinned_get(a) == edata_pinned_get(b));
 
@@ -1458,6 +1480,26 @@ extent_merge_wrapper(
 	    /* holding_core_locks */ false);
 }
 
+/*
+ * Zeroes whatever lies between the known-zero pages at either end of edata.
+ * Below the calloc madvise threshold a memset beats returning the pages to the
+ * OS and faulting them back in.
+ */
+static void
+extent_zero_dirty(tsdn_t *tsdn, ehooks_t *ehooks, edata_t *edata) {
+	size_t lead = edata_zero_lead_npages_get(edata) << LG_PAGE;
+	size_t trail = edata_zero_trail_npages_get(edata) << LG_PAGE;
+	assert(lead + trail < edata_size_get(edata));
+	void  *addr = (void *)((byte_t *)edata_base_get(edata) + lead);
+	size_t size = edata_size_get(edata) - lead - trail;
+	if (size < opt_calloc_madvise_threshold) {
+		memset(addr, 0, size);
+	} else {
+		ehooks_zero(tsdn, ehooks, addr, size);
+	}
+	edata_zero_npages_set(edata, edata_size_get(edata) >> LG_PAGE, 0);
+}
+
 bool
 extent_commit_zero(tsdn_t *tsdn, ehooks_t *ehooks, edata_t *edata, bool commit,
     bool zero, bool growing_retained) {
@@ -1471,9 +1513,10 @@ extent_commit_zero(tsdn_t *tsdn, ehooks_t *ehooks, edata_t *edata, bool commit,
 		}
 	}
 	if (zero && !edata_zeroed_get(edata)) {
-		void  *addr = edata_base_get(edata);
-		size_t size = edata_size_get(edata);
-		ehooks_zero(tsdn, ehooks, addr, size);
+		extent_zero_dirty(tsdn, ehooks, edata);
+	} else if (!edata_zeroed_get(edata)) {
+		/* The caller owns the contents from here on. */
+		edata_zero_npages_set(edata, 0, 0);
 	}
 	return false;
 }
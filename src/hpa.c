@@ -4,7 +4,11 @@
 #include "jemalloc/internal/hpa.h"
 #include "jemalloc/internal/hpa_utils.h"
 
+#include "jemalloc/internal/arenas_management.h"
 #include "jemalloc/internal/fb.h"
+#include "jemalloc/internal/mem_pressure.h"
+#include "jemalloc/internal/numa.h"
+#include "jemalloc/internal/purge_pool.h"
 #include "jemalloc/internal/witness.h"
 #include "jemalloc/internal/jemalloc_probe.h"
 
@@ -16,6 +20,11 @@ const char *const hpa_hugify_style_names[] = {"auto", "none", "eager", "lazy"};
 bool opt_experimental_hpa_start_huge_if_thp_always = true;
 bool opt_experimental_hpa_enforce_hugify = false;
 
+/* The period over which collapse_budget_us is enforced. */
+#define HPA_COLLAPSE_WINDOW_NS ((uint64_t)1000 * 1000 * 1000)
+/* How many of the oldest hugification candidates are ranked at a time. */
+#define HPA_COLLAPSE_SCAN_MAX 32
+
 bool
 hpa_hugepage_size_exceeds_limit(void) {
 	return HUGEPAGE > HUGEPAGE_MAX_EXPECTED_SIZE;
@@ -83,7 +92,11 @@ hpa_shard_init(tsdn_t *tsdn, hpa_shard_t *shard, hpa_central_t *central,
 	shard->base = base;
 	edata_cache_fast_init(&shard->ecf, edata_cache);
 	psset_init(&shard->psset);
+	if (opts->purge_lru) {
+		psset_purge_lru_enable(&shard->psset);
+	}
 	shard->age_counter = 0;
+	shard->activity_counter = 0;
 	shard->ind = ind;
 	shard->emap = emap;
 
@@ -92,12 +105,20 @@ hpa_shard_init(tsdn_t *tsdn, hpa_shard_t *shard, hpa_central_t *central,
 	shard->npending_purge = 0;
 	nstime_init_zero(&shard->last_purge);
 	nstime_init_zero(&shard->last_time_work_attempted);
+	nstime_init_zero(&shard->collapse_window_start);
+	shard->collapse_window_ns = 0;
+	hpdata_empty_list_init(&shard->spans_free);
 
 	shard->stats.npurge_passes = 0;
 	shard->stats.npurges = 0;
 	shard->stats.nhugifies = 0;
 	shard->stats.nhugify_failures = 0;
 	shard->stats.ndehugifies = 0;
+	shard->stats.ncollapses = 0;
+	shard->stats.ncollapse_failures = 0;
+	shard->stats.collapse_ns = 0;
+	shard->stats.collapse_max_ns = 0;
+	shard->stats.nrefaults = 0;
 	memset(shard->stats.hpa_alloc_min_extents, 0,
 	    sizeof(shard->stats.hpa_alloc_min_extents));
 	memset(shard->stats.hpa_alloc_max_extents, 0,
@@ -117,6 +138,33 @@ hpa_shard_init(tsdn_t *tsdn, hpa_shard_t *shard, hpa_central_t *central,
 		return true;
 	}
 
+	shard->resv = NULL;
+	shard->nresv = 0;
+	if (opts->resv_max_alloc != 0) {
+		unsigned nresv = (ncpus < HPA_RESV_NSLOTS_MAX)
+		    ? ncpus
+		    : HPA_RESV_NSLOTS_MAX;
+		shard->resv = (hpa_resv_t *)base_alloc(
+		    tsdn, base, nresv * sizeof(hpa_resv_t), CACHELINE);
+		if (shard->resv == NULL) {
+			return true;
+		}
+		for (unsigned i = 0; i < nresv; i++) {
+			hpa_resv_t *resv = &shard->resv[i];
+			if (malloc_mutex_init(&resv->mtx, "hpa_shard_resv",
+			        WITNESS_RANK_HPA_SHARD_RESV,
+			        malloc_mutex_rank_exclusive)) {
+				return true;
+			}
+			resv->ps = NULL;
+			resv->cur = NULL;
+			resv->end = NULL;
+			edata_list_inactive_init(&resv->edatas);
+			resv->nedatas = 0;
+		}
+		shard->nresv = nresv;
+	}
+
 	hpa_do_consistency_checks(shard);
 
 	return false;
@@ -136,6 +184,13 @@ hpa_shard_nonderived_stats_accum(
 	dst->nhugifies += src->nhugifies;
 	dst->nhugify_failures += src->nhugify_failures;
 	dst->ndehugifies += src->ndehugifies;
+	dst->ncollapses += src->ncollapses;
+	dst->ncollapse_failures += src->ncollapse_failures;
+	dst->collapse_ns += src->collapse_ns;
+	if (src->collapse_max_ns > dst->collapse_max_ns) {
+		dst->collapse_max_ns = src->collapse_max_ns;
+	}
+	dst->nrefaults += src->nrefaults;
 	for (size_t i = 0; i <= SEC_MAX_NALLOCS; i++) {
 		dst->hpa_alloc_min_extents[i] += src->hpa_alloc_min_extents[i];
 		dst->hpa_alloc_max_extents[i] += src->hpa_alloc_max_extents[i];
@@ -238,8 +293,8 @@ hpa_ndirty_max(tsdn_t *tsdn, hpa_shard_t *shard) {
 	if (shard->opts.dirty_mult == (fxp_t)-1) {
 		return (size_t)-1;
 	}
-	return fxp_mul_frac(
-	    psset_nactive(&shard->psset), shard->opts.dirty_mult);
+	return mem_pressure_npages_limit(fxp_mul_frac(
+	    psset_nactive(&shard->psset), shard->opts.dirty_mult));
 }
 
 static bool
@@ -254,6 +309,12 @@ hpa_hugify_blocked_by_ndirty(tsdn_t *tsdn, hpa_shard_t *shard) {
 	    > hpa_ndirty_max(tsdn, shard);
 }
 
+static hpdata_t *
+hpa_pick_purge(hpa_shard_t *shard, const nstime_t *now) {
+	return shard->opts.purge_lru ? psset_pick_purge_lru(&shard->psset, now)
+	                             : psset_pick_purge(&shard->psset, now);
+}
+
 static bool
 hpa_should_purge(tsdn_t *tsdn, hpa_shard_t *shard) {
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
@@ -261,7 +322,7 @@ hpa_should_purge(tsdn_t *tsdn, hpa_shard_t *shard) {
 	 * The page that is purgable may be delayed, but we just want to know
 	 * if there is a need for bg thread to wake up in the future.
 	 */
-	hpdata_t *ps = psset_pick_purge(&shard->psset, NULL);
+	hpdata_t *ps = hpa_pick_purge(shard, NULL);
 	if (ps == NULL) {
 		return false;
 	}
@@ -381,8 +442,8 @@ static inline size_t
 hpa_purge_start_hp(hpa_purge_batch_t *b, hpa_shard_t *shard) {
 	psset_t  *psset = &shard->psset;
 	hpdata_t *to_purge = (shard->opts.min_purge_delay_ms > 0)
-	    ? psset_pick_purge(psset, &shard->last_time_work_attempted)
-	    : psset_pick_purge(psset, NULL);
+	    ? hpa_pick_purge(shard, &shard->last_time_work_attempted)
+	    : hpa_pick_purge(shard, NULL);
 	if (to_purge == NULL) {
 		return 0;
 	}
@@ -452,6 +513,21 @@ hpa_purge_finish_hp(
 	psset_update_end(&shard->psset, hp_item->hp);
 }
 
+void
+hpa_purge_batch_finish(tsdn_t *tsdn, hpa_shard_t *shard,
+    hpa_purge_item_t *items, size_t nitems, size_t ndirty) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+
+	/* The shard updates */
+	shard->npending_purge -= ndirty;
+	shard->stats.npurges += ndirty;
+	shard->central->hooks.curtime(&shard->last_purge,
+	    /* first_reading */ false);
+	for (size_t i = 0; i < nitems; ++i) {
+		hpa_purge_finish_hp(tsdn, shard, &items[i]);
+	}
+}
+
 /* Returns number of huge pages purged. */
 static inline size_t
 hpa_purge(tsdn_t *tsdn, hpa_shard_t *shard, size_t max_hp) {
@@ -487,25 +563,109 @@ hpa_purge(tsdn_t *tsdn, hpa_shard_t *shard, size_t max_hp) {
 		if (hpa_batch_empty(&batch)) {
 			break;
 		}
+		/* Leave the madvise calls to the purge threads, if any. */
+		if (!purge_pool_submit(tsdn, shard, batch.items,
+		        batch.item_cnt, batch.ndirty_in_batch)) {
+			continue;
+		}
 		hpa_hooks_t *hooks = &shard->central->hooks;
 		malloc_mutex_unlock(tsdn, &shard->mtx);
 		hpa_purge_batch(hooks, batch.items, batch.item_cnt);
 		malloc_mutex_lock(tsdn, &shard->mtx);
-
-		/* The shard updates */
-		shard->npending_purge -= batch.ndirty_in_batch;
-		shard->stats.npurges += batch.ndirty_in_batch;
-		shard->central->hooks.curtime(&shard->last_purge,
-		    /* first_reading */ false);
-		for (size_t i = 0; i < batch.item_cnt; ++i) {
-			hpa_purge_finish_hp(tsdn, shard, &batch.items[i]);
-		}
+		hpa_purge_batch_finish(tsdn, shard, batch.items, batch.item_cnt,
+		    batch.ndirty_in_batch);
 	}
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 	shard->stats.npurge_passes++;
 	return batch.npurged_hp_total;
 }
 
+static inline bool
+hpa_collapse_budgeted(const hpa_shard_t *shard) {
+	return shard->opts.collapse_budget_us != 0;
+}
+
+/*
+ * Moves the collapse budget window up to now, forgiving a budget's worth of
+ * overrun per elapsed window.  Returns the nanoseconds until the budget is
+ * available again, 0 if some of it is left.
+ */
+static uint64_t
+hpa_collapse_budget_wait(hpa_shard_t *shard, const nstime_t *now) {
+	uint64_t budget_ns = shard->opts.collapse_budget_us * 1000;
+	if (nstime_compare(now, &shard->collapse_window_start) < 0) {
+		/* The clock went backwards; start over. */
+		nstime_copy(&shard->collapse_window_start, now);
+	}
+	uint64_t elapsed_ns = nstime_ns(now)
+	    - nstime_ns(&shard->collapse_window_start);
+	uint64_t nwindows = elapsed_ns / HPA_COLLAPSE_WINDOW_NS;
+	if (nwindows > 0) {
+		uint64_t forgiven = (nwindows
+		                        > shard->collapse_window_ns / budget_ns)
+		    ? shard->collapse_window_ns
+		    : nwindows * budget_ns;
+		shard->collapse_window_ns -= forgiven;
+		nstime_iadd(&shard->collapse_window_start,
+		    nwindows * HPA_COLLAPSE_WINDOW_NS);
+		elapsed_ns -= nwindows * HPA_COLLAPSE_WINDOW_NS;
+	}
+	if (shard->collapse_window_ns < budget_ns) {
+		return 0;
+	}
+	/* Each window to come pays off one budget's worth of the overrun. */
+	uint64_t nwait = shard->collapse_window_ns / budget_ns;
+	return nwait * HPA_COLLAPSE_WINDOW_NS - elapsed_ns;
+}
+
+/*
+ * Ranks the hugification candidates that have waited out hugify_delay_ms by
+ * their number of active pages, and then by how long they have waited;
+ * collapsing the busiest hugepages first gets the most TLB reach out of the
+ * budget.  Only the HPA_COLLAPSE_SCAN_MAX oldest candidates are considered.
+ */
+static hpdata_t *
+hpa_collapse_pick(hpa_shard_t *shard) {
+	hpdata_t *best = NULL;
+	uint64_t  best_ms = 0;
+	unsigned  nscanned = 0;
+	for (hpdata_t *ps = psset_pick_hugify(&shard->psset);
+	    ps != NULL && nscanned < HPA_COLLAPSE_SCAN_MAX;
+	    ps = psset_next_hugify(&shard->psset, ps), nscanned++) {
+		nstime_t time_hugify_allowed = hpdata_time_hugify_allowed(ps);
+		uint64_t millis = shard->central->hooks.ms_since(
+		    &time_hugify_allowed);
+		if (millis < shard->opts.hugify_delay_ms) {
+			continue;
+		}
+		if (best == NULL
+		    || hpdata_nactive_get(ps) > hpdata_nactive_get(best)
+		    || (hpdata_nactive_get(ps) == hpdata_nactive_get(best)
+		        && millis > best_ms)) {
+			best = ps;
+			best_ms = millis;
+		}
+	}
+	return best;
+}
+
+static void
+hpa_collapse_account(hpa_shard_t *shard, const nstime_t *start,
+    const nstime_t *end, bool err) {
+	uint64_t ns = (nstime_compare(end, start) > 0)
+	    ? nstime_ns(end) - nstime_ns(start)
+	    : 0;
+	shard->collapse_window_ns += ns;
+	shard->stats.ncollapses++;
+	if (err) {
+		shard->stats.ncollapse_failures++;
+	}
+	shard->stats.collapse_ns += ns;
+	if (ns > shard->stats.collapse_max_ns) {
+		shard->stats.collapse_max_ns = ns;
+	}
+}
+
 /* Returns whether or not we hugified anything. */
 static bool
 hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
@@ -515,20 +675,43 @@ hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
 		return false;
 	}
 
-	hpdata_t *to_hugify = psset_pick_hugify(&shard->psset);
-	if (to_hugify == NULL) {
-		return false;
+	bool      budgeted = hpa_collapse_budgeted(shard);
+	hpdata_t *to_hugify;
+	if (budgeted) {
+		/*
+		 * Budgeted collapses are left to the background threads; with
+		 * deferral allowed, nothing else gets here.  Application
+		 * threads skip them rather than stall in MADV_COLLAPSE.
+		 */
+		if (!shard->opts.deferral_allowed) {
+			return false;
+		}
+		nstime_t now;
+		shard->central->hooks.curtime(&now, /* first_reading */ true);
+		if (hpa_collapse_budget_wait(shard, &now) != 0) {
+			return false;
+		}
+		to_hugify = hpa_collapse_pick(shard);
+		if (to_hugify == NULL) {
+			return false;
+		}
+	} else {
+		to_hugify = psset_pick_hugify(&shard->psset);
+		if (to_hugify == NULL) {
+			return false;
+		}
+		/* Make sure that it's been hugifiable for long enough. */
+		nstime_t time_hugify_allowed = hpdata_time_hugify_allowed(
+		    to_hugify);
+		uint64_t millis = shard->central->hooks.ms_since(
+		    &time_hugify_allowed);
+		if (millis < shard->opts.hugify_delay_ms) {
+			return false;
+		}
 	}
 	assert(hpdata_hugify_allowed_get(to_hugify));
 	assert(!hpdata_changing_state_get(to_hugify));
 
-	/* Make sure that it's been hugifiable for long enough. */
-	nstime_t time_hugify_allowed = hpdata_time_hugify_allowed(to_hugify);
-	uint64_t millis = shard->central->hooks.ms_since(&time_hugify_allowed);
-	if (millis < shard->opts.hugify_delay_ms) {
-		return false;
-	}
-
 	/*
 	 * Don't let anyone else purge or hugify this page while
 	 * we're hugifying it (allocations and deallocations are
@@ -548,11 +731,25 @@ hpa_try_hugify(tsdn_t *tsdn, hpa_shard_t *shard) {
 	 * update nhugifies stat as system call is not being made.
 	 */
 	if (hpa_is_hugify_lazy(shard) || opt_experimental_hpa_enforce_hugify) {
+		/* Budgeted hugification always collapses, and is timed. */
+		nstime_t start, end;
 		malloc_mutex_unlock(tsdn, &shard->mtx);
+		if (budgeted) {
+			shard->central->hooks.curtime(
+			    &start, /* first_reading */ true);
+		}
 		bool err = shard->central->hooks.hugify(
 		    hpdata_addr_get(to_hugify), HUGEPAGE,
-		    shard->opts.hugify_sync);
+		    shard->opts.hugify_sync || budgeted);
+		if (budgeted) {
+			nstime_copy(&end, &start);
+			shard->central->hooks.curtime(
+			    &end, /* first_reading */ false);
+		}
 		malloc_mutex_lock(tsdn, &shard->mtx);
+		if (budgeted) {
+			hpa_collapse_account(shard, &start, &end, err);
+		}
 		shard->stats.nhugifies++;
 		if (err) {
 			/*
@@ -653,9 +850,28 @@ hpa_shard_maybe_do_deferred_work(
 	}
 }
 
+/*
+ * Stamps ps as the most recently active hugepage for opts.purge_lru, and
+ * counts a refault if the operation touched pages of it again after a purge;
+ * ntouched is the count of touched pages from before the operation.  The
+ * refault count is kept under either purge policy, to compare them.
+ */
+static void
+hpa_note_activity(hpa_shard_t *shard, hpdata_t *ps, size_t ntouched) {
+	if (shard->opts.purge_lru) {
+		hpdata_last_active_set(ps, shard->activity_counter++);
+	}
+	if (config_stats && hpdata_purged_get(ps)
+	    && hpdata_ntouched_get(ps) > ntouched) {
+		hpdata_purged_set(ps, false);
+		shard->stats.nrefaults++;
+	}
+}
+
 static edata_t *
 hpa_try_alloc_one_offset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
-    hpdata_t *ps, hpdata_alloc_offset_t *alloc_offset, bool *oom) {
+    hpdata_t *ps, hpdata_alloc_offset_t *alloc_offset, fb_group_t *touched,
+    bool *oom) {
 	assert(*oom == false);
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 
@@ -665,6 +881,10 @@ hpa_try_alloc_one_offset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 		return NULL;
 	}
 
+	if (touched != NULL) {
+		/* Reserving marks the range as touched; look before that. */
+		hpdata_touched_pages_copy(ps, touched);
+	}
 	void *addr = hpdata_reserve_alloc_offset(ps, size, alloc_offset);
 	JE_USDT(hpa_alloc, 5, shard->ind, addr, size, hpdata_nactive_get(ps),
 	    hpdata_age_get(ps));
@@ -709,8 +929,8 @@ hpa_try_alloc_one_offset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 
 static size_t
 hpa_try_alloc_from_one_ps(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
-    size_t max_nallocs, bool *oom, edata_list_active_t *results,
-    bool *deferred_work_generated) {
+    size_t max_nallocs, fb_group_t *touched, bool *oom,
+    edata_list_active_t *results, bool *deferred_work_generated) {
 	assert(size <= HUGEPAGE);
 	assert(size <= shard->opts.slab_max_alloc || size == sz_s2u(size));
 	assert(*oom == false);
@@ -730,6 +950,7 @@ hpa_try_alloc_from_one_ps(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
             ps, size, alloc_offsets, max_nallocs);
 
 	psset_update_begin(&shard->psset, ps);
+	size_t ntouched = hpdata_ntouched_get(ps);
 
 	if (hpdata_empty(ps)) {
 		/*
@@ -744,8 +965,8 @@ hpa_try_alloc_from_one_ps(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 
 	size_t nsuccess = 0;
 	for (; nsuccess < nallocs; nsuccess += 1) {
-		edata_t *edata = hpa_try_alloc_one_offset(
-		    tsdn, shard, size, ps, (alloc_offsets + nsuccess), oom);
+		edata_t *edata = hpa_try_alloc_one_offset(tsdn, shard, size,
+		    ps, (alloc_offsets + nsuccess), touched, oom);
 		if (edata == NULL) {
 			break;
 		}
@@ -754,6 +975,7 @@ hpa_try_alloc_from_one_ps(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 	}
 
 	hpdata_post_reserve_alloc_offsets(ps, size, alloc_offsets, nsuccess);
+	hpa_note_activity(shard, ps, ntouched);
 	hpa_update_purge_hugify_eligibility(tsdn, shard, ps);
 	psset_update_end(&shard->psset, ps);
 
@@ -770,8 +992,8 @@ hpa_try_alloc_from_one_ps(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 static size_t
 hpa_try_alloc_batch_no_grow_locked(tsdn_t *tsdn, hpa_shard_t *shard,
     size_t size, size_t min_nallocs, size_t max_nallocs,
-    bool update_min_max_stats, bool *oom, edata_list_active_t *results,
-    bool *deferred_work_generated) {
+    bool update_min_max_stats, fb_group_t *touched, bool *oom,
+    edata_list_active_t *results, bool *deferred_work_generated) {
 	assert(*oom == false);
 	malloc_mutex_assert_owner(tsdn, &shard->mtx);
 
@@ -794,7 +1016,7 @@ hpa_try_alloc_batch_no_grow_locked(tsdn_t *tsdn, hpa_shard_t *shard,
 		assert(nsuccess < min_nallocs);
 		assert(min_nallocs <= max_nallocs);
 		const size_t nallocs = hpa_try_alloc_from_one_ps(tsdn, shard,
-		    size, max_nallocs - nsuccess, oom, results,
+		    size, max_nallocs - nsuccess, touched, oom, results,
 		    deferred_work_generated);
 		if (nallocs == 0 || *oom) {
 			break;
@@ -819,24 +1041,39 @@ hpa_try_alloc_batch_no_grow_locked(tsdn_t *tsdn, hpa_shard_t *shard,
 static size_t
 hpa_try_alloc_batch_no_grow(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
     size_t min_nallocs, size_t max_nallocs, bool update_min_max_stats,
-    bool *oom, edata_list_active_t *results, bool *deferred_work_generated) {
+    fb_group_t *touched, bool *oom, edata_list_active_t *results,
+    bool *deferred_work_generated) {
 	malloc_mutex_lock(tsdn, &shard->mtx);
 	const size_t nsuccess = hpa_try_alloc_batch_no_grow_locked(tsdn, shard,
-	    size, min_nallocs, max_nallocs, update_min_max_stats, oom, results,
-	    deferred_work_generated);
+	    size, min_nallocs, max_nallocs, update_min_max_stats, touched, oom,
+	    results, deferred_work_generated);
 	malloc_mutex_unlock(tsdn, &shard->mtx);
 	return nsuccess;
 }
 
+/* The eden of hpa_central the shard grows from. */
+static unsigned
+hpa_shard_node(hpa_shard_t *shard) {
+	if (numa_enabled() && shard->ind < narenas_auto) {
+		return numa_arena_node(shard->ind);
+	}
+	return HPA_CENTRAL_NODE_ANY;
+}
+
+/*
+ * If touched is non-NULL, it receives a snapshot of the touched pages of the
+ * pageslab that the (single) allocation came from, as of before it was made.
+ */
 static size_t
 hpa_alloc_batch_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
-    size_t min_nallocs, size_t max_nallocs, edata_list_active_t *results,
-    bool *deferred_work_generated) {
+    size_t min_nallocs, size_t max_nallocs, fb_group_t *touched,
+    edata_list_active_t *results, bool *deferred_work_generated) {
+	assert(touched == NULL || max_nallocs == 1);
 	bool oom = false;
 
 	size_t nsuccess = hpa_try_alloc_batch_no_grow(tsdn, shard, size,
-	    min_nallocs, max_nallocs, /* update_min_max_stats */ true, &oom,
-	    results, deferred_work_generated);
+	    min_nallocs, max_nallocs, /* update_min_max_stats */ true, touched,
+	    &oom, results, deferred_work_generated);
 	if (min_nallocs <= nsuccess || oom) {
 		return nsuccess;
 	}
@@ -855,7 +1092,7 @@ hpa_alloc_batch_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 	assert(min_nallocs <= max_nallocs);
 	nsuccess += hpa_try_alloc_batch_no_grow(tsdn, shard, size,
 	    min_nallocs - nsuccess, max_nallocs - nsuccess,
-	    /* update_min_max_stats */ false, &oom, results,
+	    /* update_min_max_stats */ false, touched, &oom, results,
 	    deferred_work_generated);
 	if (min_nallocs <= nsuccess || oom) {
 		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
@@ -868,7 +1105,8 @@ hpa_alloc_batch_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 	 * while we're doing this potentially expensive system call.
 	 */
 	hpdata_t *ps = hpa_central_extract(tsdn, shard->central, size,
-	    shard->age_counter++, hpa_is_hugify_eager(shard), &oom);
+	    hpa_shard_node(shard), shard->age_counter++,
+	    hpa_is_hugify_eager(shard), &oom);
 	if (ps == NULL) {
 		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
 		return nsuccess;
@@ -885,7 +1123,7 @@ hpa_alloc_batch_psset(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
 	assert(min_nallocs <= max_nallocs);
 	nsuccess += hpa_try_alloc_batch_no_grow_locked(tsdn, shard, size,
 	    min_nallocs - nsuccess, max_nallocs - nsuccess,
-	    /* update_min_max_stats */ false, &oom, results,
+	    /* update_min_max_stats */ false, touched, &oom, results,
 	    deferred_work_generated);
 	malloc_mutex_unlock(tsdn, &shard->mtx);
 
@@ -919,6 +1157,380 @@ hpa_assert_results(
 	}
 }
 
+/*
+ * Zeroed requests skip the SEC, whose extents are all dirty, and take a single
+ * extent straight from the psset.  Pages that the pageslab never touched (or
+ * purged since) still read as zero, so only the rest need a memset.
+ */
+static edata_t *
+hpa_alloc_zero(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
+    bool *deferred_work_generated) {
+	fb_group_t          touched[FB_NGROUPS(HUGEPAGE_PAGES)];
+	edata_list_active_t results;
+	edata_list_active_init(&results);
+	hpa_alloc_batch_psset(tsdn, shard, size, /* min_nallocs */ 1,
+	    /* max_nallocs */ 1, touched, &results, deferred_work_generated);
+	hpa_assert_results(tsdn, shard, &results);
+	edata_t *edata = edata_list_active_first(&results);
+	if (edata == NULL) {
+		return NULL;
+	}
+	edata_list_active_remove(&results, edata);
+
+	byte_t *addr = (byte_t *)edata_base_get(edata);
+	if (!hpa_hooks_purge_zeroes(&shard->central->hooks)) {
+		memset(addr, 0, size);
+	} else {
+		byte_t *ps_addr = (byte_t *)HUGEPAGE_ADDR2BASE(addr);
+		size_t  first = (size_t)(addr - ps_addr) >> LG_PAGE;
+		size_t  last = first + (size >> LG_PAGE);
+		size_t  begin, len;
+		for (size_t i = first; i < last
+		     && fb_srange_iter(touched, HUGEPAGE_PAGES, i, &begin, &len)
+		     && begin < last;
+		     i = begin + len) {
+			size_t end = min_zu(begin + len, last);
+			memset(ps_addr + (begin << LG_PAGE), 0,
+			    (end - begin) << LG_PAGE);
+		}
+	}
+	edata_zeroed_set(edata, true);
+	return edata;
+}
+
+static hpa_resv_t *
+hpa_resv_pick(tsdn_t *tsdn, hpa_shard_t *shard) {
+	unsigned ind;
+	if (have_percpu_arena) {
+		ind = (unsigned)malloc_getcpu();
+	} else if (tsdn_null(tsdn)) {
+		ind = 0;
+	} else {
+		/* Without a CPU id, spread the threads out by their tsd. */
+		ind = (unsigned)((uintptr_t)tsdn_tsd(tsdn) >> LG_CACHELINE);
+	}
+	return &shard->resv[ind % shard->nresv];
+}
+
+/* Hands what is left of the reservation back to its hpdata. */
+static void
+hpa_resv_release(tsdn_t *tsdn, hpa_shard_t *shard, hpa_resv_t *resv) {
+	malloc_mutex_assert_owner(tsdn, &resv->mtx);
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	if (resv->ps != NULL) {
+		if (resv->cur < resv->end) {
+			psset_update_begin(&shard->psset, resv->ps);
+			hpdata_unreserve(resv->ps, resv->cur,
+			    (size_t)(resv->end - resv->cur));
+			hpa_update_purge_hugify_eligibility(
+			    tsdn, shard, resv->ps);
+			psset_update_end(&shard->psset, resv->ps);
+		}
+		resv->ps = NULL;
+		resv->cur = NULL;
+		resv->end = NULL;
+	}
+}
+
+/*
+ * Makes sure the reservation can serve an allocation of size, swapping its
+ * hpdata for one with more room if need be.  Returns true if it can't.
+ */
+static bool
+hpa_resv_refill(tsdn_t *tsdn, hpa_shard_t *shard, hpa_resv_t *resv,
+    size_t size, bool *deferred_work_generated) {
+	malloc_mutex_assert_owner(tsdn, &resv->mtx);
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	if (resv->ps == NULL || resv->cur + size > resv->end) {
+		hpa_resv_release(tsdn, shard, resv);
+		/* Prefer a hpdata that can take a whole reservation. */
+		hpdata_t *ps = psset_pick_alloc(
+		    &shard->psset, HPA_RESV_NPAGES << LG_PAGE);
+		if (ps == NULL) {
+			ps = psset_pick_alloc(&shard->psset, size);
+		}
+		if (ps == NULL) {
+			/* The regular path grows the shard. */
+			malloc_mutex_unlock(tsdn, &shard->mtx);
+			return true;
+		}
+		size_t resv_size = min_zu(HPA_RESV_NPAGES,
+		                       hpdata_longest_free_range_get(ps))
+		    << LG_PAGE;
+		assert(resv_size >= size);
+		psset_update_begin(&shard->psset, ps);
+		size_t ntouched = hpdata_ntouched_get(ps);
+		if (hpdata_empty(ps)) {
+			/* See hpa_try_alloc_from_one_ps. */
+			hpdata_age_set(ps, shard->age_counter++);
+		}
+		resv->ps = ps;
+		resv->cur = (byte_t *)hpdata_reserve_alloc(ps, resv_size);
+		resv->end = resv->cur + resv_size;
+		hpa_note_activity(shard, ps, ntouched);
+		hpa_update_purge_hugify_eligibility(tsdn, shard, ps);
+		psset_update_end(&shard->psset, ps);
+	}
+	while (resv->nedatas < HPA_RESV_NEDATAS) {
+		edata_t *edata = edata_cache_fast_get(tsdn, &shard->ecf);
+		if (edata == NULL) {
+			break;
+		}
+		edata_list_inactive_append(&resv->edatas, edata);
+		resv->nedatas++;
+	}
+	hpa_shard_maybe_do_deferred_work(tsdn, shard, /* forced */ false);
+	*deferred_work_generated = hpa_shard_has_deferred_work(tsdn, shard);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+	return resv->nedatas == 0;
+}
+
+static edata_t *
+hpa_resv_alloc(tsdn_t *tsdn, hpa_shard_t *shard, size_t size,
+    bool *deferred_work_generated) {
+	hpa_resv_t *resv = hpa_resv_pick(tsdn, shard);
+	malloc_mutex_lock(tsdn, &resv->mtx);
+	if ((resv->ps == NULL || resv->cur + size > resv->end
+	        || resv->nedatas == 0)
+	    && hpa_resv_refill(
+	        tsdn, shard, resv, size, deferred_work_generated)) {
+		malloc_mutex_unlock(tsdn, &resv->mtx);
+		return NULL;
+	}
+	hpdata_t *ps = resv->ps;
+	void     *addr = resv->cur;
+	resv->cur += size;
+	edata_t *edata = edata_list_inactive_first(&resv->edatas);
+	edata_list_inactive_remove(&resv->edatas, edata);
+	resv->nedatas--;
+	/* The hpdata can't be emptied while the range is reserved. */
+	uint64_t age = hpdata_age_get(ps);
+	malloc_mutex_unlock(tsdn, &resv->mtx);
+
+	edata_init(edata, shard->ind, addr, size, /* slab */ false, SC_NSIZES,
+	    /* sn */ age, extent_state_active, /* zeroed */ false,
+	    /* committed */ true, EXTENT_PAI_HPA, EXTENT_NOT_HEAD);
+	edata_ps_set(edata, ps);
+	if (emap_register_boundary(
+	        tsdn, shard->emap, edata, SC_NSIZES, /* slab */ false)) {
+		malloc_mutex_lock(tsdn, &shard->mtx);
+		psset_update_begin(&shard->psset, ps);
+		hpdata_unreserve(ps, addr, size);
+		hpa_update_purge_hugify_eligibility(tsdn, shard, ps);
+		psset_update_end(&shard->psset, ps);
+		edata_cache_fast_put(tsdn, &shard->ecf, edata);
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		return NULL;
+	}
+	return edata;
+}
+
+/* Returns every reservation's pages and edatas to the shard. */
+static void
+hpa_resv_flush(tsdn_t *tsdn, hpa_shard_t *shard) {
+	for (unsigned i = 0; i < shard->nresv; i++) {
+		hpa_resv_t *resv = &shard->resv[i];
+		malloc_mutex_lock(tsdn, &resv->mtx);
+		malloc_mutex_lock(tsdn, &shard->mtx);
+		hpa_resv_release(tsdn, shard, resv);
+		edata_t *edata;
+		while ((edata = edata_list_inactive_first(&resv->edatas))
+		    != NULL) {
+			edata_list_inactive_remove(&resv->edatas, edata);
+			edata_cache_fast_put(tsdn, &shard->ecf, edata);
+		}
+		resv->nedatas = 0;
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		malloc_mutex_unlock(tsdn, &resv->mtx);
+	}
+}
+
+/* Makes the nhp hpdatas starting at span a span of their own. */
+static void
+hpa_span_retile(hpdata_t *span, size_t nhp) {
+	for (size_t i = 0; i < nhp; i++) {
+		hpdata_span_move(&span[i], span);
+	}
+	hpdata_span_nhp_set(span, nhp);
+}
+
+/*
+ * Takes the smallest free span of at least nhp hugepages whose first nhp
+ * hugepages aren't being purged or hugified, and splits off what it has
+ * beyond those as a free span of its own.
+ */
+static hpdata_t *
+hpa_span_reuse(tsdn_t *tsdn, hpa_shard_t *shard, size_t nhp) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	hpdata_t *best = NULL;
+	for (hpdata_t *span = hpdata_empty_list_first(&shard->spans_free);
+	    span != NULL;
+	    span = hpdata_empty_list_next(&shard->spans_free, span)) {
+		size_t span_nhp = hpdata_span_nhp_get(span);
+		if (span_nhp < nhp
+		    || (best != NULL && span_nhp >= hpdata_span_nhp_get(best))) {
+			continue;
+		}
+		bool changing = false;
+		for (size_t i = 0; i < nhp && !changing; i++) {
+			changing = hpdata_changing_state_get(&span[i]);
+		}
+		if (!changing) {
+			best = span;
+		}
+	}
+	if (best == NULL) {
+		return NULL;
+	}
+	hpdata_empty_list_remove(&shard->spans_free, best);
+	size_t best_nhp = hpdata_span_nhp_get(best);
+	if (best_nhp > nhp) {
+		hpa_span_retile(&best[nhp], best_nhp - nhp);
+		hpdata_span_nhp_set(best, nhp);
+		hpdata_empty_list_append(&shard->spans_free, &best[nhp]);
+	}
+	return best;
+}
+
+/*
+ * Puts back a span with no extent in it, merged with the free spans next to
+ * it.  Spans tile their origin, and a span's first hugepage is empty only
+ * while it is free.
+ */
+static void
+hpa_span_free(tsdn_t *tsdn, hpa_shard_t *shard, hpdata_t *span) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	hpdata_t *origin = hpdata_span_origin_get(span);
+	hpdata_t *origin_end = origin + hpdata_span_origin_nhp_get(origin);
+	size_t    nhp = hpdata_span_nhp_get(span);
+	assert(hpdata_empty(span));
+
+	hpdata_t *next = &span[nhp];
+	if (next < origin_end && hpdata_empty(next)) {
+		hpdata_empty_list_remove(&shard->spans_free, next);
+		nhp += hpdata_span_nhp_get(next);
+	}
+	if (span > origin) {
+		hpdata_t *prev = hpdata_span_get(&span[-1]);
+		if (hpdata_empty(prev)) {
+			hpdata_empty_list_remove(&shard->spans_free, prev);
+			nhp += hpdata_span_nhp_get(prev);
+			span = prev;
+		}
+	}
+	hpa_span_retile(span, nhp);
+	hpdata_empty_list_append(&shard->spans_free, span);
+}
+
+/*
+ * Reserves the first size bytes of the span.  Returns whether they may hold
+ * anything but zeros.
+ */
+static bool
+hpa_span_reserve(tsdn_t *tsdn, hpa_shard_t *shard, hpdata_t *span,
+    size_t size) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	bool   dirty = !hpa_hooks_purge_zeroes(&shard->central->hooks);
+	size_t nhp = hpdata_span_nhp_get(span);
+	for (size_t i = 0; i < nhp; i++) {
+		hpdata_t *ps = &span[i];
+		size_t    ps_size = (i < nhp - 1) ? HUGEPAGE
+		                                  : size - (nhp - 1) * HUGEPAGE;
+		assert(hpdata_empty(ps));
+		dirty = dirty || hpdata_ntouched_get(ps) != 0;
+		psset_update_begin(&shard->psset, ps);
+		void *addr = hpdata_reserve_alloc(ps, ps_size);
+		assert(addr == hpdata_addr_get(ps));
+		(void)addr;
+		hpa_update_purge_hugify_eligibility(tsdn, shard, ps);
+		psset_update_end(&shard->psset, ps);
+	}
+	return dirty;
+}
+
+static void
+hpa_span_unreserve(tsdn_t *tsdn, hpa_shard_t *shard, hpdata_t *span,
+    size_t size) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	size_t nhp = hpdata_span_nhp_get(span);
+	for (size_t i = 0; i < nhp; i++) {
+		hpdata_t *ps = &span[i];
+		size_t    ps_size = (i < nhp - 1) ? HUGEPAGE
+		                                  : size - (nhp - 1) * HUGEPAGE;
+		psset_update_begin(&shard->psset, ps);
+		hpdata_unreserve(ps, hpdata_addr_get(ps), ps_size);
+		hpa_update_purge_hugify_eligibility(tsdn, shard, ps);
+		psset_update_end(&shard->psset, ps);
+	}
+	hpa_span_free(tsdn, shard, span);
+}
+
+/*
+ * Serves an allocation above slab_max_alloc from a span of its own, carved
+ * from a free one if possible.
+ */
+static edata_t *
+hpa_alloc_span(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, bool zero,
+    bool *deferred_work_generated) {
+	size_t nhp = HUGEPAGE_CEILING(size) / HUGEPAGE;
+	bool   oom = false;
+
+	/*
+	 * Keep the lock from picking a free span to reserving it, lest a purge
+	 * start on one of its hugepages in between.
+	 */
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	hpdata_t *span = hpa_span_reuse(tsdn, shard, nhp);
+	bool      fresh = (span == NULL);
+	if (fresh) {
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		malloc_mutex_lock(tsdn, &shard->grow_mtx);
+		span = hpa_central_extract_span(tsdn, shard->central, nhp,
+		    hpa_shard_node(shard), shard->age_counter++,
+		    hpa_is_hugify_eager(shard), &oom);
+		if (span == NULL) {
+			malloc_mutex_unlock(tsdn, &shard->grow_mtx);
+			return NULL;
+		}
+		malloc_mutex_lock(tsdn, &shard->mtx);
+		for (size_t i = 0; i < nhp; i++) {
+			psset_insert(&shard->psset, &span[i]);
+		}
+		malloc_mutex_unlock(tsdn, &shard->grow_mtx);
+	}
+
+	edata_t *edata = edata_cache_fast_get(tsdn, &shard->ecf);
+	if (edata == NULL) {
+		hpa_span_free(tsdn, shard, span);
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		return NULL;
+	}
+	/* A fresh mapping reads as zeros whatever its hpdatas say. */
+	bool dirty = hpa_span_reserve(tsdn, shard, span, size) && !fresh;
+	void *addr = hpdata_addr_get(span);
+	edata_init(edata, shard->ind, addr, size, /* slab */ false, SC_NSIZES,
+	    /* sn */ hpdata_age_get(span), extent_state_active,
+	    /* zeroed */ !dirty, /* committed */ true, EXTENT_PAI_HPA,
+	    EXTENT_NOT_HEAD);
+	edata_ps_set(edata, span);
+	if (emap_register_boundary(
+	        tsdn, shard->emap, edata, SC_NSIZES, /* slab */ false)) {
+		hpa_span_unreserve(tsdn, shard, span, size);
+		edata_cache_fast_put(tsdn, &shard->ecf, edata);
+		malloc_mutex_unlock(tsdn, &shard->mtx);
+		return NULL;
+	}
+	hpa_shard_maybe_do_deferred_work(tsdn, shard, /* forced */ false);
+	*deferred_work_generated = hpa_shard_has_deferred_work(tsdn, shard);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+
+	if (zero && dirty) {
+		memset(addr, 0, size);
+		edata_zeroed_set(edata, true);
+	}
+	return edata;
+}
+
 edata_t *
 hpa_alloc(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, size_t alignment,
     bool zero, bool guarded, bool frequent_reuse,
@@ -928,8 +1540,8 @@ hpa_alloc(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, size_t alignment,
 	witness_assert_depth_to_rank(
 	    tsdn_witness_tsdp_get(tsdn), WITNESS_RANK_CORE, 0);
 
-	/* We don't handle alignment or zeroing for now. */
-	if (alignment > PAGE || zero) {
+	/* We don't handle alignment for now. */
+	if (alignment > PAGE) {
 		return NULL;
 	}
 
@@ -945,19 +1557,33 @@ hpa_alloc(tsdn_t *tsdn, hpa_shard_t *shard, size_t size, size_t alignment,
 	 */
 	if (!(frequent_reuse && size <= HUGEPAGE)
 	    && (size > shard->opts.slab_max_alloc)) {
-		return NULL;
+		if (size > shard->opts.span_max_alloc) {
+			return NULL;
+		}
+		return hpa_alloc_span(
+		    tsdn, shard, size, zero, deferred_work_generated);
+	}
+	if (zero) {
+		return hpa_alloc_zero(tsdn, shard, size, deferred_work_generated);
 	}
 	edata_t *edata = sec_alloc(tsdn, &shard->sec, size);
 	if (edata != NULL) {
 		return edata;
 	}
+	if (size <= shard->opts.resv_max_alloc && shard->nresv != 0) {
+		edata = hpa_resv_alloc(
+		    tsdn, shard, size, deferred_work_generated);
+		if (edata != NULL) {
+			return edata;
+		}
+	}
 	edata_list_active_t results;
 	edata_list_active_init(&results);
 	size_t min_nallocs, max_nallocs;
 	sec_calc_nallocs_for_size(
 	    &shard->sec, size, &min_nallocs, &max_nallocs);
 	size_t nsuccess = hpa_alloc_batch_psset(tsdn, shard, size, min_nallocs,
-	    max_nallocs, &results, deferred_work_generated);
+	    max_nallocs, /* touched */ NULL, &results, deferred_work_generated);
 	hpa_assert_results(tsdn, shard, &results);
 	edata = edata_list_active_first(&results);
 
@@ -1038,10 +1664,17 @@ hpa_dalloc_locked(tsdn_t *tsdn, hpa_shard_t *shard, edata_t *edata) {
 	size_t unreserve_size = edata_size_get(edata);
 	edata_cache_fast_put(tsdn, &shard->ecf, edata);
 
+	if (hpdata_span_get(ps) != NULL) {
+		assert(hpdata_span_get(ps) == ps);
+		hpa_span_unreserve(tsdn, shard, ps, unreserve_size);
+		return;
+	}
+
 	psset_update_begin(&shard->psset, ps);
 	hpdata_unreserve(ps, unreserve_addr, unreserve_size);
 	JE_USDT(hpa_dalloc, 5, shard->ind, unreserve_addr, unreserve_size,
 	    hpdata_nactive_get(ps), hpdata_age_get(ps));
+	hpa_note_activity(shard, ps, hpdata_ntouched_get(ps));
 	hpa_update_purge_hugify_eligibility(tsdn, shard, ps);
 	psset_update_end(&shard->psset, ps);
 }
@@ -1075,7 +1708,10 @@ hpa_dalloc(tsdn_t *tsdn, hpa_shard_t *shard, edata_t *edata,
 	edata_list_active_init(&dalloc_list);
 	edata_list_active_append(&dalloc_list, edata);
 
-	sec_dalloc(tsdn, &shard->sec, &dalloc_list);
+	/* Spans are not cached; the SEC would hand them out as plain extents. */
+	if (hpdata_span_get(edata_ps_get(edata)) == NULL) {
+		sec_dalloc(tsdn, &shard->sec, &dalloc_list);
+	}
 	if (edata_list_active_empty(&dalloc_list)) {
 		/* sec consumed the pointer */
 		*deferred_work_generated = false;
@@ -1109,6 +1745,18 @@ hpa_time_until_deferred_work(tsdn_t *tsdn, hpa_shard_t *shard) {
 			time_ns = shard->opts.hugify_delay_ms
 			    - since_hugify_allowed_ms;
 			time_ns *= 1000 * 1000;
+		} else if (hpa_collapse_budgeted(shard)) {
+			/* Sleep until the collapse budget is refilled. */
+			nstime_t now;
+			shard->central->hooks.curtime(
+			    &now, /* first_reading */ true);
+			uint64_t until_budget_ns = hpa_collapse_budget_wait(
+			    shard, &now);
+			if (until_budget_ns == 0) {
+				malloc_mutex_unlock(tsdn, &shard->mtx);
+				return BACKGROUND_THREAD_DEFERRED_MIN;
+			}
+			time_ns = until_budget_ns;
 		} else {
 			malloc_mutex_unlock(tsdn, &shard->mtx);
 			return BACKGROUND_THREAD_DEFERRED_MIN;
@@ -1157,7 +1805,9 @@ hpa_sec_flush_impl(tsdn_t *tsdn, hpa_shard_t *shard) {
 void
 hpa_shard_disable(tsdn_t *tsdn, hpa_shard_t *shard) {
 	hpa_do_consistency_checks(shard);
+	purge_pool_drain(tsdn, shard);
 	hpa_sec_flush_impl(tsdn, shard);
+	hpa_resv_flush(tsdn, shard);
 
 	malloc_mutex_lock(tsdn, &shard->mtx);
 	edata_cache_fast_disable(tsdn, &shard->ecf);
@@ -1167,6 +1817,9 @@ hpa_shard_disable(tsdn_t *tsdn, hpa_shard_t *shard) {
 void
 hpa_shard_flush(tsdn_t *tsdn, hpa_shard_t *shard) {
 	hpa_sec_flush_impl(tsdn, shard);
+	hpa_resv_flush(tsdn, shard);
+	/* Callers expect the purges already handed over to be done, too. */
+	purge_pool_drain(tsdn, shard);
 }
 
 static void
@@ -1209,6 +1862,15 @@ hpa_shard_destroy(tsdn_t *tsdn, hpa_shard_t *shard) {
 		psset_remove(&shard->psset, ps);
 		shard->central->hooks.unmap(hpdata_addr_get(ps), HUGEPAGE);
 	}
+	while ((ps = hpdata_empty_list_first(&shard->spans_free)) != NULL) {
+		hpdata_empty_list_remove(&shard->spans_free, ps);
+		for (size_t i = 0; i < hpdata_span_nhp_get(ps); i++) {
+			assert(hpdata_empty(&ps[i]));
+			psset_remove(&shard->psset, &ps[i]);
+			shard->central->hooks.unmap(
+			    hpdata_addr_get(&ps[i]), HUGEPAGE);
+		}
+	}
 }
 
 void
@@ -1239,6 +1901,9 @@ void
 hpa_shard_prefork2(tsdn_t *tsdn, hpa_shard_t *shard) {
 	hpa_do_consistency_checks(shard);
 	sec_prefork2(tsdn, &shard->sec);
+	for (unsigned i = 0; i < shard->nresv; i++) {
+		malloc_mutex_prefork(tsdn, &shard->resv[i].mtx);
+	}
 }
 
 void
@@ -1260,6 +1925,9 @@ hpa_shard_postfork_parent(tsdn_t *tsdn, hpa_shard_t *shard) {
 	hpa_do_consistency_checks(shard);
 
 	sec_postfork_parent(tsdn, &shard->sec);
+	for (unsigned i = 0; i < shard->nresv; i++) {
+		malloc_mutex_postfork_parent(tsdn, &shard->resv[i].mtx);
+	}
 	malloc_mutex_postfork_parent(tsdn, &shard->grow_mtx);
 	malloc_mutex_postfork_parent(tsdn, &shard->mtx);
 }
@@ -1269,6 +1937,9 @@ hpa_shard_postfork_child(tsdn_t *tsdn, hpa_shard_t *shard) {
 	hpa_do_consistency_checks(shard);
 
 	sec_postfork_child(tsdn, &shard->sec);
+	for (unsigned i = 0; i < shard->nresv; i++) {
+		malloc_mutex_postfork_child(tsdn, &shard->resv[i].mtx);
+	}
 	malloc_mutex_postfork_child(tsdn, &shard->grow_mtx);
 	malloc_mutex_postfork_child(tsdn, &shard->mtx);
 }
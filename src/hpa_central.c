@@ -20,12 +20,32 @@ hpa_central_init(
 	}
 
 	central->base = base;
-	central->eden = NULL;
-	central->eden_len = 0;
+	for (unsigned i = 0; i <= HPA_CENTRAL_NODE_ANY; i++) {
+		central->eden[i] = NULL;
+		central->eden_len[i] = 0;
+	}
 	central->hooks = *hooks;
 	return false;
 }
 
+/* Maps size bytes for the given node's pageslabs. */
+static void *
+hpa_central_map(hpa_central_t *central, size_t size, unsigned node,
+    bool hugify_eager) {
+	void *addr = central->hooks.map(size);
+	if (addr == NULL) {
+		return NULL;
+	}
+	/* Bind the whole mapping at once, rather than each pageslab. */
+	if (node != HPA_CENTRAL_NODE_ANY) {
+		numa_node_bind(node, addr, size);
+	}
+	if (hugify_eager) {
+		central->hooks.hugify(addr, size, /* sync */ false);
+	}
+	return addr;
+}
+
 static hpdata_t *
 hpa_alloc_ps(tsdn_t *tsdn, hpa_central_t *central) {
 	return (hpdata_t *)base_alloc(
@@ -34,9 +54,10 @@ hpa_alloc_ps(tsdn_t *tsdn, hpa_central_t *central) {
 
 hpdata_t *
 hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
-    uint64_t age, bool hugify_eager, bool *oom) {
+    unsigned node, uint64_t age, bool hugify_eager, bool *oom) {
 	/* Don't yet support big allocations; these should get filtered out. */
 	assert(size <= HUGEPAGE);
+	assert(node <= HPA_CENTRAL_NODE_ANY);
 	/*
 	 * Should only try to extract from the central allocator if the local
 	 * shard is exhausted.  We should hold the grow_mtx on that shard.
@@ -46,6 +67,8 @@ hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
 
 	malloc_mutex_lock(tsdn, &central->grow_mtx);
 	*oom = false;
+	void  **eden = &central->eden[node];
+	size_t *eden_len = &central->eden_len[node];
 
 	hpdata_t *ps = NULL;
 	bool      start_as_huge = hugify_eager
@@ -53,16 +76,16 @@ hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
 	        && opt_experimental_hpa_start_huge_if_thp_always);
 
 	/* Is eden a perfect fit? */
-	if (central->eden != NULL && central->eden_len == HUGEPAGE) {
+	if (*eden != NULL && *eden_len == HUGEPAGE) {
 		ps = hpa_alloc_ps(tsdn, central);
 		if (ps == NULL) {
 			*oom = true;
 			malloc_mutex_unlock(tsdn, &central->grow_mtx);
 			return NULL;
 		}
-		hpdata_init(ps, central->eden, age, start_as_huge);
-		central->eden = NULL;
-		central->eden_len = 0;
+		hpdata_init(ps, *eden, age, start_as_huge);
+		*eden = NULL;
+		*eden_len = 0;
 		malloc_mutex_unlock(tsdn, &central->grow_mtx);
 		return ps;
 	}
@@ -72,18 +95,15 @@ hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
 	 * NULL, we have to allocate it too.  Otherwise, we just have to
 	 * allocate an edata_t for the new psset.
 	 */
-	if (central->eden == NULL) {
+	if (*eden == NULL) {
 		/* Allocate address space, bailing if we fail. */
-		void *new_eden = central->hooks.map(HPA_EDEN_SIZE);
+		void *new_eden = hpa_central_map(
+		    central, HPA_EDEN_SIZE, node, hugify_eager);
 		if (new_eden == NULL) {
 			*oom = true;
 			malloc_mutex_unlock(tsdn, &central->grow_mtx);
 			return NULL;
 		}
-		if (hugify_eager) {
-			central->hooks.hugify(
-			    new_eden, HPA_EDEN_SIZE, /* sync */ false);
-		}
 		ps = hpa_alloc_ps(tsdn, central);
 		if (ps == NULL) {
 			central->hooks.unmap(new_eden, HPA_EDEN_SIZE);
@@ -91,8 +111,8 @@ hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
 			malloc_mutex_unlock(tsdn, &central->grow_mtx);
 			return NULL;
 		}
-		central->eden = new_eden;
-		central->eden_len = HPA_EDEN_SIZE;
+		*eden = new_eden;
+		*eden_len = HPA_EDEN_SIZE;
 	} else {
 		/* Eden is already nonempty; only need an edata for ps. */
 		ps = hpa_alloc_ps(tsdn, central);
@@ -103,19 +123,81 @@ hpa_central_extract(tsdn_t *tsdn, hpa_central_t *central, size_t size,
 		}
 	}
 	assert(ps != NULL);
-	assert(central->eden != NULL);
-	assert(central->eden_len > HUGEPAGE);
-	assert(central->eden_len % HUGEPAGE == 0);
-	assert(HUGEPAGE_ADDR2BASE(central->eden) == central->eden);
+	assert(*eden != NULL);
+	assert(*eden_len > HUGEPAGE);
+	assert(*eden_len % HUGEPAGE == 0);
+	assert(HUGEPAGE_ADDR2BASE(*eden) == *eden);
 
-	hpdata_init(ps, central->eden, age, start_as_huge);
+	hpdata_init(ps, *eden, age, start_as_huge);
 
-	char *eden_char = (char *)central->eden;
+	char *eden_char = (char *)*eden;
 	eden_char += HUGEPAGE;
-	central->eden = (void *)eden_char;
-	central->eden_len -= HUGEPAGE;
+	*eden = (void *)eden_char;
+	*eden_len -= HUGEPAGE;
 
 	malloc_mutex_unlock(tsdn, &central->grow_mtx);
 
 	return ps;
 }
+
+hpdata_t *
+hpa_central_extract_span(tsdn_t *tsdn, hpa_central_t *central, size_t nhp,
+    unsigned node, uint64_t age, bool hugify_eager, bool *oom) {
+	assert(nhp > 0);
+	assert(node <= HPA_CENTRAL_NODE_ANY);
+	witness_assert_positive_depth_to_rank(
+	    tsdn_witness_tsdp_get(tsdn), WITNESS_RANK_HPA_SHARD_GROW);
+
+	malloc_mutex_lock(tsdn, &central->grow_mtx);
+	*oom = false;
+	void  **eden = &central->eden[node];
+	size_t *eden_len = &central->eden_len[node];
+
+	bool start_as_huge = hugify_eager
+	    || (init_system_thp_mode == system_thp_mode_always
+	        && opt_experimental_hpa_start_huge_if_thp_always);
+	size_t size = nhp * HUGEPAGE;
+
+	/*
+	 * Carve the span off the front of eden if it fits; otherwise give it
+	 * a mapping of its own, rather than abandoning what is left of eden.
+	 */
+	void *addr;
+	bool  from_eden = *eden != NULL && *eden_len >= size;
+	if (from_eden) {
+		addr = *eden;
+	} else {
+		addr = hpa_central_map(central, size, node, hugify_eager);
+		if (addr == NULL) {
+			*oom = true;
+			malloc_mutex_unlock(tsdn, &central->grow_mtx);
+			return NULL;
+		}
+	}
+	hpdata_t *span = (hpdata_t *)base_alloc(
+	    tsdn, central->base, nhp * sizeof(hpdata_t), CACHELINE);
+	if (span == NULL) {
+		if (!from_eden) {
+			central->hooks.unmap(addr, size);
+		}
+		*oom = true;
+		malloc_mutex_unlock(tsdn, &central->grow_mtx);
+		return NULL;
+	}
+	if (from_eden) {
+		*eden_len -= size;
+		*eden = (*eden_len == 0) ? NULL
+		                         : (void *)((byte_t *)*eden + size);
+	}
+	assert(HUGEPAGE_ADDR2BASE(addr) == addr);
+
+	for (size_t i = 0; i < nhp; i++) {
+		hpdata_init(&span[i], (void *)((byte_t *)addr + i * HUGEPAGE),
+		    age, start_as_huge);
+		hpdata_span_set(&span[i], span, nhp);
+	}
+
+	malloc_mutex_unlock(tsdn, &central->grow_mtx);
+
+	return span;
+}
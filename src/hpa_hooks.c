@@ -37,10 +37,18 @@ hpa_hooks_unmap(void *ptr, size_t size) {
 	pages_unmap(ptr, size);
 }
 
+/*
+ * Set once a purge fails; from then on pages that were purged may still hold
+ * stale data, and the HPA can't treat untouched pages as zeroed anymore.
+ */
+static atomic_b_t hpa_hooks_purge_failed = ATOMIC_INIT(false);
+
 static void
 hpa_hooks_purge(void *ptr, size_t size) {
 	JE_USDT(hpa_purge, 2, size, ptr);
-	pages_purge_forced(ptr, size);
+	if (pages_purge_forced(ptr, size)) {
+		atomic_store_b(&hpa_hooks_purge_failed, true, ATOMIC_RELAXED);
+	}
 }
 
 static bool
@@ -98,3 +106,12 @@ hpa_hooks_vectorized_purge(void *vec, size_t vlen, size_t nbytes) {
 	return true;
 #endif
 }
+
+bool
+hpa_hooks_purge_zeroes(const hpa_hooks_t *hooks) {
+	return hooks->map == hpa_hooks_default.map
+	    && hooks->purge == hpa_hooks_default.purge
+	    && hooks->vectorized_purge == hpa_hooks_default.vectorized_purge
+	    && pages_purge_forced_zeroes()
+	    && !atomic_load_b(&hpa_hooks_purge_failed, ATOMIC_RELAXED);
+}
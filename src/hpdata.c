@@ -9,21 +9,157 @@ hpdata_age_comp(const hpdata_t *a, const hpdata_t *b) {
 	uint64_t b_age = hpdata_age_get(b);
 	/*
 	 * hpdata ages are operation counts in the psset; no two should be the
-	 * same.
+	 * same.  (The tree compares a node against itself while removing it.)
 	 */
-	assert(a_age != b_age);
+	assert(a == b || a_age != b_age);
 	return (a_age > b_age) - (a_age < b_age);
 }
 
-ph_gen(, hpdata_age_heap, hpdata_t, age_link, hpdata_age_comp)
+static bool
+hpdata_age_summarize(
+    hpdata_t *hpdata, const hpdata_t *lchild, const hpdata_t *rchild) {
+	size_t longest = hpdata_longest_free_range_get(hpdata);
+	if (lchild != NULL) {
+		longest = max_zu(longest, lchild->h_subtree_longest_free_range);
+	}
+	if (rchild != NULL) {
+		longest = max_zu(longest, rchild->h_subtree_longest_free_range);
+	}
+	/*
+	 * The old value may be stale from an earlier stay in the tree, so it
+	 * can't tell us whether the ancestors need an update.
+	 */
+	hpdata->h_subtree_longest_free_range = longest;
+	return true;
+}
+
+rb_summarized_gen(, hpdata_age_tree_, hpdata_age_tree_t, hpdata_t, age_link,
+    hpdata_age_comp, hpdata_age_summarize)
+
+static int
+hpdata_lru_comp(const hpdata_t *a, const hpdata_t *b) {
+	uint64_t a_key = hpdata_lru_key_get(a);
+	uint64_t b_key = hpdata_lru_key_get(b);
+	int      ret = (a_key > b_key) - (a_key < b_key);
+	if (ret != 0) {
+		return ret;
+	}
+	/* Hugepages never touched by the hpa share key 0. */
+	uintptr_t a_addr = (uintptr_t)hpdata_addr_get(a);
+	uintptr_t b_addr = (uintptr_t)hpdata_addr_get(b);
+	return (a_addr > b_addr) - (a_addr < b_addr);
+}
+
+rb_gen(, hpdata_lru_tree_, hpdata_lru_tree_t, hpdata_t, lru_link,
+    hpdata_lru_comp)
+
+/* Pages covered by a leaf of the free range summary. */
+#define HPDATA_FR_LEAF_PAGES                                                   \
+	(HUGEPAGE_PAGES < FB_GROUP_BITS ? HUGEPAGE_PAGES : FB_GROUP_BITS)
+
+static void
+hpdata_fr_leaf_update(hpdata_t *hpdata, size_t leaf) {
+	const fb_group_t *group = &hpdata->active_pages[leaf];
+	const size_t      nbits = HPDATA_FR_LEAF_PAGES;
+	hpdata_fr_node_t *node = &hpdata->h_free_ranges[HPDATA_FR_NLEAVES + leaf];
+	node->prefix = (hpdata_fr_len_t)fb_ffs(group, nbits, 0);
+	node->suffix = (hpdata_fr_len_t)(
+	    nbits - (size_t)(fb_fls(group, nbits, nbits - 1) + 1));
+	node->longest = (hpdata_fr_len_t)fb_urange_longest(group, nbits);
+}
+
+/* Recomputes node i, whose children each cover child_pages pages. */
+static void
+hpdata_fr_node_update(hpdata_t *hpdata, size_t i, size_t child_pages) {
+	hpdata_fr_node_t       *node = &hpdata->h_free_ranges[i];
+	const hpdata_fr_node_t *l = &hpdata->h_free_ranges[2 * i];
+	const hpdata_fr_node_t *r = &hpdata->h_free_ranges[2 * i + 1];
+	node->prefix = (hpdata_fr_len_t)(
+	    l->prefix == child_pages ? child_pages + r->prefix : l->prefix);
+	node->suffix = (hpdata_fr_len_t)(
+	    r->suffix == child_pages ? child_pages + l->suffix : r->suffix);
+	node->longest = (hpdata_fr_len_t)max_zu(
+	    max_zu(l->longest, r->longest), (size_t)l->suffix + r->prefix);
+}
+
+/*
+ * Brings the free range summary up to date after a change to the active bits
+ * of [begin, begin + npages), and caches the new longest free range.
+ */
+static void
+hpdata_fr_update(hpdata_t *hpdata, size_t begin, size_t npages) {
+	assert(npages > 0 && begin + npages <= HUGEPAGE_PAGES);
+	size_t lo = begin / HPDATA_FR_LEAF_PAGES;
+	size_t hi = (begin + npages - 1) / HPDATA_FR_LEAF_PAGES;
+	for (size_t leaf = lo; leaf <= hi; leaf++) {
+		hpdata_fr_leaf_update(hpdata, leaf);
+	}
+	lo += HPDATA_FR_NLEAVES;
+	hi += HPDATA_FR_NLEAVES;
+	for (size_t child_pages = HPDATA_FR_LEAF_PAGES; lo > 1;
+	    child_pages *= 2) {
+		lo /= 2;
+		hi /= 2;
+		for (size_t i = lo; i <= hi; i++) {
+			hpdata_fr_node_update(hpdata, i, child_pages);
+		}
+	}
+	hpdata_longest_free_range_set(hpdata, hpdata->h_free_ranges[1].longest);
+}
+
+/*
+ * Returns the first page of the first free range at least npages long.  Going
+ * down, a range that fits either lies within the left child, straddles the two
+ * children, or lies within the right one, in address order.
+ */
+static size_t
+hpdata_fr_first_fit(const hpdata_t *hpdata, size_t npages) {
+	const hpdata_fr_node_t *fr = hpdata->h_free_ranges;
+	assert(npages > 0 && fr[1].longest >= npages);
+	size_t i = 1;
+	size_t begin = 0;
+	size_t node_pages = HPDATA_FR_NLEAVES * HPDATA_FR_LEAF_PAGES;
+	while (i < HPDATA_FR_NLEAVES) {
+		node_pages /= 2;
+		if (fr[2 * i].longest >= npages) {
+			i = 2 * i;
+		} else if ((size_t)fr[2 * i].suffix + fr[2 * i + 1].prefix
+		    >= npages) {
+			return begin + node_pages - fr[2 * i].suffix;
+		} else {
+			i = 2 * i + 1;
+			begin += node_pages;
+		}
+	}
+	/*
+	 * The range lies within this leaf.  A free range running into the leaf
+	 * from the left is too short, or we'd have stopped above.
+	 */
+	size_t start = begin;
+	size_t len = 0;
+	while (true) {
+		bool found = fb_urange_iter(
+		    hpdata->active_pages, HUGEPAGE_PAGES, start, &begin, &len);
+		assert(found);
+		if (len >= npages) {
+			return begin;
+		}
+		start = begin + len;
+	}
+}
 
-    void hpdata_init(hpdata_t *hpdata, void *addr, uint64_t age, bool is_huge) {
+void
+hpdata_init(hpdata_t *hpdata, void *addr, uint64_t age, bool is_huge) {
 	hpdata_addr_set(hpdata, addr);
 	hpdata_age_set(hpdata, age);
 	hpdata->h_huge = is_huge;
 	hpdata->h_alloc_allowed = true;
 	hpdata->h_in_psset_alloc_container = false;
 	hpdata->h_purge_allowed = false;
+	hpdata->h_last_active = 0;
+	hpdata->h_lru_key = 0;
+	hpdata->h_in_psset_lru_container = false;
+	hpdata->h_purged = false;
 	hpdata->h_hugify_allowed = false;
 	hpdata->h_in_psset_hugify_container = false;
 	hpdata->h_mid_purge = false;
@@ -33,6 +169,7 @@ ph_gen(, hpdata_age_heap, hpdata_t, age_link, hpdata_age_comp)
 	hpdata_longest_free_range_set(hpdata, HUGEPAGE_PAGES);
 	hpdata->h_nactive = 0;
 	fb_init(hpdata->active_pages, HUGEPAGE_PAGES);
+	hpdata_fr_update(hpdata, 0, HUGEPAGE_PAGES);
 	if (is_huge) {
 		fb_set_range(
 		    hpdata->touched_pages, HUGEPAGE_PAGES, 0, HUGEPAGE_PAGES);
@@ -43,6 +180,10 @@ ph_gen(, hpdata_age_heap, hpdata_t, age_link, hpdata_age_comp)
 	}
 	nstime_init_zero(&hpdata->h_time_purge_allowed);
 	hpdata->h_purged_when_empty_and_huge = false;
+	hpdata->h_span = NULL;
+	hpdata->h_span_nhp = 0;
+	hpdata->h_span_origin = NULL;
+	hpdata->h_span_origin_nhp = 0;
 
 	hpdata_assert_consistent(hpdata);
 }
@@ -59,45 +200,20 @@ hpdata_reserve_alloc(hpdata_t *hpdata, size_t sz) {
 	assert(hpdata->h_alloc_allowed);
 	assert((sz & PAGE_MASK) == 0);
 	size_t npages = sz >> LG_PAGE;
+	/*
+	 * A precondition to this function is that hpdata must be able to serve
+	 * the allocation.
+	 */
 	assert(npages <= hpdata_longest_free_range_get(hpdata));
 
-	size_t result;
-
-	size_t start = 0;
 	/*
-	 * These are dead stores, but the compiler will issue warnings on them
-	 * since it can't tell statically that found is always true below.
+	 * We use first-fit within the page slabs; this gives bounded worst-case
+	 * fragmentation within a slab.  It's not necessarily right; we could
+	 * experiment with various other options.
 	 */
-	size_t begin = 0;
-	size_t len = 0;
-
-	size_t largest_unchosen_range = 0;
-	while (true) {
-		bool found = fb_urange_iter(
-		    hpdata->active_pages, HUGEPAGE_PAGES, start, &begin, &len);
-		/*
-		 * A precondition to this function is that hpdata must be able
-		 * to serve the allocation.
-		 */
-		assert(found);
-		assert(len <= hpdata_longest_free_range_get(hpdata));
-		if (len >= npages) {
-			/*
-			 * We use first-fit within the page slabs; this gives
-			 * bounded worst-case fragmentation within a slab.  It's
-			 * not necessarily right; we could experiment with
-			 * various other options.
-			 */
-			break;
-		}
-		if (len > largest_unchosen_range) {
-			largest_unchosen_range = len;
-		}
-		start = begin + len;
-	}
-	/* We found a range; remember it. */
-	result = begin;
-	fb_set_range(hpdata->active_pages, HUGEPAGE_PAGES, begin, npages);
+	size_t result = hpdata_fr_first_fit(hpdata, npages);
+	fb_set_range(hpdata->active_pages, HUGEPAGE_PAGES, result, npages);
+	hpdata_fr_update(hpdata, result, npages);
 	hpdata->h_nactive += npages;
 
 	/*
@@ -109,32 +225,6 @@ hpdata_reserve_alloc(hpdata_t *hpdata, size_t sz) {
 	fb_set_range(hpdata->touched_pages, HUGEPAGE_PAGES, result, npages);
 	hpdata->h_ntouched += new_dirty;
 
-	/*
-	 * If we allocated out of a range that was the longest in the hpdata, it
-	 * might be the only one of that size and we'll have to adjust the
-	 * metadata.
-	 */
-	if (len == hpdata_longest_free_range_get(hpdata)) {
-		start = begin + npages;
-		while (start < HUGEPAGE_PAGES) {
-			bool found = fb_urange_iter(hpdata->active_pages,
-			    HUGEPAGE_PAGES, start, &begin, &len);
-			if (!found) {
-				break;
-			}
-			assert(len <= hpdata_longest_free_range_get(hpdata));
-			if (len == hpdata_longest_free_range_get(hpdata)) {
-				largest_unchosen_range = len;
-				break;
-			}
-			if (len > largest_unchosen_range) {
-				largest_unchosen_range = len;
-			}
-			start = begin + len;
-		}
-		hpdata_longest_free_range_set(hpdata, largest_unchosen_range);
-	}
-
 	hpdata_assert_consistent(hpdata);
 	return (
 	    void *)((byte_t *)hpdata_addr_get(hpdata) + (result << LG_PAGE));
@@ -151,20 +241,10 @@ hpdata_unreserve(hpdata_t *hpdata, void *addr, size_t sz) {
 	    >> LG_PAGE;
 	assert(begin < HUGEPAGE_PAGES);
 	size_t npages = sz >> LG_PAGE;
-	size_t old_longest_range = hpdata_longest_free_range_get(hpdata);
 
 	fb_unset_range(hpdata->active_pages, HUGEPAGE_PAGES, begin, npages);
 	/* We might have just created a new, larger range. */
-	size_t new_begin = (fb_fls(hpdata->active_pages, HUGEPAGE_PAGES, begin)
-	    + 1);
-	size_t new_end = fb_ffs(
-	    hpdata->active_pages, HUGEPAGE_PAGES, begin + npages - 1);
-	size_t new_range_len = new_end - new_begin;
-
-	if (new_range_len > old_longest_range) {
-		hpdata_longest_free_range_set(hpdata, new_range_len);
-	}
-
+	hpdata_fr_update(hpdata, begin, npages);
 	hpdata->h_nactive -= npages;
 
 	hpdata_assert_consistent(hpdata);
@@ -180,9 +260,9 @@ hpdata_find_alloc_offsets(hpdata_t *hpdata, size_t sz,
 	/* We should be able to find at least one allocation */
 	assert(npages <= hpdata_longest_free_range_get(hpdata));
 
+	/* Skip past the free ranges that are too short. */
 	size_t nallocs = 0;
-	size_t start = 0;
-	size_t longest_len = 0;
+	size_t start = hpdata_fr_first_fit(hpdata, npages);
 	while (true) {
 		size_t begin = 0;
 		size_t len = 0;
@@ -197,9 +277,7 @@ hpdata_find_alloc_offsets(hpdata_t *hpdata, size_t sz,
 
 		/* carve up the free range, if it's large enough */
 		while (npages <= len) {
-			offsets->len_before = len;
 			offsets->index = begin;
-			offsets->longest_len = longest_len;
 			offsets += 1;
 
 			nallocs += 1;
@@ -219,7 +297,6 @@ hpdata_find_alloc_offsets(hpdata_t *hpdata, size_t sz,
 		if (start == HUGEPAGE_PAGES) {
 			break;
 		}
-		longest_len = max_zu(longest_len, len);
 	}
 
 	/* post-conditions */
@@ -268,71 +345,11 @@ hpdata_post_reserve_alloc_offsets(hpdata_t *hpdata, size_t sz,
 		return;
 	}
 
-	size_t max_len = offsets[0].len_before;
-	for (size_t i = 1; i < nallocs; i += 1) {
-		max_len = max_zu(max_len, offsets[i].len_before);
-	}
-
-	const size_t prev_longest = hpdata_longest_free_range_get(hpdata);
-	assert(max_len <= prev_longest);
-	if (max_len < prev_longest) {
-		/* no need to update the hpdata longest range */
-		return;
-	}
-
-	/*
-	 * If we allocated out of a range that was the longest in the hpdata, it
-	 * might be the only one of that size and we'll have to adjust the
-	 * metadata.
-	 */
-	const size_t len_before = offsets[nallocs - 1].len_before;
-	size_t       start = offsets[nallocs - 1].index + len_before;
-	size_t       longest_len = max_zu(
-            offsets[nallocs - 1].longest_len, len_before - npages);
-
-	const size_t rest = HUGEPAGE_PAGES - start;
-	/*
-	 * Only look at the rest if we think we'll find a range longer than what
-	 * we already have. This also implicitly checks for rest == 0, so we don't
-	 * have to check before the first call to fb_urange_iter().
-	 */
-	if (longest_len < rest) {
-		while (true) {
-			size_t begin = 0;
-			size_t len = 0;
-
-			const bool found = fb_urange_iter(hpdata->active_pages,
-			    HUGEPAGE_PAGES, start, &begin, &len);
-			if (!found) {
-				break;
-			}
-
-			if (longest_len < len) {
-				if (len == prev_longest) {
-					/* it's already set to the right value */
-					assert(hpdata_longest_free_range_get(
-					           hpdata)
-					    == len);
-					assert(fb_urange_longest(
-					           hpdata->active_pages,
-					           HUGEPAGE_PAGES)
-					    == len);
-					return;
-				}
-				longest_len = len;
-			}
-
-			start = begin + len;
-			assert(start <= HUGEPAGE_PAGES);
-			if (start == HUGEPAGE_PAGES) {
-				break;
-			}
-		}
-	}
-
-	assert(fb_urange_longest(hpdata->active_pages, HUGEPAGE_PAGES)
-	    == longest_len);
-	hpdata_longest_free_range_set(hpdata, longest_len);
+	/* The offsets are in address order; update everything they span. */
+	const size_t begin = offsets[0].index;
+	const size_t end = offsets[nallocs - 1].index + npages;
+	assert(begin < end);
+	hpdata_fr_update(hpdata, begin, end - begin);
 }
 
 size_t
@@ -482,6 +499,9 @@ hpdata_purge_end(hpdata_t *hpdata, hpdata_purge_state_t *purge_state) {
 	    purge_state->to_purge, HUGEPAGE_PAGES);
 	assert(hpdata->h_ntouched >= purge_state->ndirty_to_purge);
 	hpdata->h_ntouched -= purge_state->ndirty_to_purge;
+	if (purge_state->ndirty_to_purge > 0) {
+		hpdata->h_purged = true;
+	}
 
 	hpdata_assert_consistent(hpdata);
 }
@@ -19,7 +19,7 @@ inspect_extent_util_stats_get(
 		*nregs = 1;
 	} else {
 		*nfree = edata_nfree_get(edata);
-		*nregs = bin_infos[edata_szind_get(edata)].nregs;
+		*nregs = bin_slab_nregs(&bin_infos[edata_szind_get(edata)], edata);
 		assert(*nfree <= *nregs);
 		assert(*nfree * edata_usize_get(edata) <= *size);
 	}
@@ -49,7 +49,7 @@ inspect_extent_util_stats_verbose_get(tsdn_t *tsdn, const void *ptr,
 
 	*nfree = edata_nfree_get(edata);
 	const szind_t szind = edata_szind_get(edata);
-	*nregs = bin_infos[szind].nregs;
+	*nregs = bin_slab_nregs(&bin_infos[szind], edata);
 	assert(*nfree <= *nregs);
 	assert(*nfree * edata_usize_get(edata) <= *size);
 
@@ -60,7 +60,7 @@ inspect_extent_util_stats_verbose_get(tsdn_t *tsdn, const void *ptr,
 
 	malloc_mutex_lock(tsdn, &bin->lock);
 	if (config_stats) {
-		*bin_nregs = *nregs * bin->stats.curslabs;
+		*bin_nregs = bin->stats.curslabs_nregs;
 		assert(*bin_nregs >= bin->stats.curregs);
 		*bin_nfree = *bin_nregs - bin->stats.curregs;
 	} else {
@@ -2207,6 +2207,123 @@ label_done:
 	return filled;
 }
 
+/* Upper bound on the objects staged for one round of flushing. */
+#define BATCH_FREE_NSTAGE_MAX CACHE_BIN_NFLUSH_BATCH_MAX
+
+/*
+ * Returns the staged objects to their bins, one size class at a time.  Each
+ * class is handed to arena_ptr_array_flush() as a single array, so that edata
+ * lookups are batched and every bin lock is taken once per slab group rather
+ * than once per object.
+ */
+static void
+batch_free_flush(tsd_t *tsd, arena_t *stats_arena, void **ptrs,
+    szind_t *szinds, size_t nstaged) {
+	void *group[BATCH_FREE_NSTAGE_MAX];
+	while (nstaged > 0) {
+		szind_t szind = szinds[0];
+		size_t  ngroup = 0;
+		size_t  nrest = 0;
+		for (size_t i = 0; i < nstaged; i++) {
+			if (szinds[i] == szind) {
+				group[ngroup++] = ptrs[i];
+			} else {
+				ptrs[nrest] = ptrs[i];
+				szinds[nrest] = szinds[i];
+				nrest++;
+			}
+		}
+		cache_bin_ptr_array_t arr;
+		arr.n = (cache_bin_sz_t)ngroup;
+		arr.ptr = group;
+		cache_bin_stats_t merge_stats = {0};
+		arena_ptr_array_flush(tsd, szind, &arr, (unsigned)ngroup,
+		    /* small */ true, stats_arena, merge_stats,
+		    /* use_percpu_cache */ true);
+		nstaged = nrest;
+	}
+}
+
+void
+batch_free(void **ptrs, size_t num, size_t size, int flags) {
+	LOG("core.batch_free.entry",
+	    "ptrs: %p, num: %zu, size: %zu, flags: %d", ptrs, num, size, flags);
+
+	tsd_t *tsd = tsd_fetch();
+	check_entry_exit_locking(tsd_tsdn(tsd));
+
+	/*
+	 * The object-at-a-time path below takes care of reentrancy and of the
+	 * use-after-free stash, neither of which the flush path handles.
+	 */
+	arena_t *stats_arena = NULL;
+	if (likely(tsd_reentrancy_level_get(tsd) == 0
+	        && !san_uaf_detection_enabled())) {
+		stats_arena = arena_choose(tsd, NULL);
+	}
+
+	size_t usize = 0;
+	if (size != 0) {
+		usize = inallocx(tsd_tsdn(tsd), size, flags);
+	}
+	void   *staged[BATCH_FREE_NSTAGE_MAX];
+	szind_t szinds[BATCH_FREE_NSTAGE_MAX];
+	size_t  nstaged = 0;
+	size_t  staged_bytes = 0;
+	for (size_t i = 0; i < num; i++) {
+		void *ptr = ptrs[i];
+		if (ptr == NULL) {
+			continue;
+		}
+		emap_alloc_ctx_t alloc_ctx;
+		if (stats_arena == NULL) {
+			alloc_ctx.slab = false;
+		} else if (usize != 0 && !(config_prof && opt_prof)) {
+			/* Same reasoning as in isfree(). */
+			szind_t szind = sz_size2index(usize);
+			emap_alloc_ctx_init(
+			    &alloc_ctx, szind, (szind < SC_NBINS), usize);
+		} else {
+			/* Sampled objects are never slabs; see isfree(). */
+			emap_alloc_ctx_lookup(
+			    tsd_tsdn(tsd), &arena_emap_global, ptr, &alloc_ctx);
+		}
+		if (!alloc_ctx.slab) {
+			/* Large, sampled, or no flush path available. */
+			if (size != 0) {
+				je_sdallocx(ptr, size, flags);
+			} else {
+				je_free(ptr);
+			}
+			continue;
+		}
+
+		size_t obj_usize = emap_alloc_ctx_usize_get(&alloc_ctx);
+		if (config_fill && opt_junk_free) {
+			junk_free_callback(ptr, obj_usize);
+		}
+		staged[nstaged] = ptr;
+		szinds[nstaged] = alloc_ctx.szind;
+		nstaged++;
+		staged_bytes += obj_usize;
+		if (nstaged == BATCH_FREE_NSTAGE_MAX) {
+			batch_free_flush(tsd, stats_arena, staged, szinds,
+			    nstaged);
+			nstaged = 0;
+		}
+	}
+	if (nstaged > 0) {
+		batch_free_flush(tsd, stats_arena, staged, szinds, nstaged);
+	}
+	/* As in batch_alloc(), coalesce the thread events into one. */
+	if (staged_bytes > 0) {
+		thread_dalloc_event(tsd, staged_bytes);
+	}
+
+	check_entry_exit_locking(tsd_tsdn(tsd));
+	LOG("core.batch_free.exit", "");
+}
+
 /*
  * End non-standard functions.
  */
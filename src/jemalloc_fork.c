@@ -5,6 +5,8 @@
 #include "jemalloc/internal/ctl.h"
 #include "jemalloc/internal/jemalloc_fork.h"
 #include "jemalloc/internal/jemalloc_init.h"
+#include "jemalloc/internal/percpu_cache.h"
+#include "jemalloc/internal/purge_pool.h"
 
 /******************************************************************************/
 /*
@@ -47,6 +49,8 @@ _malloc_prefork(void)
 	if (have_background_thread) {
 		background_thread_prefork1(tsd_tsdn(tsd));
 	}
+	/* Completes handed-over purges, which take the HPA shard locks. */
+	purge_pool_prefork0(tsd_tsdn(tsd));
 	/* Break arena prefork into stages to preserve lock order. */
 	for (i = 0; i < 9; i++) {
 		for (j = 0; j < narenas; j++) {
@@ -86,6 +90,8 @@ _malloc_prefork(void)
 			}
 		}
 	}
+	percpu_cache_prefork(tsd_tsdn(tsd));
+	purge_pool_prefork1(tsd_tsdn(tsd));
 	prof_prefork1(tsd_tsdn(tsd));
 	stats_prefork(tsd_tsdn(tsd));
 }
@@ -120,6 +126,8 @@ _malloc_postfork(void)
 			arena_postfork_parent(tsd_tsdn(tsd), arena);
 		}
 	}
+	purge_pool_postfork_parent(tsd_tsdn(tsd));
+	percpu_cache_postfork_parent(tsd_tsdn(tsd));
 	prof_postfork_parent(tsd_tsdn(tsd));
 	if (have_background_thread) {
 		background_thread_postfork_parent(tsd_tsdn(tsd));
@@ -151,6 +159,8 @@ jemalloc_postfork_child(void) {
 			arena_postfork_child(tsd_tsdn(tsd), arena, desc);
 		}
 	}
+	purge_pool_postfork_child(tsd_tsdn(tsd));
+	percpu_cache_postfork_child(tsd_tsdn(tsd));
 	prof_postfork_child(tsd_tsdn(tsd));
 	if (have_background_thread) {
 		background_thread_postfork_child(tsd_tsdn(tsd));
@@ -2,6 +2,7 @@
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
 #include "jemalloc/internal/arenas_management.h"
+#include "jemalloc/internal/bin_regions.h"
 #include "jemalloc/internal/conf.h"
 #include "jemalloc/internal/ctl.h"
 #include "jemalloc/internal/emap.h"
@@ -10,7 +11,11 @@
 #include "jemalloc/internal/jemalloc_fork.h"
 #include "jemalloc/internal/jemalloc_init.h"
 #include "jemalloc/internal/malloc_io.h"
+#include "jemalloc/internal/mem_pressure.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/numa.h"
+#include "jemalloc/internal/percpu_cache.h"
+#include "jemalloc/internal/purge_pool.h"
 #include "jemalloc/internal/safety_check.h"
 #include "jemalloc/internal/san.h"
 #include "jemalloc/internal/sc.h"
@@ -197,6 +202,13 @@ malloc_init_hard_a0_locked(void) {
 	if (pages_boot()) {
 		return true;
 	}
+	if (bin_regions_boot()) {
+		return true;
+	}
+	/* Before any arena, whose first mappings it may bind. */
+	if (numa_boot()) {
+		return true;
+	}
 	if (base_boot(TSDN_NULL)) {
 		return true;
 	}
@@ -227,6 +239,7 @@ malloc_init_hard_a0_locked(void) {
 	if (arena_boot(&sc_data, b0get(), opt_hpa)) {
 		return true;
 	}
+	percpu_cache_boot0();
 	if (tcache_boot(TSDN_NULL, b0get())) {
 		return true;
 	}
@@ -648,6 +661,11 @@ malloc_init_hard(void) {
 	if (config_prof && prof_boot2(tsd, b0get())) {
 		UNLOCK_RETURN(tsd_tsdn(tsd), true, true)
 	}
+	/* Needs ncpus, and must precede the first tcache fill. */
+	if (percpu_cache_boot1(tsd_tsdn(tsd), b0get())) {
+		UNLOCK_RETURN(tsd_tsdn(tsd), true, true)
+	}
+	mem_pressure_boot();
 
 	malloc_init_percpu();
 
@@ -674,6 +692,9 @@ malloc_init_hard(void) {
 			return true;
 		}
 	}
+	if (purge_pool_boot(tsd)) {
+		return true;
+	}
 #undef UNLOCK_RETURN
 	return false;
 }
@@ -3,11 +3,17 @@
 
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/emap.h"
+#include "jemalloc/internal/extent_dss.h"
 #include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/mutex.h"
 #include "jemalloc/internal/prof_recent.h"
 #include "jemalloc/internal/util.h"
 
+/******************************************************************************/
+/* Data. */
+
+size_t opt_realloc_remap_threshold = REALLOC_REMAP_THRESHOLD_DEFAULT;
+
 /******************************************************************************/
 
 void *
@@ -66,10 +72,16 @@ large_ralloc_no_move_shrink(tsdn_t *tsdn, edata_t *edata, size_t usize) {
 		return true;
 	}
 
+	size_t new_size = usize + sz_large_pad;
+	if (edata_remapped_get(edata)) {
+		/* Remapped pages mustn't leave with the trail; see pages.c. */
+		pages_remap_trim((byte_t *)edata_base_get(edata) + new_size,
+		    old_size - new_size);
+	}
+
 	bool deferred_work_generated = false;
 	bool err = pa_shrink(tsdn, &arena->pa_shard, edata, old_size,
-	    usize + sz_large_pad, sz_size2index(usize),
-	    &deferred_work_generated);
+	    new_size, sz_size2index(usize), &deferred_work_generated);
 	if (err) {
 		return true;
 	}
@@ -182,6 +194,69 @@ large_ralloc_move_helper(
 	return large_palloc(tsdn, arena, usize, alignment, zero);
 }
 
+static bool
+large_ralloc_remap_eligible(edata_t *edata) {
+	arena_t *arena = arena_get_from_edata(edata);
+	/*
+	 * Scratch arenas drop their extents wholesale on reset, without giving
+	 * back the mappings remapping uses up.
+	 */
+	return edata_pai_get(edata) == EXTENT_PAI_PAC
+	    && ehooks_are_default(arena_get_ehooks(arena))
+	    && !arena_is_scratch(arena)
+	    && !extent_in_dss(edata_base_get(edata));
+}
+
+/*
+ * Move the first copysize bytes of edata into new_edata by remapping their
+ * pages rather than copying them.  The new allocation is shifted to the old
+ * one's offset within its first page, so that whole pages line up.  Returns
+ * true if nothing was moved, in which case the caller should copy.
+ */
+static bool
+large_ralloc_remap(edata_t *edata, edata_t *new_edata, size_t copysize,
+    size_t alignment, bool zero) {
+	if (opt_realloc_remap_threshold == 0
+	    || copysize < opt_realloc_remap_threshold
+	    || !large_ralloc_remap_eligible(edata)
+	    || !large_ralloc_remap_eligible(new_edata)) {
+		return true;
+	}
+
+	byte_t *old_base = (byte_t *)edata_base_get(edata);
+	byte_t *new_base = (byte_t *)edata_base_get(new_edata);
+	size_t  offset = (byte_t *)edata_addr_get(edata) - old_base;
+	size_t  new_offset = (byte_t *)edata_addr_get(new_edata) - new_base;
+	byte_t *new_addr = new_base + offset;
+	size_t  new_usize = edata_usize_get(new_edata);
+	/* Offsets are multiples of CACHELINE, like any smaller alignment. */
+	if ((alignment > CACHELINE
+	        && ALIGNMENT_ADDR2BASE(new_addr, alignment) != new_addr)
+	    || offset + new_usize > edata_size_get(new_edata)) {
+		return true;
+	}
+	size_t remap_size = PAGE_CEILING(offset + copysize);
+	assert(remap_size <= edata_size_get(edata));
+	assert(remap_size <= edata_size_get(new_edata));
+	if (pages_remap(old_base, new_base, remap_size)) {
+		return true;
+	}
+	edata_addr_set(new_edata, new_addr);
+	edata_remapped_set(new_edata, true);
+
+	if (zero) {
+		/* The rest of the last remapped page came from the old extent. */
+		memset(new_addr + copysize, 0,
+		    remap_size - (offset + copysize));
+		/* Bytes that were past the end of the allocation before. */
+		if (offset > new_offset) {
+			memset(new_base + new_offset + new_usize, 0,
+			    offset - new_offset);
+		}
+	}
+	return false;
+}
+
 void *
 large_ralloc(tsdn_t *tsdn, arena_t *arena, void *ptr, size_t usize,
     size_t alignment, bool zero, tcache_t *tcache) {
@@ -201,7 +276,8 @@ large_ralloc(tsdn_t *tsdn, arena_t *arena, void *ptr, size_t usize,
 	/*
 	 * usize and old size are different enough that we need to use a
 	 * different size class.  In that case, fall back to allocating new
-	 * space and copying.
+	 * space and moving the contents over, by remapping their pages when
+	 * they are large enough, or else by copying.
 	 */
 	void *ret = large_ralloc_move_helper(
 	    tsdn, arena, usize, alignment, zero);
@@ -209,8 +285,13 @@ large_ralloc(tsdn_t *tsdn, arena_t *arena, void *ptr, size_t usize,
 		return NULL;
 	}
 
-	size_t copysize = (usize < oldusize) ? usize : oldusize;
-	memcpy(ret, edata_addr_get(edata), copysize);
+	size_t   copysize = (usize < oldusize) ? usize : oldusize;
+	edata_t *new_edata = emap_edata_lookup(tsdn, &arena_emap_global, ret);
+	if (large_ralloc_remap(edata, new_edata, copysize, alignment, zero)) {
+		memcpy(ret, edata_addr_get(edata), copysize);
+	} else {
+		ret = edata_addr_get(new_edata);
+	}
 	isdalloct(tsdn, edata_addr_get(edata), oldusize, tcache, NULL, true);
 	return ret;
 }
@@ -240,6 +321,10 @@ large_dalloc_prep_impl(
 
 static void
 large_dalloc_finish_impl(tsdn_t *tsdn, arena_t *arena, edata_t *edata) {
+	if (unlikely(edata_remapped_get(edata))) {
+		pages_remap_release(edata_base_get(edata), edata_size_get(edata));
+		edata_remapped_set(edata, false);
+	}
 	bool deferred_work_generated = false;
 	pa_dalloc(tsdn, &arena->pa_shard, edata, &deferred_work_generated);
 	if (deferred_work_generated) {
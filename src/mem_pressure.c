@@ -0,0 +1,198 @@
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/malloc_io.h"
+#include "jemalloc/internal/mem_pressure.h"
+#include "jemalloc/internal/nstime.h"
+
+bool opt_pressure_purge = false;
+
+atomic_u_t mem_pressure_level = ATOMIC_INIT(mem_pressure_normal);
+
+#define MEM_PRESSURE_PSI_PATH "/proc/pressure/memory"
+#define MEM_PRESSURE_CGROUP_PATH "/proc/self/cgroup"
+#define MEM_PRESSURE_CGROUP_ROOT "/sys/fs/cgroup"
+#define MEM_PRESSURE_PATH_MAX 256
+
+/* Set at boot; empty if the process is not in a cgroup v2 hierarchy. */
+static char mem_pressure_cgroup_dir[MEM_PRESSURE_PATH_MAX];
+
+/* Only the first background thread samples, so these need no lock. */
+static bool     mem_pressure_sampled = false;
+static nstime_t mem_pressure_sample_time;
+
+/* Reads a small file into buf as a string.  Returns true on error. */
+static bool
+mem_pressure_read(const char *path, char *buf, size_t size) {
+#ifdef _WIN32
+	return true;
+#else
+	int fd;
+#	if defined(O_CLOEXEC)
+	fd = malloc_open(path, O_RDONLY | O_CLOEXEC);
+#	else
+	fd = malloc_open(path, O_RDONLY);
+#	endif
+	if (fd == -1) {
+		return true;
+	}
+	ssize_t nread = malloc_read_fd(fd, buf, size - 1);
+	malloc_close(fd);
+	if (nread <= 0) {
+		return true;
+	}
+	buf[nread] = '\0';
+	return false;
+#endif
+}
+
+/*
+ * Reads a cgroup memory file holding either a byte count or "max", which is
+ * returned as 0.  Returns true on error.
+ */
+static bool
+mem_pressure_cgroup_read(const char *name, uint64_t *bytes) {
+	char path[MEM_PRESSURE_PATH_MAX + 32];
+	char buf[32];
+	malloc_snprintf(
+	    path, sizeof(path), "%s/%s", mem_pressure_cgroup_dir, name);
+	if (mem_pressure_read(path, buf, sizeof(buf))) {
+		return true;
+	}
+	if (strncmp(buf, "max", 3) == 0) {
+		*bytes = 0;
+		return false;
+	}
+	char *end;
+	set_errno(0);
+	*bytes = (uint64_t)malloc_strtoumax(buf, &end, 10);
+	return end == buf || get_errno() != 0;
+}
+
+void
+mem_pressure_boot(void) {
+	mem_pressure_cgroup_dir[0] = '\0';
+	if (!opt_pressure_purge) {
+		return;
+	}
+	char buf[MEM_PRESSURE_PATH_MAX];
+	if (mem_pressure_read(MEM_PRESSURE_CGROUP_PATH, buf, sizeof(buf))) {
+		return;
+	}
+	/* The unified hierarchy is the one with the "0::<path>" entry. */
+	for (char *line = buf; line != NULL && *line != '\0';) {
+		char *next = strchr(line, '\n');
+		if (next != NULL) {
+			*next++ = '\0';
+		}
+		if (strncmp(line, "0::", 3) == 0) {
+			malloc_snprintf(mem_pressure_cgroup_dir,
+			    sizeof(mem_pressure_cgroup_dir), "%s%s",
+			    MEM_PRESSURE_CGROUP_ROOT, line + 3);
+			return;
+		}
+		line = next;
+	}
+}
+
+bool
+mem_pressure_psi_parse(const char *buf, uint64_t *avg10) {
+	static const char key[] = "some avg10=";
+	const char       *s = strstr(buf, key);
+	if (s == NULL) {
+		return true;
+	}
+	s += sizeof(key) - 1;
+	char *end;
+	set_errno(0);
+	uintmax_t whole = malloc_strtoumax(s, &end, 10);
+	if (end == s || get_errno() != 0) {
+		return true;
+	}
+	uint64_t hundredths = (uint64_t)whole * 100;
+	if (*end == '.') {
+		/* The kernel prints two decimals; ignore any further ones. */
+		uint64_t scale = 10;
+		for (s = end + 1; *s >= '0' && *s <= '9' && scale > 0; s++) {
+			hundredths += (uint64_t)(*s - '0') * scale;
+			scale /= 10;
+		}
+	}
+	*avg10 = hundredths;
+	return false;
+}
+
+mem_pressure_t
+mem_pressure_compute(uint64_t psi_avg10, uint64_t usage, uint64_t limit) {
+	/* Percent of the cgroup limit in use. */
+	uint64_t used = 0;
+	if (limit != 0) {
+		if (usage >= limit) {
+			used = 100;
+		} else if (usage > UINT64_MAX / 100) {
+			used = usage / (limit / 100);
+		} else {
+			used = usage * 100 / limit;
+		}
+	}
+	if (psi_avg10 >= MEM_PRESSURE_PSI_HIGH
+	    || used >= MEM_PRESSURE_CGROUP_HIGH) {
+		return mem_pressure_high;
+	}
+	if (psi_avg10 >= MEM_PRESSURE_PSI_MODERATE
+	    || used >= MEM_PRESSURE_CGROUP_MODERATE) {
+		return mem_pressure_moderate;
+	}
+	if (psi_avg10 < MEM_PRESSURE_PSI_HEADROOM
+	    && used < MEM_PRESSURE_CGROUP_HEADROOM) {
+		return mem_pressure_headroom;
+	}
+	return mem_pressure_normal;
+}
+
+void
+mem_pressure_update(void) {
+	if (!opt_pressure_purge) {
+		return;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+	if (mem_pressure_sampled
+	    && nstime_compare(&now, &mem_pressure_sample_time) >= 0) {
+		nstime_t elapsed;
+		nstime_copy(&elapsed, &now);
+		nstime_subtract(&elapsed, &mem_pressure_sample_time);
+		if (nstime_ns(&elapsed) < MEM_PRESSURE_INTERVAL_NS) {
+			return;
+		}
+	}
+	mem_pressure_sampled = true;
+	nstime_copy(&mem_pressure_sample_time, &now);
+
+	char     buf[256];
+	uint64_t psi_avg10 = 0;
+	bool     have_psi = !mem_pressure_read(
+	                        MEM_PRESSURE_PSI_PATH, buf, sizeof(buf))
+	    && !mem_pressure_psi_parse(buf, &psi_avg10);
+
+	uint64_t usage = 0;
+	uint64_t limit = 0;
+	bool     have_cgroup = false;
+	if (mem_pressure_cgroup_dir[0] != '\0'
+	    && !mem_pressure_cgroup_read("memory.current", &usage)) {
+		have_cgroup = true;
+		/* Throttling starts at memory.high; fall back to the hard limit. */
+		if (mem_pressure_cgroup_read("memory.high", &limit)
+		    || limit == 0) {
+			if (mem_pressure_cgroup_read("memory.max", &limit)) {
+				limit = 0;
+			}
+		}
+	}
+
+	mem_pressure_t level = (have_psi || have_cgroup)
+	    ? mem_pressure_compute(psi_avg10, usage, limit)
+	    : mem_pressure_normal;
+	atomic_store_u(&mem_pressure_level, (unsigned)level, ATOMIC_RELAXED);
+}
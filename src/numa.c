@@ -0,0 +1,155 @@
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/arenas_management.h"
+#include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/malloc_io.h"
+#include "jemalloc/internal/numa.h"
+
+#ifdef JEMALLOC_HAVE_MBIND
+#	include <linux/mempolicy.h>
+#	include <sys/syscall.h>
+#endif
+
+bool     opt_numa = false;
+unsigned numa_nnodes = 1;
+#ifdef JEMALLOC_HAVE_MBIND
+/* Ids of the online nodes, indexed by the node numbers used elsewhere. */
+static unsigned numa_nodes[NUMA_NODES_MAX];
+#endif
+
+static const char *
+numa_node_id_parse(const char *p, unsigned *id) {
+	if (*p < '0' || *p > '9') {
+		return NULL;
+	}
+	unsigned node = 0;
+	while (*p >= '0' && *p <= '9') {
+		node = node * 10 + (unsigned)(*p - '0');
+		if (node >= NUMA_NODES_MAX) {
+			return NULL;
+		}
+		p++;
+	}
+	*id = node;
+	return p;
+}
+
+unsigned
+numa_nodes_parse(const char *list, unsigned nodes[NUMA_NODES_MAX]) {
+	unsigned    nnodes = 0;
+	const char *p = list;
+	while (*p != '\0' && *p != '\n') {
+		unsigned first, last;
+		p = numa_node_id_parse(p, &first);
+		if (p == NULL) {
+			return 0;
+		}
+		last = first;
+		if (*p == '-') {
+			p = numa_node_id_parse(p + 1, &last);
+			if (p == NULL || last < first) {
+				return 0;
+			}
+		}
+		for (unsigned node = first; node <= last; node++) {
+			/* Ids are distinct and increasing in sysfs lists. */
+			if (nnodes > 0 && node <= nodes[nnodes - 1]) {
+				return 0;
+			}
+			nodes[nnodes++] = node;
+		}
+		if (*p == ',') {
+			p++;
+		}
+	}
+	return nnodes;
+}
+
+#ifdef JEMALLOC_HAVE_MBIND
+static unsigned
+numa_nnodes_read(void) {
+	int fd = malloc_open("/sys/devices/system/node/online", O_RDONLY);
+	if (fd == -1) {
+		return 0;
+	}
+	char    buf[128];
+	ssize_t nread = malloc_read_fd(fd, buf, sizeof(buf) - 1);
+	malloc_close(fd);
+	if (nread <= 0) {
+		return 0;
+	}
+	buf[nread] = '\0';
+	return numa_nodes_parse(buf, numa_nodes);
+}
+#endif
+
+bool
+numa_boot(void) {
+	if (!opt_numa) {
+		return false;
+	}
+#ifdef JEMALLOC_HAVE_MBIND
+	/* Per-CPU arenas already have their own arena assignment. */
+	if (!(have_percpu_arena && PERCPU_ARENA_ENABLED(opt_percpu_arena))) {
+		numa_nnodes = numa_nnodes_read();
+	} else {
+		numa_nnodes = 0;
+	}
+#else
+	numa_nnodes = 0;
+#endif
+	if (numa_nnodes < 2) {
+		/* Nothing to gain on a single node. */
+		numa_nnodes = 1;
+		opt_numa = false;
+	}
+	return false;
+}
+
+unsigned
+numa_node_get(void) {
+	assert(numa_enabled());
+#ifdef JEMALLOC_HAVE_MBIND
+	unsigned cpu, id;
+	if (syscall(SYS_getcpu, &cpu, &id, NULL) == 0) {
+		for (unsigned node = 0; node < numa_nnodes; node++) {
+			if (numa_nodes[node] == id) {
+				return node;
+			}
+		}
+	}
+#endif
+	return 0;
+}
+
+void
+numa_node_bind(unsigned node, void *addr, size_t size) {
+	assert(numa_enabled());
+	assert(node < numa_nnodes);
+#ifdef JEMALLOC_HAVE_MBIND
+	unsigned long mask[NUMA_NODES_MAX / (sizeof(unsigned long) * 8)] = {0};
+	unsigned      id = numa_nodes[node];
+	mask[id / (sizeof(unsigned long) * 8)] = 1UL
+	    << (id % (sizeof(unsigned long) * 8));
+	/*
+	 * Preferred rather than strict binding, so that a full node makes the
+	 * kernel fall back to other nodes instead of failing the allocation.
+	 * Failure only costs locality, hence is ignored.
+	 */
+	syscall(SYS_mbind, addr, size, MPOL_PREFERRED, mask,
+	    sizeof(mask) * 8 + 1, 0);
+#else
+	(void)node;
+	(void)addr;
+	(void)size;
+#endif
+}
+
+void
+numa_arena_bind(unsigned arena_ind, void *addr, size_t size) {
+	if (!numa_enabled() || arena_ind >= narenas_auto) {
+		return;
+	}
+	numa_node_bind(numa_arena_node(arena_ind), addr, size);
+}
@@ -1,8 +1,11 @@
 #include "jemalloc/internal/jemalloc_preamble.h"
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
-#include "jemalloc/internal/san.h"
+#include "jemalloc/internal/bin_regions.h"
 #include "jemalloc/internal/hpa.h"
+#include "jemalloc/internal/san.h"
+
+size_t opt_zero_pool_max = 0;
 
 static void
 pa_nactive_add(pa_shard_t *shard, size_t add_pages) {
@@ -15,6 +18,11 @@ pa_nactive_sub(pa_shard_t *shard, size_t sub_pages) {
 	atomic_fetch_sub_zu(&shard->nactive, sub_pages, ATOMIC_RELAXED);
 }
 
+static bool
+pa_shard_uses_hpa(pa_shard_t *shard) {
+	return atomic_load_b(&shard->use_hpa, ATOMIC_RELAXED);
+}
+
 bool
 pa_central_init(pa_central_t *central, base_t *base, bool hpa,
     const hpa_hooks_t *hpa_hooks) {
@@ -50,6 +58,16 @@ pa_shard_init(tsdn_t *tsdn, pa_shard_t *shard, pa_central_t *central,
 
 	shard->ever_used_hpa = false;
 	atomic_store_b(&shard->use_hpa, false, ATOMIC_RELAXED);
+	shard->scratch = false;
+	shard->scratch_reg = NULL;
+	shard->scratch_reg_used = 0;
+	shard->scratch_edata_first = NULL;
+	shard->scratch_edata_cur = NULL;
+	shard->scratch_edata_used = 0;
+	shard->huge_bins = false;
+	shard->huge_bins_reg = NULL;
+	shard->zero_pool = false;
+	shard->bin_regions = false;
 
 	atomic_store_zu(&shard->nactive, 0, ATOMIC_RELAXED);
 
@@ -86,9 +104,166 @@ pa_shard_disable_hpa(tsdn_t *tsdn, pa_shard_t *shard) {
 	}
 }
 
+bool
+pa_shard_enable_scratch(tsdn_t *tsdn, pa_shard_t *shard) {
+	assert(!pa_shard_uses_hpa(shard));
+	if (malloc_mutex_init(&shard->scratch_mtx, "pa_scratch",
+	        WITNESS_RANK_PA_SCRATCH, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	edata_list_active_init(&shard->scratch_regs_full);
+	shard->scratch = true;
+	return false;
+}
+
+bool
+pa_shard_enable_huge_bins(tsdn_t *tsdn, pa_shard_t *shard) {
+	if (malloc_mutex_init(&shard->huge_bins_mtx, "pa_huge_bins",
+	        WITNESS_RANK_PA_HUGE_BINS, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	for (unsigned i = 0; i < SC_NBINS; i++) {
+		edata_list_active_init(&shard->huge_bins_free[i]);
+		shard->huge_bins_nfree[i] = 0;
+	}
+	shard->huge_bins_dirty_bytes = 0;
+	shard->huge_bins = true;
+	return false;
+}
+
+bool
+pa_shard_enable_zero_pool(tsdn_t *tsdn, pa_shard_t *shard) {
+	if (malloc_mutex_init(&shard->zero_pool_mtx, "pa_zero_pool",
+	        WITNESS_RANK_PA_ZERO_POOL, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	for (unsigned i = 0; i < PA_ZERO_POOL_NPAGES_MAX; i++) {
+		edata_list_active_init(&shard->zero_pool_free[i]);
+		shard->zero_pool_demand[i] = 0;
+	}
+	shard->zero_pool_bytes = 0;
+	shard->zero_pool_nhits = 0;
+	shard->zero_pool_nmisses = 0;
+	shard->zero_pool = true;
+	return false;
+}
+
+bool
+pa_shard_enable_bin_regions(tsdn_t *tsdn, pa_shard_t *shard) {
+	assert(bin_regions_enabled());
+	if (malloc_mutex_init(&shard->bin_regions_mtx, "pa_bin_regions",
+	        WITNESS_RANK_PA_BIN_REGIONS, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	for (unsigned i = 0; i < SC_NBINS; i++) {
+		for (unsigned j = 0; j <= BIN_SLAB_LG_SCALE_MAX; j++) {
+			edata_list_active_init(&shard->bin_regions_free[i][j]);
+			shard->bin_regions_ndirty[i][j] = 0;
+		}
+	}
+	shard->bin_regions_bytes = 0;
+	shard->bin_regions_dirty_bytes = 0;
+	shard->bin_regions = true;
+	return false;
+}
+
+static void
+pa_huge_bins_release(tsdn_t *tsdn, pa_shard_t *shard,
+    edata_list_active_t *list) {
+	edata_t *edata;
+	while ((edata = edata_list_active_first(list)) != NULL) {
+		edata_list_active_remove(list, edata);
+		edata_huge_bin_set(edata, false);
+		bool deferred_work_generated = false;
+		pac_dalloc(tsdn, &shard->pac, edata, &deferred_work_generated);
+	}
+}
+
 void
 pa_shard_reset(tsdn_t *tsdn, pa_shard_t *shard) {
 	atomic_store_zu(&shard->nactive, 0, ATOMIC_RELAXED);
+	if (shard->huge_bins) {
+		edata_list_active_t release;
+		edata_list_active_init(&release);
+		malloc_mutex_lock(tsdn, &shard->huge_bins_mtx);
+		if (shard->huge_bins_reg != NULL) {
+			edata_list_active_append(&release,
+			    shard->huge_bins_reg);
+			shard->huge_bins_reg = NULL;
+		}
+		for (unsigned i = 0; i < SC_NBINS; i++) {
+			edata_list_active_concat(
+			    &release, &shard->huge_bins_free[i]);
+			shard->huge_bins_nfree[i] = 0;
+		}
+		shard->huge_bins_dirty_bytes = 0;
+		malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+		pa_huge_bins_release(tsdn, shard, &release);
+	}
+	if (shard->zero_pool) {
+		edata_list_active_t release;
+		edata_list_active_init(&release);
+		malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+		for (unsigned i = 0; i < PA_ZERO_POOL_NPAGES_MAX; i++) {
+			edata_list_active_concat(
+			    &release, &shard->zero_pool_free[i]);
+			shard->zero_pool_demand[i] = 0;
+		}
+		shard->zero_pool_bytes = 0;
+		malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+		edata_t *edata;
+		while ((edata = edata_list_active_first(&release)) != NULL) {
+			edata_list_active_remove(&release, edata);
+			bool deferred_work_generated = false;
+			pac_dalloc(tsdn, &shard->pac, edata,
+			    &deferred_work_generated);
+		}
+	}
+	if (shard->scratch) {
+		/*
+		 * The arena has forgotten every extent carved from the regions
+		 * by now, without necessarily dropping their emap entries.  Each
+		 * region has its whole emap range cleared and goes back as a
+		 * single extent, and the edata_t's all become free at once,
+		 * regardless of how many extents were carved.
+		 */
+		edata_list_active_t release;
+		edata_list_active_init(&release);
+		malloc_mutex_lock(tsdn, &shard->scratch_mtx);
+		edata_list_active_concat(&release, &shard->scratch_regs_full);
+		if (shard->scratch_reg != NULL) {
+			edata_list_active_append(&release, shard->scratch_reg);
+			shard->scratch_reg = NULL;
+			shard->scratch_reg_used = 0;
+		}
+		shard->scratch_edata_cur = shard->scratch_edata_first;
+		shard->scratch_edata_used = 0;
+		edata_t *reg;
+		edata_list_active_t reregistered;
+		edata_list_active_init(&reregistered);
+		while ((reg = edata_list_active_first(&release)) != NULL) {
+			edata_list_active_remove(&release, reg);
+			emap_deregister_range(tsdn, shard->emap,
+			    edata_base_get(reg), edata_size_get(reg));
+			/*
+			 * These rtree leaves were populated when the region was
+			 * first registered, so this can't fail in practice;
+			 * if it does, the region is leaked rather than handed
+			 * to the PAC unmapped.
+			 */
+			if (!emap_register_boundary(tsdn, shard->emap, reg,
+			        SC_NSIZES, /* slab */ false)) {
+				edata_list_active_append(&reregistered, reg);
+			}
+		}
+		malloc_mutex_unlock(tsdn, &shard->scratch_mtx);
+		while ((reg = edata_list_active_first(&reregistered)) != NULL) {
+			edata_list_active_remove(&reregistered, reg);
+			bool deferred_work_generated = false;
+			pac_dalloc(tsdn, &shard->pac, reg,
+			    &deferred_work_generated);
+		}
+	}
 	pa_shard_flush(tsdn, shard);
 }
 
@@ -99,19 +274,485 @@ pa_shard_flush(tsdn_t *tsdn, pa_shard_t *shard) {
 	}
 }
 
-static bool
-pa_shard_uses_hpa(pa_shard_t *shard) {
-	return atomic_load_b(&shard->use_hpa, ATOMIC_RELAXED);
+/*
+ * Hands the free bin region slabs' edata_t back before they go away with the
+ * shard's base.  The address range of the slabs can't be handed to another
+ * shard without its size class, and is abandoned after purging.
+ */
+static void
+pa_bin_regions_destroy(tsdn_t *tsdn, pa_shard_t *shard) {
+	for (unsigned i = 0; i < SC_NBINS; i++) {
+		for (unsigned j = 0; j <= BIN_SLAB_LG_SCALE_MAX; j++) {
+			edata_list_active_t *free_list =
+			    &shard->bin_regions_free[i][j];
+			edata_t *edata;
+			while ((edata = edata_list_active_first(free_list))
+			    != NULL) {
+				edata_list_active_remove(free_list, edata);
+				pages_purge_forced(edata_base_get(edata),
+				    edata_size_get(edata));
+				edata_cache_put(
+				    tsdn, &shard->edata_cache, edata);
+			}
+			shard->bin_regions_ndirty[i][j] = 0;
+		}
+	}
+	shard->bin_regions_bytes = 0;
+	shard->bin_regions_dirty_bytes = 0;
 }
 
 void
 pa_shard_destroy(tsdn_t *tsdn, pa_shard_t *shard) {
+	if (shard->bin_regions) {
+		pa_bin_regions_destroy(tsdn, shard);
+	}
 	pac_destroy(tsdn, &shard->pac);
 	if (shard->ever_used_hpa) {
 		hpa_shard_destroy(tsdn, &shard->hpa);
 	}
 }
 
+struct pa_scratch_edata_block_s {
+	edata_t                   edata[PA_SCRATCH_EDATA_NBLOCK];
+	pa_scratch_edata_block_t *next;
+};
+
+/*
+ * Takes an edata_t from the scratch edata_t blocks, adding a block if they are
+ * all used up.  Returns NULL on OOM.
+ */
+static edata_t *
+pa_scratch_edata_get(tsdn_t *tsdn, pa_shard_t *shard) {
+	malloc_mutex_assert_owner(tsdn, &shard->scratch_mtx);
+	pa_scratch_edata_block_t *block = shard->scratch_edata_cur;
+	if (block == NULL || shard->scratch_edata_used
+	        == PA_SCRATCH_EDATA_NBLOCK) {
+		pa_scratch_edata_block_t *next = (block == NULL)
+		    ? shard->scratch_edata_first
+		    : block->next;
+		if (next == NULL) {
+			next = (pa_scratch_edata_block_t *)base_alloc(tsdn,
+			    shard->base, sizeof(pa_scratch_edata_block_t),
+			    EDATA_ALIGNMENT);
+			if (next == NULL) {
+				return NULL;
+			}
+			next->next = NULL;
+			if (block == NULL) {
+				shard->scratch_edata_first = next;
+			} else {
+				block->next = next;
+			}
+		}
+		shard->scratch_edata_cur = next;
+		shard->scratch_edata_used = 0;
+		block = next;
+	}
+	return &block->edata[shard->scratch_edata_used++];
+}
+
+/*
+ * Finds room for size bytes at the given alignment in the current scratch
+ * region.  Returns false if there is none.
+ */
+static bool
+pa_scratch_fit(pa_shard_t *shard, size_t size, size_t alignment,
+    uintptr_t *addr) {
+	edata_t *reg = shard->scratch_reg;
+	if (reg == NULL) {
+		return false;
+	}
+	uintptr_t base = (uintptr_t)edata_base_get(reg);
+	uintptr_t cur = ALIGNMENT_CEILING(
+	    base + shard->scratch_reg_used, alignment);
+	if (cur - base + size > edata_size_get(reg)) {
+		return false;
+	}
+	*addr = cur;
+	return true;
+}
+
+/*
+ * Cuts size bytes off the front of the scratch region, starting a new region
+ * when it runs short.  Returns NULL if the PAC can't supply a new region.
+ */
+static edata_t *
+pa_scratch_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size,
+    size_t alignment, bool zero, bool *deferred_work_generated) {
+	pac_t   *pac = &shard->pac;
+	edata_t *to_dalloc = NULL;
+
+	malloc_mutex_lock(tsdn, &shard->scratch_mtx);
+	edata_t *edata = pa_scratch_edata_get(tsdn, shard);
+	if (edata == NULL) {
+		malloc_mutex_unlock(tsdn, &shard->scratch_mtx);
+		return NULL;
+	}
+	uintptr_t addr;
+	if (!pa_scratch_fit(shard, size, alignment, &addr)) {
+		/* The PAC takes core locks of its own; grow unlocked. */
+		malloc_mutex_unlock(tsdn, &shard->scratch_mtx);
+		size_t reg_size = size > PA_SCRATCH_REG_SIZE
+		    ? size
+		    : PA_SCRATCH_REG_SIZE;
+		edata_t *reg = pac_alloc(tsdn, pac, reg_size, alignment,
+		    /* zero */ false, /* guarded */ false,
+		    /* frequent_reuse */ false, deferred_work_generated);
+		if (reg == NULL) {
+			/* The edata_t stays unused until reset. */
+			return NULL;
+		}
+		malloc_mutex_lock(tsdn, &shard->scratch_mtx);
+		/* Someone else may have installed a region in the meantime. */
+		if (pa_scratch_fit(shard, size, alignment, &addr)) {
+			to_dalloc = reg;
+		} else {
+			emap_deregister_boundary(tsdn, shard->emap, reg);
+			if (shard->scratch_reg != NULL) {
+				edata_list_active_append(
+				    &shard->scratch_regs_full, shard->scratch_reg);
+			}
+			shard->scratch_reg = reg;
+			shard->scratch_reg_used = 0;
+			bool fit = pa_scratch_fit(shard, size, alignment, &addr);
+			assert(fit);
+			(void)fit;
+		}
+	}
+	edata_t *reg = shard->scratch_reg;
+	shard->scratch_reg_used = addr + size - (uintptr_t)edata_base_get(reg);
+	/* Nothing is ever carved twice from a region, so zeroed still holds. */
+	edata_init(edata, shard->ind, (void *)addr, size, /* slab */ false,
+	    SC_NSIZES, edata_sn_get(reg), extent_state_active,
+	    edata_zeroed_get(reg), edata_committed_get(reg), EXTENT_PAI_PAC,
+	    EXTENT_NOT_HEAD);
+	malloc_mutex_unlock(tsdn, &shard->scratch_mtx);
+
+	if (to_dalloc != NULL) {
+		pac_dalloc(tsdn, pac, to_dalloc, deferred_work_generated);
+	}
+	if (emap_register_boundary(tsdn, shard->emap, edata, SC_NSIZES,
+	        /* slab */ false)) {
+		/* The pages and the edata_t stay with the shard until reset. */
+		return NULL;
+	}
+	if (zero && !edata_zeroed_get(edata)) {
+		ehooks_zero(tsdn, pac_ehooks_get(pac), edata_base_get(edata),
+		    size);
+	}
+	return edata;
+}
+
+/*
+ * Drops an extent carved from a scratch region.  Its memory and edata_t stay
+ * with the shard until it is reset.
+ */
+static void
+pa_scratch_dalloc(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata) {
+	malloc_mutex_lock(tsdn, &shard->scratch_mtx);
+	emap_deregister_boundary(tsdn, shard->emap, edata);
+	malloc_mutex_unlock(tsdn, &shard->scratch_mtx);
+}
+
+/*
+ * Takes a slab of size class szind off the shard's hugepage-backed regions,
+ * preferring one freed earlier.  Returns NULL on failure, in which case the
+ * caller falls back to the regular allocators.
+ */
+static edata_t *
+pa_huge_bins_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size,
+    szind_t szind, bool zero, bool *deferred_work_generated) {
+	pac_t    *pac = &shard->pac;
+	ehooks_t *ehooks = pac_ehooks_get(pac);
+	edata_t  *edata = NULL;
+
+	if (size > HUGEPAGE) {
+		return NULL;
+	}
+	malloc_mutex_lock(tsdn, &shard->huge_bins_mtx);
+	edata = edata_list_active_first(&shard->huge_bins_free[szind]);
+	if (edata != NULL) {
+		edata_list_active_remove(&shard->huge_bins_free[szind], edata);
+		assert(shard->huge_bins_nfree[szind] > 0);
+		shard->huge_bins_nfree[szind]--;
+		assert(shard->huge_bins_dirty_bytes >= size);
+		shard->huge_bins_dirty_bytes -= size;
+		malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+		assert(edata_size_get(edata) == size);
+		if (zero) {
+			ehooks_zero(tsdn, ehooks, edata_base_get(edata), size);
+		}
+		return edata;
+	}
+	edata_t *to_dalloc = NULL;
+	if (shard->huge_bins_reg == NULL
+	    || edata_size_get(shard->huge_bins_reg) < size) {
+		/* The PAC takes core locks of its own; grow unlocked. */
+		malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+		edata_t *reg = pac_alloc(tsdn, pac, HUGEPAGE, HUGEPAGE,
+		    /* zero */ false, /* guarded */ false,
+		    /* frequent_reuse */ false, deferred_work_generated);
+		if (reg == NULL) {
+			return NULL;
+		}
+		/* Custom hooks may not hand out madvise()-able memory. */
+		if (ehooks_are_default(ehooks)) {
+			pages_huge(edata_base_get(reg), HUGEPAGE);
+		}
+		malloc_mutex_lock(tsdn, &shard->huge_bins_mtx);
+		/* The tail of the old region would never be carved again. */
+		to_dalloc = shard->huge_bins_reg;
+		shard->huge_bins_reg = reg;
+	}
+	edata_t *reg = shard->huge_bins_reg;
+	if (edata_size_get(reg) == size) {
+		edata = reg;
+		shard->huge_bins_reg = NULL;
+	} else {
+		edata_t *trail = extent_split_wrapper(tsdn, pac, ehooks, reg,
+		    size, edata_size_get(reg) - size,
+		    /* holding_core_locks */ true);
+		if (trail != NULL) {
+			edata = reg;
+			shard->huge_bins_reg = trail;
+		}
+	}
+	malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+
+	if (to_dalloc != NULL) {
+		pac_dalloc(tsdn, pac, to_dalloc, deferred_work_generated);
+	}
+	if (edata != NULL) {
+		edata_huge_bin_set(edata, true);
+		if (zero && !edata_zeroed_get(edata)) {
+			ehooks_zero(tsdn, ehooks, edata_base_get(edata), size);
+		}
+	}
+	return edata;
+}
+
+/*
+ * Keeps a freed slab for the next one of its size class, or hands it to the
+ * PAC, to be purged by decay, once enough are kept.
+ */
+static void
+pa_huge_bins_dalloc(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata,
+    szind_t szind, bool *deferred_work_generated) {
+	assert(shard->huge_bins);
+	assert(szind < SC_NBINS);
+	malloc_mutex_lock(tsdn, &shard->huge_bins_mtx);
+	if (shard->huge_bins_nfree[szind] < PA_HUGE_BINS_NFREE_MAX) {
+		edata_zeroed_set(edata, false);
+		edata_list_active_prepend(&shard->huge_bins_free[szind], edata);
+		shard->huge_bins_nfree[szind]++;
+		shard->huge_bins_dirty_bytes += edata_size_get(edata);
+		malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+		return;
+	}
+	malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+	edata_huge_bin_set(edata, false);
+	pac_dalloc(tsdn, &shard->pac, edata, deferred_work_generated);
+}
+
+/* Returns the lg scale of a size bytes slab of szind, i.e. its free list. */
+static unsigned
+pa_bin_regions_scale(szind_t szind, size_t size) {
+	size_t   slab_size = bin_infos[szind].slab_size;
+	unsigned scale = lg_floor(size / slab_size);
+	assert(scale <= BIN_SLAB_LG_SCALE_MAX);
+	assert(slab_size << scale == size);
+	return scale;
+}
+
+/*
+ * Free slabs leave the emap, so that lookups on stale pointers into them find
+ * nothing, as with extents freed to the PAC.
+ */
+static void
+pa_bin_regions_dalloc(
+    tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, szind_t szind) {
+	assert(shard->bin_regions);
+	assert(szind < SC_NBINS);
+	size_t               size = edata_size_get(edata);
+	unsigned             scale = pa_bin_regions_scale(szind, size);
+	edata_list_active_t *free_list = &shard->bin_regions_free[szind][scale];
+	unsigned            *ndirty = &shard->bin_regions_ndirty[szind][scale];
+
+	malloc_mutex_lock(tsdn, &shard->bin_regions_mtx);
+	emap_deregister_boundary(tsdn, shard->emap, edata);
+	if (*ndirty < PA_BIN_REGIONS_NDIRTY_MAX) {
+		edata_zeroed_set(edata, false);
+		edata_list_active_prepend(free_list, edata);
+		(*ndirty)++;
+		shard->bin_regions_dirty_bytes += size;
+		malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+		return;
+	}
+	malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+
+	bool zeroed = !pages_purge_forced(edata_base_get(edata), size)
+	    && pages_purge_forced_zeroes();
+	edata_zeroed_set(edata, zeroed);
+	malloc_mutex_lock(tsdn, &shard->bin_regions_mtx);
+	edata_list_active_append(free_list, edata);
+	malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+}
+
+/*
+ * Takes a size bytes slab of size class szind out of the shard's bin region
+ * slabs, preferring the most recently freed one, or carves a new one from the
+ * region of szind.  Returns NULL once the region is used up, in which case the
+ * caller falls back to the regular allocators.
+ */
+static edata_t *
+pa_bin_regions_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size,
+    szind_t szind, bool zero) {
+	unsigned             scale = pa_bin_regions_scale(szind, size);
+	edata_list_active_t *free_list = &shard->bin_regions_free[szind][scale];
+	unsigned            *ndirty = &shard->bin_regions_ndirty[szind][scale];
+
+	malloc_mutex_lock(tsdn, &shard->bin_regions_mtx);
+	edata_t *edata = edata_list_active_first(free_list);
+	if (edata != NULL) {
+		assert(edata_size_get(edata) == size);
+		edata_list_active_remove(free_list, edata);
+		if (*ndirty > 0) {
+			(*ndirty)--;
+			assert(shard->bin_regions_dirty_bytes >= size);
+			shard->bin_regions_dirty_bytes -= size;
+		}
+		malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+		if (emap_register_boundary(
+		        tsdn, shard->emap, edata, SC_NSIZES, /* slab */ false)) {
+			edata_zeroed_set(edata, false);
+			malloc_mutex_lock(tsdn, &shard->bin_regions_mtx);
+			edata_list_active_append(free_list, edata);
+			malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+			return NULL;
+		}
+		if (zero && !edata_zeroed_get(edata)) {
+			memset(edata_base_get(edata), 0, size);
+		}
+		return edata;
+	}
+	malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+
+	edata = edata_cache_get(tsdn, &shard->edata_cache);
+	if (edata == NULL) {
+		return NULL;
+	}
+	bool  zeroed;
+	void *addr = bin_regions_slab_alloc(szind, size, &zeroed);
+	if (addr == NULL) {
+		edata_cache_put(tsdn, &shard->edata_cache, edata);
+		return NULL;
+	}
+	edata_init(edata, shard->ind, addr, size, /* slab */ false, SC_NSIZES,
+	    extent_sn_next(&shard->pac), extent_state_active, zeroed,
+	    /* committed */ true, EXTENT_PAI_PAC, EXTENT_NOT_HEAD);
+	if (emap_register_boundary(
+	        tsdn, shard->emap, edata, SC_NSIZES, /* slab */ false)) {
+		/* As with a failed commit, the address range is lost. */
+		edata_cache_put(tsdn, &shard->edata_cache, edata);
+		return NULL;
+	}
+	malloc_mutex_lock(tsdn, &shard->bin_regions_mtx);
+	shard->bin_regions_bytes += size;
+	malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+	return edata;
+}
+
+/*
+ * Takes a pre-zeroed extent of the given size out of the zero pool.  On a
+ * miss, records the demand for the next fill and returns NULL, in which case
+ * the caller falls back to the regular allocators.
+ */
+static edata_t *
+pa_zero_pool_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size,
+    bool *deferred_work_generated) {
+	size_t i = (size >> LG_PAGE) - 1;
+	if (i >= PA_ZERO_POOL_NPAGES_MAX) {
+		return NULL;
+	}
+	malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+	edata_t *edata = edata_list_active_first(&shard->zero_pool_free[i]);
+	if (edata != NULL) {
+		edata_list_active_remove(&shard->zero_pool_free[i], edata);
+		assert(shard->zero_pool_bytes >= size);
+		shard->zero_pool_bytes -= size;
+		shard->zero_pool_nhits++;
+	} else {
+		if (shard->zero_pool_demand[i] < UINT32_MAX) {
+			shard->zero_pool_demand[i]++;
+		}
+		shard->zero_pool_nmisses++;
+		/* Let the background thread know there is a pool to fill. */
+		*deferred_work_generated = true;
+	}
+	malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+	assert(edata == NULL
+	    || (edata_size_get(edata) == size && edata_zeroed_get(edata)));
+	return edata;
+}
+
+void
+pa_shard_zero_pool_fill(tsdn_t *tsdn, pa_shard_t *shard) {
+	if (!shard->zero_pool) {
+		return;
+	}
+	for (unsigned i = 0; i < PA_ZERO_POOL_NPAGES_MAX; i++) {
+		size_t size = (size_t)(i + 1) << LG_PAGE;
+		malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+		uint32_t nfill = shard->zero_pool_demand[i];
+		if (nfill > PA_ZERO_POOL_FILL_MAX) {
+			nfill = PA_ZERO_POOL_FILL_MAX;
+		}
+		shard->zero_pool_demand[i] = 0;
+		malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+
+		for (uint32_t n = 0; n < nfill; n++) {
+			malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+			bool full = shard->zero_pool_bytes + size
+			    > opt_zero_pool_max;
+			malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+			if (full) {
+				return;
+			}
+			/* Recently freed dirty extents are the likely source. */
+			bool     deferred_work_generated = false;
+			edata_t *edata = pac_alloc(tsdn, &shard->pac, size, PAGE,
+			    /* zero */ false, /* guarded */ false,
+			    /* frequent_reuse */ false, &deferred_work_generated);
+			if (edata == NULL) {
+				return;
+			}
+			/*
+			 * Write every page, even ones known to be zero, so
+			 * that the page faults are taken here as well.
+			 */
+			memset(edata_base_get(edata), 0, size);
+			edata_zeroed_set(edata, true);
+			malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+			edata_list_active_append(
+			    &shard->zero_pool_free[i], edata);
+			shard->zero_pool_bytes += size;
+			malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+		}
+	}
+}
+
+static bool
+pa_zero_pool_demand_pending(tsdn_t *tsdn, pa_shard_t *shard) {
+	bool pending = false;
+	malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+	for (unsigned i = 0; i < PA_ZERO_POOL_NPAGES_MAX && !pending; i++) {
+		pending = (shard->zero_pool_demand[i] != 0);
+	}
+	pending = pending && shard->zero_pool_bytes < opt_zero_pool_max;
+	malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+	return pending;
+}
+
 edata_t *
 pa_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size, size_t alignment,
     bool slab, szind_t szind, bool zero, bool guarded,
@@ -121,17 +762,40 @@ pa_alloc(tsdn_t *tsdn, pa_shard_t *shard, size_t size, size_t alignment,
 	assert(!guarded || alignment <= PAGE);
 
 	edata_t *edata = NULL;
-	if (!guarded && pa_shard_uses_hpa(shard)) {
-		edata = hpa_alloc(tsdn, &shard->hpa, size, alignment,
-		    zero, /* guarded */ false, slab, deferred_work_generated);
+	/* Custom extent hooks expect to supply all of the arena's memory. */
+	if (slab && shard->bin_regions && !guarded
+	    && ehooks_are_default(pac_ehooks_get(&shard->pac))) {
+		edata = pa_bin_regions_alloc(tsdn, shard, size, szind, zero);
 	}
-	/*
-	 * Fall back to the PAC if the HPA is off or couldn't serve the given
-	 * allocation request.
-	 */
-	if (edata == NULL) {
-		edata = pac_alloc(tsdn, &shard->pac, size, alignment, zero,
-		    guarded, slab, deferred_work_generated);
+	if (edata == NULL && slab && shard->huge_bins && !guarded
+	    && bin_infos[szind].huge) {
+		edata = pa_huge_bins_alloc(tsdn, shard, size, szind, zero,
+		    deferred_work_generated);
+	}
+	if (zero && !slab && shard->zero_pool && !guarded
+	    && alignment <= PAGE) {
+		edata = pa_zero_pool_alloc(
+		    tsdn, shard, size, deferred_work_generated);
+	}
+	if (shard->scratch) {
+		/* Scratch shards own all their extents, and guard none. */
+		assert(!guarded);
+		edata = pa_scratch_alloc(tsdn, shard, size, alignment, zero,
+		    deferred_work_generated);
+	} else {
+		if (edata == NULL && !guarded && pa_shard_uses_hpa(shard)) {
+			edata = hpa_alloc(tsdn, &shard->hpa, size, alignment,
+			    zero, /* guarded */ false, slab,
+			    deferred_work_generated);
+		}
+		/*
+		 * Fall back to the PAC if the HPA is off or couldn't serve the
+		 * given allocation request.
+		 */
+		if (edata == NULL) {
+			edata = pac_alloc(tsdn, &shard->pac, size, alignment,
+			    zero, guarded, slab, deferred_work_generated);
+		}
 	}
 	if (edata != NULL) {
 		assert(edata_size_get(edata) == size);
@@ -153,7 +817,8 @@ pa_expand(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
 	assert(new_size > old_size);
 	assert(edata_size_get(edata) == old_size);
 	assert((new_size & PAGE_MASK) == 0);
-	if (edata_guarded_get(edata)) {
+	/* Scratch extents are bump-allocated and can't resize in place. */
+	if (edata_guarded_get(edata) || shard->scratch) {
 		return true;
 	}
 	size_t expand_amount = new_size - old_size;
@@ -183,7 +848,8 @@ pa_shrink(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
 	assert(new_size < old_size);
 	assert(edata_size_get(edata) == old_size);
 	assert((new_size & PAGE_MASK) == 0);
-	if (edata_guarded_get(edata)) {
+	/* Scratch extents are bump-allocated and can't resize in place. */
+	if (edata_guarded_get(edata) || shard->scratch) {
 		return true;
 	}
 	size_t shrink_amount = old_size - new_size;
@@ -210,6 +876,7 @@ pa_shrink(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata, size_t old_size,
 void
 pa_dalloc(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata,
     bool *deferred_work_generated) {
+	szind_t szind = edata_szind_get(edata);
 	emap_remap(tsdn, shard->emap, edata, SC_NSIZES, /* slab */ false);
 	if (edata_slab_get(edata)) {
 		emap_deregister_interior(tsdn, shard->emap, edata);
@@ -221,7 +888,14 @@ pa_dalloc(tsdn_t *tsdn, pa_shard_t *shard, edata_t *edata,
 	edata_addr_set(edata, edata_base_get(edata));
 	edata_szind_set(edata, SC_NSIZES);
 	pa_nactive_sub(shard, edata_size_get(edata) >> LG_PAGE);
-	if (edata_pai_get(edata) == EXTENT_PAI_HPA) {
+	if (bin_regions_lookup(edata_base_get(edata), &szind)) {
+		pa_bin_regions_dalloc(tsdn, shard, edata, szind);
+	} else if (shard->scratch) {
+		pa_scratch_dalloc(tsdn, shard, edata);
+	} else if (edata_huge_bin_get(edata)) {
+		pa_huge_bins_dalloc(
+		    tsdn, shard, edata, szind, deferred_work_generated);
+	} else if (edata_pai_get(edata) == EXTENT_PAI_HPA) {
 		hpa_dalloc(tsdn, &shard->hpa, edata, deferred_work_generated);
 	} else {
 		pac_dalloc(tsdn, &shard->pac, edata, deferred_work_generated);
@@ -253,6 +927,8 @@ pa_shard_do_deferred_work(tsdn_t *tsdn, pa_shard_t *shard) {
 	if (pa_shard_uses_hpa(shard)) {
 		hpa_shard_do_deferred_work(tsdn, &shard->hpa);
 	}
+	pac_cold_demote(tsdn, &shard->pac);
+	pa_shard_zero_pool_fill(tsdn, shard);
 }
 
 /*
@@ -266,6 +942,9 @@ pa_shard_time_until_deferred_work(tsdn_t *tsdn, pa_shard_t *shard) {
 	if (time == BACKGROUND_THREAD_DEFERRED_MIN) {
 		return time;
 	}
+	if (shard->zero_pool && pa_zero_pool_demand_pending(tsdn, shard)) {
+		return BACKGROUND_THREAD_DEFERRED_MIN;
+	}
 
 	if (pa_shard_uses_hpa(shard)) {
 		uint64_t hpa = hpa_time_until_deferred_work(
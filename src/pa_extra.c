@@ -24,6 +24,18 @@ pa_shard_prefork2(tsdn_t *tsdn, pa_shard_t *shard) {
 void
 pa_shard_prefork3(tsdn_t *tsdn, pa_shard_t *shard) {
 	malloc_mutex_prefork(tsdn, &shard->pac.grow_mtx);
+	if (shard->scratch) {
+		malloc_mutex_prefork(tsdn, &shard->scratch_mtx);
+	}
+	if (shard->huge_bins) {
+		malloc_mutex_prefork(tsdn, &shard->huge_bins_mtx);
+	}
+	if (shard->zero_pool) {
+		malloc_mutex_prefork(tsdn, &shard->zero_pool_mtx);
+	}
+	if (shard->bin_regions) {
+		malloc_mutex_prefork(tsdn, &shard->bin_regions_mtx);
+	}
 	if (shard->ever_used_hpa) {
 		hpa_shard_prefork3(tsdn, &shard->hpa);
 	}
@@ -53,6 +65,18 @@ pa_shard_postfork_parent(tsdn_t *tsdn, pa_shard_t *shard) {
 	ecache_postfork_parent(tsdn, &shard->pac.ecache_retained);
 	ecache_postfork_parent(tsdn, &shard->pac.ecache_pinned);
 	malloc_mutex_postfork_parent(tsdn, &shard->pac.grow_mtx);
+	if (shard->scratch) {
+		malloc_mutex_postfork_parent(tsdn, &shard->scratch_mtx);
+	}
+	if (shard->huge_bins) {
+		malloc_mutex_postfork_parent(tsdn, &shard->huge_bins_mtx);
+	}
+	if (shard->zero_pool) {
+		malloc_mutex_postfork_parent(tsdn, &shard->zero_pool_mtx);
+	}
+	if (shard->bin_regions) {
+		malloc_mutex_postfork_parent(tsdn, &shard->bin_regions_mtx);
+	}
 	malloc_mutex_postfork_parent(tsdn, &shard->pac.decay_dirty.mtx);
 	malloc_mutex_postfork_parent(tsdn, &shard->pac.decay_muzzy.mtx);
 	if (shard->ever_used_hpa) {
@@ -68,6 +92,18 @@ pa_shard_postfork_child(tsdn_t *tsdn, pa_shard_t *shard) {
 	ecache_postfork_child(tsdn, &shard->pac.ecache_retained);
 	ecache_postfork_child(tsdn, &shard->pac.ecache_pinned);
 	malloc_mutex_postfork_child(tsdn, &shard->pac.grow_mtx);
+	if (shard->scratch) {
+		malloc_mutex_postfork_child(tsdn, &shard->scratch_mtx);
+	}
+	if (shard->huge_bins) {
+		malloc_mutex_postfork_child(tsdn, &shard->huge_bins_mtx);
+	}
+	if (shard->zero_pool) {
+		malloc_mutex_postfork_child(tsdn, &shard->zero_pool_mtx);
+	}
+	if (shard->bin_regions) {
+		malloc_mutex_postfork_child(tsdn, &shard->bin_regions_mtx);
+	}
 	malloc_mutex_postfork_child(tsdn, &shard->pac.decay_dirty.mtx);
 	malloc_mutex_postfork_child(tsdn, &shard->pac.decay_muzzy.mtx);
 	if (shard->ever_used_hpa) {
@@ -114,12 +150,40 @@ pa_shard_stats_merge(tsdn_t *tsdn, pa_shard_t *shard,
 	    ecache_npages_get(&shard->pac.ecache_pinned) << LG_PAGE;
 	pa_shard_stats_out->edata_avail += atomic_load_zu(
 	    &shard->edata_cache.count, ATOMIC_RELAXED);
+	if (shard->zero_pool) {
+		malloc_mutex_lock(tsdn, &shard->zero_pool_mtx);
+		pa_shard_stats_out->zero_pool_bytes += shard->zero_pool_bytes;
+		pa_shard_stats_out->zero_pool_nhits += shard->zero_pool_nhits;
+		pa_shard_stats_out->zero_pool_nmisses +=
+		    shard->zero_pool_nmisses;
+		malloc_mutex_unlock(tsdn, &shard->zero_pool_mtx);
+	}
+	size_t bin_regions_dirty_bytes = 0;
+	if (shard->bin_regions) {
+		malloc_mutex_lock(tsdn, &shard->bin_regions_mtx);
+		pa_shard_stats_out->bin_regions_bytes +=
+		    shard->bin_regions_bytes;
+		bin_regions_dirty_bytes = shard->bin_regions_dirty_bytes;
+		pa_shard_stats_out->bin_regions_dirty_bytes +=
+		    bin_regions_dirty_bytes;
+		malloc_mutex_unlock(tsdn, &shard->bin_regions_mtx);
+	}
+
+	size_t huge_bins_dirty_bytes = 0;
+	if (shard->huge_bins) {
+		malloc_mutex_lock(tsdn, &shard->huge_bins_mtx);
+		huge_bins_dirty_bytes = shard->huge_bins_dirty_bytes;
+		pa_shard_stats_out->huge_bins_dirty_bytes +=
+		    huge_bins_dirty_bytes;
+		malloc_mutex_unlock(tsdn, &shard->huge_bins_mtx);
+	}
 
 	size_t resident_pgs = 0;
 	resident_pgs += pa_shard_nactive(shard);
 	resident_pgs += pa_shard_ndirty(shard);
 	resident_pgs += ecache_npages_get(&shard->pac.ecache_pinned);
-	*resident += (resident_pgs << LG_PAGE);
+	*resident += (resident_pgs << LG_PAGE) + bin_regions_dirty_bytes
+	    + huge_bins_dirty_bytes;
 
 	/* Dirty decay stats */
 	locked_inc_u64_unsynchronized(
@@ -151,6 +215,8 @@ pa_shard_stats_merge(tsdn_t *tsdn, pa_shard_t *shard,
 
 	atomic_load_add_store_zu(&pa_shard_stats_out->pac_stats.abandoned_vm,
 	    atomic_load_zu(&shard->pac.stats->abandoned_vm, ATOMIC_RELAXED));
+	atomic_load_add_store_zu(&pa_shard_stats_out->pac_stats.cold_demoted,
+	    atomic_load_zu(&shard->pac.stats->cold_demoted, ATOMIC_RELAXED));
 
 	for (pszind_t i = 0; i < SC_NPSIZES; i++) {
 		size_t dirty, muzzy, retained, pinned, dirty_bytes,
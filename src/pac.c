@@ -1,6 +1,7 @@
 #include "jemalloc/internal/jemalloc_preamble.h"
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
+#include "jemalloc/internal/mem_pressure.h"
 #include "jemalloc/internal/pac.h"
 #include "jemalloc/internal/san.h"
 
@@ -91,10 +92,25 @@ pac_init(tsdn_t *tsdn, pac_t *pac, base_t *base, emap_t *emap,
 	pac->stats = pac_stats;
 	pac->stats_mtx = stats_mtx;
 	atomic_store_zu(&pac->extent_sn_next, 0, ATOMIC_RELAXED);
+	atomic_store_zu(&pac->nalloc_pages, 0, ATOMIC_RELAXED);
+	pac->cold_scanned = false;
+	atomic_store_b(&pac->cold_sweeping, false, ATOMIC_RELAXED);
 
 	return false;
 }
 
+ssize_t opt_cold_age_ms = -1;
+bool    opt_cold_pageout = false;
+
+/* Counts allocated pages, which drive the predictive decay forecast. */
+static inline void
+pac_nalloc_add(pac_t *pac, size_t size) {
+	if (opt_dirty_decay_predictive) {
+		atomic_fetch_add_zu(
+		    &pac->nalloc_pages, size >> LG_PAGE, ATOMIC_RELAXED);
+	}
+}
+
 static inline bool
 pac_may_have_muzzy(pac_t *pac) {
 	return pac_decay_ms_get(pac, extent_state_muzzy) != 0;
@@ -270,6 +286,9 @@ pac_alloc(tsdn_t *tsdn, pac_t *pac, size_t size, size_t alignment,
 		edata = pac_alloc_new_guarded(
 		    tsdn, pac, ehooks, size, alignment, zero, frequent_reuse);
 	}
+	if (edata != NULL) {
+		pac_nalloc_add(pac, size);
+	}
 
 	return edata;
 }
@@ -340,6 +359,7 @@ pac_expand(tsdn_t *tsdn, pac_t *pac, edata_t *edata, size_t old_size,
 		atomic_fetch_add_zu(
 		    &pac->stats->pac_mapped, mapped_add, ATOMIC_RELAXED);
 	}
+	pac_nalloc_add(pac, expand_amount);
 	return false;
 }
 
@@ -404,14 +424,28 @@ pac_dalloc(tsdn_t *tsdn, pac_t *pac, edata_t *edata,
 	}
 }
 
+static inline bool
+pac_decay_predictive(pac_t *pac, decay_t *decay) {
+	return opt_dirty_decay_predictive && decay == &pac->decay_dirty;
+}
+
 static inline uint64_t
-pac_ns_until_purge(tsdn_t *tsdn, decay_t *decay, size_t npages) {
+pac_ns_until_purge(tsdn_t *tsdn, pac_t *pac, decay_t *decay, size_t npages) {
 	if (malloc_mutex_trylock(tsdn, &decay->mtx)) {
 		/* Use minimal interval if decay is contended. */
 		return BACKGROUND_THREAD_DEFERRED_MIN;
 	}
 	uint64_t result = decay_ns_until_purge(
 	    decay, npages, ARENA_DEFERRED_PURGE_NPAGES_THRESHOLD);
+	/*
+	 * Pages beyond the forecast are purged at the next epoch, whatever the
+	 * backlog says.
+	 */
+	if (pac_decay_predictive(pac, decay) && decay_gradually(decay)
+	    && npages > decay_forecast_limit_get(decay)
+	    && decay_epoch_duration_ns(decay) < result) {
+		result = decay_epoch_duration_ns(decay);
+	}
 
 	malloc_mutex_unlock(tsdn, &decay->mtx);
 	return result;
@@ -421,20 +455,101 @@ uint64_t
 pac_time_until_deferred_work(tsdn_t *tsdn, pac_t *pac) {
 	uint64_t time;
 
-	time = pac_ns_until_purge(
-	    tsdn, &pac->decay_dirty, ecache_npages_get(&pac->ecache_dirty));
+	time = pac_ns_until_purge(tsdn, pac, &pac->decay_dirty,
+	    ecache_npages_get(&pac->ecache_dirty));
 	if (time == BACKGROUND_THREAD_DEFERRED_MIN) {
 		return time;
 	}
 
-	uint64_t muzzy = pac_ns_until_purge(
-	    tsdn, &pac->decay_muzzy, ecache_npages_get(&pac->ecache_muzzy));
+	uint64_t muzzy = pac_ns_until_purge(tsdn, pac, &pac->decay_muzzy,
+	    ecache_npages_get(&pac->ecache_muzzy));
 	if (muzzy < time) {
 		time = muzzy;
 	}
+
+	/* Come back for the next cold demotion scan. */
+	if (opt_cold_age_ms >= 0
+	    && ecache_npages_get(&pac->ecache_dirty) > 0) {
+		uint64_t cold = atomic_load_b(&pac->cold_sweeping,
+		                    ATOMIC_RELAXED)
+		    ? BACKGROUND_THREAD_DEFERRED_MIN
+		    : (uint64_t)opt_cold_age_ms * KQU(1000000);
+		if (cold < time) {
+			time = cold;
+		}
+	}
 	return time;
 }
 
+void
+pac_cold_demote(tsdn_t *tsdn, pac_t *pac) {
+	if (opt_cold_age_ms < 0 || !ehooks_are_default(pac_ehooks_get(pac))) {
+		return;
+	}
+	nstime_t now;
+	nstime_init_update(&now);
+
+	/*
+	 * Every opt_cold_age_ms, a sweep walks the LRU from the head.  Extents
+	 * go from fresh to idle on the first sweep that sees them, and get
+	 * demoted on the next one.  Each scan looks at no more than
+	 * PAC_COLD_SCAN_MAX extents and leaves a cursor in the eset for the
+	 * next scan to resume the sweep from.  The scan only updates the marks
+	 * under the lock: cold pages keep their contents, so advising them
+	 * after the extent got reused is harmless.
+	 */
+	void    *addrs[PAC_COLD_BATCH];
+	size_t   sizes[PAC_COLD_BATCH];
+	unsigned n = 0;
+	ecache_t *ecache = &pac->ecache_dirty;
+	eset_t   *eset = &ecache->eset;
+	malloc_mutex_lock(tsdn, &ecache->mtx);
+	edata_t *edata = eset->lru_cursor;
+	if (edata == NULL) {
+		if (pac->cold_scanned
+		    && nstime_compare(&now, &pac->cold_scan_time) >= 0
+		    && nstime_ms_between(&pac->cold_scan_time, &now)
+		        < (uint64_t)opt_cold_age_ms) {
+			malloc_mutex_unlock(tsdn, &ecache->mtx);
+			return;
+		}
+		pac->cold_scanned = true;
+		nstime_copy(&pac->cold_scan_time, &now);
+		edata = edata_list_inactive_first(&eset->lru);
+	}
+	for (unsigned nscanned = 0; edata != NULL && nscanned < PAC_COLD_SCAN_MAX
+	     && n < PAC_COLD_BATCH;
+	     nscanned++, edata = edata_list_inactive_next(&eset->lru, edata)) {
+		switch (edata_cold_get(edata)) {
+		case EXTENT_COLD_FRESH:
+			edata_cold_set(edata, EXTENT_COLD_IDLE);
+			break;
+		case EXTENT_COLD_IDLE:
+			addrs[n] = edata_base_get(edata);
+			sizes[n] = edata_size_get(edata);
+			n++;
+			edata_cold_set(edata, EXTENT_COLD_DEMOTED);
+			break;
+		default:
+			break;
+		}
+	}
+	eset->lru_cursor = edata;
+	atomic_store_b(&pac->cold_sweeping, edata != NULL, ATOMIC_RELAXED);
+	malloc_mutex_unlock(tsdn, &ecache->mtx);
+
+	size_t demoted = 0;
+	for (unsigned i = 0; i < n; i++) {
+		if (!pages_cold(addrs[i], sizes[i], opt_cold_pageout)) {
+			demoted += sizes[i];
+		}
+	}
+	if (config_stats && demoted > 0) {
+		atomic_fetch_add_zu(
+		    &pac->stats->cold_demoted, demoted, ATOMIC_RELAXED);
+	}
+}
+
 bool
 pac_retain_grow_limit_get_set(
     tsdn_t *tsdn, pac_t *pac, size_t *old_limit, size_t *new_limit) {
@@ -695,9 +810,16 @@ pac_maybe_decay_purge(tsdn_t *tsdn, pac_t *pac, decay_t *decay,
 	size_t npages_current = ecache_npages_get(ecache);
 	bool   epoch_advanced = decay_maybe_advance_epoch(
             decay, &time, npages_current);
+	bool predictive = pac_decay_predictive(pac, decay);
+	if (predictive && epoch_advanced) {
+		decay_forecast_update(decay,
+		    atomic_load_zu(&pac->nalloc_pages, ATOMIC_RELAXED));
+	}
 	if (eagerness == PAC_PURGE_ALWAYS
 	    || (epoch_advanced && eagerness == PAC_PURGE_ON_EPOCH_ADVANCE)) {
-		size_t npages_limit = decay_npages_limit_get(decay);
+		size_t npages_limit = mem_pressure_npages_limit(predictive
+		        ? decay_forecast_limit_get(decay)
+		        : decay_npages_limit_get(decay));
 		pac_decay_try_purge(tsdn, pac, decay, decay_stats, ecache,
 		    npages_current, npages_limit);
 	}
@@ -498,6 +498,28 @@ pages_purge_lazy(void *addr, size_t size) {
 #endif
 }
 
+/*
+ * Whether a successful pages_purge_forced() leaves demand-zeroed pages behind,
+ * i.e. whether purged memory can be handed out as zeroed without a memset.
+ */
+bool
+pages_purge_forced_zeroes(void) {
+	if (!pages_can_purge_forced) {
+		return false;
+	}
+#if defined(JEMALLOC_PURGE_MADVISE_DONTNEED)                                   \
+    && defined(JEMALLOC_PURGE_MADVISE_DONTNEED_ZEROS)
+	return madvise_dont_need_zeros_is_faulty == 0;
+#elif defined(JEMALLOC_PURGE_POSIX_MADVISE_DONTNEED)                           \
+    && defined(JEMALLOC_PURGE_POSIX_MADVISE_DONTNEED_ZEROS)
+	return madvise_dont_need_zeros_is_faulty == 0;
+#elif defined(JEMALLOC_MAPS_COALESCE)
+	return true;
+#else
+	return false;
+#endif
+}
+
 bool
 pages_purge_forced(void *addr, size_t size) {
 	assert(PAGE_ADDR2BASE(addr) == addr);
@@ -599,6 +621,134 @@ pages_collapse(void *addr, size_t size) {
 #endif
 }
 
+/*
+ * Moves the pages to the inactive list, so that they are reclaimed first under
+ * memory pressure, or with pageout, reclaims them right away.  Either way the
+ * contents survive, swapped out if need be.
+ */
+bool
+pages_cold(void *addr, size_t size, bool pageout) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+#ifdef JEMALLOC_HAVE_MADVISE_COLD
+	return (madvise(addr, size, pageout ? MADV_PAGEOUT : MADV_COLD) != 0);
+#else
+	return true;
+#endif
+}
+
+#ifdef JEMALLOC_HAVE_MREMAP
+#	ifndef MREMAP_DONTUNMAP
+#		define MREMAP_DONTUNMAP 4
+#	endif
+/* Cleared once the kernel turns out not to support MREMAP_DONTUNMAP. */
+static atomic_b_t pages_remap_supported = ATOMIC_INIT(true);
+/*
+ * The pages a remap moves become a mapping of their own in the middle of the
+ * target range, which doesn't merge with its neighbours until the range is
+ * mapped afresh by pages_remap_release().  Once a process reaches
+ * vm.max_map_count mappings, mmap(2), mprotect(2) and even munmap(2) start
+ * failing, so remaps stop (and reallocations copy) while the ranges not yet
+ * released may have used up a quarter of the limit.  PAGES_REMAP_NMAPS is the
+ * worst case of new mappings per remap.
+ */
+#	define PAGES_REMAP_NMAPS 4
+/* Linux's DEFAULT_MAX_MAP_COUNT, for when the limit can't be read. */
+#	define PAGES_MAX_MAP_COUNT_DEFAULT 65530
+static atomic_zu_t pages_remap_nmaps_avail = ATOMIC_INIT(0);
+#endif
+
+/*
+ * Move the physical pages backing [old_addr, old_addr + size) to new_addr,
+ * replacing whatever was mapped there, without copying.  The old range stays
+ * mapped, and reads back as zeros.  Returns true if nothing was moved.
+ */
+bool
+pages_remap(void *old_addr, void *new_addr, size_t size) {
+	assert(PAGE_ADDR2BASE(old_addr) == old_addr);
+	assert(PAGE_ADDR2BASE(new_addr) == new_addr);
+	assert(PAGE_CEILING(size) == size);
+#ifdef JEMALLOC_HAVE_MREMAP
+	if (!atomic_load_b(&pages_remap_supported, ATOMIC_RELAXED)) {
+		return true;
+	}
+	size_t avail = atomic_load_zu(&pages_remap_nmaps_avail, ATOMIC_RELAXED);
+	do {
+		if (avail < PAGES_REMAP_NMAPS) {
+			return true;
+		}
+	} while (!atomic_compare_exchange_weak_zu(&pages_remap_nmaps_avail,
+	    &avail, avail - PAGES_REMAP_NMAPS, ATOMIC_RELAXED, ATOMIC_RELAXED));
+	/*
+	 * MREMAP_DONTUNMAP leaves the source mapping in place, so a failure
+	 * never opens a hole in the old extent.
+	 */
+	void *result = mremap(old_addr, size, size,
+	    MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP, new_addr);
+	if (result == MAP_FAILED) {
+		if (get_errno() == EINVAL) {
+			atomic_store_b(
+			    &pages_remap_supported, false, ATOMIC_RELAXED);
+		}
+		atomic_fetch_add_zu(&pages_remap_nmaps_avail, PAGES_REMAP_NMAPS,
+		    ATOMIC_RELAXED);
+		return true;
+	}
+	assert(result == new_addr);
+	/*
+	 * Map the source afresh rather than leave it split off; it reads back
+	 * as zeros either way, and a fresh mapping merges with its neighbours.
+	 */
+	os_pages_commit(old_addr, size, true);
+	return false;
+#else
+	return true;
+#endif
+}
+
+/*
+ * Map [addr, addr + size), part of a range that holds pages moved by
+ * pages_remap(), afresh, so that it merges with its neighbours again.  The
+ * contents are lost.
+ */
+void
+pages_remap_trim(void *addr, size_t size) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+#ifdef JEMALLOC_HAVE_MREMAP
+	os_pages_commit(addr, size, true);
+#else
+	not_reached();
+#endif
+}
+
+/*
+ * As pages_remap_trim(), for all of the range, which also hands back the
+ * mappings the remap was charged for.
+ */
+void
+pages_remap_release(void *addr, size_t size) {
+	assert(PAGE_ADDR2BASE(addr) == addr);
+	assert(PAGE_CEILING(size) == size);
+#ifdef JEMALLOC_HAVE_MREMAP
+	if (!os_pages_commit(addr, size, true)) {
+		atomic_fetch_add_zu(&pages_remap_nmaps_avail, PAGES_REMAP_NMAPS,
+		    ATOMIC_RELAXED);
+	}
+#else
+	not_reached();
+#endif
+}
+
+size_t
+pages_remap_nmaps_avail_get(void) {
+#ifdef JEMALLOC_HAVE_MREMAP
+	return atomic_load_zu(&pages_remap_nmaps_avail, ATOMIC_RELAXED);
+#else
+	return 0;
+#endif
+}
+
 bool
 pages_dontdump(void *addr, size_t size) {
 	assert(PAGE_ADDR2BASE(addr) == addr);
@@ -781,6 +931,37 @@ os_overcommits_proc(void) {
 }
 #endif
 
+#ifdef JEMALLOC_HAVE_MREMAP
+static size_t
+os_max_map_count_proc(void) {
+	int fd;
+#	if defined(O_CLOEXEC)
+	fd = malloc_open("/proc/sys/vm/max_map_count", O_RDONLY | O_CLOEXEC);
+#	else
+	fd = malloc_open("/proc/sys/vm/max_map_count", O_RDONLY);
+	if (fd != -1) {
+		fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+	}
+#	endif
+	if (fd == -1) {
+		return PAGES_MAX_MAP_COUNT_DEFAULT;
+	}
+	char    buf[32];
+	ssize_t nread = malloc_read_fd(fd, buf, sizeof(buf) - 1);
+	malloc_close(fd);
+	if (nread < 1) {
+		return PAGES_MAX_MAP_COUNT_DEFAULT;
+	}
+	buf[nread] = '\0';
+	char     *end;
+	uintmax_t count = malloc_strtoumax(buf, &end, 10);
+	if (end == buf || count > SIZE_T_MAX) {
+		return PAGES_MAX_MAP_COUNT_DEFAULT;
+	}
+	return (size_t)count;
+}
+#endif
+
 static bool
 pages_should_skip_set_thp_state() {
 	if (opt_thp == thp_mode_do_nothing
@@ -915,6 +1096,11 @@ pages_boot(void) {
 
 	init_thp_state();
 
+#ifdef JEMALLOC_HAVE_MREMAP
+	atomic_store_zu(&pages_remap_nmaps_avail, os_max_map_count_proc() / 4,
+	    ATOMIC_RELAXED);
+#endif
+
 #ifdef __FreeBSD__
 	/*
 	 * FreeBSD doesn't need the check; madvise(2) is known to work.
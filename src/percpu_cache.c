@@ -0,0 +1,662 @@
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/percpu_cache.h"
+
+/*
+ * The critical sections are hand-written, and only exist for x86-64 so far;
+ * elsewhere the per-CPU caches are always mutex protected.
+ */
+#if defined(JEMALLOC_HAVE_RSEQ) && defined(JEMALLOC_HAVE_MEMBARRIER_RSEQ) \
+    && defined(__x86_64__)
+#	define PERCPU_CACHE_RSEQ
+#	include <linux/membarrier.h>
+#	include <sys/rseq.h>
+#	include <sys/syscall.h>
+#endif
+
+typedef struct percpu_cache_bin_s percpu_cache_bin_t;
+struct percpu_cache_bin_s {
+	/*
+	 * Number of objects on the stack.  Every rseq critical section commits
+	 * by storing to it.
+	 */
+	atomic_zu_t ncached;
+	/* The lowest ncached since the last GC pass; only a hint. */
+	atomic_zu_t low_water;
+	/* Requests served from this stack, not yet merged into bin stats. */
+	atomic_zu_t nrequests;
+	/* Coldest object at the bottom; pushes and pops happen at the top. */
+	void **stack;
+};
+
+typedef struct percpu_cache_s percpu_cache_t;
+struct percpu_cache_s {
+	/*
+	 * Serializes everyone but the rseq critical sections, which only ever
+	 * run on the cache's own CPU.
+	 */
+	malloc_mutex_t mtx;
+	/*
+	 * Number of threads working on the stacks from outside the critical
+	 * sections, which back off while it is nonzero.  Modified under mtx.
+	 */
+	atomic_u32_t nstopped;
+	percpu_cache_bin_t bins[SC_NBINS];
+};
+
+bool opt_percpu_cache = false;
+
+bool percpu_cache_enabled_do_not_access_directly = false;
+
+#ifdef PERCPU_CACHE_RSEQ
+/* Whether the stacks are accessed in rseq critical sections or under mtx. */
+static bool percpu_cache_rseq = false;
+#endif
+/* Number of per-CPU caches; CPUs with higher ids bypass the layer. */
+static unsigned percpu_cache_ncpus;
+/* Distance between consecutive per-CPU caches; a multiple of CACHELINE. */
+static size_t percpu_cache_stride;
+static byte_t *percpu_caches;
+static cache_bin_sz_t percpu_cache_ncached_max[SC_NBINS];
+
+/* Guards percpu_cache_gc_last. */
+static malloc_mutex_t percpu_cache_gc_mtx;
+static nstime_t       percpu_cache_gc_last;
+
+static percpu_cache_t *
+percpu_cache_get(unsigned cpu) {
+	assert(cpu < percpu_cache_ncpus);
+	return (percpu_cache_t *)(percpu_caches + cpu * percpu_cache_stride);
+}
+
+void
+percpu_cache_boot0(void) {
+	if (!opt_percpu_cache) {
+		return;
+	}
+#ifdef PERCPU_CACHE_RSEQ
+	if (__rseq_size > 0
+	    && syscall(SYS_membarrier,
+	           MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ, 0, 0)
+	        == 0) {
+		percpu_cache_rseq = true;
+		return;
+	}
+#endif
+	if (!have_percpu_arena) {
+		/* No way to find the current CPU; stay with the thread caches. */
+		opt_percpu_cache = false;
+	}
+}
+
+void
+percpu_cache_ncached_max_init(const cache_bin_info_t *infos) {
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		percpu_cache_ncached_max[i] = infos[i].ncached_max;
+	}
+}
+
+bool
+percpu_cache_boot1(tsdn_t *tsdn, base_t *base) {
+	if (!opt_percpu_cache) {
+		return false;
+	}
+
+	percpu_cache_ncpus = ncpus;
+#ifdef PERCPU_CACHE_RSEQ
+	if (percpu_cache_rseq) {
+		/*
+		 * CPU ids come straight from the kernel, and may exceed the
+		 * number of CPUs the process is allowed to run on.
+		 */
+		long nconf = sysconf(_SC_NPROCESSORS_CONF);
+		if (nconf > (long)percpu_cache_ncpus) {
+			percpu_cache_ncpus = (unsigned)nconf;
+		}
+	}
+#endif
+	size_t nslots = 0;
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		nslots += percpu_cache_ncached_max[i];
+	}
+
+	if (malloc_mutex_init(&percpu_cache_gc_mtx, "percpu_cache_gc",
+	        WITNESS_RANK_PERCPU_CACHE, malloc_mutex_rank_exclusive)) {
+		return true;
+	}
+	nstime_init_zero(&percpu_cache_gc_last);
+
+	percpu_cache_stride = CACHELINE_CEILING(sizeof(percpu_cache_t));
+	percpu_caches = (byte_t *)base_alloc(
+	    tsdn, base, percpu_cache_stride * percpu_cache_ncpus, CACHELINE);
+	if (percpu_caches == NULL) {
+		return true;
+	}
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		percpu_cache_t *pcache = percpu_cache_get(cpu);
+		if (malloc_mutex_init(&pcache->mtx, "percpu_cache",
+		        WITNESS_RANK_PERCPU_CACHE,
+		        malloc_mutex_rank_exclusive)) {
+			return true;
+		}
+		atomic_store_u32(&pcache->nstopped, 0, ATOMIC_RELAXED);
+		void **slots = (void **)base_alloc(tsdn, base,
+		    (nslots == 0 ? 1 : nslots) * sizeof(void *), CACHELINE);
+		if (slots == NULL) {
+			return true;
+		}
+		for (szind_t i = 0; i < SC_NBINS; i++) {
+			percpu_cache_bin_t *bin = &pcache->bins[i];
+			atomic_store_zu(&bin->ncached, 0, ATOMIC_RELAXED);
+			atomic_store_zu(&bin->low_water, 0, ATOMIC_RELAXED);
+			atomic_store_zu(&bin->nrequests, 0, ATOMIC_RELAXED);
+			bin->stack = slots;
+			slots += percpu_cache_ncached_max[i];
+		}
+	}
+
+	percpu_cache_enabled_do_not_access_directly = true;
+	return false;
+}
+
+static void
+percpu_cache_bin_low_water_update(percpu_cache_bin_t *bin, size_t ncached) {
+	if (ncached < atomic_load_zu(&bin->low_water, ATOMIC_RELAXED)) {
+		atomic_store_zu(&bin->low_water, ncached, ATOMIC_RELAXED);
+	}
+}
+
+static void
+percpu_cache_bin_nrequests_add(percpu_cache_bin_t *bin, uint64_t nrequests) {
+	if (config_stats && nrequests > 0) {
+		atomic_fetch_add_zu(
+		    &bin->nrequests, (size_t)nrequests, ATOMIC_RELAXED);
+	}
+}
+
+#ifdef PERCPU_CACHE_RSEQ
+#	define PERCPU_CACHE_STR_(x) #x
+#	define PERCPU_CACHE_STR(x) PERCPU_CACHE_STR_(x)
+
+/*
+ * Opens a critical section running from label 1 to label 2, with its abort
+ * handler at label 4: emits the struct rseq_cs describing it, points the rseq
+ * area at that, and bails out if the thread is no longer on the expected CPU
+ * (restart) or the stacks are stopped (give up).
+ */
+#	define PERCPU_CACHE_RSEQ_BEGIN                                         \
+		".pushsection __rseq_cs, \"aw\"\n\t"                            \
+		".balign 32\n\t"                                                \
+		"3:\n\t"                                                        \
+		".long 0x0, 0x0\n\t"                                            \
+		".quad 1f, (2f - 1f), 4f\n\t"                                   \
+		".popsection\n\t"                                               \
+		"leaq 3b(%%rip), %%rax\n\t"                                     \
+		"movq %%rax, %[rseq_cs]\n\t"                                    \
+		"1:\n\t"                                                        \
+		"cmpl %[cpu], %[cpu_id]\n\t"                                    \
+		"jnz 4f\n\t"                                                    \
+		"cmpl $0, %[nstopped]\n\t"                                      \
+		"jnz %l[label_fail]\n\t"
+
+/* The kernel checks for RSEQ_SIG right in front of the abort handler. */
+#	define PERCPU_CACHE_RSEQ_END                                           \
+		"2:\n\t"                                                        \
+		".pushsection __rseq_failure, \"ax\"\n\t"                       \
+		".byte 0x0f, 0xb9, 0x3d\n\t"                                    \
+		".long " PERCPU_CACHE_STR(RSEQ_SIG) "\n\t"                      \
+		"4:\n\t"                                                        \
+		"jmp %l[label_abort]\n\t"                                       \
+		".popsection\n\t"
+
+static struct rseq *
+percpu_cache_rseq_area(void) {
+	return (struct rseq *)((uintptr_t)__builtin_thread_pointer()
+	    + __rseq_offset);
+}
+
+/*
+ * Returns the current CPU, or -1 if this thread's rseq registration failed or
+ * the CPU has no cache.
+ */
+static int32_t
+percpu_cache_rseq_cpu(struct rseq *rs) {
+	int32_t cpu = (int32_t)(*(volatile uint32_t *)&rs->cpu_id);
+	if (unlikely(cpu < 0 || (unsigned)cpu >= percpu_cache_ncpus)) {
+		return -1;
+	}
+	return cpu;
+}
+
+static cache_bin_sz_t
+percpu_cache_rseq_fill(szind_t binind, void **ptrs, cache_bin_sz_t nmax,
+    uint64_t nrequests) {
+	struct rseq        *rs = percpu_cache_rseq_area();
+	percpu_cache_bin_t *bin;
+	size_t              nfilled = 0;
+	size_t              nleft = 0;
+label_retry:;
+	int32_t cpu = percpu_cache_rseq_cpu(rs);
+	if (cpu < 0) {
+		return 0;
+	}
+	percpu_cache_t *pcache = percpu_cache_get((unsigned)cpu);
+	bin = &pcache->bins[binind];
+	/* Copies the top min(ncached, nmax) objects out, then pops them. */
+	__asm__ __volatile__ goto(PERCPU_CACHE_RSEQ_BEGIN
+	                          "movq %[ncached], %%rax\n\t"
+	                          "movq %[nmax], %%rcx\n\t"
+	                          "cmpq %%rcx, %%rax\n\t"
+	                          "cmovbq %%rax, %%rcx\n\t"
+	                          "testq %%rcx, %%rcx\n\t"
+	                          "jz %l[label_fail]\n\t"
+	                          "subq %%rcx, %%rax\n\t"
+	                          "leaq (%[stack], %%rax, 8), %%rsi\n\t"
+	                          "xorl %%edx, %%edx\n\t"
+	                          "5:\n\t"
+	                          "movq (%%rsi, %%rdx, 8), %%r8\n\t"
+	                          "movq %%r8, (%[ptrs], %%rdx, 8)\n\t"
+	                          "incq %%rdx\n\t"
+	                          "cmpq %%rcx, %%rdx\n\t"
+	                          "jne 5b\n\t"
+	                          "movq %%rcx, %[nfilled]\n\t"
+	                          "movq %%rax, %[nleft]\n\t"
+	                          /* Commit. */
+	                          "movq %%rax, %[ncached]\n\t"
+	                          PERCPU_CACHE_RSEQ_END
+	                          : /* No outputs. */
+	                          : [rseq_cs] "m"(rs->rseq_cs),
+	                          [cpu_id] "m"(rs->cpu_id), [cpu] "r"(cpu),
+	                          [nstopped] "m"(pcache->nstopped),
+	                          [ncached] "m"(bin->ncached),
+	                          [stack] "r"(bin->stack), [ptrs] "r"(ptrs),
+	                          [nmax] "r"((size_t)nmax),
+	                          [nfilled] "m"(nfilled), [nleft] "m"(nleft)
+	                          : "memory", "cc", "rax", "rcx", "rdx", "rsi",
+	                          "r8"
+	                          : label_abort, label_fail);
+	percpu_cache_bin_low_water_update(bin, nleft);
+	percpu_cache_bin_nrequests_add(bin, nrequests);
+	return (cache_bin_sz_t)nfilled;
+label_abort:
+	goto label_retry;
+label_fail:
+	return 0;
+}
+
+static cache_bin_sz_t
+percpu_cache_rseq_dalloc(szind_t binind, void **ptrs, cache_bin_sz_t n) {
+	struct rseq *rs = percpu_cache_rseq_area();
+	size_t       nstored = 0;
+label_retry:;
+	int32_t cpu = percpu_cache_rseq_cpu(rs);
+	if (cpu < 0) {
+		return 0;
+	}
+	percpu_cache_t     *pcache = percpu_cache_get((unsigned)cpu);
+	percpu_cache_bin_t *bin = &pcache->bins[binind];
+	/* Copies min(room, n) objects onto the top, then pushes them. */
+	__asm__ __volatile__ goto(PERCPU_CACHE_RSEQ_BEGIN
+	                          "movq %[ncached], %%rax\n\t"
+	                          "movq %[ncached_max], %%rcx\n\t"
+	                          "subq %%rax, %%rcx\n\t"
+	                          "cmpq %[n], %%rcx\n\t"
+	                          "cmovaq %[n], %%rcx\n\t"
+	                          "testq %%rcx, %%rcx\n\t"
+	                          "jz %l[label_fail]\n\t"
+	                          "leaq (%[stack], %%rax, 8), %%rsi\n\t"
+	                          "xorl %%edx, %%edx\n\t"
+	                          "5:\n\t"
+	                          "movq (%[ptrs], %%rdx, 8), %%r8\n\t"
+	                          "movq %%r8, (%%rsi, %%rdx, 8)\n\t"
+	                          "incq %%rdx\n\t"
+	                          "cmpq %%rcx, %%rdx\n\t"
+	                          "jne 5b\n\t"
+	                          "movq %%rcx, %[nstored]\n\t"
+	                          "addq %%rcx, %%rax\n\t"
+	                          /* Commit. */
+	                          "movq %%rax, %[ncached]\n\t"
+	                          PERCPU_CACHE_RSEQ_END
+	                          : /* No outputs. */
+	                          : [rseq_cs] "m"(rs->rseq_cs),
+	                          [cpu_id] "m"(rs->cpu_id), [cpu] "r"(cpu),
+	                          [nstopped] "m"(pcache->nstopped),
+	                          [ncached] "m"(bin->ncached),
+	                          [ncached_max] "r"(
+	                              (size_t)percpu_cache_ncached_max[binind]),
+	                          [stack] "r"(bin->stack), [ptrs] "r"(ptrs),
+	                          [n] "r"((size_t)n), [nstored] "m"(nstored)
+	                          : "memory", "cc", "rax", "rcx", "rdx", "rsi",
+	                          "r8"
+	                          : label_abort, label_fail);
+	return (cache_bin_sz_t)nstored;
+label_abort:
+	goto label_retry;
+label_fail:
+	return 0;
+}
+
+/*
+ * Makes sure no critical section on cpu still runs under the assumption that
+ * its stacks are not stopped.  Returns true on failure.
+ */
+static bool
+percpu_cache_rseq_fence(unsigned cpu) {
+	if (syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ,
+	        MEMBARRIER_CMD_FLAG_CPU, (int)cpu)
+	    == 0) {
+		return false;
+	}
+	/* Kernels before 5.10 can only target all CPUs. */
+	return syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_RSEQ,
+	           0, 0)
+	    != 0;
+}
+#endif
+
+/* The mutex protected counterparts of the above. */
+static percpu_cache_t *
+percpu_cache_lock(tsdn_t *tsdn) {
+	malloc_cpuid_t cpu = malloc_getcpu();
+	percpu_cache_t *pcache = percpu_cache_get(
+	    cpu < 0 ? 0 : (unsigned)cpu % percpu_cache_ncpus);
+	malloc_mutex_lock(tsdn, &pcache->mtx);
+	return pcache;
+}
+
+static cache_bin_sz_t
+percpu_cache_locked_fill(tsdn_t *tsdn, szind_t binind, void **ptrs,
+    cache_bin_sz_t nmax, uint64_t nrequests) {
+	percpu_cache_t     *pcache = percpu_cache_lock(tsdn);
+	percpu_cache_bin_t *bin = &pcache->bins[binind];
+	size_t ncached = atomic_load_zu(&bin->ncached, ATOMIC_RELAXED);
+	size_t nfilled = ncached < nmax ? ncached : nmax;
+	if (nfilled > 0) {
+		ncached -= nfilled;
+		memcpy(ptrs, bin->stack + ncached, nfilled * sizeof(void *));
+		atomic_store_zu(&bin->ncached, ncached, ATOMIC_RELAXED);
+		percpu_cache_bin_low_water_update(bin, ncached);
+		percpu_cache_bin_nrequests_add(bin, nrequests);
+	}
+	malloc_mutex_unlock(tsdn, &pcache->mtx);
+	return (cache_bin_sz_t)nfilled;
+}
+
+static cache_bin_sz_t
+percpu_cache_locked_dalloc(
+    tsdn_t *tsdn, szind_t binind, void **ptrs, cache_bin_sz_t n) {
+	percpu_cache_t     *pcache = percpu_cache_lock(tsdn);
+	percpu_cache_bin_t *bin = &pcache->bins[binind];
+	size_t ncached = atomic_load_zu(&bin->ncached, ATOMIC_RELAXED);
+	size_t nstored = percpu_cache_ncached_max[binind] - ncached;
+	if (nstored > n) {
+		nstored = n;
+	}
+	memcpy(bin->stack + ncached, ptrs, nstored * sizeof(void *));
+	atomic_store_zu(&bin->ncached, ncached + nstored, ATOMIC_RELAXED);
+	malloc_mutex_unlock(tsdn, &pcache->mtx);
+	return (cache_bin_sz_t)nstored;
+}
+
+cache_bin_sz_t
+percpu_cache_fill(tsdn_t *tsdn, szind_t binind, void **ptrs,
+    cache_bin_sz_t nmax, uint64_t nrequests) {
+	assert(percpu_cache_enabled());
+	assert(binind < SC_NBINS);
+#ifdef PERCPU_CACHE_RSEQ
+	if (percpu_cache_rseq) {
+		return percpu_cache_rseq_fill(binind, ptrs, nmax, nrequests);
+	}
+#endif
+	return percpu_cache_locked_fill(tsdn, binind, ptrs, nmax, nrequests);
+}
+
+cache_bin_sz_t
+percpu_cache_dalloc(
+    tsdn_t *tsdn, szind_t binind, void **ptrs, cache_bin_sz_t n) {
+	assert(percpu_cache_enabled());
+	assert(binind < SC_NBINS);
+	if (n == 0) {
+		return 0;
+	}
+#ifdef PERCPU_CACHE_RSEQ
+	if (percpu_cache_rseq) {
+		return percpu_cache_rseq_dalloc(binind, ptrs, n);
+	}
+#endif
+	return percpu_cache_locked_dalloc(tsdn, binind, ptrs, n);
+}
+
+/* Hands the stacks of cpu back to the critical sections. */
+static void
+percpu_cache_start(tsdn_t *tsdn, unsigned cpu) {
+#ifdef PERCPU_CACHE_RSEQ
+	if (!percpu_cache_rseq) {
+		return;
+	}
+	percpu_cache_t *pcache = percpu_cache_get(cpu);
+	malloc_mutex_lock(tsdn, &pcache->mtx);
+	atomic_store_u32(&pcache->nstopped,
+	    atomic_load_u32(&pcache->nstopped, ATOMIC_RELAXED) - 1,
+	    ATOMIC_RELEASE);
+	malloc_mutex_unlock(tsdn, &pcache->mtx);
+#endif
+}
+
+/*
+ * Takes the stacks of cpu away from the critical sections, until the matching
+ * percpu_cache_start().  Returns true on failure.
+ */
+static bool
+percpu_cache_stop(tsdn_t *tsdn, unsigned cpu) {
+#ifdef PERCPU_CACHE_RSEQ
+	if (!percpu_cache_rseq) {
+		return false;
+	}
+	percpu_cache_t *pcache = percpu_cache_get(cpu);
+	malloc_mutex_lock(tsdn, &pcache->mtx);
+	atomic_store_u32(&pcache->nstopped,
+	    atomic_load_u32(&pcache->nstopped, ATOMIC_RELAXED) + 1,
+	    ATOMIC_RELAXED);
+	malloc_mutex_unlock(tsdn, &pcache->mtx);
+	if (percpu_cache_rseq_fence(cpu)) {
+		percpu_cache_start(tsdn, cpu);
+		return true;
+	}
+#endif
+	return false;
+}
+
+/*
+ * Returns the nflush coldest objects of a stopped stack to their arenas, along
+ * with the pending request count.
+ */
+static void
+percpu_cache_drain_bin(tsd_t *tsd, unsigned cpu, szind_t binind, bool all) {
+	tsdn_t             *tsdn = tsd_tsdn(tsd);
+	percpu_cache_t     *pcache = percpu_cache_get(cpu);
+	percpu_cache_bin_t *bin = &pcache->bins[binind];
+	VARIABLE_ARRAY(void *, ptrs, percpu_cache_ncached_max[binind] + 1);
+
+	malloc_mutex_lock(tsdn, &pcache->mtx);
+	size_t ncached = atomic_load_zu(&bin->ncached, ATOMIC_RELAXED);
+	size_t nflush;
+	if (all) {
+		nflush = ncached;
+	} else {
+		size_t low_water = atomic_load_zu(
+		    &bin->low_water, ATOMIC_RELAXED);
+		if (low_water > ncached) {
+			low_water = ncached;
+		}
+		nflush = low_water - (low_water >> 2);
+	}
+	memcpy(ptrs, bin->stack, nflush * sizeof(void *));
+	memmove(bin->stack, bin->stack + nflush,
+	    (ncached - nflush) * sizeof(void *));
+	atomic_store_zu(&bin->ncached, ncached - nflush, ATOMIC_RELAXED);
+	atomic_store_zu(&bin->low_water, ncached - nflush, ATOMIC_RELAXED);
+	cache_bin_stats_t merge_stats = {0};
+	/*
+	 * The requests are credited to the arena the objects go back to, so
+	 * with nothing to flush they wait for a later drain.
+	 */
+	if (config_stats && nflush > 0) {
+		merge_stats.nrequests = atomic_exchange_zu(
+		    &bin->nrequests, 0, ATOMIC_RELAXED);
+	}
+	malloc_mutex_unlock(tsdn, &pcache->mtx);
+
+	if (nflush == 0) {
+		return;
+	}
+	cache_bin_ptr_array_t arr;
+	arr.n = (cache_bin_sz_t)nflush;
+	arr.ptr = ptrs;
+	arena_ptr_array_flush(tsd, binind, &arr, (unsigned)nflush,
+	    /* small */ true, /* stats_arena */ NULL, merge_stats,
+	    /* use_percpu_cache */ false);
+}
+
+/*
+ * Returns objects of cpu to their arenas: all of them, or 3/4 of those below
+ * each stack's low water mark.
+ */
+static void
+percpu_cache_drain(tsd_t *tsd, unsigned cpu, bool all) {
+	percpu_cache_t *pcache = percpu_cache_get(cpu);
+	/*
+	 * Skip the fence for CPUs with nothing to do.  Racing with the critical
+	 * sections here is benign; the next pass catches up.
+	 */
+	bool idle = true;
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		percpu_cache_bin_t *bin = &pcache->bins[i];
+		size_t ncached = atomic_load_zu(&bin->ncached, ATOMIC_RELAXED);
+		if ((all ? ncached
+		         : atomic_load_zu(&bin->low_water, ATOMIC_RELAXED))
+		    > 0) {
+			idle = false;
+		} else if (!all) {
+			atomic_store_zu(&bin->low_water, ncached, ATOMIC_RELAXED);
+		}
+	}
+	if (idle) {
+		return;
+	}
+
+	tsdn_t *tsdn = tsd_tsdn(tsd);
+	if (percpu_cache_stop(tsdn, cpu)) {
+		return;
+	}
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		percpu_cache_drain_bin(tsd, cpu, i, all);
+	}
+	percpu_cache_start(tsdn, cpu);
+}
+
+void
+percpu_cache_gc(tsd_t *tsd) {
+	if (!percpu_cache_enabled()) {
+		return;
+	}
+	tsdn_t *tsdn = tsd_tsdn(tsd);
+	/* Someone else is already on it. */
+	if (malloc_mutex_trylock(tsdn, &percpu_cache_gc_mtx)) {
+		return;
+	}
+	nstime_t now;
+	nstime_copy(&now, &percpu_cache_gc_last);
+	nstime_update(&now);
+	bool due = nstime_ns(&now) - nstime_ns(&percpu_cache_gc_last)
+	    >= PERCPU_CACHE_GC_INTERVAL_NS;
+	if (due) {
+		nstime_copy(&percpu_cache_gc_last, &now);
+	}
+	malloc_mutex_unlock(tsdn, &percpu_cache_gc_mtx);
+	if (!due) {
+		return;
+	}
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		percpu_cache_drain(tsd, cpu, /* all */ false);
+	}
+}
+
+void
+percpu_cache_flush_all(tsd_t *tsd) {
+	if (!percpu_cache_enabled()) {
+		return;
+	}
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		percpu_cache_drain(tsd, cpu, /* all */ true);
+	}
+}
+
+size_t
+percpu_cache_bytes_get(tsdn_t *tsdn) {
+	if (!percpu_cache_enabled()) {
+		return 0;
+	}
+	/* A snapshot; the stacks keep changing underneath. */
+	size_t bytes = 0;
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		percpu_cache_t *pcache = percpu_cache_get(cpu);
+		for (szind_t i = 0; i < SC_NBINS; i++) {
+			bytes += atomic_load_zu(
+			             &pcache->bins[i].ncached, ATOMIC_RELAXED)
+			    * sz_index2size(i);
+		}
+	}
+	return bytes;
+}
+
+void
+percpu_cache_prefork(tsdn_t *tsdn) {
+	if (!percpu_cache_enabled()) {
+		return;
+	}
+	malloc_mutex_prefork(tsdn, &percpu_cache_gc_mtx);
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		malloc_mutex_prefork(tsdn, &percpu_cache_get(cpu)->mtx);
+	}
+}
+
+void
+percpu_cache_postfork_parent(tsdn_t *tsdn) {
+	if (!percpu_cache_enabled()) {
+		return;
+	}
+	malloc_mutex_postfork_parent(tsdn, &percpu_cache_gc_mtx);
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		malloc_mutex_postfork_parent(tsdn, &percpu_cache_get(cpu)->mtx);
+	}
+}
+
+void
+percpu_cache_postfork_child(tsdn_t *tsdn) {
+	if (!percpu_cache_enabled()) {
+		return;
+	}
+	malloc_mutex_postfork_child(tsdn, &percpu_cache_gc_mtx);
+	for (unsigned cpu = 0; cpu < percpu_cache_ncpus; cpu++) {
+		percpu_cache_t *pcache = percpu_cache_get(cpu);
+		malloc_mutex_postfork_child(tsdn, &pcache->mtx);
+		/* Whoever had the stacks stopped did not make it across. */
+		atomic_store_u32(&pcache->nstopped, 0, ATOMIC_RELAXED);
+	}
+#ifdef PERCPU_CACHE_RSEQ
+	if (percpu_cache_rseq
+	    && syscall(SYS_membarrier,
+	           MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_RSEQ, 0, 0)
+	        != 0) {
+		/*
+		 * Without the fence the stacks could not be drained safely.  No
+		 * critical section can be in flight in a freshly forked child,
+		 * so switching to the mutexes is safe.
+		 */
+		percpu_cache_rseq = false;
+	}
+#endif
+}
@@ -8,7 +8,7 @@
 void
 psset_init(psset_t *psset) {
 	for (unsigned i = 0; i < PSSET_NPSIZES; i++) {
-		hpdata_age_heap_new(&psset->pageslabs[i]);
+		hpdata_age_tree_new(&psset->pageslabs[i]);
 	}
 	fb_init(psset->pageslab_bitmap, PSSET_NPSIZES);
 	memset(&psset->stats, 0, sizeof(psset->stats));
@@ -17,9 +17,17 @@ psset_init(psset_t *psset) {
 		hpdata_purge_list_init(&psset->to_purge[i]);
 	}
 	fb_init(psset->purge_bitmap, PSSET_NPURGE_LISTS);
+	psset->purge_lru_enabled = false;
+	hpdata_lru_tree_new(&psset->purge_lru);
 	hpdata_hugify_list_init(&psset->to_hugify);
 }
 
+void
+psset_purge_lru_enable(psset_t *psset) {
+	assert(hpdata_lru_tree_empty(&psset->purge_lru));
+	psset->purge_lru_enabled = true;
+}
+
 static void
 psset_bin_stats_accum(psset_bin_stats_t *dst, psset_bin_stats_t *src) {
 	dst->npageslabs += src->npageslabs;
@@ -124,7 +132,7 @@ psset_slab_stats_remove(
 }
 
 static pszind_t
-psset_hpdata_heap_index(const hpdata_t *ps) {
+psset_hpdata_tree_index(const hpdata_t *ps) {
 	assert(!hpdata_full(ps));
 	assert(!hpdata_empty(ps));
 	size_t   longest_free_range = hpdata_longest_free_range_get(ps);
@@ -135,21 +143,21 @@ psset_hpdata_heap_index(const hpdata_t *ps) {
 }
 
 static void
-psset_hpdata_heap_remove(psset_t *psset, hpdata_t *ps) {
-	pszind_t pind = psset_hpdata_heap_index(ps);
-	hpdata_age_heap_remove(&psset->pageslabs[pind], ps);
-	if (hpdata_age_heap_empty(&psset->pageslabs[pind])) {
+psset_hpdata_tree_remove(psset_t *psset, hpdata_t *ps) {
+	pszind_t pind = psset_hpdata_tree_index(ps);
+	hpdata_age_tree_remove(&psset->pageslabs[pind], ps);
+	if (hpdata_age_tree_empty(&psset->pageslabs[pind])) {
 		fb_unset(psset->pageslab_bitmap, PSSET_NPSIZES, (size_t)pind);
 	}
 }
 
 static void
-psset_hpdata_heap_insert(psset_t *psset, hpdata_t *ps) {
-	pszind_t pind = psset_hpdata_heap_index(ps);
-	if (hpdata_age_heap_empty(&psset->pageslabs[pind])) {
+psset_hpdata_tree_insert(psset_t *psset, hpdata_t *ps) {
+	pszind_t pind = psset_hpdata_tree_index(ps);
+	if (hpdata_age_tree_empty(&psset->pageslabs[pind])) {
 		fb_set(psset->pageslab_bitmap, PSSET_NPSIZES, (size_t)pind);
 	}
-	hpdata_age_heap_insert(&psset->pageslabs[pind], ps);
+	hpdata_age_tree_insert(&psset->pageslabs[pind], ps);
 }
 
 static void
@@ -160,7 +168,7 @@ psset_stats_insert(psset_t *psset, hpdata_t *ps) {
 	} else if (hpdata_full(ps)) {
 		psset_slab_stats_insert(stats, psset->stats.full_slabs, ps);
 	} else {
-		pszind_t pind = psset_hpdata_heap_index(ps);
+		pszind_t pind = psset_hpdata_tree_index(ps);
 		psset_slab_stats_insert(
 		    stats, psset->stats.nonfull_slabs[pind], ps);
 	}
@@ -174,7 +182,7 @@ psset_stats_remove(psset_t *psset, hpdata_t *ps) {
 	} else if (hpdata_full(ps)) {
 		psset_slab_stats_remove(stats, psset->stats.full_slabs, ps);
 	} else {
-		pszind_t pind = psset_hpdata_heap_index(ps);
+		pszind_t pind = psset_hpdata_tree_index(ps);
 		psset_slab_stats_remove(
 		    stats, psset->stats.nonfull_slabs[pind], ps);
 	}
@@ -201,7 +209,7 @@ psset_alloc_container_insert(psset_t *psset, hpdata_t *ps) {
 		 * going to return them from a psset_pick_alloc call.
 		 */
 	} else {
-		psset_hpdata_heap_insert(psset, ps);
+		psset_hpdata_tree_insert(psset, ps);
 	}
 }
 
@@ -216,7 +224,7 @@ psset_alloc_container_remove(psset_t *psset, hpdata_t *ps) {
 	} else if (hpdata_full(ps)) {
 		/* Same as above -- do nothing in this case. */
 	} else {
-		psset_hpdata_heap_remove(psset, ps);
+		psset_hpdata_tree_remove(psset, ps);
 	}
 }
 
@@ -285,6 +293,47 @@ psset_maybe_insert_purge_list(psset_t *psset, hpdata_t *ps) {
 	}
 }
 
+static void
+psset_lru_remove(psset_t *psset, hpdata_t *ps) {
+	hpdata_in_psset_lru_container_set(ps, false);
+	hpdata_lru_tree_remove(&psset->purge_lru, ps);
+}
+
+/* Files ps by its last activity. */
+static void
+psset_lru_insert(psset_t *psset, hpdata_t *ps) {
+	hpdata_lru_key_set(ps, hpdata_last_active_get(ps));
+	hpdata_in_psset_lru_container_set(ps, true);
+	hpdata_lru_tree_insert(&psset->purge_lru, ps);
+}
+
+/*
+ * Unlike the purge lists, the LRU keeps an hpdata in place across updates
+ * that didn't change its last activity.
+ */
+static void
+psset_lru_update(psset_t *psset, hpdata_t *ps) {
+	if (!psset->purge_lru_enabled) {
+		return;
+	}
+	if (hpdata_in_psset_lru_container_get(ps)) {
+		if (hpdata_purge_allowed_get(ps)
+		    && hpdata_lru_key_get(ps) == hpdata_last_active_get(ps)) {
+			return;
+		}
+		psset_lru_remove(psset, ps);
+	}
+	if (hpdata_purge_allowed_get(ps)) {
+		psset_lru_insert(psset, ps);
+	}
+}
+
+/* Span hugepages are allocated from as a whole, never through the psset. */
+static bool
+psset_alloc_container_eligible(const hpdata_t *ps) {
+	return hpdata_alloc_allowed_get(ps) && hpdata_span_get(ps) == NULL;
+}
+
 void
 psset_update_begin(psset_t *psset, hpdata_t *ps) {
 	hpdata_assert_consistent(ps);
@@ -319,10 +368,11 @@ psset_update_end(psset_t *psset, hpdata_t *ps) {
 	 * it was in.
 	 */
 	assert(!hpdata_in_psset_alloc_container_get(ps));
-	if (hpdata_alloc_allowed_get(ps)) {
+	if (psset_alloc_container_eligible(ps)) {
 		psset_alloc_container_insert(psset, ps);
 	}
 	psset_maybe_insert_purge_list(psset, ps);
+	psset_lru_update(psset, ps);
 
 	if (hpdata_hugify_allowed_get(ps)
 	    && !hpdata_in_psset_hugify_container_get(ps)) {
@@ -336,25 +386,14 @@ psset_update_end(psset_t *psset, hpdata_t *ps) {
 	hpdata_assert_consistent(ps);
 }
 
-static hpdata_t *
-psset_enumerate_search(psset_t *psset, pszind_t pind, size_t size) {
-	if (hpdata_age_heap_empty(&psset->pageslabs[pind])) {
-		return NULL;
-	}
-
-	hpdata_t                          *ps = NULL;
-	hpdata_age_heap_enumerate_helper_t helper;
-	hpdata_age_heap_enumerate_prepare(&psset->pageslabs[pind], &helper,
-	    PSSET_ENUMERATE_MAX_NUM, sizeof(helper.bfs_queue) / sizeof(void *));
-
-	while ((ps = hpdata_age_heap_enumerate_next(
-	            &psset->pageslabs[pind], &helper))) {
-		if (hpdata_longest_free_range_get(ps) >= size) {
-			return ps;
-		}
-	}
+static bool
+psset_fits_filter_node(void *ctx, hpdata_t *ps) {
+	return hpdata_longest_free_range_get(ps) >= *(size_t *)ctx;
+}
 
-	return NULL;
+static bool
+psset_fits_filter_subtree(void *ctx, hpdata_t *ps) {
+	return hpdata_subtree_longest_free_range_get(ps) >= *(size_t *)ctx;
 }
 
 hpdata_t *
@@ -365,10 +404,18 @@ psset_pick_alloc(psset_t *psset, size_t size) {
 	pszind_t  min_pind = sz_psz2ind(sz_psz_quantize_ceil(size));
 	hpdata_t *ps = NULL;
 
-	/* See comments in eset_first_fit for why we enumerate search below. */
+	/*
+	 * See comments in eset_first_fit for why we search the bin below.  Only
+	 * some of its pageslabs can fit the request; the bin's tree tracks the
+	 * longest free range under each node, so we find the oldest that does
+	 * in O(log n).
+	 */
 	pszind_t pind_prev = sz_psz2ind(sz_psz_quantize_floor(size));
 	if (sz_large_size_classes_disabled() && pind_prev < min_pind) {
-		ps = psset_enumerate_search(psset, pind_prev, size);
+		size_t npages = size >> LG_PAGE;
+		ps = hpdata_age_tree_first_filtered(&psset->pageslabs[pind_prev],
+		    &psset_fits_filter_node, &psset_fits_filter_subtree,
+		    &npages);
 		if (ps != NULL) {
 			return ps;
 		}
@@ -379,7 +426,7 @@ psset_pick_alloc(psset_t *psset, size_t size) {
 	if (pind == PSSET_NPSIZES) {
 		return hpdata_empty_list_first(&psset->empty);
 	}
-	ps = hpdata_age_heap_first(&psset->pageslabs[pind]);
+	ps = hpdata_age_tree_first(&psset->pageslabs[pind]);
 	if (ps == NULL) {
 		return NULL;
 	}
@@ -426,20 +473,42 @@ psset_pick_purge(psset_t *psset, const nstime_t *now) {
 	return NULL;
 }
 
+hpdata_t *
+psset_pick_purge_lru(psset_t *psset, const nstime_t *now) {
+	assert(psset->purge_lru_enabled);
+	hpdata_t *ps = hpdata_lru_tree_first(&psset->purge_lru);
+	if (ps == NULL || now == NULL) {
+		return ps;
+	}
+	/*
+	 * As in psset_pick_purge, we only guarantee the min delay for the
+	 * first candidate; it is also the one that went idle the earliest.
+	 */
+	const nstime_t *tm_allowed = hpdata_time_purge_allowed_get(ps);
+	return nstime_compare(tm_allowed, now) <= 0 ? ps : NULL;
+}
+
 hpdata_t *
 psset_pick_hugify(psset_t *psset) {
 	return hpdata_hugify_list_first(&psset->to_hugify);
 }
 
+hpdata_t *
+psset_next_hugify(psset_t *psset, hpdata_t *ps) {
+	assert(hpdata_in_psset_hugify_container_get(ps));
+	return hpdata_hugify_list_next(&psset->to_hugify, ps);
+}
+
 void
 psset_insert(psset_t *psset, hpdata_t *ps) {
 	hpdata_in_psset_set(ps, true);
 
 	psset_stats_insert(psset, ps);
-	if (hpdata_alloc_allowed_get(ps)) {
+	if (psset_alloc_container_eligible(ps)) {
 		psset_alloc_container_insert(psset, ps);
 	}
 	psset_maybe_insert_purge_list(psset, ps);
+	psset_lru_update(psset, ps);
 
 	if (hpdata_hugify_allowed_get(ps)) {
 		hpdata_in_psset_hugify_container_set(ps, true);
@@ -456,6 +525,9 @@ psset_remove(psset_t *psset, hpdata_t *ps) {
 		psset_alloc_container_remove(psset, ps);
 	}
 	psset_maybe_remove_purge_list(psset, ps);
+	if (hpdata_in_psset_lru_container_get(ps)) {
+		psset_lru_remove(psset, ps);
+	}
 	if (hpdata_in_psset_hugify_container_get(ps)) {
 		hpdata_in_psset_hugify_container_set(ps, false);
 		hpdata_hugify_list_remove(&psset->to_hugify, ps);
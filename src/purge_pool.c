@@ -0,0 +1,400 @@
+#include "jemalloc/internal/jemalloc_preamble.h"
+#include "jemalloc/internal/jemalloc_internal_includes.h"
+
+#include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/purge_pool.h"
+
+JEMALLOC_DIAGNOSTIC_DISABLE_SPURIOUS
+
+/******************************************************************************/
+/* Data. */
+
+unsigned opt_purge_threads = 0;
+size_t   opt_purge_budget = 0;
+
+#ifndef JEMALLOC_BACKGROUND_THREAD
+
+bool
+purge_pool_boot(tsd_t *tsd) {
+	return false;
+}
+
+bool
+purge_pool_submit(tsdn_t *tsdn, hpa_shard_t *shard, hpa_purge_item_t *items,
+    size_t nitems, size_t ndirty) {
+	return true;
+}
+
+void
+purge_pool_drain(tsdn_t *tsdn, hpa_shard_t *shard) {}
+
+uint64_t
+purge_pool_njobs_get(void) {
+	return 0;
+}
+
+void
+purge_pool_prefork0(tsdn_t *tsdn) {}
+
+void
+purge_pool_prefork1(tsdn_t *tsdn) {}
+
+void
+purge_pool_postfork_parent(tsdn_t *tsdn) {}
+
+void
+purge_pool_postfork_child(tsdn_t *tsdn) {}
+
+#else
+
+typedef enum {
+	purge_pool_job_free,
+	purge_pool_job_queued,
+	purge_pool_job_running
+} purge_pool_job_state_t;
+
+typedef struct purge_pool_job_s purge_pool_job_t;
+struct purge_pool_job_s {
+	purge_pool_job_state_t state;
+	/* Submission order; workers take the oldest queued job first. */
+	uint64_t         seq;
+	hpa_shard_t     *shard;
+	size_t           nitems;
+	size_t           ndirty;
+	hpa_purge_item_t items[HPA_PURGE_BATCH_MAX];
+};
+
+/* Whether submissions are accepted; false until boot and in forked children. */
+static atomic_b_t purge_pool_running = ATOMIC_INIT(false);
+
+/* Everything below is protected by purge_pool_mtx. */
+static malloc_mutex_t purge_pool_mtx;
+/* Signaled when a job is queued. */
+static pthread_cond_t purge_pool_cond;
+/* Broadcast when a job completes. */
+static pthread_cond_t   purge_pool_done_cond;
+static bool             purge_pool_forking;
+static uint64_t         purge_pool_seq;
+static uint64_t         purge_pool_njobs;
+static unsigned         purge_pool_nrunning;
+static nstime_t         purge_pool_tick_start;
+static size_t           purge_pool_tick_bytes;
+static purge_pool_job_t purge_pool_jobs[PURGE_POOL_NJOBS];
+
+static void
+purge_pool_now(nstime_t *now) {
+	/* Specific clock required by timedwait. */
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	nstime_init2(now, tv.tv_sec, tv.tv_usec * 1000);
+}
+
+static void
+purge_pool_cond_wait(
+    tsdn_t *tsdn, pthread_cond_t *cond, const nstime_t *deadline) {
+	/*
+	 * pthread_cond_wait drops and re-acquires the mutex internally, w/o
+	 * going through our wrapper.  Update the locked state explicitly, and
+	 * the witness too, since other threads take the mutex while we wait.
+	 */
+	witness_unlock(tsdn_witness_tsdp_get(tsdn), &purge_pool_mtx.witness);
+	atomic_store_b(&purge_pool_mtx.locked, false, ATOMIC_RELAXED);
+	if (deadline == NULL) {
+		pthread_cond_wait(cond, &purge_pool_mtx.lock);
+	} else {
+		struct timespec ts;
+		ts.tv_sec = (time_t)nstime_sec(deadline);
+		ts.tv_nsec = (long)nstime_nsec(deadline);
+		pthread_cond_timedwait(cond, &purge_pool_mtx.lock, &ts);
+	}
+	atomic_store_b(&purge_pool_mtx.locked, true, ATOMIC_RELAXED);
+	witness_lock(tsdn_witness_tsdp_get(tsdn), &purge_pool_mtx.witness);
+}
+
+/* Returns the oldest queued job, restricted to shard unless it is NULL. */
+static purge_pool_job_t *
+purge_pool_job_oldest(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_assert_owner(tsdn, &purge_pool_mtx);
+	purge_pool_job_t *oldest = NULL;
+	for (unsigned i = 0; i < PURGE_POOL_NJOBS; i++) {
+		purge_pool_job_t *job = &purge_pool_jobs[i];
+		if (job->state != purge_pool_job_queued
+		    || (shard != NULL && job->shard != shard)) {
+			continue;
+		}
+		if (oldest == NULL || job->seq < oldest->seq) {
+			oldest = job;
+		}
+	}
+	return oldest;
+}
+
+static bool
+purge_pool_shard_running(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_assert_owner(tsdn, &purge_pool_mtx);
+	for (unsigned i = 0; i < PURGE_POOL_NJOBS; i++) {
+		purge_pool_job_t *job = &purge_pool_jobs[i];
+		if (job->state == purge_pool_job_running
+		    && (shard == NULL || job->shard == shard)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Purges a job claimed under purge_pool_mtx, then releases its slot.  Called
+ * and returns with purge_pool_mtx held, but drops it across the purge.
+ */
+static void
+purge_pool_job_run(tsdn_t *tsdn, purge_pool_job_t *job) {
+	malloc_mutex_assert_owner(tsdn, &purge_pool_mtx);
+	assert(job->state == purge_pool_job_queued);
+	job->state = purge_pool_job_running;
+	purge_pool_nrunning++;
+	malloc_mutex_unlock(tsdn, &purge_pool_mtx);
+
+	hpa_shard_t *shard = job->shard;
+	hpa_purge_batch(&shard->central->hooks, job->items, job->nitems);
+	malloc_mutex_lock(tsdn, &shard->mtx);
+	hpa_purge_batch_finish(tsdn, shard, job->items, job->nitems,
+	    job->ndirty);
+	malloc_mutex_unlock(tsdn, &shard->mtx);
+
+	malloc_mutex_lock(tsdn, &purge_pool_mtx);
+	job->state = purge_pool_job_free;
+	job->shard = NULL;
+	purge_pool_nrunning--;
+	purge_pool_njobs++;
+	pthread_cond_broadcast(&purge_pool_done_cond);
+}
+
+/*
+ * Charges a job against the current tick's budget.  Returns true, with
+ * *deadline set to the end of the tick, if the job has to wait for the next
+ * one.  At least one job is let through per tick, however large.
+ */
+static bool
+purge_pool_budget_charge(
+    tsdn_t *tsdn, purge_pool_job_t *job, nstime_t *deadline) {
+	malloc_mutex_assert_owner(tsdn, &purge_pool_mtx);
+	if (opt_purge_budget == 0) {
+		return false;
+	}
+	nstime_t now;
+	purge_pool_now(&now);
+	nstime_copy(deadline, &purge_pool_tick_start);
+	nstime_iadd(deadline, PURGE_POOL_TICK_NS);
+	if (nstime_compare(&now, deadline) >= 0
+	    || nstime_compare(&now, &purge_pool_tick_start) < 0) {
+		nstime_copy(&purge_pool_tick_start, &now);
+		nstime_copy(deadline, &now);
+		nstime_iadd(deadline, PURGE_POOL_TICK_NS);
+		purge_pool_tick_bytes = 0;
+	}
+	size_t nbytes = job->ndirty << LG_PAGE;
+	size_t left = opt_purge_budget - purge_pool_tick_bytes;
+	if (nbytes > left) {
+		if (purge_pool_tick_bytes != 0) {
+			return true;
+		}
+		nbytes = left;
+	}
+	purge_pool_tick_bytes += nbytes;
+	return false;
+}
+
+static void *
+purge_pool_entry(void *arg) {
+#	ifdef JEMALLOC_HAVE_PTHREAD_SETNAME_NP
+	pthread_setname_np(pthread_self(), "jemalloc_purge");
+#	elif defined(JEMALLOC_HAVE_PTHREAD_SET_NAME_NP)
+	pthread_set_name_np(pthread_self(), "jemalloc_purge");
+#	endif
+	/* Internal tsd, so that purging never triggers arena creation. */
+	tsdn_t *tsdn = tsd_tsdn(tsd_internal_fetch());
+
+	malloc_mutex_lock(tsdn, &purge_pool_mtx);
+	while (true) {
+		purge_pool_job_t *job = purge_pool_job_oldest(tsdn, NULL);
+		if (job == NULL) {
+			purge_pool_cond_wait(tsdn, &purge_pool_cond, NULL);
+			continue;
+		}
+		nstime_t deadline;
+		if (purge_pool_budget_charge(tsdn, job, &deadline)) {
+			purge_pool_cond_wait(tsdn, &purge_pool_cond, &deadline);
+			continue;
+		}
+		purge_pool_job_run(tsdn, job);
+	}
+	not_reached();
+	return NULL;
+}
+
+bool
+purge_pool_boot(tsd_t *tsd) {
+	/* Only HPA purging is offloaded. */
+	if (opt_purge_threads == 0 || !opt_hpa) {
+		return false;
+	}
+	if (malloc_mutex_init(&purge_pool_mtx, "purge_pool",
+	        WITNESS_RANK_PURGE_POOL, malloc_mutex_rank_exclusive)
+	    || pthread_cond_init(&purge_pool_cond, NULL) != 0
+	    || pthread_cond_init(&purge_pool_done_cond, NULL) != 0) {
+		return true;
+	}
+	purge_pool_forking = false;
+	purge_pool_seq = 0;
+	purge_pool_njobs = 0;
+	purge_pool_nrunning = 0;
+	nstime_init_zero(&purge_pool_tick_start);
+	purge_pool_tick_bytes = 0;
+	for (unsigned i = 0; i < PURGE_POOL_NJOBS; i++) {
+		purge_pool_jobs[i].state = purge_pool_job_free;
+		purge_pool_jobs[i].shard = NULL;
+	}
+
+	/* Sets up the pthread_create wrapper, as for background threads. */
+	background_thread_ctl_init(tsd_tsdn(tsd));
+	unsigned ncreated = 0;
+	for (unsigned i = 0; i < opt_purge_threads; i++) {
+		pthread_t thread;
+		pre_reentrancy(tsd, NULL);
+		int err = background_thread_create_signals_masked(
+		    &thread, NULL, purge_pool_entry, NULL);
+		post_reentrancy(tsd);
+		if (err != 0) {
+			malloc_printf(
+			    "<jemalloc>: purge thread creation failed (%d)\n",
+			    err);
+			if (opt_abort) {
+				abort();
+			}
+			break;
+		}
+		ncreated++;
+	}
+	atomic_store_b(&purge_pool_running, ncreated > 0, ATOMIC_RELEASE);
+	return false;
+}
+
+bool
+purge_pool_submit(tsdn_t *tsdn, hpa_shard_t *shard, hpa_purge_item_t *items,
+    size_t nitems, size_t ndirty) {
+	malloc_mutex_assert_owner(tsdn, &shard->mtx);
+	assert(nitems > 0 && nitems <= HPA_PURGE_BATCH_MAX);
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return true;
+	}
+	malloc_mutex_lock(tsdn, &purge_pool_mtx);
+	purge_pool_job_t *job = NULL;
+	if (!purge_pool_forking) {
+		for (unsigned i = 0; i < PURGE_POOL_NJOBS; i++) {
+			if (purge_pool_jobs[i].state == purge_pool_job_free) {
+				job = &purge_pool_jobs[i];
+				break;
+			}
+		}
+	}
+	if (job == NULL) {
+		malloc_mutex_unlock(tsdn, &purge_pool_mtx);
+		return true;
+	}
+	job->state = purge_pool_job_queued;
+	job->seq = purge_pool_seq++;
+	job->shard = shard;
+	job->nitems = nitems;
+	job->ndirty = ndirty;
+	memcpy(job->items, items, nitems * sizeof(hpa_purge_item_t));
+	pthread_cond_signal(&purge_pool_cond);
+	malloc_mutex_unlock(tsdn, &purge_pool_mtx);
+	return false;
+}
+
+/* Completes the jobs of shard, or of every shard if it is NULL. */
+static void
+purge_pool_drain_locked(tsdn_t *tsdn, hpa_shard_t *shard) {
+	malloc_mutex_assert_owner(tsdn, &purge_pool_mtx);
+	while (true) {
+		/* Rather than waiting on the workers, do queued jobs here. */
+		purge_pool_job_t *job = purge_pool_job_oldest(tsdn, shard);
+		if (job != NULL) {
+			purge_pool_job_run(tsdn, job);
+		} else if (purge_pool_shard_running(tsdn, shard)) {
+			purge_pool_cond_wait(tsdn, &purge_pool_done_cond, NULL);
+		} else {
+			break;
+		}
+	}
+}
+
+void
+purge_pool_drain(tsdn_t *tsdn, hpa_shard_t *shard) {
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return;
+	}
+	malloc_mutex_assert_not_owner(tsdn, &shard->mtx);
+	malloc_mutex_lock(tsdn, &purge_pool_mtx);
+	purge_pool_drain_locked(tsdn, shard);
+	malloc_mutex_unlock(tsdn, &purge_pool_mtx);
+}
+
+uint64_t
+purge_pool_njobs_get(void) {
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	tsdn_t  *tsdn = tsdn_fetch();
+	malloc_mutex_lock(tsdn, &purge_pool_mtx);
+	uint64_t njobs = purge_pool_njobs;
+	malloc_mutex_unlock(tsdn, &purge_pool_mtx);
+	return njobs;
+}
+
+void
+purge_pool_prefork0(tsdn_t *tsdn) {
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return;
+	}
+	/*
+	 * The workers don't survive into the child, so nothing may be left in
+	 * flight: new batches are purged inline from here on, and the ones
+	 * already handed over are completed now.
+	 */
+	malloc_mutex_lock(tsdn, &purge_pool_mtx);
+	purge_pool_forking = true;
+	purge_pool_drain_locked(tsdn, NULL);
+	assert(purge_pool_nrunning == 0);
+	malloc_mutex_unlock(tsdn, &purge_pool_mtx);
+}
+
+void
+purge_pool_prefork1(tsdn_t *tsdn) {
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return;
+	}
+	malloc_mutex_prefork(tsdn, &purge_pool_mtx);
+}
+
+void
+purge_pool_postfork_parent(tsdn_t *tsdn) {
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return;
+	}
+	purge_pool_forking = false;
+	malloc_mutex_postfork_parent(tsdn, &purge_pool_mtx);
+}
+
+void
+purge_pool_postfork_child(tsdn_t *tsdn) {
+	if (!atomic_load_b(&purge_pool_running, ATOMIC_ACQUIRE)) {
+		return;
+	}
+	/* The child has no workers; it purges inline from now on. */
+	atomic_store_b(&purge_pool_running, false, ATOMIC_RELEASE);
+	purge_pool_forking = false;
+	malloc_mutex_postfork_child(tsdn, &purge_pool_mtx);
+}
+
+#endif /* JEMALLOC_BACKGROUND_THREAD */
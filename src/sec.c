@@ -5,9 +5,14 @@
 #include "jemalloc/internal/jemalloc_probe.h"
 
 static bool
-sec_bin_init(sec_bin_t *bin) {
+sec_bin_init(sec_bin_t *bin, size_t bytes_max) {
 	bin->bytes_cur = 0;
 	sec_bin_stats_init(&bin->stats);
+	bin->bytes_max = bytes_max;
+	bin->bytes_lowwater = 0;
+	bin->epoch_nops = 0;
+	bin->epoch_nmisses = 0;
+	bin->epoch_nflushes = 0;
 	edata_list_active_init(&bin->freelist);
 	bool err = malloc_mutex_init(&bin->mtx, "sec_bin", WITNESS_RANK_SEC_BIN,
 	    malloc_mutex_rank_exclusive);
@@ -25,6 +30,17 @@ sec_init(tsdn_t *tsdn, sec_t *sec, base_t *base, const sec_opts_t *opts) {
 		return false;
 	}
 	assert(opts->max_alloc >= PAGE);
+	if (opts->percpu) {
+		if (have_percpu_arena) {
+			assert(ncpus > 0);
+			sec->opts.nshards = ncpus < SEC_NSHARDS_MAX
+			    ? ncpus
+			    : SEC_NSHARDS_MAX;
+		} else {
+			sec->opts.percpu = false;
+		}
+	}
+	assert(sec->opts.nshards <= SEC_NSHARDS_MAX);
 
 	/*
 	 * Same as tcache, sec do not cache allocs/dallocs larger than
@@ -36,25 +52,37 @@ sec_init(tsdn_t *tsdn, sec_t *sec, base_t *base, const sec_opts_t *opts) {
 	size_t   max_alloc = PAGE_FLOOR(opts->max_alloc);
 	pszind_t npsizes = sz_psz2ind(max_alloc) + 1;
 
-	size_t ntotal_bins = opts->nshards * (size_t)npsizes;
+	size_t ntotal_bins = sec->opts.nshards * (size_t)npsizes;
 	size_t sz_bins = sizeof(sec_bin_t) * ntotal_bins;
 	void  *dynalloc = base_alloc(tsdn, base, sz_bins, CACHELINE);
 	if (dynalloc == NULL) {
 		return true;
 	}
 	sec->bins = (sec_bin_t *)dynalloc;
+	/*
+	 * Adaptive bins start out with half their share of the budget; the
+	 * other half is left for the bins that turn out to need it.
+	 */
+	size_t bin_bytes_max = opts->adaptive ? opts->max_bytes / 2
+	                                      : opts->max_bytes;
 	for (pszind_t j = 0; j < ntotal_bins; j++) {
-		if (sec_bin_init(&sec->bins[j])) {
+		if (sec_bin_init(&sec->bins[j], bin_bytes_max)) {
 			return true;
 		}
 	}
 	sec->npsizes = npsizes;
+	atomic_store_zu(&sec->bytes_unassigned,
+	    opts->adaptive ? ntotal_bins * (opts->max_bytes - bin_bytes_max) : 0,
+	    ATOMIC_RELAXED);
 
 	return false;
 }
 
 static uint8_t
 sec_shard_pick(tsdn_t *tsdn, sec_t *sec) {
+	if (sec->opts.percpu) {
+		return (uint8_t)((unsigned)malloc_getcpu() % sec->opts.nshards);
+	}
 	/*
 	 * Eventually, we should implement affinity, tracking source shard using
 	 * the edata_t's newly freed up fields.  For now, just randomly
@@ -90,6 +118,25 @@ sec_bin_pick(sec_t *sec, uint8_t shard, pszind_t pszind) {
 	return &sec->bins[ind];
 }
 
+/*
+ * The bin to use when we go straight to a single shard: the only one, or the
+ * one of the current CPU.
+ */
+static sec_bin_t *
+sec_bin_pick_direct(tsdn_t *tsdn, sec_t *sec, pszind_t pszind) {
+	uint8_t shard = sec->opts.percpu ? sec_shard_pick(tsdn, sec) : 0;
+	return sec_bin_pick(sec, shard, pszind);
+}
+
+/* Blocking lock that counts the times the bin was already held. */
+static void
+sec_bin_lock(tsdn_t *tsdn, sec_bin_t *bin) {
+	if (malloc_mutex_trylock(tsdn, &bin->mtx)) {
+		malloc_mutex_lock(tsdn, &bin->mtx);
+		bin->stats.nlock_contended++;
+	}
+}
+
 void
 sec_calc_nallocs_for_size(
     sec_t *sec, size_t size, size_t *min_nallocs_ret, size_t *max_nallocs_ret) {
@@ -123,6 +170,7 @@ static edata_t *
 sec_bin_alloc_locked(tsdn_t *tsdn, sec_t *sec, sec_bin_t *bin, size_t size) {
 	malloc_mutex_assert_owner(tsdn, &bin->mtx);
 
+	bin->epoch_nops++;
 	edata_t *edata = edata_list_active_first(&bin->freelist);
 	if (edata != NULL) {
 		assert(!edata_list_active_empty(&bin->freelist));
@@ -131,10 +179,21 @@ sec_bin_alloc_locked(tsdn_t *tsdn, sec_t *sec, sec_bin_t *bin, size_t size) {
 		assert(sz <= bin->bytes_cur && sz > 0);
 		bin->bytes_cur -= sz;
 		bin->stats.nhits++;
+		if (bin->bytes_cur < bin->bytes_lowwater) {
+			bin->bytes_lowwater = bin->bytes_cur;
+		}
 	}
 	return edata;
 }
 
+static void
+sec_bin_miss_locked(tsdn_t *tsdn, sec_bin_t *bin) {
+	malloc_mutex_assert_owner(tsdn, &bin->mtx);
+	bin->stats.nmisses++;
+	bin->epoch_nmisses++;
+	bin->bytes_lowwater = 0;
+}
+
 static edata_t *
 sec_multishard_trylock_alloc(
     tsdn_t *tsdn, sec_t *sec, size_t size, pszind_t pszind) {
@@ -166,11 +225,11 @@ sec_multishard_trylock_alloc(
 	 */
 	assert(cur_shard == sec_shard_pick(tsdn, sec));
 	bin = sec_bin_pick(sec, cur_shard, pszind);
-	malloc_mutex_lock(tsdn, &bin->mtx);
+	sec_bin_lock(tsdn, bin);
 	edata_t *edata = sec_bin_alloc_locked(tsdn, sec, bin, size);
 	if (edata == NULL) {
 		/* Only now we know it is a miss. */
-		bin->stats.nmisses++;
+		sec_bin_miss_locked(tsdn, bin);
 	}
 	malloc_mutex_unlock(tsdn, &bin->mtx);
 	JE_USDT(sec_alloc, 5, sec, bin, edata, size, /* frequent_reuse */ 1);
@@ -187,15 +246,16 @@ sec_alloc(tsdn_t *tsdn, sec_t *sec, size_t size) {
 	assert(pszind < sec->npsizes);
 
 	/*
-	 * If there's only one shard, skip the trylock optimization and
-	 * go straight to the blocking lock.
+	 * If there's only one shard, or shards are per-CPU (so that the current
+	 * one is rarely contended), skip the trylock optimization and go
+	 * straight to the blocking lock.
 	 */
-	if (sec->opts.nshards == 1) {
-		sec_bin_t *bin = sec_bin_pick(sec, /* shard */ 0, pszind);
-		malloc_mutex_lock(tsdn, &bin->mtx);
+	if (sec->opts.nshards == 1 || sec->opts.percpu) {
+		sec_bin_t *bin = sec_bin_pick_direct(tsdn, sec, pszind);
+		sec_bin_lock(tsdn, bin);
 		edata_t *edata = sec_bin_alloc_locked(tsdn, sec, bin, size);
 		if (edata == NULL) {
-			bin->stats.nmisses++;
+			sec_bin_miss_locked(tsdn, bin);
 		}
 		malloc_mutex_unlock(tsdn, &bin->mtx);
 		JE_USDT(sec_alloc, 5, sec, bin, edata, size,
@@ -205,6 +265,50 @@ sec_alloc(tsdn_t *tsdn, sec_t *sec, size_t size) {
 	return sec_multishard_trylock_alloc(tsdn, sec, size, pszind);
 }
 
+/* Takes up to want bytes from the unassigned budget; returns how many. */
+static size_t
+sec_budget_take(sec_t *sec, size_t want) {
+	size_t avail = atomic_load_zu(&sec->bytes_unassigned, ATOMIC_RELAXED);
+	size_t got;
+	do {
+		got = min_zu(want, avail);
+		if (got == 0) {
+			return 0;
+		}
+	} while (!atomic_compare_exchange_weak_zu(&sec->bytes_unassigned,
+	    &avail, avail - got, ATOMIC_RELAXED, ATOMIC_RELAXED));
+	return got;
+}
+
+/*
+ * Resizes an adaptive bin at the end of its epoch.  Misses on extents we had
+ * to flush earlier mean the bin's reuse distance exceeds its capacity, so it
+ * grows by half, as far as the budget allows.  A bin that never ran dry gives
+ * back half of the bytes that sat unused the whole epoch, keeping room for at
+ * least one extent.
+ */
+static void
+sec_bin_adapt_locked(tsdn_t *tsdn, sec_t *sec, sec_bin_t *bin, size_t size) {
+	malloc_mutex_assert_owner(tsdn, &bin->mtx);
+	if (!sec->opts.adaptive || bin->epoch_nops < SEC_ADAPT_EPOCH_NOPS) {
+		return;
+	}
+	if (bin->epoch_nmisses > 0 && bin->epoch_nflushes > 0) {
+		bin->bytes_max += sec_budget_take(
+		    sec, max_zu(bin->bytes_max / 2, size));
+	} else if (bin->epoch_nmisses == 0 && bin->bytes_max > size) {
+		size_t give = min_zu(
+		    bin->bytes_lowwater / 2, bin->bytes_max - size);
+		bin->bytes_max -= give;
+		atomic_fetch_add_zu(&sec->bytes_unassigned, give,
+		    ATOMIC_RELAXED);
+	}
+	bin->bytes_lowwater = bin->bytes_cur;
+	bin->epoch_nops = 0;
+	bin->epoch_nmisses = 0;
+	bin->epoch_nflushes = 0;
+}
+
 static void
 sec_bin_dalloc_locked(tsdn_t *tsdn, sec_t *sec, sec_bin_t *bin, size_t size,
     edata_list_active_t *dalloc_list) {
@@ -219,13 +323,16 @@ sec_bin_dalloc_locked(tsdn_t *tsdn, sec_t *sec, sec_bin_t *bin, size_t size,
 	/* Single extent can be returned to SEC */
 	assert(edata_list_active_empty(dalloc_list));
 
-	if (bin->bytes_cur <= sec->opts.max_bytes) {
+	bin->epoch_nops++;
+	sec_bin_adapt_locked(tsdn, sec, bin, size);
+	if (bin->bytes_cur <= bin->bytes_max) {
 		bin->stats.ndalloc_noflush++;
 		return;
 	}
 	bin->stats.ndalloc_flush++;
-	/* we want to flush 1/4 of max_bytes */
-	size_t bytes_target = sec->opts.max_bytes - (sec->opts.max_bytes >> 2);
+	bin->epoch_nflushes++;
+	/* we want to flush 1/4 of bytes_max */
+	size_t bytes_target = bin->bytes_max - (bin->bytes_max >> 2);
 	while (bin->bytes_cur > bytes_target
 	    && !edata_list_active_empty(&bin->freelist)) {
 		edata_t *cur = edata_list_active_last(&bin->freelist);
@@ -260,7 +367,7 @@ sec_multishard_trylock_dalloc(tsdn_t *tsdn, sec_t *sec, size_t size,
 	/* No bin had alloc or had the extent */
 	assert(cur_shard == sec_shard_pick(tsdn, sec));
 	sec_bin_t *bin = sec_bin_pick(sec, cur_shard, pszind);
-	malloc_mutex_lock(tsdn, &bin->mtx);
+	sec_bin_lock(tsdn, bin);
 	sec_bin_dalloc_locked(tsdn, sec, bin, size, dalloc_list);
 	malloc_mutex_unlock(tsdn, &bin->mtx);
 }
@@ -279,12 +386,12 @@ sec_dalloc(tsdn_t *tsdn, sec_t *sec, edata_list_active_t *dalloc_list) {
 	assert(pszind < sec->npsizes);
 
 	/*
-         * If there's only one shard, skip the trylock optimization and
-	 * go straight to the blocking lock.
+         * If there's only one shard, or shards are per-CPU, skip the trylock
+	 * optimization and go straight to the blocking lock.
 	 */
-	if (sec->opts.nshards == 1) {
-		sec_bin_t *bin = sec_bin_pick(sec, /* shard */ 0, pszind);
-		malloc_mutex_lock(tsdn, &bin->mtx);
+	if (sec->opts.nshards == 1 || sec->opts.percpu) {
+		sec_bin_t *bin = sec_bin_pick_direct(tsdn, sec, pszind);
+		sec_bin_lock(tsdn, bin);
 		sec_bin_dalloc_locked(tsdn, sec, bin, size, dalloc_list);
 		malloc_mutex_unlock(tsdn, &bin->mtx);
 		return;
@@ -304,9 +411,9 @@ sec_fill(tsdn_t *tsdn, sec_t *sec, size_t size, edata_list_active_t *result,
 
 	sec_bin_t *bin = sec_bin_pick(sec, sec_shard_pick(tsdn, sec), pszind);
 	malloc_mutex_assert_not_owner(tsdn, &bin->mtx);
-	malloc_mutex_lock(tsdn, &bin->mtx);
+	sec_bin_lock(tsdn, bin);
 	size_t new_cached_bytes = nallocs * size;
-	if (bin->bytes_cur + new_cached_bytes <= sec->opts.max_bytes) {
+	if (bin->bytes_cur + new_cached_bytes <= bin->bytes_max) {
 		assert(!edata_list_active_empty(result));
 		edata_list_active_concat(&bin->freelist, result);
 		bin->bytes_cur += new_cached_bytes;
@@ -316,7 +423,7 @@ sec_fill(tsdn_t *tsdn, sec_t *sec, size_t size, edata_list_active_t *result,
 		 * going above max.
 		 */
 		bin->stats.noverfills++;
-		while (bin->bytes_cur + size <= sec->opts.max_bytes) {
+		while (bin->bytes_cur + size <= bin->bytes_max) {
 			edata_t *edata = edata_list_active_first(result);
 			if (edata == NULL) {
 				break;
@@ -340,6 +447,7 @@ sec_flush(tsdn_t *tsdn, sec_t *sec, edata_list_active_t *to_flush) {
 		sec_bin_t *bin = &sec->bins[i];
 		malloc_mutex_lock(tsdn, &bin->mtx);
 		bin->bytes_cur = 0;
+		bin->bytes_lowwater = 0;
 		edata_list_active_concat(to_flush, &bin->freelist);
 		malloc_mutex_unlock(tsdn, &bin->mtx);
 	}
@@ -357,6 +465,8 @@ sec_stats_merge(tsdn_t *tsdn, sec_t *sec, sec_stats_t *stats) {
 		malloc_mutex_lock(tsdn, &bin->mtx);
 		sum += bin->bytes_cur;
 		sec_bin_stats_accum(&stats->total, &bin->stats);
+		sec_bin_stats_accum(
+		    &stats->shards[i / sec->npsizes], &bin->stats);
 		malloc_mutex_unlock(tsdn, &bin->mtx);
 	}
 	stats->bytes += sum;
@@ -344,6 +344,7 @@ stats_arena_bins_print(
 	COL_HDR(row, curregs, NULL, right, 13, size)
 	COL_HDR(row, curslabs, NULL, right, 13, size)
 	COL_HDR(row, nonfull_slabs, NULL, right, 15, size)
+	COL_HDR(row, curslabs_huge, NULL, right, 15, size)
 	COL_HDR(row, regs, NULL, right, 5, unsigned)
 	COL_HDR(row, pgs, NULL, right, 4, size)
 	/* To buffer a right- and left-justified column. */
@@ -400,10 +401,10 @@ stats_arena_bins_print(
 		uint64_t     nslabs;
 		size_t       reg_size, slab_size, curregs;
 		size_t       curslabs;
-		size_t       nonfull_slabs;
+		size_t       nonfull_slabs, curslabs_huge, cur_slab_size;
 		uint32_t     nregs, nshards;
 		uint64_t     nmalloc, ndalloc, nrequests, nfills, nflushes;
-		uint64_t     nreslabs;
+		uint64_t     nreslabs, nremote_frees, nslab_grows, nslab_shrinks;
 		prof_stats_t prof_live;
 		prof_stats_t prof_accum;
 
@@ -451,6 +452,16 @@ stats_arena_bins_print(
 		CTL_LEAF(stats_arenas_mib, 5, "curslabs", &curslabs, size_t);
 		CTL_LEAF(stats_arenas_mib, 5, "nonfull_slabs", &nonfull_slabs,
 		    size_t);
+		CTL_LEAF(stats_arenas_mib, 5, "curslabs_huge", &curslabs_huge,
+		    size_t);
+		CTL_LEAF(stats_arenas_mib, 5, "nremote_frees", &nremote_frees,
+		    uint64_t);
+		CTL_LEAF(stats_arenas_mib, 5, "slab_size", &cur_slab_size,
+		    size_t);
+		CTL_LEAF(stats_arenas_mib, 5, "nslab_grows", &nslab_grows,
+		    uint64_t);
+		CTL_LEAF(stats_arenas_mib, 5, "nslab_shrinks", &nslab_shrinks,
+		    uint64_t);
 
 		if (mutex) {
 			mutex_stats_read_arena_bin(stats_arenas_mib, 5,
@@ -486,6 +497,16 @@ stats_arena_bins_print(
 		    emitter, "curslabs", emitter_type_size, &curslabs);
 		emitter_json_kv(emitter, "nonfull_slabs", emitter_type_size,
 		    &nonfull_slabs);
+		emitter_json_kv(emitter, "curslabs_huge", emitter_type_size,
+		    &curslabs_huge);
+		emitter_json_kv(emitter, "nremote_frees", emitter_type_uint64,
+		    &nremote_frees);
+		emitter_json_kv(emitter, "slab_size", emitter_type_size,
+		    &cur_slab_size);
+		emitter_json_kv(emitter, "nslab_grows", emitter_type_uint64,
+		    &nslab_grows);
+		emitter_json_kv(emitter, "nslab_shrinks", emitter_type_uint64,
+		    &nslab_shrinks);
 		if (mutex) {
 			emitter_json_object_kv_begin(emitter, "mutex");
 			mutex_stats_emit(
@@ -534,6 +555,7 @@ stats_arena_bins_print(
 		col_curregs.size_val = curregs;
 		col_curslabs.size_val = curslabs;
 		col_nonfull_slabs.size_val = nonfull_slabs;
+		col_curslabs_huge.size_val = curslabs_huge;
 		col_regs.unsigned_val = nregs;
 		col_pgs.size_val = slab_size / page;
 		col_util.str_val = util;
@@ -809,6 +831,7 @@ stats_arena_hpa_shard_sec_print(emitter_t *emitter, unsigned i) {
 	size_t sec_dalloc_flush;
 	size_t sec_dalloc_noflush;
 	size_t sec_overfills;
+	size_t sec_lock_contended;
 	CTL_M2_GET("stats.arenas.0.hpa_sec_bytes", i, &sec_bytes, size_t);
 	emitter_kv(emitter, "sec_bytes", "Bytes in small extent cache",
 	    emitter_type_size, &sec_bytes);
@@ -833,6 +856,56 @@ stats_arena_hpa_shard_sec_print(emitter_t *emitter, unsigned i) {
 	emitter_kv(emitter, "sec_overfills",
 	    "sec_fill calls that went over max_bytes", emitter_type_size,
 	    &sec_overfills);
+	CTL_M2_GET("stats.arenas.0.hpa_sec_lock_contended", i,
+	    &sec_lock_contended, size_t);
+	emitter_kv(emitter, "sec_lock_contended",
+	    "Contended bin locks in small extent cache", emitter_type_size,
+	    &sec_lock_contended);
+
+	/* Per-shard stats, for the shards that saw any traffic. */
+	emitter_row_t header_row;
+	emitter_row_init(&header_row);
+	emitter_row_t row;
+	emitter_row_init(&row);
+
+	COL_HDR(row, shard, NULL, right, 7, unsigned)
+	COL_HDR(row, hits, NULL, right, 16, size)
+	COL_HDR(row, misses, NULL, right, 16, size)
+	COL_HDR(row, lock_contended, NULL, right, 16, size)
+
+	size_t stats_arenas_mib[CTL_MAX_DEPTH];
+	CTL_LEAF_PREPARE(stats_arenas_mib, 0, "stats.arenas");
+	stats_arenas_mib[2] = i;
+	CTL_LEAF_PREPARE(stats_arenas_mib, 3, "hpa_sec_shards");
+
+	emitter_table_printf(emitter, "Small extent cache shards:\n");
+	emitter_table_row(emitter, &header_row);
+	emitter_json_array_kv_begin(emitter, "sec_shards");
+	for (unsigned j = 0; j < SEC_NSHARDS_MAX; j++) {
+		size_t hits, misses, lock_contended;
+		stats_arenas_mib[4] = j;
+		CTL_LEAF(stats_arenas_mib, 5, "hits", &hits, size_t);
+		CTL_LEAF(stats_arenas_mib, 5, "misses", &misses, size_t);
+		CTL_LEAF(stats_arenas_mib, 5, "lock_contended",
+		    &lock_contended, size_t);
+		if (hits == 0 && misses == 0 && lock_contended == 0) {
+			continue;
+		}
+		col_shard.unsigned_val = j;
+		col_hits.size_val = hits;
+		col_misses.size_val = misses;
+		col_lock_contended.size_val = lock_contended;
+		emitter_table_row(emitter, &row);
+
+		emitter_json_object_begin(emitter);
+		emitter_json_kv(emitter, "shard", emitter_type_unsigned, &j);
+		emitter_json_kv(emitter, "hits", emitter_type_size, &hits);
+		emitter_json_kv(emitter, "misses", emitter_type_size, &misses);
+		emitter_json_kv(emitter, "lock_contended", emitter_type_size,
+		    &lock_contended);
+		emitter_json_object_end(emitter);
+	}
+	emitter_json_array_end(emitter); /* End "sec_shards" */
 }
 
 static void
@@ -856,6 +929,11 @@ stats_arena_hpa_shard_counters_print(
 	uint64_t nhugifies;
 	uint64_t nhugify_failures;
 	uint64_t ndehugifies;
+	uint64_t ncollapses;
+	uint64_t ncollapse_failures;
+	uint64_t collapse_ns;
+	uint64_t collapse_max_ns;
+	uint64_t nrefaults;
 
 	CTL_M2_GET(
 	    "stats.arenas.0.hpa_shard.npageslabs", i, &npageslabs, size_t);
@@ -887,6 +965,16 @@ stats_arena_hpa_shard_counters_print(
 	    &nhugify_failures, uint64_t);
 	CTL_M2_GET(
 	    "stats.arenas.0.hpa_shard.ndehugifies", i, &ndehugifies, uint64_t);
+	CTL_M2_GET(
+	    "stats.arenas.0.hpa_shard.ncollapses", i, &ncollapses, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.ncollapse_failures", i,
+	    &ncollapse_failures, uint64_t);
+	CTL_M2_GET(
+	    "stats.arenas.0.hpa_shard.collapse_ns", i, &collapse_ns, uint64_t);
+	CTL_M2_GET("stats.arenas.0.hpa_shard.collapse_max_ns", i,
+	    &collapse_max_ns, uint64_t);
+	CTL_M2_GET(
+	    "stats.arenas.0.hpa_shard.nrefaults", i, &nrefaults, uint64_t);
 
 	emitter_table_printf(emitter,
 	    "HPA shard stats:\n"
@@ -902,7 +990,11 @@ stats_arena_hpa_shard_counters_print(
 	    " / sec)\n"
 	    "  Hugify failures: %" FMTu64 " (%" FMTu64
 	    " / sec)\n"
-	    "  Dehugifies: %" FMTu64 " (%" FMTu64 " / sec)\n",
+	    "  Dehugifies: %" FMTu64 " (%" FMTu64
+	    " / sec)\n"
+	    "  Collapses: %" FMTu64 " (%" FMTu64 " failed, %" FMTu64
+	    " ns avg, %" FMTu64 " ns max)\n"
+	    "  Refaults: %" FMTu64 " (%" FMTu64 " / sec)\n",
 	    npageslabs, npageslabs_huge, npageslabs_nonhuge, nactive,
 	    nactive_huge, nactive_nonhuge, ndirty, ndirty_huge, ndirty_nonhuge,
 	    nretained_nonhuge, npurge_passes,
@@ -910,7 +1002,9 @@ stats_arena_hpa_shard_counters_print(
 	    rate_per_second(npurges, uptime), nhugifies,
 	    rate_per_second(nhugifies, uptime), nhugify_failures,
 	    rate_per_second(nhugify_failures, uptime), ndehugifies,
-	    rate_per_second(ndehugifies, uptime));
+	    rate_per_second(ndehugifies, uptime), ncollapses,
+	    ncollapse_failures, ncollapses == 0 ? 0 : collapse_ns / ncollapses,
+	    collapse_max_ns, nrefaults, rate_per_second(nrefaults, uptime));
 
 	emitter_json_kv(emitter, "npageslabs", emitter_type_size, &npageslabs);
 	emitter_json_kv(emitter, "nactive", emitter_type_size, &nactive);
@@ -924,6 +1018,16 @@ stats_arena_hpa_shard_counters_print(
 	    &nhugify_failures);
 	emitter_json_kv(
 	    emitter, "ndehugifies", emitter_type_uint64, &ndehugifies);
+	emitter_json_kv(
+	    emitter, "ncollapses", emitter_type_uint64, &ncollapses);
+	emitter_json_kv(emitter, "ncollapse_failures", emitter_type_uint64,
+	    &ncollapse_failures);
+	emitter_json_kv(
+	    emitter, "collapse_ns", emitter_type_uint64, &collapse_ns);
+	emitter_json_kv(
+	    emitter, "collapse_max_ns", emitter_type_uint64, &collapse_max_ns);
+	emitter_json_kv(
+	    emitter, "nrefaults", emitter_type_uint64, &nrefaults);
 
 	emitter_json_object_kv_begin(emitter, "slabs");
 	emitter_json_kv(emitter, "npageslabs_nonhuge", emitter_type_size,
@@ -1255,7 +1359,9 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	ssize_t     dirty_decay_ms, muzzy_decay_ms;
 	size_t      page, pactive, pdirty, pmuzzy, mapped, retained, pinned;
 	size_t      base, internal, resident, metadata_edata, metadata_rtree,
-	    metadata_thp, extent_avail;
+	    metadata_thp, extent_avail, zero_pool_bytes, bin_regions_bytes,
+	    bin_regions_dirty_bytes, huge_bins_dirty_bytes;
+	uint64_t zero_pool_hits, zero_pool_misses;
 	uint64_t dirty_npurge, dirty_nmadvise, dirty_purged;
 	uint64_t muzzy_npurge, muzzy_nmadvise, muzzy_purged;
 	size_t   small_allocated;
@@ -1264,7 +1370,7 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	size_t   large_allocated;
 	uint64_t large_nmalloc, large_ndalloc, large_nrequests, large_nfills,
 	    large_nflushes;
-	size_t   tcache_bytes, tcache_stashed_bytes, abandoned_vm;
+	size_t   tcache_bytes, tcache_stashed_bytes, abandoned_vm, cold_demoted;
 	uint64_t uptime;
 
 	CTL_GET("arenas.page", &page, size_t);
@@ -1564,9 +1670,22 @@ stats_arena_print(emitter_t *emitter, unsigned i, bool bins, bool large,
 	GET_AND_EMIT_MEM_STAT(tcache_stashed_bytes)
 	GET_AND_EMIT_MEM_STAT(resident)
 	GET_AND_EMIT_MEM_STAT(abandoned_vm)
+	GET_AND_EMIT_MEM_STAT(cold_demoted)
 	GET_AND_EMIT_MEM_STAT(extent_avail)
+	GET_AND_EMIT_MEM_STAT(zero_pool_bytes)
+	GET_AND_EMIT_MEM_STAT(bin_regions_bytes)
+	GET_AND_EMIT_MEM_STAT(bin_regions_dirty_bytes)
+	GET_AND_EMIT_MEM_STAT(huge_bins_dirty_bytes)
 #undef GET_AND_EMIT_MEM_STAT
 
+	CTL_M2_GET("stats.arenas.0.zero_pool_hits", i, &zero_pool_hits, uint64_t);
+	emitter_kv(emitter, "zero_pool_hits", "Total hits in zero pool",
+	    emitter_type_uint64, &zero_pool_hits);
+	CTL_M2_GET(
+	    "stats.arenas.0.zero_pool_misses", i, &zero_pool_misses, uint64_t);
+	emitter_kv(emitter, "zero_pool_misses", "Total misses in zero pool",
+	    emitter_type_uint64, &zero_pool_misses);
+
 	if (mutex) {
 		stats_arena_mutexes_print(emitter, i, uptime);
 	}
@@ -1729,12 +1848,21 @@ stats_general_print(emitter_t *emitter) {
 	OPT_WRITE_CHAR_P("dss")
 	OPT_WRITE_UNSIGNED("narenas")
 	OPT_WRITE_CHAR_P("percpu_arena")
+	OPT_WRITE_BOOL("percpu_cache")
+	OPT_WRITE_BOOL("pressure_purge")
+	OPT_WRITE_BOOL("numa")
 	OPT_WRITE_SIZE_T("oversize_threshold")
+	OPT_WRITE_SIZE_T("realloc_remap_threshold")
+	OPT_WRITE_SIZE_T("zero_pool_max")
 	OPT_WRITE_BOOL("hpa")
 	OPT_WRITE_SIZE_T("hpa_slab_max_alloc")
+	OPT_WRITE_SIZE_T("hpa_span_max_alloc")
+	OPT_WRITE_SIZE_T("hpa_resv_max_alloc")
 	OPT_WRITE_SIZE_T("hpa_hugification_threshold")
 	OPT_WRITE_UINT64("hpa_hugify_delay_ms")
 	OPT_WRITE_BOOL("hpa_hugify_sync")
+	OPT_WRITE_BOOL("hpa_purge_lru")
+	OPT_WRITE_UINT64("hpa_collapse_budget_us")
 	OPT_WRITE_UINT64("hpa_min_purge_interval_ms")
 	OPT_WRITE_SSIZE_T("experimental_hpa_max_purge_nhp")
 	if (je_mallctl("opt.hpa_dirty_mult", (void *)&u32v, &u32sz, NULL, 0)
@@ -1761,11 +1889,23 @@ stats_general_print(emitter_t *emitter) {
 	OPT_WRITE_SIZE_T("hpa_sec_nshards")
 	OPT_WRITE_SIZE_T("hpa_sec_max_alloc")
 	OPT_WRITE_SIZE_T("hpa_sec_max_bytes")
+	OPT_WRITE_BOOL("hpa_sec_percpu")
+	OPT_WRITE_BOOL("hpa_sec_adaptive")
+	OPT_WRITE_UNSIGNED("purge_threads")
+	OPT_WRITE_SIZE_T("purge_budget")
 	OPT_WRITE_BOOL("huge_arena_pac_thp")
 	OPT_WRITE_CHAR_P("metadata_thp")
 	OPT_WRITE_INT64("mutex_max_spin")
+	OPT_WRITE_BOOL("bin_regions")
+	OPT_WRITE_UNSIGNED("lg_bin_region")
+	OPT_WRITE_BOOL("bin_remote_free")
+	OPT_WRITE_SIZE_T("bin_remote_free_max")
+	OPT_WRITE_BOOL("slab_size_auto")
 	OPT_WRITE_BOOL_MUTABLE("background_thread", "background_thread")
 	OPT_WRITE_SSIZE_T_MUTABLE("dirty_decay_ms", "arenas.dirty_decay_ms")
+	OPT_WRITE_BOOL("dirty_decay_predictive")
+	OPT_WRITE_SSIZE_T("cold_age_ms")
+	OPT_WRITE_BOOL("cold_pageout")
 	OPT_WRITE_SSIZE_T_MUTABLE("muzzy_decay_ms", "arenas.muzzy_decay_ms")
 	OPT_WRITE_SIZE_T("lg_extent_max_active_fit")
 	OPT_WRITE_CHAR_P("junk")
@@ -1784,6 +1924,9 @@ stats_general_print(emitter_t *emitter) {
 	OPT_WRITE_SIZE_T("tcache_gc_delay_bytes")
 	OPT_WRITE_UNSIGNED("lg_tcache_flush_small_div")
 	OPT_WRITE_UNSIGNED("lg_tcache_flush_large_div")
+	OPT_WRITE_BOOL("tcache_adaptive")
+	OPT_WRITE_SIZE_T("tcache_adaptive_budget")
+	OPT_WRITE_SIZE_T("tcache_global_budget")
 	OPT_WRITE_UNSIGNED("debug_double_free_max_scan")
 	OPT_WRITE_CHAR_P("thp")
 	OPT_WRITE_BOOL("prof")
@@ -1962,6 +2105,8 @@ stats_print_helper(emitter_t *emitter, bool merged, bool destroyed,
 	    metadata_thp, resident, mapped, retained, pinned;
 	size_t   num_background_threads;
 	size_t   zero_reallocs;
+	size_t   percpu_cache_bytes;
+	size_t   realloc_remap_mappings;
 	uint64_t background_thread_num_runs, background_thread_run_interval;
 
 	CTL_GET("stats.allocated", &allocated, size_t);
@@ -1976,6 +2121,8 @@ stats_print_helper(emitter_t *emitter, bool merged, bool destroyed,
 	CTL_GET("stats.pinned", &pinned, size_t);
 
 	CTL_GET("stats.zero_reallocs", &zero_reallocs, size_t);
+	CTL_GET("stats.percpu_cache_bytes", &percpu_cache_bytes, size_t);
+	CTL_GET("stats.realloc_remap_mappings", &realloc_remap_mappings, size_t);
 
 	if (have_background_thread) {
 		CTL_GET("stats.background_thread.num_threads",
@@ -2007,6 +2154,10 @@ stats_print_helper(emitter_t *emitter, bool merged, bool destroyed,
 	emitter_json_kv(emitter, "pinned", emitter_type_size, &pinned);
 	emitter_json_kv(
 	    emitter, "zero_reallocs", emitter_type_size, &zero_reallocs);
+	emitter_json_kv(emitter, "percpu_cache_bytes", emitter_type_size,
+	    &percpu_cache_bytes);
+	emitter_json_kv(emitter, "realloc_remap_mappings", emitter_type_size,
+	    &realloc_remap_mappings);
 
 	emitter_table_printf(emitter,
 	    "Allocated: %zu, active: %zu, "
@@ -2018,6 +2169,9 @@ stats_print_helper(emitter_t *emitter, bool merged, bool destroyed,
 	/* Strange behaviors */
 	emitter_table_printf(emitter,
 	    "Count of realloc(non-null-ptr, 0) calls: %zu\n", zero_reallocs);
+	emitter_table_printf(emitter,
+	    "Mappings left for realloc remapping: %zu\n",
+	    realloc_remap_mappings);
 
 	/* Background thread stats. */
 	emitter_json_object_kv_begin(emitter, "background_thread");
@@ -4,6 +4,7 @@
 #include "jemalloc/internal/assert.h"
 #include "jemalloc/internal/base.h"
 #include "jemalloc/internal/mutex.h"
+#include "jemalloc/internal/percpu_cache.h"
 #include "jemalloc/internal/safety_check.h"
 #include "jemalloc/internal/san.h"
 #include "jemalloc/internal/sc.h"
@@ -58,6 +59,22 @@ size_t opt_tcache_gc_delay_bytes = 0;
 unsigned opt_lg_tcache_flush_small_div = 1;
 unsigned opt_lg_tcache_flush_large_div = 1;
 
+/*
+ * Whether to size small bin fills and full-bin flushes from the recent refill
+ * and overflow history of each bin (see tcache_adaptive_update()), rather than
+ * with the fixed halving and doubling of lg_fill_div.  The budget bounds the
+ * bytes a single fill of every small bin would bring in, per thread.
+ */
+bool   opt_tcache_adaptive = false;
+size_t opt_tcache_adaptive_budget = ((size_t)1) << 20;
+
+/*
+ * Bytes all tcaches together may cache before the background thread starts
+ * making idle ones flush; 0 means no limit.  Requires stats, which maintain
+ * the per-arena lists of tcaches this is enforced through.
+ */
+size_t opt_tcache_global_budget = 0;
+
 /*
  * Number of cache bins enabled, including both large and small.  This value
  * is only used to initialize tcache_nbins in the per-thread tcache.
@@ -190,6 +207,102 @@ tcache_nfill_small_gc_update(
 	ctl->offset = 0;
 }
 
+static void
+tcache_adaptive_bin_init(
+    tcache_slow_t *tcache_slow, cache_bin_t *cache_bin, szind_t szind) {
+	cache_bin_sz_t ncached_max = cache_bin_ncached_max_get_unsafe(cache_bin);
+	/* Start out from what the fixed heuristics currently pick. */
+	cache_bin_sz_t nfill = ncached_max
+	    >> tcache_nfill_small_lg_div_get(tcache_slow, szind);
+	if (nfill == 0 && ncached_max > 0) {
+		nfill = 1;
+	}
+	tcache_slow->bin_nfill[szind] = nfill;
+	tcache_slow->bin_flush_remain[szind] = ncached_max
+	    >> opt_lg_tcache_flush_small_div;
+	tcache_slow->bin_nrefills[szind] = 0;
+	tcache_slow->bin_noverflows[szind] = 0;
+	tcache_slow->adaptive_fill_bytes += (size_t)nfill
+	    * sz_index2size(szind);
+}
+
+static void
+tcache_adaptive_init(tcache_slow_t *tcache_slow, tcache_t *tcache) {
+	tcache_slow->adaptive_fill_bytes = 0;
+	unsigned nbins = tcache_nbins_get(tcache_slow);
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		if (i < nbins) {
+			tcache_adaptive_bin_init(
+			    tcache_slow, &tcache->bins[i], i);
+		} else {
+			tcache_slow->bin_nfill[i] = 0;
+			tcache_slow->bin_flush_remain[i] = 0;
+			tcache_slow->bin_nrefills[i] = 0;
+			tcache_slow->bin_noverflows[i] = 0;
+		}
+	}
+}
+
+/*
+ * Called once per GC window of a small bin.  A bin that ran dry more than once
+ * during the window would have needed a single fill of nrefills times the size,
+ * so the fill grows to that in one step, as far as the budget allows; a bin
+ * that kept items unused throughout shrinks its fill by that many (at most
+ * half).  The depth of full-bin flushes follows the traffic: a bin that only
+ * overflows is draining frees and keeps fewer items, while one that overflows
+ * and refills in the same window keeps more.
+ */
+static void
+tcache_adaptive_update(tcache_slow_t *tcache_slow, cache_bin_t *cache_bin,
+    szind_t szind, cache_bin_sz_t low_water) {
+	size_t         usize = sz_index2size(szind);
+	cache_bin_sz_t ncached_max = cache_bin_ncached_max_get(cache_bin);
+	size_t         nfill = tcache_slow->bin_nfill[szind];
+	unsigned       nrefills = tcache_slow->bin_nrefills[szind];
+	unsigned       noverflows = tcache_slow->bin_noverflows[szind];
+
+	size_t want = nfill;
+	if (low_water > 0) {
+		want -= (low_water < nfill / 2) ? low_water : nfill / 2;
+	} else if (nrefills > 1) {
+		want = nfill * nrefills;
+	}
+	assert(tcache_slow->adaptive_fill_bytes >= nfill * usize);
+	size_t others = tcache_slow->adaptive_fill_bytes - nfill * usize;
+	size_t budget = tcache_slow->adaptive_budget;
+	size_t budget_nfill = budget > others ? (budget - others) / usize : 0;
+	if (want > budget_nfill) {
+		want = budget_nfill;
+	}
+	if (want > ncached_max) {
+		want = ncached_max;
+	}
+	if (want == 0) {
+		want = 1;
+	}
+	tcache_slow->adaptive_fill_bytes = others + want * usize;
+	tcache_slow->bin_nfill[szind] = (cache_bin_sz_t)want;
+
+	cache_bin_sz_t remain = tcache_slow->bin_flush_remain[szind];
+	if (noverflows > 0) {
+		if (nrefills == 0) {
+			remain /= 2;
+		} else {
+			remain += (ncached_max - remain) / 2;
+		}
+	}
+	/* A flush must leave room for the deallocation that triggered it. */
+	cache_bin_sz_t remain_max = ncached_max
+	    - (ncached_max / 4 > 0 ? ncached_max / 4 : 1);
+	if (remain > remain_max) {
+		remain = remain_max;
+	}
+	tcache_slow->bin_flush_remain[szind] = remain;
+
+	tcache_slow->bin_nrefills[szind] = 0;
+	tcache_slow->bin_noverflows[szind] = 0;
+}
+
 static uint8_t
 tcache_gc_item_delay_compute(szind_t szind) {
 	assert(szind < SC_NBINS);
@@ -352,7 +465,10 @@ tcache_gc_small(
 	assert(!tcache_bin_disabled(szind, cache_bin, tcache->tcache_slow));
 	cache_bin_sz_t ncached = cache_bin_ncached_get_local(cache_bin);
 	cache_bin_sz_t low_water = cache_bin_low_water_get(cache_bin);
-	if (low_water > 0) {
+	if (tcache_slow->adaptive) {
+		tcache_adaptive_update(tcache_slow, cache_bin, szind, low_water);
+		tcache_slow->bin_refilled[szind] = false;
+	} else if (low_water > 0) {
 		/*
 		 * There is unused items within the GC period => reduce fill count.
 		 * limit field != 0 is borrowed to indicate that the fill count
@@ -495,10 +611,23 @@ tcache_gc_event(tsd_t *tsd) {
 	if (tcache == NULL) {
 		return;
 	}
+	/* Age the per-CPU caches along with the thread caches feeding them. */
+	percpu_cache_gc(tsd);
 
 	tcache_slow_t *tcache_slow = tsd_tcache_slowp_get(tsd);
 	assert(tcache_slow != NULL);
 
+	if (opt_tcache_global_budget != 0) {
+		atomic_store_u32(&tcache_slow->ngc_events,
+		    atomic_load_u32(&tcache_slow->ngc_events, ATOMIC_RELAXED)
+		        + 1,
+		    ATOMIC_RELAXED);
+		if (tcache_reclaim_pending(tsd)) {
+			tcache_reclaim(tsd);
+			return;
+		}
+	}
+
 	/* When the new tcache gc is not enabled, GC one bin at a time. */
 	if (!opt_experimental_tcache_gc) {
 		szind_t szind = tcache_slow->next_gc_bin;
@@ -572,8 +701,16 @@ tcache_alloc_small_hard(tsdn_t *tsdn, arena_t *arena, tcache_t *tcache,
 	assert(tcache_slow->arena != NULL);
 	assert(!tcache_bin_disabled(binind, cache_bin, tcache_slow));
 	assert(cache_bin_ncached_get_local(cache_bin) == 0);
-	cache_bin_sz_t nfill = cache_bin_ncached_max_get(cache_bin)
-	    >> tcache_nfill_small_lg_div_get(tcache_slow, binind);
+	cache_bin_sz_t nfill;
+	if (tcache_slow->adaptive) {
+		nfill = tcache_slow->bin_nfill[binind];
+		if (tcache_slow->bin_nrefills[binind] < UINT8_MAX) {
+			tcache_slow->bin_nrefills[binind]++;
+		}
+	} else {
+		nfill = cache_bin_ncached_max_get(cache_bin)
+		    >> tcache_nfill_small_lg_div_get(tcache_slow, binind);
+	}
 	if (nfill == 0) {
 		nfill = 1;
 	}
@@ -626,7 +763,8 @@ tcache_bin_flush_bottom(tsd_t *tsd, tcache_t *tcache, cache_bin_t *cache_bin,
 	cache_bin_init_ptr_array_for_flush(cache_bin, &ptrs, nflush);
 
 	arena_ptr_array_flush(tsd, binind, &ptrs, nflush, small,
-	    tcache->tcache_slow->arena, cache_bin->tstats);
+	    tcache->tcache_slow->arena, cache_bin->tstats,
+	    /* use_percpu_cache */ true);
 
 	cache_bin_finish_flush(cache_bin, &ptrs, nflush);
 }
@@ -679,7 +817,8 @@ tcache_bin_flush_stashed(tsd_t *tsd, tcache_t *tcache, cache_bin_t *cache_bin,
 	    cache_bin, binind, &ptrs, nstashed);
 	san_check_stashed_ptrs(ptrs.ptr, nstashed, sz_index2size(binind));
 	arena_ptr_array_flush(tsd, binind, &ptrs, nstashed, is_small,
-	    tcache->tcache_slow->arena, cache_bin->tstats);
+	    tcache->tcache_slow->arena, cache_bin->tstats,
+	    /* use_percpu_cache */ true);
 	cache_bin_finish_flush_stashed(cache_bin);
 
 	assert(cache_bin_nstashed_get_local(cache_bin) == 0);
@@ -697,6 +836,12 @@ tcache_get_default_ncached_max(void) {
 	return opt_tcache_ncached_max;
 }
 
+cache_bin_sz_t
+tcache_ncached_max_default_get(szind_t ind) {
+	assert(ind < TCACHE_NBINS_MAX);
+	return tcache_get_default_ncached_max()[ind].ncached_max;
+}
+
 bool
 tcache_bin_ncached_max_read(
     tsd_t *tsd, size_t bin_size, cache_bin_sz_t *ncached_max) {
@@ -776,6 +921,8 @@ tcache_default_settings_init(tcache_slow_t *tcache_slow) {
 	assert(global_do_not_change_tcache_maxclass != 0);
 	assert(global_do_not_change_tcache_nbins != 0);
 	tcache_slow->tcache_nbins = global_do_not_change_tcache_nbins;
+	tcache_slow->adaptive = opt_tcache_adaptive;
+	tcache_slow->adaptive_budget = opt_tcache_adaptive_budget;
 }
 
 static void
@@ -790,6 +937,11 @@ tcache_init(tsd_t *tsd, tcache_slow_t *tcache_slow, tcache_t *tcache, void *mem,
 	tcache_slow->next_gc_bin_large = SC_NBINS;
 	tcache_slow->arena = NULL;
 	tcache_slow->dyn_alloc = mem;
+	atomic_store_b(&tcache_slow->reclaim_requested, false, ATOMIC_RELAXED);
+	atomic_store_u32(&tcache_slow->ngc_events, 0, ATOMIC_RELAXED);
+	tcache_slow->reclaim_ngc_events_seen = 0;
+	tcache_slow->reclaim_idle = false;
+	tcache_slow->owner = NULL;
 
 	/*
 	 * We reserve cache bins for all small size classes, even if some may
@@ -837,6 +989,7 @@ tcache_init(tsd_t *tsd, tcache_slow_t *tcache_slow, tcache_t *tcache, void *mem,
 		    tcache_bin_info, tcache_nbins, &size, &alignment);
 		assert(cur_offset == size);
 	}
+	tcache_adaptive_init(tcache_slow, tcache);
 }
 
 static inline unsigned
@@ -945,6 +1098,7 @@ tsd_tcache_data_init_impl(
 	}
 
 	tcache_init(tsd, tcache_slow, tcache, mem, tcache_bin_info);
+	tcache_slow->owner = tsd;
 	/*
 	 * Initialization is a bit tricky here.  After malloc init is done, all
 	 * threads can rely on arena_choose and associate tcache accordingly.
@@ -1030,6 +1184,108 @@ tcache_create_explicit(tsd_t *tsd) {
 	return tcache;
 }
 
+static tcache_slow_t *
+tcache_slow_from_descriptor(cache_bin_array_descriptor_t *desc) {
+	return (tcache_slow_t *)((byte_t *)desc
+	    - offsetof(tcache_slow_t, cache_bin_array_descriptor));
+}
+
+static size_t
+tcache_budget_bytes_get(cache_bin_array_descriptor_t *desc) {
+	size_t bytes = 0;
+	for (szind_t i = 0; i < TCACHE_NBINS_MAX; i++) {
+		cache_bin_t *cache_bin = &desc->bins[i];
+		if (cache_bin_disabled(cache_bin)) {
+			continue;
+		}
+		cache_bin_sz_t ncached, nstashed;
+		cache_bin_nitems_get_remote(cache_bin, &ncached, &nstashed);
+		bytes += (size_t)ncached * sz_index2size(i);
+	}
+	return bytes;
+}
+
+/*
+ * Cache bins belong to their owner thread and cannot be flushed from outside,
+ * so when the tcaches together hold more than opt_tcache_global_budget, the
+ * owners of idle ones (no GC event since the previous call) are made to flush
+ * everything themselves.  Each gets a reclaim request, and has its fast path
+ * thresholds zeroed, so that its very next allocation or deallocation takes
+ * the slow path and serves the request there; see te_wakeup().  Busy threads
+ * already keep their caches trimmed through regular GC and are left alone.
+ * Called periodically by the background thread.
+ */
+void
+tcache_budget_enforce(tsdn_t *tsdn) {
+	if (!config_stats || opt_tcache_global_budget == 0) {
+		return;
+	}
+
+	unsigned                      narenas = narenas_total_get();
+	size_t                        total = 0;
+	cache_bin_array_descriptor_t *desc;
+	for (unsigned i = 0; i < narenas; i++) {
+		arena_t *arena = arena_get(tsdn, i, false);
+		if (arena == NULL) {
+			continue;
+		}
+		malloc_mutex_lock(tsdn, &arena->cache_bin_array_descriptor_ql_mtx);
+		ql_foreach (desc, &arena->cache_bin_array_descriptor_ql, link) {
+			tcache_slow_t *tcache_slow =
+			    tcache_slow_from_descriptor(desc);
+			uint32_t ngc_events = atomic_load_u32(
+			    &tcache_slow->ngc_events, ATOMIC_RELAXED);
+			tcache_slow->reclaim_idle = (ngc_events
+			    == tcache_slow->reclaim_ngc_events_seen);
+			tcache_slow->reclaim_ngc_events_seen = ngc_events;
+			total += tcache_budget_bytes_get(desc);
+		}
+		malloc_mutex_unlock(
+		    tsdn, &arena->cache_bin_array_descriptor_ql_mtx);
+	}
+	if (total <= opt_tcache_global_budget) {
+		return;
+	}
+
+	size_t excess = total - opt_tcache_global_budget;
+	for (unsigned i = 0; i < narenas && excess > 0; i++) {
+		arena_t *arena = arena_get(tsdn, i, false);
+		if (arena == NULL) {
+			continue;
+		}
+		malloc_mutex_lock(tsdn, &arena->cache_bin_array_descriptor_ql_mtx);
+		ql_foreach (desc, &arena->cache_bin_array_descriptor_ql, link) {
+			tcache_slow_t *tcache_slow =
+			    tcache_slow_from_descriptor(desc);
+			if (!tcache_slow->reclaim_idle
+			    || tcache_slow->owner == NULL) {
+				continue;
+			}
+			size_t bytes = tcache_budget_bytes_get(desc);
+			if (bytes == 0) {
+				continue;
+			}
+			atomic_store_b(&tcache_slow->reclaim_requested, true,
+			    ATOMIC_RELAXED);
+			/*
+			 * The owner can't go away while its tcache is on the
+			 * list.  Either it sees the request when recomputing its
+			 * thresholds, or the zeroing below lands after that;
+			 * see te_recompute_fast_threshold().
+			 */
+			atomic_fence(ATOMIC_SEQ_CST);
+			te_next_event_fast_set_non_nominal(tcache_slow->owner);
+			if (bytes >= excess) {
+				excess = 0;
+				break;
+			}
+			excess -= bytes;
+		}
+		malloc_mutex_unlock(
+		    tsdn, &arena->cache_bin_array_descriptor_ql_mtx);
+	}
+}
+
 bool
 tsd_tcache_enabled_data_init(tsd_t *tsd) {
 	/* Called upon tsd initialization. */
@@ -1102,6 +1358,25 @@ thread_tcache_max_set(tsd_t *tsd, size_t tcache_max) {
 	return ret;
 }
 
+void
+thread_tcache_adaptive_set(tsd_t *tsd, bool adaptive) {
+	tcache_slow_t *tcache_slow = tsd_tcache_slowp_get(tsd);
+	if (adaptive && !tcache_slow->adaptive && tcache_available(tsd)) {
+		/*
+		 * Pick up from the current fill counts; a tcache that is not
+		 * set up yet does this in tcache_init().
+		 */
+		tcache_adaptive_init(tcache_slow, tsd_tcachep_get(tsd));
+	}
+	tcache_slow->adaptive = adaptive;
+}
+
+void
+thread_tcache_adaptive_budget_set(tsd_t *tsd, size_t budget) {
+	/* Bins over the new budget shrink at their next GC. */
+	tsd_tcache_slowp_get(tsd)->adaptive_budget = budget;
+}
+
 static bool
 tcache_bin_info_settings_parse(const char *bin_settings_segment_cur,
     size_t len_left, cache_bin_info_t tcache_bin_info[TCACHE_NBINS_MAX],
@@ -1192,6 +1467,26 @@ tcache_flush(tsd_t *tsd) {
 	tcache_flush_cache(tsd, tsd_tcachep_get(tsd));
 }
 
+bool
+tcache_reclaim_pending(tsd_t *tsd) {
+	return atomic_load_b(
+	    &tsd_tcache_slowp_get(tsd)->reclaim_requested, ATOMIC_RELAXED);
+}
+
+/* Serves a request made by tcache_budget_enforce(); called by the owner. */
+void
+tcache_reclaim(tsd_t *tsd) {
+	if (!tcache_reclaim_pending(tsd)) {
+		return;
+	}
+	/* Cleared first, so that a request made during the flush isn't lost. */
+	atomic_store_b(&tsd_tcache_slowp_get(tsd)->reclaim_requested, false,
+	    ATOMIC_RELAXED);
+	if (tcache_available(tsd)) {
+		tcache_flush_cache(tsd, tsd_tcachep_get(tsd));
+	}
+}
+
 static void
 tcache_destroy(tsd_t *tsd, tcache_t *tcache, bool tsd_tcache) {
 	tcache_slow_t *tcache_slow = tcache->tcache_slow;
@@ -1368,6 +1663,21 @@ tcache_boot(tsdn_t *tsdn, base_t *base) {
 	 * accessed using tcache_get_default_ncached_max.
 	 */
 	tcache_bin_info_compute(opt_tcache_ncached_max);
+	if (opt_percpu_cache) {
+		/*
+		 * The per-CPU caches take over the sizes computed above for
+		 * small objects; thread caches keep just enough for the fast
+		 * path.
+		 */
+		percpu_cache_ncached_max_init(opt_tcache_ncached_max);
+		for (szind_t i = 0; i < SC_NBINS; i++) {
+			if (opt_tcache_ncached_max[i].ncached_max
+			    > PERCPU_CACHE_TCACHE_NCACHED_MAX) {
+				cache_bin_info_init(&opt_tcache_ncached_max[i],
+				    PERCPU_CACHE_TCACHE_NCACHED_MAX);
+			}
+		}
+	}
 
 	if (malloc_mutex_init(&tcaches_mtx, "tcaches", WITNESS_RANK_TCACHES,
 	        malloc_mutex_rank_exclusive)) {
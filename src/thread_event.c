@@ -58,7 +58,9 @@ te_assert_invariants_impl(tsd_t *tsd, te_ctx_t *ctx) {
 	if (next_event > TE_NEXT_EVENT_FAST_MAX || !tsd_fast(tsd)) {
 		assert(next_event_fast == 0U);
 	} else {
-		assert(next_event_fast == next_event);
+		/* Unless zeroed by another thread; see te_wakeup(). */
+		assert(next_event_fast == next_event
+		    || (opt_tcache_global_budget != 0 && next_event_fast == 0U));
 	}
 
 	/* The subtraction is intentionally susceptible to underflow. */
@@ -122,6 +124,35 @@ te_recompute_fast_threshold(tsd_t *tsd) {
 	te_ctx_next_event_fast_update(&ctx);
 	te_ctx_get(tsd, &ctx, false);
 	te_ctx_next_event_fast_update(&ctx);
+
+	if (opt_tcache_global_budget != 0) {
+		/*
+		 * Pairs with the fence in tcache_budget_enforce(): either a
+		 * pending reclaim request is seen here, or the other thread's
+		 * zeroing of the thresholds lands after the stores above.
+		 */
+		atomic_fence(ATOMIC_SEQ_CST);
+		if (tcache_reclaim_pending(tsd)) {
+			te_next_event_fast_set_non_nominal(tsd);
+		}
+	}
+}
+
+/*
+ * Called on the slow path when the fast thresholds are zero and a tcache
+ * budget is set.  That is how tcache_budget_enforce() gets an idle thread,
+ * which would not reach its next tcache GC event any time soon, to flush its
+ * tcache at its very next allocation or deallocation.  The flush is the
+ * thread's own, so it can't race with the thread's fast path.
+ */
+void
+te_wakeup(tsd_t *tsd) {
+	assert(tsd_nominal(tsd));
+	tcache_reclaim(tsd);
+	/* Slow tsds keep their thresholds zeroed anyway. */
+	if (tsd_fast(tsd)) {
+		te_recompute_fast_threshold(tsd);
+	}
 }
 
 static inline void
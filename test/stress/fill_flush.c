@@ -70,8 +70,97 @@ TEST_BEGIN(test_array_vs_item_large) {
 }
 TEST_END
 
+#define TINY_NALLOCS 4096
+
+void *volatile tiny_allocs[TINY_NALLOCS];
+/* Every other region of the tiny slabs, to fragment their bitmaps. */
+static void  *tiny_holes[TINY_NALLOCS];
+static size_t tiny_size;
+static bool   tiny_fragmented;
+
+static void
+tiny_fragment(void) {
+	void **ptrs = mallocx(2 * TINY_NALLOCS * sizeof(void *), 0);
+	assert_ptr_not_null(ptrs, "mallocx shouldn't fail");
+	for (int i = 0; i < 2 * TINY_NALLOCS; i++) {
+		ptrs[i] = mallocx(tiny_size, MALLOCX_TCACHE_NONE);
+		assert_ptr_not_null(ptrs[i], "mallocx shouldn't fail");
+	}
+	for (int i = 0; i < TINY_NALLOCS; i++) {
+		tiny_holes[i] = ptrs[2 * i];
+		sdallocx(ptrs[2 * i + 1], tiny_size, MALLOCX_TCACHE_NONE);
+	}
+	dallocx(ptrs, 0);
+	tiny_fragmented = true;
+}
+
+static void
+tiny_unfragment(void) {
+	for (int i = 0; i < TINY_NALLOCS; i++) {
+		sdallocx(tiny_holes[i], tiny_size, MALLOCX_TCACHE_NONE);
+	}
+	tiny_fragmented = false;
+}
+
+/*
+ * Refills the thread cache from the slab bitmaps: everything goes back to the
+ * slabs at the end of each round.
+ */
+static void
+tiny_refill(void) {
+	for (int i = 0; i < TINY_NALLOCS; i++) {
+		void *p = mallocx(tiny_size, 0);
+		assert_ptr_not_null(p, "mallocx shouldn't fail");
+		tiny_allocs[i] = p;
+	}
+	for (int i = 0; i < TINY_NALLOCS; i++) {
+		sdallocx(tiny_allocs[i], tiny_size, 0);
+	}
+	assert_d_eq(mallctl("thread.tcache.flush", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl failure");
+}
+
+static void
+tiny_refill_dense(void) {
+	assert_false(tiny_fragmented, "Slabs should be unfragmented");
+	tiny_refill();
+}
+
+/* Free regions alternate with live ones, which defeats run extraction. */
+static void
+tiny_refill_sparse(void) {
+	if (!tiny_fragmented) {
+		tiny_fragment();
+	}
+	tiny_refill();
+}
+
+static void
+tiny_compare(size_t size) {
+	char name_dense[64], name_sparse[64];
+	malloc_snprintf(name_dense, sizeof(name_dense),
+	    "%zu-byte refill from contiguous free regions", size);
+	malloc_snprintf(name_sparse, sizeof(name_sparse),
+	    "%zu-byte refill from scattered free regions", size);
+	tiny_size = size;
+	compare_funcs(10, 100, name_dense, tiny_refill_dense, name_sparse,
+	    tiny_refill_sparse);
+	tiny_unfragment();
+}
+
+TEST_BEGIN(test_refill_dense_vs_sparse_8) {
+	tiny_compare(8);
+}
+TEST_END
+
+TEST_BEGIN(test_refill_dense_vs_sparse_16) {
+	tiny_compare(16);
+}
+TEST_END
+
 int
 main(void) {
-	return test_no_reentrancy(
-	    test_array_vs_item_small, test_array_vs_item_large);
+	return test_no_reentrancy(test_array_vs_item_small,
+	    test_array_vs_item_large, test_refill_dense_vs_sparse_8,
+	    test_refill_dense_vs_sparse_16);
 }
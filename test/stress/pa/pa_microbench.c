@@ -11,6 +11,7 @@
 #include "jemalloc/internal/sec.h"
 #include "jemalloc/internal/emap.h"
 #include "jemalloc/internal/psset.h"
+#include "jemalloc/internal/prng.h"
 
 /*
  * PA Microbenchmark (Simplified Version)
@@ -51,6 +52,8 @@ typedef struct {
 	uint64_t alloc_count;     /* Number of allocations */
 	uint64_t dealloc_count;   /* Number of deallocations */
 	uint64_t bytes_allocated; /* Current bytes allocated */
+	uint64_t alloc_ns;        /* Time spent in pa_alloc */
+	uint64_t dealloc_ns;      /* Time spent in pa_dalloc */
 } shard_stats_t;
 
 /* Structure to group per-shard PA infrastructure */
@@ -104,7 +107,11 @@ static hpa_shard_opts_t g_hpa_opts = {
 	/* experimental_max_purge_nhp */ -1,
 	/* purge_threshold */           HUGEPAGE,
 	/* min_purge_delay_ms */        0,
-	/* hugify_style */              hpa_hugify_style_eager
+	/* hugify_style */              hpa_hugify_style_eager,
+	/* collapse_budget_us */        0,
+	/* span_max_alloc */            0,
+	/* resv_max_alloc */            0,
+	/* purge_lru */                 false
 };
 
 /* Override for curtime */
@@ -416,7 +423,7 @@ print_shard_stats(int shard_id, size_t operation_count) {
 	/* Output enhanced stats with detailed breakdown */
 	fprintf(g_stats_output,
 	    "%zu,%d,%lu,%lu,%lu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%lu,%lu,%lu"
-	    ",%lu,%lu\n",
+	    ",%lu,%lu,%lu\n",
 	    operation_count, shard_id, g_shard_stats[shard_id].alloc_count,
 	    g_shard_stats[shard_id].dealloc_count,
 	    g_shard_stats[shard_id].bytes_allocated, total_pageslabs,
@@ -425,7 +432,8 @@ print_shard_stats(int shard_id, size_t operation_count) {
 	    empty_pageslabs_non_huge, empty_pageslabs_huge, dirty_bytes,
 	    hpa_stats.nonderived_stats.nhugifies,
 	    hpa_stats.nonderived_stats.nhugify_failures,
-	    hpa_stats.nonderived_stats.ndehugifies, npurge_passes, npurges);
+	    hpa_stats.nonderived_stats.ndehugifies, npurge_passes, npurges,
+	    hpa_stats.nonderived_stats.nrefaults);
 	fflush(g_stats_output);
 }
 
@@ -460,10 +468,14 @@ simulate_trace(
 			bool deferred_work_generated = false;
 
 			/* Allocate using PA allocator */
+			nstime_t start;
+			nstime_init_update(&start);
 			edata_t *edata = pa_alloc(tsdn,
 			    &g_shard_infra[shard_ind].pa_shard, size,
 			    PAGE /* alignment */, slab, szind, false /* zero */,
 			    false /* guarded */, &deferred_work_generated);
+			g_shard_stats[shard_ind].alloc_ns += nstime_ns_since(
+			    &start);
 
 			if (edata != NULL) {
 				/* Store allocation record */
@@ -494,10 +506,14 @@ simulate_trace(
 				bool    deferred_work_generated = false;
 
 				/* Deallocate using PA allocator */
+				nstime_t start;
+				nstime_init_update(&start);
 				pa_dalloc(tsdn,
 				    &g_shard_infra[shard_ind].pa_shard,
 				    g_alloc_records[alloc_index].edata,
 				    &deferred_work_generated);
+				g_shard_stats[shard_ind].dealloc_ns +=
+				    nstime_ns_since(&start);
 
 				/* Update shard-specific stats */
 				g_shard_stats[shard_ind].dealloc_count++;
@@ -529,11 +545,23 @@ simulate_trace(
 	/* Print final stats for all shards */
 	printf("\nFinal shard statistics:\n");
 	for (int i = 0; i < num_shards; i++) {
+		hpa_shard_stats_t hpa_stats;
+		collect_hpa_stats(i, &hpa_stats);
+		shard_stats_t *stats = &g_shard_stats[i];
 		printf(
-		    "  Shard %d: Allocs=%lu, Deallocs=%lu, Active Bytes=%lu\n",
-		    i, g_shard_stats[i].alloc_count,
-		    g_shard_stats[i].dealloc_count,
-		    g_shard_stats[i].bytes_allocated);
+		    "  Shard %d: Allocs=%lu, Deallocs=%lu, Active Bytes=%lu, "
+		    "Purges=%lu, Refaults=%lu\n",
+		    i, stats->alloc_count, stats->dealloc_count,
+		    stats->bytes_allocated,
+		    hpa_stats.nonderived_stats.npurges,
+		    hpa_stats.nonderived_stats.nrefaults);
+		printf("           alloc=%lu ns/op, dalloc=%lu ns/op\n",
+		    stats->alloc_count == 0
+		        ? 0
+		        : stats->alloc_ns / stats->alloc_count,
+		    stats->dealloc_count == 0
+		        ? 0
+		        : stats->dealloc_ns / stats->dealloc_count);
 
 		/* Final stats to file */
 		print_shard_stats(i, count);
@@ -567,6 +595,95 @@ cleanup_remaining_allocations(int num_shards) {
 	printf("Cleaned up %zu remaining allocations\n", cleaned_up);
 }
 
+/*
+ * Benchmarks the psset's allocation search on its own, with no trace: fills a
+ * psset with npageslabs fragmented pageslabs, then repeatedly picks one for a
+ * random number of pages and carves the allocation out of it (and frees it
+ * again).
+ */
+#define BENCH_PSSET_NOPS (1000 * 1000)
+#define BENCH_PSSET_NCHUNKS 8
+#define BENCH_PSSET_MAX_NPAGES 32
+
+static int
+bench_psset_alloc(size_t npageslabs) {
+	void *dummy_jet = jet_malloc(16);
+	if (dummy_jet == NULL) {
+		fprintf(stderr, "Failed to initialize JET jemalloc\n");
+		return 1;
+	}
+	jet_free(dummy_jet);
+
+	hpdata_t *hpdatas = malloc(npageslabs * sizeof(hpdata_t));
+	psset_t  *psset = malloc(sizeof(psset_t));
+	if (hpdatas == NULL || psset == NULL) {
+		fprintf(stderr, "Failed to allocate pageslabs\n");
+		free(hpdatas);
+		free(psset);
+		return 1;
+	}
+	psset_init(psset);
+
+	/*
+	 * Every pageslab is active except for one free range at the start of
+	 * each of its chunks, of 1 to HUGEPAGE_PAGES / BENCH_PSSET_NCHUNKS
+	 * pages.  The address ranges are made up; nothing touches them.
+	 */
+	const size_t chunk_pages = HUGEPAGE_PAGES / BENCH_PSSET_NCHUNKS;
+	uint64_t     prng = 1;
+	for (size_t i = 0; i < npageslabs; i++) {
+		hpdata_t *ps = &hpdatas[i];
+		hpdata_init(ps, (void *)((i + 1) * HUGEPAGE), i,
+		    /* is_huge */ false);
+		byte_t *addr = hpdata_reserve_alloc(ps, HUGEPAGE);
+		for (size_t j = 0; j < BENCH_PSSET_NCHUNKS; j++) {
+			size_t npages = 1 + (size_t)prng_range_u64(
+			    &prng, chunk_pages);
+			hpdata_unreserve(ps, addr + j * chunk_pages * PAGE,
+			    npages * PAGE);
+		}
+		psset_insert(psset, ps);
+	}
+
+	uint64_t pick_ns = 0;
+	uint64_t update_ns = 0;
+	uint64_t nmisses = 0;
+	for (size_t i = 0; i < BENCH_PSSET_NOPS; i++) {
+		size_t npages = 1 + (size_t)prng_range_u64(
+		    &prng, BENCH_PSSET_MAX_NPAGES);
+		nstime_t start;
+		nstime_init_update(&start);
+		hpdata_t *ps = psset_pick_alloc(psset, npages * PAGE);
+		pick_ns += nstime_ns_since(&start);
+		if (ps == NULL) {
+			nmisses++;
+			continue;
+		}
+		nstime_init_update(&start);
+		psset_update_begin(psset, ps);
+		void *addr = hpdata_reserve_alloc(ps, npages * PAGE);
+		psset_update_end(psset, ps);
+		psset_update_begin(psset, ps);
+		hpdata_unreserve(ps, addr, npages * PAGE);
+		psset_update_end(psset, ps);
+		update_ns += nstime_ns_since(&start);
+	}
+
+	printf("psset benchmark: %zu pageslabs, %d ops (%lu found no fit)\n",
+	    npageslabs, BENCH_PSSET_NOPS, nmisses);
+	printf("  psset_pick_alloc: %lu ns/op\n", pick_ns / BENCH_PSSET_NOPS);
+	uint64_t nfound = BENCH_PSSET_NOPS - nmisses;
+	printf("  reserve + unreserve: %lu ns/op\n",
+	    nfound == 0 ? 0 : update_ns / nfound);
+
+	for (size_t i = 0; i < npageslabs; i++) {
+		psset_remove(psset, &hpdatas[i]);
+	}
+	free(hpdatas);
+	free(psset);
+	return 0;
+}
+
 static void
 print_usage(const char *program) {
 	printf("Usage: %s [options] <trace_file.csv>\n", program);
@@ -576,6 +693,11 @@ print_usage(const char *program) {
 	    "  -o, --output FILE    Output file for statistics (default: stdout)\n");
 	printf("  -s, --sec            Use SEC (default)\n");
 	printf("  -p, --hpa-only       Use HPA only (no SEC)\n");
+	printf(
+	    "  -l, --lru            Purge least recently active hugepages first\n");
+	printf(
+	    "  -b, --bench-psset N  Benchmark psset allocation search over N\n"
+	    "                       fragmented pageslabs instead of a trace\n");
 	printf(
 	    "  -i, --interval N     Stats print interval (default: 100000, 0=disable)\n");
 	printf(
@@ -592,6 +714,7 @@ main(int argc, char *argv[]) {
 	const char *trace_file = NULL;
 	const char *stats_output_file = NULL;
 	size_t      stats_interval = 100000; /* Default stats print interval */
+	size_t      bench_npageslabs = 0;
 	/* Parse command line arguments */
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "-h") == 0
@@ -613,6 +736,23 @@ main(int argc, char *argv[]) {
 		} else if (strcmp(argv[i], "-p") == 0
 		    || strcmp(argv[i], "--hpa-only") == 0) {
 			g_use_sec = false;
+		} else if (strcmp(argv[i], "-l") == 0
+		    || strcmp(argv[i], "--lru") == 0) {
+			g_hpa_opts.purge_lru = true;
+		} else if (strcmp(argv[i], "-b") == 0
+		    || strcmp(argv[i], "--bench-psset") == 0) {
+			if (i + 1 >= argc) {
+				fprintf(stderr,
+				    "Error: %s requires an argument\n",
+				    argv[i]);
+				return 1;
+			}
+			bench_npageslabs = (size_t)atol(argv[++i]);
+			if (bench_npageslabs == 0) {
+				fprintf(stderr,
+				    "Error: --bench-psset must be > 0\n");
+				return 1;
+			}
 		} else if (strcmp(argv[i], "-i") == 0
 		    || strcmp(argv[i], "--interval") == 0) {
 			if (i + 1 >= argc) {
@@ -646,6 +786,10 @@ main(int argc, char *argv[]) {
 		}
 	}
 
+	if (bench_npageslabs > 0) {
+		return bench_psset_alloc(bench_npageslabs);
+	}
+
 	if (!trace_file) {
 		fprintf(stderr, "Error: No trace file specified\n");
 		print_usage(argv[0]);
@@ -654,6 +798,7 @@ main(int argc, char *argv[]) {
 
 	printf("Trace file: %s\n", trace_file);
 	printf("Mode: %s\n", g_use_sec ? "PA with SEC" : "HPA only");
+	printf("Purge policy: %s\n", g_hpa_opts.purge_lru ? "LRU" : "dirtiest");
 
 	/* Open stats output file */
 	if (stats_output_file) {
@@ -673,7 +818,7 @@ main(int argc, char *argv[]) {
 		    "full_pageslabs_non_huge,full_pageslabs_huge,"
 		    "empty_pageslabs_non_huge,empty_pageslabs_huge,"
 		    "dirty_bytes,nhugifies,nhugify_failures,ndehugifies,"
-		    "npurge_passes,npurges\n");
+		    "npurge_passes,npurges,nrefaults\n");
 	}
 
 	/* Load trace data and determine max number of arenas */
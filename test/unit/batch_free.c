@@ -0,0 +1,128 @@
+#include "test/jemalloc_test.h"
+
+#define BATCH_MAX 2048
+static void *global_ptrs[BATCH_MAX];
+
+typedef struct batch_free_packet_s batch_free_packet_t;
+struct batch_free_packet_s {
+	void **ptrs;
+	size_t num;
+	size_t size;
+	int    flags;
+};
+
+static void
+batch_free_wrapper(void **ptrs, size_t num, size_t size, int flags) {
+	batch_free_packet_t batch_free_packet = {ptrs, num, size, flags};
+	assert_d_eq(mallctl("experimental.batch_free", NULL, NULL,
+	                &batch_free_packet, sizeof(batch_free_packet)),
+	    0, "");
+}
+
+static uint64_t
+thread_deallocated(void) {
+	uint64_t deallocated;
+	size_t   sz = sizeof(deallocated);
+	assert_d_eq(mallctl("thread.deallocated", (void *)&deallocated, &sz,
+	                NULL, 0),
+	    0, "");
+	return deallocated;
+}
+
+static size_t
+bin_curregs(unsigned arena_ind, size_t usize) {
+	uint64_t epoch = 1;
+	assert_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0, "");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.bins.%u.curregs",
+	    arena_ind, (unsigned)sz_size2index(usize));
+	size_t curregs;
+	size_t sz = sizeof(curregs);
+	assert_d_eq(mallctl(cmd, (void *)&curregs, &sz, NULL, 0), 0, "");
+	return curregs;
+}
+
+static void
+test_wrapper(size_t size, size_t batch, bool sized) {
+	assert(batch <= BATCH_MAX);
+	size_t usize = sz_s2u(size);
+	for (size_t i = 0; i < batch; i++) {
+		global_ptrs[i] = mallocx(size, 0);
+		assert_ptr_not_null(global_ptrs[i], "");
+	}
+	uint64_t deallocated = thread_deallocated();
+	batch_free_wrapper(global_ptrs, batch, sized ? size : 0, 0);
+	if (config_stats) {
+		expect_u64_eq(thread_deallocated() - deallocated,
+		    batch * usize, "Unexpected deallocated bytes");
+	}
+}
+
+TEST_BEGIN(test_batch_free) {
+	test_wrapper(11, 1, true);
+	test_wrapper(11, 100, true);
+	test_wrapper(11, BATCH_MAX, true);
+	test_wrapper(11, BATCH_MAX, false);
+}
+TEST_END
+
+TEST_BEGIN(test_batch_free_large) {
+	test_wrapper(SC_LARGE_MINCLASS, 4, true);
+	test_wrapper(SC_LARGE_MINCLASS, 4, false);
+}
+TEST_END
+
+TEST_BEGIN(test_batch_free_mixed) {
+	size_t   sizes[] = {8, 96, 1024, SC_LARGE_MINCLASS, 3 * PAGE};
+	size_t   nsizes = sizeof(sizes) / sizeof(sizes[0]);
+	uint64_t expected = 0;
+	for (size_t i = 0; i < BATCH_MAX; i++) {
+		/* Holes are skipped, as with free(NULL). */
+		if (i % 7 == 0) {
+			global_ptrs[i] = NULL;
+			continue;
+		}
+		size_t size = sizes[i % nsizes];
+		global_ptrs[i] = mallocx(size, 0);
+		assert_ptr_not_null(global_ptrs[i], "");
+		expected += sz_s2u(size);
+	}
+	uint64_t deallocated = thread_deallocated();
+	batch_free_wrapper(global_ptrs, BATCH_MAX, 0, 0);
+	if (config_stats) {
+		expect_u64_eq(thread_deallocated() - deallocated, expected,
+		    "Unexpected deallocated bytes");
+	}
+}
+TEST_END
+
+TEST_BEGIN(test_batch_free_manual_arena) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind;
+	size_t   len_unsigned = sizeof(unsigned);
+	assert_d_eq(
+	    mallctl("arenas.create", &arena_ind, &len_unsigned, NULL, 0), 0,
+	    "");
+	size_t size = 64;
+	int    flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	for (size_t i = 0; i < BATCH_MAX; i++) {
+		global_ptrs[i] = mallocx(size, flags);
+		assert_ptr_not_null(global_ptrs[i], "");
+	}
+	if (!(config_prof && opt_prof)) {
+		/* Sampled objects are promoted and live outside the bin. */
+		expect_zu_eq(bin_curregs(arena_ind, size), BATCH_MAX, "");
+	}
+	/* Objects go straight back to their bins, bypassing the tcache. */
+	batch_free_wrapper(global_ptrs, BATCH_MAX, size, 0);
+	expect_zu_eq(bin_curregs(arena_ind, size), 0, "");
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_batch_free, test_batch_free_large,
+	    test_batch_free_mixed, test_batch_free_manual_arena);
+}
@@ -0,0 +1 @@
+#include "batch_free.c"
@@ -20,7 +20,7 @@ create_mock_slab(edata_t *slab, szind_t binind, uint64_t sn) {
 
 	/* Initialize bitmap to all regions free. */
 	slab_data = edata_slab_data_get(slab);
-	bitmap_init(slab_data->bitmap, &bin_info->bitmap_info, false);
+	bitmap_init(slab_data->bitmap, &bin_info->bitmap_info[0], false);
 }
 
 /*
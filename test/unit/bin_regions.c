@@ -0,0 +1,190 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/bin_regions.h"
+
+#define TEST_SZ 64
+
+static unsigned
+test_arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+test_arena_destroy(unsigned arena_ind) {
+	char cmd[64];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.destroy", arena_ind);
+	expect_d_eq(mallctl(cmd, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+}
+
+static size_t
+arena_stat_get(unsigned arena_ind, const char *name) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(
+	    cmd, sizeof(cmd), "stats.arenas.%u.%s", arena_ind, name);
+	size_t val;
+	size_t sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+/* Slabs are carved at multiples of their size into the region. */
+static size_t
+slab_ind_get(const void *ptr, size_t slab_size) {
+	uintptr_t region_mask = ((uintptr_t)1 << opt_lg_bin_region) - 1;
+	return (((uintptr_t)ptr - bin_regions_base) & region_mask) / slab_size;
+}
+
+TEST_BEGIN(test_bin_regions_ctl) {
+	bool   enabled;
+	size_t sz = sizeof(enabled);
+	expect_d_eq(mallctl("opt.bin_regions", (void *)&enabled, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_b_eq(enabled, bin_regions_enabled(),
+	    "opt.bin_regions should reflect whether the regions are in use");
+
+	unsigned lg_region;
+	sz = sizeof(lg_region);
+	expect_d_eq(mallctl("opt.lg_bin_region", (void *)&lg_region, &sz,
+	                NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_u_eq(lg_region, BIN_REGIONS_LG_REGION_DEFAULT,
+	    "Unexpected default region size");
+}
+TEST_END
+
+TEST_BEGIN(test_bin_regions_lookup) {
+	test_skip_if(!bin_regions_enabled());
+	/* Sampled objects are promoted out of their slabs. */
+	test_skip_if(opt_prof);
+
+	for (szind_t binind = 0; binind < SC_NBINS; binind++) {
+		size_t size = sz_index2size(binind);
+		void  *p = mallocx(size, MALLOCX_TCACHE_NONE);
+		expect_ptr_not_null(p, "Unexpected mallocx() failure");
+
+		szind_t szind = SC_NSIZES;
+		expect_true(bin_regions_lookup(p, &szind),
+		    "Small object should be in the bin regions");
+		expect_u_eq(szind, binind,
+		    "Address should encode the size class");
+		expect_zu_eq(malloc_usable_size(p), size,
+		    "Unexpected usable size");
+		/* Unsized, so the size class comes from the address. */
+		free(p);
+	}
+
+	void *p = mallocx(SC_LARGE_MINCLASS, 0);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	szind_t szind = SC_NSIZES;
+	expect_false(bin_regions_lookup(p, &szind),
+	    "Large object should not be in the bin regions");
+	expect_zu_eq(malloc_usable_size(p), SC_LARGE_MINCLASS,
+	    "Unexpected usable size");
+	free(p);
+}
+TEST_END
+
+TEST_BEGIN(test_bin_regions_reuse) {
+	test_skip_if(!bin_regions_enabled());
+	test_skip_if(opt_prof);
+
+	unsigned arena_ind = test_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	szind_t  binind = sz_size2index(TEST_SZ);
+	size_t   slab_size = bin_infos[binind].slab_size;
+	size_t   nregs = bin_infos[binind].nregs;
+
+	/* Fill and empty more slabs than are kept dirty. */
+	size_t nslabs = PA_BIN_REGIONS_NDIRTY_MAX + 2;
+	size_t nobjs = nslabs * nregs;
+	void **ptrs = mallocx(nobjs * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (size_t i = 0; i < nobjs; i++) {
+		ptrs[i] = mallocx(TEST_SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	if (config_stats) {
+		expect_zu_eq(arena_stat_get(arena_ind, "bin_regions_bytes"),
+		    nslabs * slab_size, "Every slab should be carved");
+	}
+	for (size_t i = 0; i < nobjs; i++) {
+		dallocx(ptrs[i], flags);
+	}
+	if (config_stats) {
+		expect_zu_eq(arena_stat_get(arena_ind, "bin_regions_bytes"),
+		    nslabs * slab_size, "Freed slabs should stay carved");
+		expect_zu_eq(
+		    arena_stat_get(arena_ind, "bin_regions_dirty_bytes"),
+		    PA_BIN_REGIONS_NDIRTY_MAX * slab_size,
+		    "Slabs beyond the dirty limit should be purged");
+	}
+
+	/* The most recently freed of the dirty slabs comes back first. */
+	void *p = mallocx(TEST_SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_zu_eq(slab_ind_get(p, slab_size),
+	    slab_ind_get(
+	        ptrs[PA_BIN_REGIONS_NDIRTY_MAX * nregs - 1], slab_size),
+	    "Freed dirty slab should be reused");
+	if (config_stats) {
+		expect_zu_eq(arena_stat_get(arena_ind, "bin_regions_bytes"),
+		    nslabs * slab_size, "Reuse should not carve a new slab");
+	}
+	dallocx(p, flags);
+	dallocx(ptrs, 0);
+
+	test_arena_destroy(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_bin_regions_reuse_slab_sizes) {
+	test_skip_if(!bin_regions_enabled());
+
+	unsigned arena_ind = test_arena_create();
+	tsdn_t  *tsdn = tsd_tsdn(tsd_fetch());
+	arena_t *arena = arena_get(tsdn, arena_ind, false);
+	szind_t  binind = sz_size2index(TEST_SZ);
+	size_t   slab_size = bin_infos[binind].slab_size;
+	bool     deferred_work_generated = false;
+
+	/* Slabs of a size class differ in size with opt.slab_size_auto. */
+	edata_t *big = pa_alloc(tsdn, &arena->pa_shard, 2 * slab_size, PAGE,
+	    /* slab */ true, binind, /* zero */ false, /* guarded */ false,
+	    &deferred_work_generated);
+	expect_ptr_not_null(big, "Unexpected pa_alloc() failure");
+	edata_t *small = pa_alloc(tsdn, &arena->pa_shard, slab_size, PAGE,
+	    /* slab */ true, binind, /* zero */ false, /* guarded */ false,
+	    &deferred_work_generated);
+	expect_ptr_not_null(small, "Unexpected pa_alloc() failure");
+	void *addr = edata_base_get(big);
+	pa_dalloc(tsdn, &arena->pa_shard, big, &deferred_work_generated);
+	pa_dalloc(tsdn, &arena->pa_shard, small, &deferred_work_generated);
+
+	/* The smaller slab, freed last, doesn't stand in the way. */
+	big = pa_alloc(tsdn, &arena->pa_shard, 2 * slab_size, PAGE,
+	    /* slab */ true, binind, /* zero */ false, /* guarded */ false,
+	    &deferred_work_generated);
+	expect_ptr_not_null(big, "Unexpected pa_alloc() failure");
+	expect_ptr_eq(addr, edata_base_get(big),
+	    "Freed slab of the same size should be reused");
+	pa_dalloc(tsdn, &arena->pa_shard, big, &deferred_work_generated);
+
+	test_arena_destroy(arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_bin_regions_ctl, test_bin_regions_lookup,
+	    test_bin_regions_reuse, test_bin_regions_reuse_slab_sizes);
+}
@@ -0,0 +1,127 @@
+#include "test/jemalloc_test.h"
+
+#define NALLOC 64
+/* Large enough to hold a bin_remote_free_t. */
+#define SZ 64
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+thread_arena_set(unsigned arena_ind) {
+	expect_d_eq(mallctl("thread.arena", NULL, NULL, (void *)&arena_ind,
+	                sizeof(arena_ind)),
+	    0, "Unexpected mallctl() failure");
+}
+
+static void
+stats_refresh(void) {
+	uint64_t epoch = 1;
+	expect_d_eq(mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)),
+	    0, "Unexpected mallctl() failure");
+}
+
+static uint64_t
+bin_stat_u64_get(unsigned arena_ind, const char *name) {
+	stats_refresh();
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.bins.%u.%s",
+	    arena_ind, (unsigned)sz_size2index(SZ), name);
+	uint64_t val;
+	size_t   sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+static size_t
+bin_curregs_get(unsigned arena_ind) {
+	stats_refresh();
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.bins.%u.curregs",
+	    arena_ind, (unsigned)sz_size2index(SZ));
+	size_t val;
+	size_t sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+TEST_BEGIN(test_remote_free_drain) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!config_stats);
+	test_skip_if(!opt_bin_remote_free);
+
+	unsigned owner = arena_create();
+	unsigned flusher = arena_create();
+	void    *ptrs[NALLOC];
+	for (unsigned i = 0; i < NALLOC; i++) {
+		ptrs[i] = mallocx(
+		    SZ, MALLOCX_ARENA(owner) | MALLOCX_TCACHE_NONE);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	expect_zu_eq(bin_curregs_get(owner), NALLOC, "Unexpected curregs");
+
+	/*
+	 * Free through a tcache bound to a different arena, so that the flush
+	 * finds the owner's bin to be remote.
+	 */
+	thread_arena_set(flusher);
+	for (unsigned i = 0; i < NALLOC; i++) {
+		dallocx(ptrs[i], 0);
+	}
+	expect_d_eq(mallctl("thread.tcache.flush", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	expect_u64_eq(bin_stat_u64_get(owner, "nremote_frees"), 0,
+	    "Remote frees should stay pending until the owner drains them");
+
+	/* Any locked operation on the owner's bin drains the inbox. */
+	void *p = mallocx(SZ, MALLOCX_ARENA(owner) | MALLOCX_TCACHE_NONE);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_u64_eq(bin_stat_u64_get(owner, "nremote_frees"), NALLOC,
+	    "Unexpected number of drained remote frees");
+	expect_zu_eq(bin_curregs_get(owner), 1, "Unexpected curregs");
+	dallocx(p, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+TEST_BEGIN(test_remote_free_reset) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!opt_bin_remote_free);
+
+	unsigned owner = arena_create();
+	unsigned flusher = arena_create();
+	thread_arena_set(flusher);
+	for (unsigned i = 0; i < NALLOC; i++) {
+		void *p = mallocx(
+		    SZ, MALLOCX_ARENA(owner) | MALLOCX_TCACHE_NONE);
+		expect_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, 0);
+	}
+	expect_d_eq(mallctl("thread.tcache.flush", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+
+	/* Pending remote frees must not outlive the slabs they point into. */
+	char cmd[64];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.reset", owner);
+	expect_d_eq(mallctl(cmd, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	void *p = mallocx(SZ, MALLOCX_ARENA(owner) | MALLOCX_TCACHE_NONE);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	if (config_stats) {
+		expect_zu_eq(bin_curregs_get(owner), 1, "Unexpected curregs");
+	}
+	dallocx(p, MALLOCX_TCACHE_NONE);
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_remote_free_drain, test_remote_free_reset);
+}
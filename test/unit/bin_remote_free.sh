@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="bin_remote_free:true,bin_remote_free_max:1024"
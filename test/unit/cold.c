@@ -0,0 +1,152 @@
+#include "test/jemalloc_test.h"
+
+#define SZ (64 * PAGE)
+
+static unsigned
+cold_arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+cold_arena_reset(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = ARRAY_SIZE(mib);
+	expect_d_eq(mallctlnametomib("arena.0.reset", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	expect_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static void
+cold_demote(unsigned arena_ind) {
+	tsdn_t  *tsdn = tsd_tsdn(tsd_fetch());
+	arena_t *arena = arena_get(tsdn, arena_ind, false);
+	expect_ptr_not_null(arena, "Unexpected arena_get() failure");
+	pac_cold_demote(tsdn, &arena->pa_shard.pac);
+}
+
+static size_t
+cold_demoted_get(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.cold_demoted",
+	    arena_ind);
+	size_t demoted;
+	size_t sz = sizeof(demoted);
+	expect_d_eq(mallctl(cmd, (void *)&demoted, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return demoted;
+}
+
+/* Whether the system supports MADV_COLD at all. */
+static bool
+cold_supported(void) {
+	void *p = mallocx(PAGE, MALLOCX_ALIGN(PAGE));
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	bool supported = !pages_cold(p, PAGE, false);
+	dallocx(p, 0);
+	return supported;
+}
+
+TEST_BEGIN(test_cold_ctl) {
+	ssize_t age;
+	size_t  sz = sizeof(age);
+	expect_d_eq(mallctl("opt.cold_age_ms", (void *)&age, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	expect_zd_eq(age, 0, "Unexpected opt.cold_age_ms");
+}
+TEST_END
+
+TEST_BEGIN(test_cold_demote) {
+	test_skip_if(!config_stats);
+	test_skip_if(opt_hpa);
+	test_skip_if(!cold_supported());
+
+	unsigned arena_ind = cold_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void    *p = mallocx(SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	memset(p, 1, SZ);
+	dallocx(p, flags);
+
+	/* The first scan only notices the freed extent. */
+	cold_demote(arena_ind);
+	expect_zu_eq(cold_demoted_get(arena_ind), 0,
+	    "Freshly freed extent should not be demoted");
+	cold_demote(arena_ind);
+	size_t demoted = cold_demoted_get(arena_ind);
+	expect_zu_ge(demoted, SZ, "Idle extent should be demoted");
+	cold_demote(arena_ind);
+	expect_zu_eq(cold_demoted_get(arena_ind), demoted,
+	    "Extents should be demoted only once");
+
+	/* Reuse starts the extent over. */
+	p = mallocx(SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+	cold_demote(arena_ind);
+	expect_zu_eq(cold_demoted_get(arena_ind), demoted,
+	    "Reused extent should not be demoted right away");
+	cold_demote(arena_ind);
+	expect_zu_gt(cold_demoted_get(arena_ind), demoted,
+	    "Reused extent should be demoted once idle");
+
+	cold_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_cold_demote_incremental) {
+	test_skip_if(!config_stats);
+	test_skip_if(opt_hpa);
+	test_skip_if(!cold_supported());
+
+	enum { NFREE = PAC_COLD_SCAN_MAX + PAC_COLD_SCAN_MAX / 2 };
+	unsigned arena_ind = cold_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	void    *ptrs[2 * NFREE];
+	for (unsigned i = 0; i < ARRAY_SIZE(ptrs); i++) {
+		ptrs[i] = mallocx(SC_LARGE_MINCLASS, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	/* Keep the freed extents apart. */
+	for (unsigned i = 0; i < ARRAY_SIZE(ptrs); i += 2) {
+		dallocx(ptrs[i], flags);
+	}
+
+	tsdn_t  *tsdn = tsd_tsdn(tsd_fetch());
+	arena_t *arena = arena_get(tsdn, arena_ind, false);
+	eset_t  *eset = &arena->pa_shard.pac.ecache_dirty.eset;
+	cold_demote(arena_ind);
+	expect_ptr_not_null(eset->lru_cursor,
+	    "A scan should stop after PAC_COLD_SCAN_MAX extents");
+	expect_zu_eq(cold_demoted_get(arena_ind), 0,
+	    "Freshly freed extents should not be demoted");
+
+	unsigned nscans = 1;
+	while (cold_demoted_get(arena_ind) < NFREE * SC_LARGE_MINCLASS) {
+		expect_u_lt(nscans, 2 * NFREE / PAC_COLD_BATCH + 4,
+		    "Scans should make progress through the LRU");
+		cold_demote(arena_ind);
+		nscans++;
+	}
+
+	for (unsigned i = 1; i < ARRAY_SIZE(ptrs); i += 2) {
+		dallocx(ptrs[i], flags);
+	}
+	cold_arena_reset(arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_cold_ctl, test_cold_demote,
+	    test_cold_demote_incremental);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="cold_age_ms:0,dirty_decay_ms:-1"
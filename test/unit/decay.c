@@ -273,9 +273,77 @@ TEST_BEGIN(test_decay_ns_until_purge) {
 }
 TEST_END
 
+TEST_BEGIN(test_decay_forecast) {
+	decay_t decay;
+	memset(&decay, 0, sizeof(decay));
+
+	nstime_t curtime;
+	nstime_init(&curtime, 0);
+	bool err = decay_init(&decay, &curtime, 1000);
+	assert_false(err, "");
+
+	nstime_t interval;
+	nstime_init(&interval, decay_epoch_duration_ns(&decay));
+
+	/* Advances one epoch and reports nalloc pages allocated so far. */
+#define FORECAST_STEP(nalloc)                                           \
+	do {                                                           \
+		nstime_add(&curtime, &interval);                       \
+		nstime_add(&curtime, &interval);                       \
+		expect_true(decay_maybe_advance_epoch(&decay, &curtime, 0), \
+		    "Epoch didn't advance");                           \
+		decay_forecast_update(&decay, (nalloc));              \
+	} while (0)
+
+	size_t nalloc = 1000;
+	/* The first sample only sets the baseline. */
+	FORECAST_STEP(nalloc);
+	expect_zu_eq(decay_forecast_limit_get(&decay), 0,
+	    "Forecast without any history");
+
+	/* 100 pages over two epochs. */
+	nalloc += 100;
+	FORECAST_STEP(nalloc);
+	expect_zu_eq(decay_forecast_limit_get(&decay),
+	    50 * DECAY_FORECAST_HORIZON, "Forecast should follow demand");
+
+	/* A burst raises the forecast at once. */
+	nalloc += 1000;
+	FORECAST_STEP(nalloc);
+	size_t burst_limit = decay_forecast_limit_get(&decay);
+	expect_zu_eq(burst_limit, 500 * DECAY_FORECAST_HORIZON,
+	    "Forecast should follow the burst");
+
+	/* And fades gradually once it is over. */
+	FORECAST_STEP(nalloc);
+	size_t limit = decay_forecast_limit_get(&decay);
+	expect_zu_lt(limit, burst_limit, "Forecast should fade");
+	expect_zu_gt(limit, burst_limit / 2, "Forecast faded too quickly");
+	for (unsigned i = 0; i < SMOOTHSTEP_NSTEPS; i++) {
+		FORECAST_STEP(nalloc);
+	}
+	expect_zu_eq(decay_forecast_limit_get(&decay), 0,
+	    "Forecast should fade out without demand");
+
+	/* A long idle period forgets the peak entirely. */
+	nalloc += 1000;
+	FORECAST_STEP(nalloc);
+	expect_zu_gt(decay_forecast_limit_get(&decay), 0, "");
+	nstime_t idle;
+	nstime_copy(&idle, &interval);
+	nstime_imultiply(&idle, 2 * SMOOTHSTEP_NSTEPS);
+	nstime_add(&curtime, &idle);
+	FORECAST_STEP(nalloc);
+	expect_zu_eq(decay_forecast_limit_get(&decay), 0,
+	    "Forecast should not survive a long idle period");
+#undef FORECAST_STEP
+}
+TEST_END
+
 int
 main(void) {
 	return test(test_decay_init, test_decay_ms_valid,
 	    test_decay_npages_purge_in, test_decay_maybe_advance_epoch,
-	    test_decay_empty, test_decay, test_decay_ns_until_purge);
+	    test_decay_empty, test_decay, test_decay_ns_until_purge,
+	    test_decay_forecast);
 }
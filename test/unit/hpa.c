@@ -43,7 +43,15 @@ static hpa_shard_opts_t test_hpa_shard_opts_default = {
     /* min_purge_delay_ms */
     0,
     /* hugify_style */
-    hpa_hugify_style_lazy};
+    hpa_hugify_style_lazy,
+    /* collapse_budget_us */
+    0,
+    /* span_max_alloc */
+    0,
+    /* resv_max_alloc */
+    0,
+    /* purge_lru */
+    false};
 
 static hpa_shard_opts_t test_hpa_shard_opts_purge = {
     /* slab_max_alloc */
@@ -67,7 +75,15 @@ static hpa_shard_opts_t test_hpa_shard_opts_purge = {
     /* min_purge_delay_ms */
     0,
     /* hugify_style */
-    hpa_hugify_style_lazy};
+    hpa_hugify_style_lazy,
+    /* collapse_budget_us */
+    0,
+    /* span_max_alloc */
+    0,
+    /* resv_max_alloc */
+    0,
+    /* purge_lru */
+    false};
 
 static hpa_shard_opts_t test_hpa_shard_opts_aggressive = {
     /* slab_max_alloc */
@@ -91,7 +107,15 @@ static hpa_shard_opts_t test_hpa_shard_opts_aggressive = {
     /* min_purge_delay_ms */
     10,
     /* hugify_style */
-    hpa_hugify_style_eager};
+    hpa_hugify_style_eager,
+    /* collapse_budget_us */
+    0,
+    /* span_max_alloc */
+    0,
+    /* resv_max_alloc */
+    0,
+    /* purge_lru */
+    false};
 
 static hpa_shard_t *
 create_test_data(const hpa_hooks_t *hooks, hpa_shard_opts_t *opts) {
@@ -166,6 +190,43 @@ TEST_BEGIN(test_alloc_max) {
 }
 TEST_END
 
+TEST_BEGIN(test_alloc_zero) {
+	test_skip_if(!hpa_supported());
+
+	hpa_shard_t *shard = create_test_data(
+	    &hpa_hooks_default, &test_hpa_shard_opts_default);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	/* Keeps the pageslab from being purged as a whole. */
+	bool     deferred_work_generated = false;
+	edata_t *keep = hpa_alloc(tsdn, shard, 64 * PAGE, PAGE,
+	    /* zero */ false, /* guarded */ false, /* frequent_reuse */ false,
+	    &deferred_work_generated);
+	expect_ptr_not_null(keep, "Unexpected null edata");
+	edata_t *dirty = hpa_alloc(tsdn, shard, 4 * PAGE, PAGE,
+	    /* zero */ false, /* guarded */ false, /* frequent_reuse */ false,
+	    &deferred_work_generated);
+	expect_ptr_not_null(dirty, "Unexpected null edata");
+	memset(edata_base_get(dirty), 0xa5, 4 * PAGE);
+	hpa_dalloc(tsdn, shard, dirty, &deferred_work_generated);
+
+	/* Half of the range was touched before, half is fresh. */
+	edata_t *edata = hpa_alloc(tsdn, shard, 8 * PAGE, PAGE,
+	    /* zero */ true, /* guarded */ false, /* frequent_reuse */ false,
+	    &deferred_work_generated);
+	expect_ptr_not_null(edata, "Zeroed allocation failed");
+	expect_true(edata_zeroed_get(edata), "Extent should be zeroed");
+	uint8_t *addr = (uint8_t *)edata_base_get(edata);
+	for (size_t i = 0; i < 8 * PAGE; i++) {
+		expect_u_eq(addr[i], 0, "Byte %zu isn't zeroed", i);
+	}
+	hpa_dalloc(tsdn, shard, edata, &deferred_work_generated);
+	hpa_dalloc(tsdn, shard, keep, &deferred_work_generated);
+
+	destroy_test_data(shard);
+}
+TEST_END
+
 typedef struct mem_contents_s mem_contents_t;
 struct mem_contents_s {
 	uintptr_t my_addr;
@@ -1426,6 +1487,365 @@ TEST_BEGIN(test_experimental_hpa_enforce_hugify) {
 }
 TEST_END
 
+/* Every collapse takes a millisecond and is remembered. */
+static void *collapse_last_ptr = NULL;
+static bool
+collapse_test_hugify(void *ptr, size_t size, bool sync) {
+	expect_true(sync, "Budgeted hugification should collapse");
+	++ndefer_hugify_calls;
+	collapse_last_ptr = ptr;
+	nstime_iadd(&defer_curtime, 1000 * 1000);
+	return false;
+}
+
+TEST_BEGIN(test_collapse_budget) {
+	test_skip_if(!hpa_supported() || !config_stats);
+
+	hpa_hooks_t hooks;
+	hooks.map = &defer_test_map;
+	hooks.unmap = &defer_test_unmap;
+	hooks.purge = &defer_test_purge;
+	hooks.hugify = &collapse_test_hugify;
+	hooks.dehugify = &defer_test_dehugify;
+	hooks.curtime = &defer_test_curtime;
+	hooks.ms_since = &defer_test_ms_since;
+	hooks.vectorized_purge = &defer_vectorized_purge;
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.deferral_allowed = true;
+	opts.hugify_delay_ms = 0;
+	opts.hugification_threshold = HUGEPAGE / 2;
+	/* Never purge, so that nothing holds back hugification. */
+	opts.dirty_mult = (fxp_t)-1;
+	/* Enough for a single collapse per second. */
+	opts.collapse_budget_us = 1000;
+
+	ndefer_hugify_calls = 0;
+	hpa_shard_t *shard = create_test_data(&hooks, &opts);
+	bool         deferred_work_generated = false;
+	nstime_init2(&defer_curtime, 100, 0);
+
+	/* Fill the first hugepage and three quarters of the second. */
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	enum { NALLOCS = HUGEPAGE_PAGES * 7 / 4 };
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = hpa_alloc(tsdn, shard, PAGE, PAGE, false,
+		    false, false, &deferred_work_generated);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	/*
+	 * Leave the first hugepage, which became a candidate first, with fewer
+	 * active pages than the second.
+	 */
+	for (int i = 0; i < (int)HUGEPAGE_PAGES * 3 / 8; i++) {
+		hpa_dalloc(tsdn, shard, edatas[i], &deferred_work_generated);
+	}
+	void *first = HUGEPAGE_ADDR2BASE(
+	    edata_addr_get(edatas[HUGEPAGE_PAGES - 1]));
+	void *second = HUGEPAGE_ADDR2BASE(
+	    edata_addr_get(edatas[HUGEPAGE_PAGES]));
+	expect_ptr_ne(first, second, "Allocations should span two hugepages");
+
+	/* Without background threads, nothing gets collapsed inline. */
+	hpa_shard_set_deferral_allowed(tsdn, shard, false);
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(0, ndefer_hugify_calls, "Collapsed without deferral");
+	hpa_shard_set_deferral_allowed(tsdn, shard, true);
+
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(1, ndefer_hugify_calls, "Budget allows one collapse");
+	expect_ptr_eq(second, collapse_last_ptr,
+	    "Fuller hugepage should be collapsed first");
+	expect_u64_eq(999 * 1000 * 1000,
+	    hpa_time_until_deferred_work(tsdn, shard),
+	    "Should sleep until the budget is refilled");
+
+	/* Nothing happens until the next window. */
+	nstime_iadd(&defer_curtime, 998 * 1000 * 1000);
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(1, ndefer_hugify_calls, "Budget should be spent");
+
+	nstime_iadd(&defer_curtime, 1000 * 1000);
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(2, ndefer_hugify_calls, "Budget should be refilled");
+	expect_ptr_eq(first, collapse_last_ptr, "Wrong hugepage collapsed");
+
+	expect_u64_eq(2, shard->stats.ncollapses, "");
+	expect_u64_eq(0, shard->stats.ncollapse_failures, "");
+	expect_u64_eq(2 * 1000 * 1000, shard->stats.collapse_ns, "");
+	expect_u64_eq(1000 * 1000, shard->stats.collapse_max_ns, "");
+
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_span_alloc) {
+	test_skip_if(!hpa_supported());
+
+	hpa_hooks_t hooks;
+	hooks.map = &defer_test_map;
+	hooks.unmap = &defer_test_unmap;
+	hooks.purge = &defer_test_purge;
+	hooks.hugify = &defer_test_hugify;
+	hooks.dehugify = &defer_test_dehugify;
+	hooks.curtime = &defer_test_curtime;
+	hooks.ms_since = &defer_test_ms_since;
+	hooks.vectorized_purge = &defer_vectorized_purge;
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.deferral_allowed = true;
+	opts.hugify_delay_ms = 0;
+	opts.span_max_alloc = 4 * HUGEPAGE;
+
+	ndefer_hugify_calls = 0;
+	hpa_shard_t *shard = create_test_data(&hooks, &opts);
+	bool         deferred_work_generated = false;
+	nstime_init2(&defer_curtime, 100, 0);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	expect_ptr_null(hpa_alloc(tsdn, shard, 4 * HUGEPAGE + PAGE, PAGE,
+	                    false, false, false, &deferred_work_generated),
+	    "Allocation above span_max_alloc should fail");
+
+	size_t   size = 2 * HUGEPAGE + PAGE;
+	edata_t *span = hpa_alloc(tsdn, shard, size, PAGE, false, false,
+	    false, &deferred_work_generated);
+	expect_ptr_not_null(span, "Span allocation failed");
+	expect_zu_eq(size, edata_size_get(span), "");
+	expect_ptr_eq(HUGEPAGE_ADDR2BASE(edata_addr_get(span)),
+	    edata_addr_get(span), "Span should be hugepage-aligned");
+	expect_zu_eq(2, shard->psset.stats.full_slabs[0].npageslabs,
+	    "The span's whole hugepages should be full");
+
+	/* Small allocations don't come out of the span's last hugepage. */
+	edata_t *small = hpa_alloc(tsdn, shard, PAGE, PAGE, false, false,
+	    false, &deferred_work_generated);
+	expect_ptr_not_null(small, "Unexpected null edata");
+	expect_true((uintptr_t)edata_addr_get(small)
+	            >= (uintptr_t)edata_addr_get(span) + 3 * HUGEPAGE
+	        || (uintptr_t)edata_addr_get(small)
+	            < (uintptr_t)edata_addr_get(span),
+	    "Small allocation placed inside a span");
+
+	/* The full hugepages get hugified like any other. */
+	hpa_shard_do_deferred_work(tsdn, shard);
+	expect_zu_eq(2, ndefer_hugify_calls, "Span should be hugified");
+
+	/* A freed span backs the next allocation of the same length. */
+	void *addr = edata_addr_get(span);
+	hpa_dalloc(tsdn, shard, span, &deferred_work_generated);
+	span = hpa_alloc(tsdn, shard, 3 * HUGEPAGE, PAGE, false, false,
+	    false, &deferred_work_generated);
+	expect_ptr_not_null(span, "Span allocation failed");
+	expect_ptr_eq(addr, edata_addr_get(span), "Free span not reused");
+
+	edata_t *other = hpa_alloc(tsdn, shard, HUGEPAGE + PAGE, PAGE, false,
+	    false, false, &deferred_work_generated);
+	expect_ptr_not_null(other, "Span allocation failed");
+	expect_ptr_ne(addr, edata_addr_get(other), "Span used twice");
+
+	hpa_dalloc(tsdn, shard, other, &deferred_work_generated);
+	hpa_dalloc(tsdn, shard, span, &deferred_work_generated);
+	hpa_dalloc(tsdn, shard, small, &deferred_work_generated);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_span_split_merge) {
+	test_skip_if(!hpa_supported());
+
+	hpa_hooks_t hooks;
+	hooks.map = &defer_test_map;
+	hooks.unmap = &defer_test_unmap;
+	hooks.purge = &defer_test_purge;
+	hooks.hugify = &defer_test_hugify;
+	hooks.dehugify = &defer_test_dehugify;
+	hooks.curtime = &defer_test_curtime;
+	hooks.ms_since = &defer_test_ms_since;
+	hooks.vectorized_purge = &defer_vectorized_purge;
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.deferral_allowed = true;
+	opts.span_max_alloc = 6 * HUGEPAGE;
+
+	hpa_shard_t *shard = create_test_data(&hooks, &opts);
+	bool         deferred_work_generated = false;
+	nstime_init2(&defer_curtime, 100, 0);
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+	edata_t *whole = hpa_alloc(tsdn, shard, 6 * HUGEPAGE, PAGE, false,
+	    false, false, &deferred_work_generated);
+	expect_ptr_not_null(whole, "Span allocation failed");
+	byte_t *addr = edata_addr_get(whole);
+	hpa_dalloc(tsdn, shard, whole, &deferred_work_generated);
+
+	/* Shorter spans get carved out of the free one. */
+	edata_t *spans[3];
+	for (unsigned i = 0; i < ARRAY_SIZE(spans); i++) {
+		spans[i] = hpa_alloc(tsdn, shard, HUGEPAGE + PAGE, PAGE, false,
+		    false, false, &deferred_work_generated);
+		expect_ptr_not_null(spans[i], "Span allocation failed");
+		expect_ptr_eq(addr + i * 2 * HUGEPAGE,
+		    edata_addr_get(spans[i]), "Free span should be split");
+	}
+	edata_t *other = hpa_alloc(tsdn, shard, HUGEPAGE + PAGE, PAGE, false,
+	    false, false, &deferred_work_generated);
+	expect_ptr_not_null(other, "Span allocation failed");
+	expect_true((byte_t *)edata_addr_get(other) < addr
+	        || (byte_t *)edata_addr_get(other) >= addr + 6 * HUGEPAGE,
+	    "Span used twice");
+	hpa_dalloc(tsdn, shard, other, &deferred_work_generated);
+
+	/* Freed spans merge with the free spans on either side. */
+	hpa_dalloc(tsdn, shard, spans[0], &deferred_work_generated);
+	hpa_dalloc(tsdn, shard, spans[2], &deferred_work_generated);
+	hpa_dalloc(tsdn, shard, spans[1], &deferred_work_generated);
+	whole = hpa_alloc(tsdn, shard, 5 * HUGEPAGE + PAGE, PAGE, false,
+	    false, false, &deferred_work_generated);
+	expect_ptr_not_null(whole, "Span allocation failed");
+	expect_ptr_eq(addr, edata_addr_get(whole),
+	    "Free spans should have been merged");
+
+	hpa_dalloc(tsdn, shard, whole, &deferred_work_generated);
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_resv_alloc) {
+	test_skip_if(!hpa_supported());
+
+	hpa_hooks_t hooks;
+	hooks.map = &defer_test_map;
+	hooks.unmap = &defer_test_unmap;
+	hooks.purge = &defer_test_purge;
+	hooks.hugify = &defer_test_hugify;
+	hooks.dehugify = &defer_test_dehugify;
+	hooks.curtime = &defer_test_curtime;
+	hooks.ms_since = &defer_test_ms_since;
+	hooks.vectorized_purge = &defer_vectorized_purge;
+
+	hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+	opts.resv_max_alloc = 2 * PAGE;
+
+	hpa_shard_t *shard = create_test_data(&hooks, &opts);
+	bool         deferred_work_generated = false;
+	tsdn_t      *tsdn = tsd_tsdn(tsd_fetch());
+	expect_u_gt(shard->nresv, 0, "Reservations should be enabled");
+
+	/* Grow the shard; the reservations take from existing hugepages. */
+	edata_t *big = hpa_alloc(tsdn, shard, 4 * PAGE, PAGE, false, false,
+	    false, &deferred_work_generated);
+	expect_ptr_not_null(big, "Unexpected null edata");
+
+	enum { NALLOCS = 8 };
+	edata_t *edatas[NALLOCS];
+	for (int i = 0; i < NALLOCS; i++) {
+		edatas[i] = hpa_alloc(tsdn, shard, (i % 2 + 1) * PAGE, PAGE,
+		    false, false, false, &deferred_work_generated);
+		expect_ptr_not_null(edatas[i], "Unexpected null edata");
+	}
+	/* All from this thread's reservation, so back to back. */
+	for (int i = 1; i < NALLOCS; i++) {
+		expect_ptr_eq(edata_past_get(edatas[i - 1]),
+		    edata_addr_get(edatas[i]), "Reservation not carved in order");
+	}
+	expect_zu_eq(4 + HPA_RESV_NPAGES, shard->psset.stats.merged.nactive,
+	    "The whole reservation should count as active");
+
+	for (int i = 0; i < NALLOCS; i++) {
+		hpa_dalloc(tsdn, shard, edatas[i], &deferred_work_generated);
+	}
+	expect_zu_eq(4 + HPA_RESV_NPAGES - NALLOCS / 2 * 3,
+	    shard->psset.stats.merged.nactive,
+	    "Freed extents should return to the hpdata");
+	hpa_shard_flush(tsdn, shard);
+	expect_zu_eq(4, shard->psset.stats.merged.nactive,
+	    "Flushing should release the reservations");
+
+	/* A flushed reservation refills on demand. */
+	edata_t *edata = hpa_alloc(tsdn, shard, PAGE, PAGE, false, false,
+	    false, &deferred_work_generated);
+	expect_ptr_not_null(edata, "Unexpected null edata");
+	hpa_dalloc(tsdn, shard, edata, &deferred_work_generated);
+	hpa_dalloc(tsdn, shard, big, &deferred_work_generated);
+
+	destroy_test_data(shard);
+}
+TEST_END
+
+TEST_BEGIN(test_purge_lru) {
+	test_skip_if(!hpa_supported());
+
+	hpa_hooks_t hooks;
+	hooks.map = &defer_test_map;
+	hooks.unmap = &defer_test_unmap;
+	hooks.purge = &defer_test_purge;
+	hooks.hugify = &defer_test_hugify;
+	hooks.dehugify = &defer_test_dehugify;
+	hooks.curtime = &defer_test_curtime;
+	hooks.ms_since = &defer_test_ms_since;
+	hooks.vectorized_purge = &defer_vectorized_purge;
+
+	for (int lru = 0; lru < 2; lru++) {
+		hpa_shard_opts_t opts = test_hpa_shard_opts_default;
+		opts.deferral_allowed = true;
+		opts.purge_lru = (lru == 1);
+
+		hpa_shard_t *shard = create_test_data(&hooks, &opts);
+		bool         deferred_work_generated = false;
+		nstime_init(&defer_curtime, 0);
+		tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+
+		enum { NALLOCS = 4 * HUGEPAGE_PAGES };
+		edata_t *edatas[NALLOCS];
+		for (int i = 0; i < NALLOCS; i++) {
+			edatas[i] = hpa_alloc(tsdn, shard, PAGE, PAGE, false,
+			    false, false, &deferred_work_generated);
+			expect_ptr_not_null(edatas[i], "Unexpected null edata");
+		}
+		/*
+		 * Free 200 pages of the first hugepage, then 300 of the
+		 * second; purging either one brings us under dirty_mult.
+		 */
+		hpdata_t *older = edata_ps_get(edatas[0]);
+		hpdata_t *newer = edata_ps_get(edatas[HUGEPAGE_PAGES]);
+		for (int i = 0; i < 200; i++) {
+			hpa_dalloc(tsdn, shard, edatas[i],
+			    &deferred_work_generated);
+		}
+		for (int i = 0; i < 300; i++) {
+			hpa_dalloc(tsdn, shard, edatas[HUGEPAGE_PAGES + i],
+			    &deferred_work_generated);
+		}
+		nstime_init2(&defer_curtime, 6, 0);
+		hpa_shard_do_deferred_work(tsdn, shard);
+
+		/* The dirtier hugepage by default, the idler one with LRU. */
+		hpdata_t *purged = lru ? older : newer;
+		hpdata_t *kept = lru ? newer : older;
+		expect_zu_eq(HUGEPAGE_PAGES - (lru ? 200 : 300),
+		    hpdata_ntouched_get(purged), "Wrong hugepage purged");
+		expect_zu_eq(HUGEPAGE_PAGES, hpdata_ntouched_get(kept),
+		    "Unexpected purge");
+		expect_u64_eq(0, shard->stats.nrefaults, "");
+
+		/* Reusing the purged pages counts one refault. */
+		for (int i = 0; i < 2; i++) {
+			edata_t *edata = hpa_alloc(tsdn, shard, PAGE, PAGE,
+			    false, false, false, &deferred_work_generated);
+			expect_ptr_eq(older, edata_ps_get(edata),
+			    "Should reuse the fullest hugepage");
+		}
+		expect_u64_eq(lru ? 1 : 0, shard->stats.nrefaults, "");
+		expect_true(lru || shard->activity_counter == 0,
+		    "Activity should only be tracked for the LRU policy");
+
+		destroy_test_data(shard);
+	}
+}
+TEST_END
+
 int
 main(void) {
 	/*
@@ -1440,7 +1860,7 @@ main(void) {
 	(void)mem_tree_iter;
 	(void)mem_tree_reverse_iter;
 	(void)mem_tree_destroy;
-	return test_no_reentrancy(test_alloc_max, test_stress, test_defer_time,
+	return test_no_reentrancy(test_alloc_max, test_alloc_zero, test_stress, test_defer_time,
 	    test_purge_no_infinite_loop, test_no_min_purge_interval,
 	    test_min_purge_interval, test_purge,
 	    test_experimental_max_purge_nhp, test_vectorized_opt_eq_zero,
@@ -1449,5 +1869,7 @@ main(void) {
 	    test_delay_when_not_allowed_deferral, test_deferred_until_time,
 	    test_eager_no_hugify_on_threshold,
 	    test_hpa_hugify_style_none_huge_no_syscall,
-	    test_experimental_hpa_enforce_hugify);
+	    test_experimental_hpa_enforce_hugify, test_collapse_budget,
+	    test_span_alloc, test_span_split_merge, test_resv_alloc,
+	    test_purge_lru);
 }
@@ -43,7 +43,15 @@ static hpa_shard_opts_t test_hpa_shard_opts = {
     /* min_purge_delay_ms */
     10,
     /* hugify_style */
-    hpa_hugify_style_lazy};
+    hpa_hugify_style_lazy,
+    /* collapse_budget_us */
+    0,
+    /* span_max_alloc */
+    0,
+    /* resv_max_alloc */
+    0,
+    /* purge_lru */
+    false};
 
 static hpa_shard_t *
 create_test_data(const hpa_hooks_t *hooks, hpa_shard_opts_t *opts,
@@ -161,6 +169,8 @@ TEST_BEGIN(test_hpa_sec) {
 	sec_opts.nshards = 1;
 	sec_opts.max_alloc = 2 * PAGE;
 	sec_opts.max_bytes = NALLOCS * PAGE;
+	sec_opts.percpu = false;
+	sec_opts.adaptive = false;
 
 	hpa_shard_t *shard = create_test_data(&hooks, &opts, &sec_opts);
 	bool         deferred_work_generated = false;
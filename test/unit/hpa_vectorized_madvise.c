@@ -43,7 +43,15 @@ static hpa_shard_opts_t test_hpa_shard_opts_default = {
     /* purge_delay_ms */
     0,
     /* hugify_style */
-    hpa_hugify_style_lazy};
+    hpa_hugify_style_lazy,
+    /* collapse_budget_us */
+    0,
+    /* span_max_alloc */
+    0,
+    /* resv_max_alloc */
+    0,
+    /* purge_lru */
+    false};
 
 static hpa_shard_t *
 create_test_data(const hpa_hooks_t *hooks, hpa_shard_opts_t *opts) {
@@ -55,6 +55,99 @@ TEST_BEGIN(test_reserve_alloc) {
 }
 TEST_END
 
+/* The first free range of at least npages in the shadow map, or -1. */
+static ssize_t
+shadow_first_fit(const bool *active, size_t npages) {
+	size_t len = 0;
+	for (size_t i = 0; i < HUGEPAGE_PAGES; i++) {
+		len = active[i] ? 0 : len + 1;
+		if (len == npages) {
+			return (ssize_t)(i + 1 - npages);
+		}
+	}
+	return -1;
+}
+
+static size_t
+shadow_longest(const bool *active) {
+	size_t len = 0;
+	size_t longest = 0;
+	for (size_t i = 0; i < HUGEPAGE_PAGES; i++) {
+		len = active[i] ? 0 : len + 1;
+		longest = len > longest ? len : longest;
+	}
+	return longest;
+}
+
+TEST_BEGIN(test_reserve_alloc_random) {
+	hpdata_t hpdata;
+	hpdata_init(&hpdata, HPDATA_ADDR, HPDATA_AGE, /* is_huge */ false);
+
+	/* Checks the free range summary against a shadow copy. */
+	bool     active[HUGEPAGE_PAGES] = {false};
+	uint64_t state = 42;
+	for (int op = 0; op < 20000; op++) {
+		size_t npages = 1 + (size_t)prng_range_u64(&state, 16);
+		if (prng_range_u64(&state, 2) == 0) {
+			ssize_t expected = shadow_first_fit(active, npages);
+			if (expected < 0) {
+				expect_zu_lt(hpdata_longest_free_range_get(
+				                 &hpdata),
+				    npages, "");
+				continue;
+			}
+			void *alloc = hpdata_reserve_alloc(
+			    &hpdata, npages * PAGE);
+			expect_ptr_eq((char *)HPDATA_ADDR + expected * PAGE,
+			    alloc, "Not first fit");
+			for (size_t i = 0; i < npages; i++) {
+				active[expected + i] = true;
+			}
+		} else {
+			/* Free the active pages around a random page. */
+			size_t begin = (size_t)prng_range_u64(
+			    &state, HUGEPAGE_PAGES);
+			size_t len = 0;
+			while (begin + len < HUGEPAGE_PAGES
+			    && active[begin + len] && len < npages) {
+				active[begin + len] = false;
+				len++;
+			}
+			if (len > 0) {
+				hpdata_unreserve(&hpdata,
+				    (char *)HPDATA_ADDR + begin * PAGE,
+				    len * PAGE);
+			}
+		}
+		expect_true(hpdata_consistent(&hpdata), "");
+		expect_zu_eq(shadow_longest(active),
+		    hpdata_longest_free_range_get(&hpdata), "");
+	}
+
+	/* Batched allocations skip the ranges that are too short. */
+	size_t npages = 3;
+	if (shadow_first_fit(active, npages) >= 0) {
+		hpdata_alloc_offset_t offsets[8];
+		size_t nallocs = hpdata_find_alloc_offsets(
+		    &hpdata, npages * PAGE, offsets, 8);
+		expect_zu_eq((size_t)shadow_first_fit(active, npages),
+		    offsets[0].index, "");
+		for (size_t i = 0; i < nallocs; i++) {
+			hpdata_reserve_alloc_offset(
+			    &hpdata, npages * PAGE, &offsets[i]);
+			for (size_t j = 0; j < npages; j++) {
+				active[offsets[i].index + j] = true;
+			}
+		}
+		hpdata_post_reserve_alloc_offsets(
+		    &hpdata, npages * PAGE, offsets, nallocs);
+		expect_true(hpdata_consistent(&hpdata), "");
+		expect_zu_eq(shadow_longest(active),
+		    hpdata_longest_free_range_get(&hpdata), "");
+	}
+}
+TEST_END
+
 TEST_BEGIN(test_purge_simple) {
 	hpdata_t hpdata;
 	hpdata_init(&hpdata, HPDATA_ADDR, HPDATA_AGE, /* is_huge */ false);
@@ -254,7 +347,8 @@ TEST_END
 
 int
 main(void) {
-	return test_no_reentrancy(test_reserve_alloc, test_purge_simple,
+	return test_no_reentrancy(test_reserve_alloc,
+	    test_reserve_alloc_random, test_purge_simple,
 	    test_purge_intervening_dalloc, test_purge_over_retained,
 	    test_hugify);
 }
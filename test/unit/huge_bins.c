@@ -0,0 +1,185 @@
+#include "test/jemalloc_test.h"
+
+#define HUGE_SZ 64
+#define OTHER_SZ 128
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+test_arena_reset(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = ARRAY_SIZE(mib);
+	expect_d_eq(mallctlnametomib("arena.0.reset", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	expect_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static bool
+bin_huge_get(size_t size) {
+	size_t mib[4];
+	size_t miblen = ARRAY_SIZE(mib);
+	expect_d_eq(mallctlnametomib("arenas.bin.0.huge", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[2] = (size_t)sz_size2index(size);
+	bool   huge;
+	size_t sz = sizeof(huge);
+	expect_d_eq(mallctlbymib(mib, miblen, (void *)&huge, &sz, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+	return huge;
+}
+
+static size_t
+bin_stat_get(unsigned arena_ind, size_t size, const char *name) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.bins.%u.%s",
+	    arena_ind, (unsigned)sz_size2index(size), name);
+	size_t val;
+	size_t sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+TEST_BEGIN(test_huge_bins_ctl) {
+	expect_true(bin_huge_get(HUGE_SZ), "Selected bin should be huge");
+	expect_false(bin_huge_get(OTHER_SZ), "Other bins should not be huge");
+}
+TEST_END
+
+TEST_BEGIN(test_huge_bins_region) {
+	test_skip_if(opt_prof);
+
+	unsigned arena_ind = arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	szind_t  binind = sz_size2index(HUGE_SZ);
+	size_t   nregs = bin_infos[binind].nregs;
+
+	/* Two full slabs, which come from the same hugepage. */
+	size_t nobjs = 2 * nregs;
+	void **ptrs = mallocx(nobjs * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (size_t i = 0; i < nobjs; i++) {
+		ptrs[i] = mallocx(HUGE_SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	void *first = ptrs[0];
+	void *last = ptrs[nobjs - 1];
+	expect_ptr_eq(HUGEPAGE_ADDR2BASE(first), HUGEPAGE_ADDR2BASE(last),
+	    "Slabs should share a hugepage");
+
+	for (size_t i = 0; i < nobjs; i++) {
+		dallocx(ptrs[i], flags);
+	}
+	/* Freed slabs are reused rather than returned to the arena. */
+	void *p = mallocx(HUGE_SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_ptr_eq(HUGEPAGE_ADDR2BASE(p), HUGEPAGE_ADDR2BASE(first),
+	    "Freed slab should be reused");
+	dallocx(p, flags);
+	dallocx(ptrs, 0);
+
+	test_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_huge_bins_stats) {
+	test_skip_if(!config_stats);
+	test_skip_if(opt_prof);
+
+	unsigned arena_ind = arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	void *p = mallocx(HUGE_SZ, flags);
+	void *q = mallocx(OTHER_SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	expect_zu_eq(bin_stat_get(arena_ind, HUGE_SZ, "curslabs_huge"), 1,
+	    "Huge bin slab should be counted");
+	expect_zu_eq(bin_stat_get(arena_ind, OTHER_SZ, "curslabs_huge"), 0,
+	    "Other bins should have no huge slabs");
+	dallocx(p, flags);
+	dallocx(q, flags);
+	expect_zu_eq(bin_stat_get(arena_ind, HUGE_SZ, "curslabs_huge"), 0,
+	    "Freed slab should no longer be counted");
+
+	p = mallocx(HUGE_SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	test_arena_reset(arena_ind);
+	expect_zu_eq(bin_stat_get(arena_ind, HUGE_SZ, "curslabs_huge"), 0,
+	    "Reset should release every slab");
+}
+TEST_END
+
+static size_t
+arena_stat_get(unsigned arena_ind, const char *name) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(
+	    cmd, sizeof(cmd), "stats.arenas.%u.%s", arena_ind, name);
+	size_t val;
+	size_t sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+TEST_BEGIN(test_huge_bins_free_cap) {
+	test_skip_if(!config_stats);
+	test_skip_if(opt_prof);
+
+	unsigned arena_ind = arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	szind_t  binind = sz_size2index(HUGE_SZ);
+	size_t   nregs = bin_infos[binind].nregs;
+	size_t   slab_size = bin_infos[binind].slab_size;
+
+	/* Twice as many slabs as are kept once freed. */
+	size_t nobjs = 2 * PA_HUGE_BINS_NFREE_MAX * nregs;
+	void **ptrs = mallocx(nobjs * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (size_t i = 0; i < nobjs; i++) {
+		ptrs[i] = mallocx(HUGE_SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	expect_zu_eq(arena_stat_get(arena_ind, "huge_bins_dirty_bytes"), 0,
+	    "No free slabs yet");
+	size_t pdirty = arena_stat_get(arena_ind, "pdirty");
+	for (size_t i = 0; i < nobjs; i++) {
+		dallocx(ptrs[i], flags);
+	}
+	dallocx(ptrs, 0);
+
+	expect_zu_eq(arena_stat_get(arena_ind, "huge_bins_dirty_bytes"),
+	    PA_HUGE_BINS_NFREE_MAX * slab_size,
+	    "Only a bounded number of free slabs should be kept");
+	expect_zu_ge(arena_stat_get(arena_ind, "pdirty"),
+	    pdirty + PA_HUGE_BINS_NFREE_MAX * slab_size / PAGE,
+	    "The other slabs should have gone back to the arena");
+
+	test_arena_reset(arena_ind);
+	expect_zu_eq(arena_stat_get(arena_ind, "huge_bins_dirty_bytes"), 0,
+	    "Reset should release every free slab");
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_huge_bins_ctl, test_huge_bins_region,
+	    test_huge_bins_stats, test_huge_bins_free_cap);
+}
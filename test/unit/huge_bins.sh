@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="huge_bins:64-64:1"
@@ -70,7 +70,124 @@ TEST_BEGIN(test_large_ralloc_no_move_expand_fail) {
 }
 TEST_END
 
+static void
+fill(void *p, size_t size, uint8_t seed) {
+	for (size_t i = 0; i < size; i += sizeof(size_t)) {
+		*(size_t *)((byte_t *)p + i) = i + seed;
+	}
+}
+
+static void
+check(void *p, size_t size, uint8_t seed) {
+	for (size_t i = 0; i < size; i += sizeof(size_t)) {
+		if (*(size_t *)((byte_t *)p + i) != i + seed) {
+			expect_zu_eq(*(size_t *)((byte_t *)p + i), i + seed,
+			    "Contents lost at offset %zu", i);
+			return;
+		}
+	}
+}
+
+/*
+ * Grow and shrink allocations that cannot be resized in place, so that their
+ * contents are moved, by remapping when they are large enough.
+ */
+TEST_BEGIN(test_large_ralloc_move) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	size_t size = SC_LARGE_MINCLASS;
+	void  *p = mallocx(size, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	uint8_t seed = 0;
+	fill(p, size, seed);
+	for (unsigned i = 0; i < 8; i++) {
+		/* Block in-place expansion. */
+		void *blocker = mallocx(SC_LARGE_MINCLASS, flags);
+		expect_ptr_not_null(blocker, "Unexpected mallocx() failure");
+
+		size_t new_size = size * 2;
+		void  *q = rallocx(p, new_size, flags | MALLOCX_ZERO);
+		expect_ptr_not_null(q, "Unexpected rallocx() failure");
+		check(q, size, seed);
+		for (size_t j = size; j < new_size; j++) {
+			if (((uint8_t *)q)[j] != 0) {
+				expect_u_eq(((uint8_t *)q)[j], 0,
+				    "Grown part should be zeroed");
+				break;
+			}
+		}
+		seed++;
+		fill(q, new_size, seed);
+		dallocx(blocker, flags);
+
+		p = q;
+		size = new_size;
+	}
+
+	/* Shrink by moving to an over-aligned allocation. */
+	size_t new_size = size / 2;
+	void  *q = rallocx(p, new_size, flags | MALLOCX_ALIGN(HUGEPAGE));
+	expect_ptr_not_null(q, "Unexpected rallocx() failure");
+	expect_ptr_eq(HUGEPAGE_ADDR2BASE(q), q, "Alignment not honored");
+	check(q, new_size, seed);
+	dallocx(q, flags);
+}
+TEST_END
+
+static size_t
+remap_mappings_get(void) {
+	size_t mappings;
+	size_t sz = sizeof(mappings);
+	expect_d_eq(mallctl("stats.realloc_remap_mappings", (void *)&mappings,
+	                &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return mappings;
+}
+
+/*
+ * The mappings a remap is charged for come back once the allocation holding
+ * the moved pages is freed, but not when it merely shrinks.
+ */
+TEST_BEGIN(test_large_ralloc_remap_mappings) {
+	test_skip_if(!config_stats);
+	size_t avail = remap_mappings_get();
+	test_skip_if(avail == 0);
+
+	unsigned arena_ind;
+	size_t   sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	int flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	size_t size = 4 * SC_LARGE_MINCLASS;
+	void  *p = mallocx(size, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	/* Block in-place expansion. */
+	void *blocker = mallocx(size, flags);
+	expect_ptr_not_null(blocker, "Unexpected mallocx() failure");
+	void *q = rallocx(p, 2 * size, flags);
+	expect_ptr_not_null(q, "Unexpected rallocx() failure");
+	dallocx(blocker, flags);
+	size_t remapped = remap_mappings_get();
+	expect_zu_le(remapped, avail, "Remapping can't add to the budget");
+
+	expect_zu_eq(xallocx(q, size, 0, flags), size,
+	    "Unexpected xallocx() failure");
+	expect_zu_eq(remap_mappings_get(), remapped,
+	    "Shrinking shouldn't hand the mappings back");
+
+	dallocx(q, flags);
+	expect_zu_eq(remap_mappings_get(), avail,
+	    "Freeing should hand the mappings back");
+}
+TEST_END
+
 int
 main(void) {
-	return test_no_reentrancy(test_large_ralloc_no_move_expand_fail);
+	return test_no_reentrancy(test_large_ralloc_no_move_expand_fail,
+	    test_large_ralloc_move, test_large_ralloc_remap_mappings);
 }
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="realloc_remap_threshold:16384"
@@ -308,19 +308,40 @@ TEST_BEGIN(test_mallctl_opt) {
 	TEST_MALLCTL_OPT(const char *, dss, always);
 	TEST_MALLCTL_OPT(bool, hpa, always);
 	TEST_MALLCTL_OPT(size_t, hpa_slab_max_alloc, always);
+	TEST_MALLCTL_OPT(size_t, hpa_span_max_alloc, always);
+	TEST_MALLCTL_OPT(size_t, hpa_resv_max_alloc, always);
 	TEST_MALLCTL_OPT(bool, hpa_hugify_sync, always);
+	TEST_MALLCTL_OPT(bool, hpa_purge_lru, always);
+	TEST_MALLCTL_OPT(uint64_t, hpa_collapse_budget_us, always);
 	TEST_MALLCTL_OPT(size_t, hpa_sec_nshards, always);
 	TEST_MALLCTL_OPT(size_t, hpa_sec_max_alloc, always);
 	TEST_MALLCTL_OPT(size_t, hpa_sec_max_bytes, always);
+	TEST_MALLCTL_OPT(bool, hpa_sec_percpu, always);
+	TEST_MALLCTL_OPT(bool, hpa_sec_adaptive, always);
+	TEST_MALLCTL_OPT(unsigned, purge_threads, always);
+	TEST_MALLCTL_OPT(size_t, purge_budget, always);
 	TEST_MALLCTL_OPT(ssize_t, experimental_hpa_max_purge_nhp, always);
 	TEST_MALLCTL_OPT(size_t, hpa_purge_threshold, always);
 	TEST_MALLCTL_OPT(uint64_t, hpa_min_purge_delay_ms, always);
 	TEST_MALLCTL_OPT(const char *, hpa_hugify_style, always);
 	TEST_MALLCTL_OPT(unsigned, narenas, always);
+	TEST_MALLCTL_OPT(bool, bin_regions, always);
+	TEST_MALLCTL_OPT(unsigned, lg_bin_region, always);
+	TEST_MALLCTL_OPT(bool, bin_remote_free, always);
+	TEST_MALLCTL_OPT(size_t, bin_remote_free_max, always);
+	TEST_MALLCTL_OPT(bool, slab_size_auto, always);
+	TEST_MALLCTL_OPT(bool, percpu_cache, always);
+	TEST_MALLCTL_OPT(bool, pressure_purge, always);
+	TEST_MALLCTL_OPT(bool, numa, always);
 	TEST_MALLCTL_OPT(const char *, percpu_arena, always);
 	TEST_MALLCTL_OPT(size_t, oversize_threshold, always);
+	TEST_MALLCTL_OPT(size_t, realloc_remap_threshold, always);
+	TEST_MALLCTL_OPT(size_t, zero_pool_max, always);
 	TEST_MALLCTL_OPT(bool, background_thread, always);
 	TEST_MALLCTL_OPT(ssize_t, dirty_decay_ms, always);
+	TEST_MALLCTL_OPT(bool, dirty_decay_predictive, always);
+	TEST_MALLCTL_OPT(ssize_t, cold_age_ms, always);
+	TEST_MALLCTL_OPT(bool, cold_pageout, always);
 	TEST_MALLCTL_OPT(ssize_t, muzzy_decay_ms, always);
 	TEST_MALLCTL_OPT(bool, stats_print, always);
 	TEST_MALLCTL_OPT(const char *, stats_print_opts, always);
@@ -333,6 +354,9 @@ TEST_BEGIN(test_mallctl_opt) {
 	TEST_MALLCTL_OPT(bool, tcache, always);
 	TEST_MALLCTL_OPT(size_t, lg_extent_max_active_fit, always);
 	TEST_MALLCTL_OPT(size_t, tcache_max, always);
+	TEST_MALLCTL_OPT(bool, tcache_adaptive, always);
+	TEST_MALLCTL_OPT(size_t, tcache_adaptive_budget, always);
+	TEST_MALLCTL_OPT(size_t, tcache_global_budget, always);
 	TEST_MALLCTL_OPT(const char *, thp, always);
 	TEST_MALLCTL_OPT(const char *, zero_realloc, always);
 	TEST_MALLCTL_OPT(bool, prof, prof);
@@ -949,6 +973,7 @@ TEST_BEGIN(test_arenas_bin_constants) {
 	TEST_ARENAS_BIN_CONSTANT(uint32_t, nregs, bin_infos[0].nregs);
 	TEST_ARENAS_BIN_CONSTANT(size_t, slab_size, bin_infos[0].slab_size);
 	TEST_ARENAS_BIN_CONSTANT(uint32_t, nshards, bin_infos[0].n_shards);
+	TEST_ARENAS_BIN_CONSTANT(bool, huge, bin_infos[0].huge);
 
 #undef TEST_ARENAS_BIN_CONSTANT
 }
@@ -0,0 +1,106 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/mem_pressure.h"
+
+TEST_BEGIN(test_psi_parse) {
+	uint64_t avg10;
+
+	expect_false(mem_pressure_psi_parse(
+	                 "some avg10=1.23 avg60=0.50 avg300=0.10 total=42\n"
+	                 "full avg10=0.45 avg60=0.20 avg300=0.05 total=17\n",
+	                 &avg10),
+	    "Unexpected parse failure");
+	expect_u64_eq(avg10, 123, "Unexpected some avg10");
+
+	expect_false(mem_pressure_psi_parse(
+	                 "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+	                 &avg10),
+	    "Unexpected parse failure");
+	expect_u64_eq(avg10, 0, "Unexpected some avg10");
+
+	expect_false(mem_pressure_psi_parse("some avg10=37.5 avg60=1.00",
+	                 &avg10),
+	    "Unexpected parse failure");
+	expect_u64_eq(avg10, 3750, "Unexpected some avg10");
+
+	expect_true(mem_pressure_psi_parse("full avg10=1.00 avg60=1.00",
+	                &avg10),
+	    "Parse should fail without a some line");
+	expect_true(mem_pressure_psi_parse("some avg10=x", &avg10),
+	    "Parse should fail without a value");
+}
+TEST_END
+
+TEST_BEGIN(test_compute) {
+	expect_d_eq(mem_pressure_compute(0, 0, 0), mem_pressure_headroom,
+	    "No stalls and no limit should leave headroom");
+	expect_d_eq(mem_pressure_compute(50, 0, 0), mem_pressure_normal,
+	    "Light stalls should be normal");
+	expect_d_eq(mem_pressure_compute(MEM_PRESSURE_PSI_MODERATE, 0, 0),
+	    mem_pressure_moderate, "Unexpected level");
+	expect_d_eq(mem_pressure_compute(MEM_PRESSURE_PSI_HIGH, 0, 0),
+	    mem_pressure_high, "Unexpected level");
+
+	uint64_t limit = (uint64_t)1 << 30;
+	expect_d_eq(mem_pressure_compute(0, limit / 4, limit),
+	    mem_pressure_headroom, "Unexpected level");
+	expect_d_eq(mem_pressure_compute(0, limit / 2 + limit / 8, limit),
+	    mem_pressure_normal, "Unexpected level");
+	expect_d_eq(mem_pressure_compute(0, limit / 100 * 85, limit),
+	    mem_pressure_moderate, "Unexpected level");
+	expect_d_eq(mem_pressure_compute(0, limit / 100 * 96, limit),
+	    mem_pressure_high, "Unexpected level");
+	expect_d_eq(mem_pressure_compute(0, 2 * limit, limit),
+	    mem_pressure_high, "Usage above the limit should be high");
+	expect_d_eq(mem_pressure_compute(0, UINT64_MAX - 1, UINT64_MAX),
+	    mem_pressure_high, "Unexpected level");
+	/* Either source raises the level on its own. */
+	expect_d_eq(mem_pressure_compute(MEM_PRESSURE_PSI_HIGH, limit / 4,
+	                limit),
+	    mem_pressure_high, "Unexpected level");
+}
+TEST_END
+
+TEST_BEGIN(test_npages_limit) {
+	test_skip_if(!opt_pressure_purge);
+
+	unsigned saved = atomic_load_u(&mem_pressure_level, ATOMIC_RELAXED);
+
+	atomic_store_u(&mem_pressure_level, mem_pressure_headroom,
+	    ATOMIC_RELAXED);
+	expect_zu_eq(mem_pressure_npages_limit(100), 200,
+	    "Headroom should double the budget");
+	expect_zu_eq(mem_pressure_npages_limit(SIZE_MAX), SIZE_MAX,
+	    "Doubling should saturate");
+	atomic_store_u(&mem_pressure_level, mem_pressure_normal,
+	    ATOMIC_RELAXED);
+	expect_zu_eq(mem_pressure_npages_limit(100), 100,
+	    "Normal should keep the budget");
+	atomic_store_u(&mem_pressure_level, mem_pressure_moderate,
+	    ATOMIC_RELAXED);
+	expect_zu_eq(mem_pressure_npages_limit(100), 50,
+	    "Moderate pressure should halve the budget");
+	atomic_store_u(&mem_pressure_level, mem_pressure_high,
+	    ATOMIC_RELAXED);
+	expect_zu_eq(mem_pressure_npages_limit(100), 0,
+	    "High pressure should drop the budget");
+
+	atomic_store_u(&mem_pressure_level, saved, ATOMIC_RELAXED);
+}
+TEST_END
+
+TEST_BEGIN(test_update) {
+	test_skip_if(!opt_pressure_purge);
+
+	/* Whatever the system looks like, the result is a valid level. */
+	mem_pressure_update();
+	expect_u_le(atomic_load_u(&mem_pressure_level, ATOMIC_RELAXED),
+	    mem_pressure_high, "Unexpected level");
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_psi_parse, test_compute, test_npages_limit,
+	    test_update);
+}
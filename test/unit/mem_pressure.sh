@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="pressure_purge:true"
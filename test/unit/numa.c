@@ -0,0 +1,64 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/numa.h"
+
+TEST_BEGIN(test_numa_nodes_parse) {
+	unsigned nodes[NUMA_NODES_MAX];
+	expect_u_eq(numa_nodes_parse("0\n", nodes), 1, "Single node");
+	expect_u_eq(nodes[0], 0, "Wrong node id");
+	expect_u_eq(numa_nodes_parse("0-1\n", nodes), 2, "Node range");
+	expect_u_eq(nodes[1], 1, "Wrong node id");
+
+	/* Offline nodes are skipped. */
+	expect_u_eq(numa_nodes_parse("0,2-3", nodes), 3, "Sparse nodes");
+	expect_u_eq(nodes[0], 0, "Wrong node id");
+	expect_u_eq(nodes[1], 2, "Wrong node id");
+	expect_u_eq(nodes[2], 3, "Wrong node id");
+	expect_u_eq(numa_nodes_parse("1", nodes), 1, "Node numbers are ids");
+	expect_u_eq(nodes[0], 1, "Wrong node id");
+
+	expect_u_eq(numa_nodes_parse("", nodes), 0, "Empty list");
+	expect_u_eq(numa_nodes_parse("node0", nodes), 0, "Malformed list");
+	expect_u_eq(numa_nodes_parse("0-64", nodes), 0, "Too many nodes");
+	expect_u_eq(numa_nodes_parse("3-1", nodes), 0, "Reversed range");
+	expect_u_eq(numa_nodes_parse("2,1", nodes), 0, "Unordered list");
+}
+TEST_END
+
+static void *
+thd_start(void *arg) {
+	unsigned *node = (unsigned *)arg;
+	*node = numa_node_get();
+
+	void *p = malloc(1);
+	expect_ptr_not_null(p, "Unexpected malloc() failure");
+	free(p);
+
+	unsigned arena_ind;
+	size_t   sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("thread.arena", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	/* Migrations in between are possible, but unlikely. */
+	if (*node == numa_node_get() && *node < narenas_auto) {
+		expect_u_eq(numa_arena_node(arena_ind), *node,
+		    "Thread should be bound to an arena on its node");
+	}
+	return NULL;
+}
+
+TEST_BEGIN(test_numa_arena_choose) {
+	test_skip_if(!opt_numa);
+
+	for (unsigned i = 0; i < 8; i++) {
+		thd_t    thd;
+		unsigned node;
+		thd_create(&thd, thd_start, (void *)&node);
+		thd_join(thd, NULL);
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_numa_nodes_parse, test_numa_arena_choose);
+}
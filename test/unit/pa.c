@@ -21,6 +21,24 @@ split_hook(extent_hooks_t *extent_hooks, void *addr, size_t size, size_t size_a,
 	return !maps_coalesce;
 }
 
+static bool purge_fails = false;
+
+static bool
+decommit_hook(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    size_t offset, size_t length, unsigned arena_ind) {
+	return true;
+}
+
+static bool
+purge_forced_hook(extent_hooks_t *extent_hooks, void *addr, size_t size,
+    size_t offset, size_t length, unsigned arena_ind) {
+	if (purge_fails) {
+		return true;
+	}
+	return ehooks_default_extent_hooks.purge_forced(
+	    extent_hooks, addr, size, offset, length, arena_ind);
+}
+
 static void
 init_test_extent_hooks(extent_hooks_t *hooks) {
 	/*
@@ -165,8 +183,69 @@ TEST_BEGIN(test_failed_coalesce_releases_neighbor) {
 }
 TEST_END
 
+static void
+purge_dirty(test_data_t *test_data) {
+	malloc_mutex_lock(TSDN_NULL, &test_data->shard.pac.decay_dirty.mtx);
+	pac_decay_all(TSDN_NULL, &test_data->shard.pac,
+	    &test_data->shard.pac.decay_dirty,
+	    &test_data->shard.pac.stats->decay_dirty,
+	    &test_data->shard.pac.ecache_dirty, true);
+	malloc_mutex_unlock(TSDN_NULL, &test_data->shard.pac.decay_dirty.mtx);
+}
+
+TEST_BEGIN(test_zero_known_pages) {
+	test_skip_if(!maps_coalesce || !opt_retain);
+
+	test_data_t *test_data = init_test_data(-1, -1);
+	test_data->hooks.decommit = &decommit_hook;
+	test_data->hooks.purge_forced = &purge_forced_hook;
+
+	bool     deferred_work_generated = false;
+	size_t   size = 8 * PAGE;
+	edata_t *edata = pa_alloc(TSDN_NULL, &test_data->shard, size, PAGE,
+	    /* slab */ false, sz_size2index(size), /* zero */ false,
+	    /* guarded */ false, &deferred_work_generated);
+	expect_ptr_not_null(edata, "Unexpected pa_alloc() failure");
+	uint8_t *addr = (uint8_t *)edata_base_get(edata);
+	memset(addr, 0xa5, size);
+
+	/* The back half is retained without having been zeroed... */
+	purge_fails = true;
+	expect_false(pa_shrink(TSDN_NULL, &test_data->shard, edata, size,
+	                 size / 2, sz_size2index(size / 2),
+	                 &deferred_work_generated),
+	    "Unexpected pa_shrink() failure");
+	purge_dirty(test_data);
+	/* ... and the front half gets zeroed by the purge. */
+	purge_fails = false;
+	pa_dalloc(TSDN_NULL, &test_data->shard, edata, &deferred_work_generated);
+	purge_dirty(test_data);
+
+	edata_t *retained = emap_edata_lookup(TSDN_NULL, &test_data->emap, addr);
+	expect_ptr_not_null(retained, "Expected a retained extent");
+	expect_d_eq(edata_state_get(retained), extent_state_retained,
+	    "Expected a retained extent");
+	expect_false(edata_zeroed_get(retained),
+	    "Extent shouldn't be zeroed as a whole");
+	expect_zu_eq(edata_zero_lead_npages_get(retained), 4,
+	    "The purged pages should be known to be zero");
+
+	edata = pa_alloc(TSDN_NULL, &test_data->shard, size, PAGE,
+	    /* slab */ false, sz_size2index(size), /* zero */ true,
+	    /* guarded */ false, &deferred_work_generated);
+	expect_ptr_not_null(edata, "Unexpected pa_alloc() failure");
+	expect_ptr_eq(edata_base_get(edata), addr, "Expected to reuse pages");
+	expect_true(edata_zeroed_get(edata), "Extent should be zeroed");
+	for (size_t i = 0; i < size; i++) {
+		expect_u_eq(addr[i], 0, "Byte %zu isn't zeroed", i);
+	}
+	pa_dalloc(TSDN_NULL, &test_data->shard, edata, &deferred_work_generated);
+	destroy_test_data(test_data);
+}
+TEST_END
+
 int
 main(void) {
-	return test(
-	    test_alloc_free_purge_thds, test_failed_coalesce_releases_neighbor);
+	return test(test_alloc_free_purge_thds,
+	    test_failed_coalesce_releases_neighbor, test_zero_known_pages);
 }
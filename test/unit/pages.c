@@ -23,7 +23,33 @@ TEST_BEGIN(test_pages_huge) {
 }
 TEST_END
 
+TEST_BEGIN(test_pages_remap) {
+	size_t size = 4 * PAGE;
+	bool   commit = true;
+	uint8_t *pages = (uint8_t *)pages_map(NULL, 2 * size, PAGE, &commit);
+	expect_ptr_not_null(pages, "Unexpected pages_map() error");
+	uint8_t *dst = pages + size;
+
+	memset(pages, 0xa5, size);
+	memset(dst, 0x5a, size);
+	if (pages_remap(pages, dst, size)) {
+		/* Not supported here; neither range may have changed. */
+		for (size_t i = 0; i < size; i++) {
+			expect_u_eq(pages[i], 0xa5, "Source was modified");
+			expect_u_eq(dst[i], 0x5a, "Destination was modified");
+		}
+	} else {
+		for (size_t i = 0; i < size; i++) {
+			expect_u_eq(dst[i], 0xa5, "Contents were not moved");
+			expect_u_eq(pages[i], 0, "Source should read as zeros");
+		}
+	}
+
+	pages_unmap(pages, 2 * size);
+}
+TEST_END
+
 int
 main(void) {
-	return test(test_pages_huge);
+	return test(test_pages_huge, test_pages_remap);
 }
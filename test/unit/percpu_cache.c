@@ -0,0 +1,231 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/percpu_cache.h"
+
+#define NALLOC 64
+#define SZ 64
+#define NTHREADS 4
+#define NITER 10000
+
+static void
+thread_tcache_flush(void) {
+	expect_d_eq(mallctl("thread.tcache.flush", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+}
+
+static void
+percpu_cache_flush(void) {
+	expect_d_eq(
+	    mallctl("experimental.percpu_cache_flush", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+}
+
+static size_t
+percpu_cache_bytes(void) {
+	size_t bytes;
+	size_t sz = sizeof(bytes);
+	expect_d_eq(mallctl("stats.percpu_cache_bytes", (void *)&bytes, &sz,
+	                NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return bytes;
+}
+
+static void
+alloc_and_free(unsigned flags) {
+	void *ptrs[NALLOC];
+	for (unsigned i = 0; i < NALLOC; i++) {
+		ptrs[i] = mallocx(SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < NALLOC; i++) {
+		dallocx(ptrs[i], 0);
+	}
+}
+
+TEST_BEGIN(test_percpu_cache_flush) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!config_stats);
+	test_skip_if(!percpu_cache_enabled());
+
+	thread_tcache_flush();
+	percpu_cache_flush();
+	expect_zu_eq(percpu_cache_bytes(), 0, "Per-CPU caches should be empty");
+
+	/* Whatever the thread cache flushes stops at the per-CPU cache. */
+	alloc_and_free(0);
+	thread_tcache_flush();
+	expect_zu_ge(percpu_cache_bytes(), NALLOC * SZ,
+	    "Flushed objects should be held by the per-CPU cache");
+
+	percpu_cache_flush();
+	expect_zu_eq(percpu_cache_bytes(), 0, "Per-CPU caches should be empty");
+}
+TEST_END
+
+TEST_BEGIN(test_percpu_cache_manual_arena) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!config_stats);
+	test_skip_if(!percpu_cache_enabled());
+
+	unsigned arena_ind;
+	size_t   sz = sizeof(arena_ind);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+
+	thread_tcache_flush();
+	percpu_cache_flush();
+	alloc_and_free(MALLOCX_ARENA(arena_ind));
+	thread_tcache_flush();
+	expect_zu_eq(percpu_cache_bytes(), 0,
+	    "Objects from manual arenas should bypass the per-CPU cache");
+
+	char cmd[64];
+	malloc_snprintf(cmd, sizeof(cmd), "arena.%u.destroy", arena_ind);
+	expect_d_eq(mallctl(cmd, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+}
+TEST_END
+
+TEST_BEGIN(test_percpu_cache_refill) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!config_stats);
+	test_skip_if(!percpu_cache_enabled());
+	/* Migrating between CPUs would make the refill source unpredictable. */
+	test_skip_if(ncpus > 1);
+
+	thread_tcache_flush();
+	percpu_cache_flush();
+	alloc_and_free(0);
+	thread_tcache_flush();
+	size_t cached = percpu_cache_bytes();
+	expect_zu_ge(cached, NALLOC * SZ, "Unexpected per-CPU cache size");
+
+	/* An empty thread cache refills from the per-CPU cache first. */
+	void *p = mallocx(SZ, 0);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_zu_lt(percpu_cache_bytes(), cached,
+	    "Refill should have drawn from the per-CPU cache");
+	dallocx(p, 0);
+	thread_tcache_flush();
+	percpu_cache_flush();
+}
+TEST_END
+
+TEST_BEGIN(test_percpu_cache_tcache_shrunk) {
+	test_skip_if(!percpu_cache_enabled());
+
+	for (szind_t i = 0; i < SC_NBINS; i++) {
+		expect_u_le(tcache_ncached_max_default_get(i),
+		    PERCPU_CACHE_TCACHE_NCACHED_MAX,
+		    "Thread caches should shrink when per-CPU caches are on");
+	}
+}
+TEST_END
+
+TEST_BEGIN(test_percpu_cache_purge) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!config_stats);
+	test_skip_if(!percpu_cache_enabled());
+
+	alloc_and_free(0);
+	thread_tcache_flush();
+	expect_zu_ge(percpu_cache_bytes(), NALLOC * SZ,
+	    "Flushed objects should be held by the per-CPU cache");
+
+	/* Purging everything starts with the per-CPU caches. */
+	expect_d_eq(mallctl("arena." STRINGIFY(MALLCTL_ARENAS_ALL) ".purge",
+	                NULL, NULL, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_zu_eq(percpu_cache_bytes(), 0, "Per-CPU caches should be empty");
+}
+TEST_END
+
+TEST_BEGIN(test_percpu_cache_gc) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(!config_stats);
+	test_skip_if(!percpu_cache_enabled());
+
+	tsd_t *tsd = tsd_fetch();
+	thread_tcache_flush();
+	percpu_cache_flush();
+
+	/* Start the interval afresh. */
+	sleep_ns((unsigned)PERCPU_CACHE_GC_INTERVAL_NS);
+	percpu_cache_gc(tsd);
+
+	alloc_and_free(0);
+	thread_tcache_flush();
+	size_t cached = percpu_cache_bytes();
+	expect_zu_ge(cached, NALLOC * SZ, "Unexpected per-CPU cache size");
+
+	/* Within the interval, nothing happens. */
+	percpu_cache_gc(tsd);
+	expect_zu_eq(percpu_cache_bytes(), cached, "GC ran too early");
+
+	/*
+	 * The first pass only sets the low water marks; the second one returns
+	 * most of what stayed unused in between.
+	 */
+	sleep_ns((unsigned)PERCPU_CACHE_GC_INTERVAL_NS);
+	percpu_cache_gc(tsd);
+	expect_zu_le(percpu_cache_bytes(), cached, "Unexpected growth");
+	cached = percpu_cache_bytes();
+	sleep_ns((unsigned)PERCPU_CACHE_GC_INTERVAL_NS);
+	percpu_cache_gc(tsd);
+	expect_zu_le(percpu_cache_bytes(), cached - cached * 3 / 4 + SZ,
+	    "GC should return unused objects");
+
+	percpu_cache_flush();
+}
+TEST_END
+
+static void *
+thd_start(void *arg) {
+	void    *ptrs[NALLOC];
+	unsigned seed = (unsigned)(uintptr_t)arg;
+	for (unsigned i = 0; i < NITER; i++) {
+		unsigned n = 1 + (seed = seed * 1103515245 + 12345) % NALLOC;
+		size_t   sz = 8 << (i % 8);
+		for (unsigned j = 0; j < n; j++) {
+			ptrs[j] = mallocx(sz, 0);
+			expect_ptr_not_null(ptrs[j], "Unexpected mallocx() failure");
+			*(unsigned *)ptrs[j] = j;
+		}
+		for (unsigned j = 0; j < n; j++) {
+			expect_u_eq(*(unsigned *)ptrs[j], j,
+			    "Object handed out twice");
+			dallocx(ptrs[j], 0);
+		}
+	}
+	return NULL;
+}
+
+TEST_BEGIN(test_percpu_cache_threads) {
+	test_skip_if(!percpu_cache_enabled());
+
+	thd_t thds[NTHREADS];
+	for (unsigned i = 0; i < NTHREADS; i++) {
+		thd_create(&thds[i], thd_start, (void *)(uintptr_t)(i + 1));
+	}
+	/* Drain concurrently with the threads, too. */
+	for (unsigned i = 0; i < 100; i++) {
+		percpu_cache_flush();
+	}
+	for (unsigned i = 0; i < NTHREADS; i++) {
+		thd_join(thds[i], NULL);
+	}
+	percpu_cache_flush();
+	if (config_stats) {
+		expect_zu_eq(
+		    percpu_cache_bytes(), 0, "Per-CPU caches should be empty");
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_percpu_cache_flush, test_percpu_cache_manual_arena,
+	    test_percpu_cache_refill, test_percpu_cache_tcache_shrunk,
+	    test_percpu_cache_purge, test_percpu_cache_gc,
+	    test_percpu_cache_threads);
+}
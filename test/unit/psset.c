@@ -1066,6 +1066,101 @@ TEST_BEGIN(test_purge_prefers_empty_huge) {
 }
 TEST_END
 
+static pszind_t
+test_psset_bin(size_t npages) {
+	return sz_psz2ind(sz_psz_quantize_floor(npages << LG_PAGE));
+}
+
+TEST_BEGIN(test_pick_alloc_partial_bin) {
+	test_skip_if(hpa_hugepage_size_exceeds_limit());
+	test_skip_if(!sz_large_size_classes_disabled());
+
+	/*
+	 * Find a length that isn't a page size class, so that pageslabs whose
+	 * longest free range is one page shorter share its bin but don't fit.
+	 */
+	size_t fit = 2;
+	while (fit < HUGEPAGE_PAGES
+	    && (sz_psz_quantize_floor(fit << LG_PAGE) == (fit << LG_PAGE)
+	        || test_psset_bin(fit - 1) != test_psset_bin(fit))) {
+		fit++;
+	}
+	test_skip_if(fit == HUGEPAGE_PAGES);
+
+	psset_t psset;
+	psset_init(&psset);
+
+	enum { NHP = 8 };
+	hpdata_t hpdata[NHP];
+	for (int i = 0; i < NHP; i++) {
+		hpdata_init(&hpdata[i], (void *)((10 + i) * HUGEPAGE), 100 + i,
+		    /* is_huge */ false);
+		void  *ptr = hpdata_reserve_alloc(&hpdata[i], HUGEPAGE);
+		size_t len = (i < NHP - 2) ? fit - 1 : fit;
+		hpdata_unreserve(&hpdata[i], (byte_t *)ptr + PAGE, len * PAGE);
+		psset_insert(&psset, &hpdata[i]);
+	}
+
+	/* The oldest pageslab that fits, even though older ones don't. */
+	expect_ptr_eq(&hpdata[NHP - 2],
+	    psset_pick_alloc(&psset, fit << LG_PAGE), "");
+	expect_ptr_eq(&hpdata[0], psset_pick_alloc(&psset, PAGE), "");
+	expect_ptr_null(psset_pick_alloc(&psset, (fit + 1) << LG_PAGE), "");
+
+	psset_remove(&psset, &hpdata[NHP - 2]);
+	expect_ptr_eq(&hpdata[NHP - 1],
+	    psset_pick_alloc(&psset, fit << LG_PAGE), "");
+	psset_remove(&psset, &hpdata[NHP - 1]);
+	expect_ptr_null(psset_pick_alloc(&psset, fit << LG_PAGE), "");
+}
+TEST_END
+
+TEST_BEGIN(test_purge_lru) {
+	test_skip_if(hpa_hugepage_size_exceeds_limit());
+	void *ptr;
+
+	psset_t psset;
+	psset_init(&psset);
+	psset_purge_lru_enable(&psset);
+
+	enum { NHP = 4 };
+	/* Out of address order, so neither age nor address decides. */
+	const uint64_t last_active[NHP] = {30, 10, 40, 20};
+	hpdata_t       hpdata[NHP];
+	for (int i = 0; i < NHP; i++) {
+		hpdata_init(&hpdata[i], (void *)((10 + i) * HUGEPAGE), 123 + i,
+		    /* is_huge */ false);
+		psset_insert(&psset, &hpdata[i]);
+
+		psset_update_begin(&psset, &hpdata[i]);
+		/* More dirty pages the later the slab was active. */
+		ptr = hpdata_reserve_alloc(&hpdata[i], (2 + i) * PAGE);
+		hpdata_unreserve(&hpdata[i], ptr, (1 + i) * PAGE);
+		hpdata_last_active_set(&hpdata[i], last_active[i]);
+		hpdata_purge_allowed_set(&hpdata[i], true);
+		psset_update_end(&psset, &hpdata[i]);
+	}
+	/* The dirtiness order is the reverse. */
+	expect_ptr_eq(&hpdata[3], psset_pick_purge(&psset, NULL), "");
+	expect_ptr_eq(&hpdata[1], psset_pick_purge_lru(&psset, NULL), "");
+
+	/* Activity moves a slab to the back. */
+	psset_update_begin(&psset, &hpdata[1]);
+	hpdata_last_active_set(&hpdata[1], 50);
+	psset_update_end(&psset, &hpdata[1]);
+
+	const int order[NHP] = {3, 0, 2, 1};
+	for (int i = 0; i < NHP; i++) {
+		hpdata_t *to_purge = psset_pick_purge_lru(&psset, NULL);
+		expect_ptr_eq(&hpdata[order[i]], to_purge, "");
+		psset_update_begin(&psset, to_purge);
+		hpdata_purge_allowed_set(to_purge, false);
+		psset_update_end(&psset, to_purge);
+	}
+	expect_ptr_null(psset_pick_purge_lru(&psset, NULL), "");
+}
+TEST_END
+
 int
 main(void) {
 	return test_no_reentrancy(test_empty, test_fill, test_reuse, test_evict,
@@ -1073,5 +1168,6 @@ main(void) {
 	    test_stats_fullness, test_oldest_fit, test_insert_remove,
 	    test_purge_prefers_nonhuge, test_purge_timing,
 	    test_purge_prefers_empty, test_pick_purge_underflow,
-	    test_purge_prefers_empty_huge);
+	    test_purge_prefers_empty_huge, test_pick_alloc_partial_bin,
+	    test_purge_lru);
 }
@@ -0,0 +1,95 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/purge_pool.h"
+
+#define NALLOCS 256
+
+static unsigned
+purge_pool_arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static uint64_t
+purge_pool_npurges_get(unsigned arena_ind) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.hpa_shard.npurges",
+	    arena_ind);
+	uint64_t npurges;
+	size_t   sz = sizeof(npurges);
+	expect_d_eq(mallctl(cmd, (void *)&npurges, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return npurges;
+}
+
+TEST_BEGIN(test_purge_pool_ctl) {
+	unsigned nthreads;
+	size_t   sz = sizeof(nthreads);
+	expect_d_eq(
+	    mallctl("opt.purge_threads", (void *)&nthreads, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	expect_u_eq(nthreads, 2, "Unexpected opt.purge_threads");
+
+	size_t budget;
+	sz = sizeof(budget);
+	expect_d_eq(mallctl("opt.purge_budget", (void *)&budget, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_zu_eq(budget, 0, "Unexpected opt.purge_budget");
+}
+TEST_END
+
+TEST_BEGIN(test_purge_pool_offload) {
+	test_skip_if(!config_stats);
+	test_skip_if(!opt_hpa);
+	test_skip_if(!have_background_thread);
+	/* Skip since guarded pages cannot be allocated from hpa. */
+	test_skip_if(san_guard_enabled());
+
+	unsigned arena_ind = purge_pool_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	tsdn_t  *tsdn = tsd_tsdn(tsd_fetch());
+	arena_t *arena = arena_get(tsdn, arena_ind, false);
+	expect_ptr_not_null(arena, "Unexpected arena_get() failure");
+	hpa_shard_t *shard = &arena->pa_shard.hpa;
+
+	uint64_t njobs = purge_pool_njobs_get();
+	void    *ptrs[NALLOCS];
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		ptrs[i] = mallocx(PAGE, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+		memset(ptrs[i], 1, PAGE);
+	}
+	/* Leave holes behind, so that the hugepage is dirty but not empty. */
+	for (unsigned i = 0; i < NALLOCS; i += 2) {
+		dallocx(ptrs[i], flags);
+	}
+	hpa_shard_do_deferred_work(tsdn, shard);
+	purge_pool_drain(tsdn, shard);
+
+	expect_u64_gt(purge_pool_njobs_get(), njobs,
+	    "Purges should have been handed to the pool");
+	expect_u64_gt(purge_pool_npurges_get(arena_ind), 0,
+	    "Handed over purges should be accounted to the shard");
+
+	/* Purged hugepages are usable again. */
+	for (unsigned i = 0; i < NALLOCS; i += 2) {
+		ptrs[i] = mallocx(PAGE, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		dallocx(ptrs[i], flags);
+	}
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_purge_pool_ctl, test_purge_pool_offload);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="hpa:true,purge_threads:2,hpa_dirty_mult:0,hpa_min_purge_interval_ms:0,hpa_sec_nshards:0"
@@ -0,0 +1,223 @@
+#include "test/jemalloc_test.h"
+
+static unsigned
+scratch_arena_create(void) {
+	arena_config_t config = arena_config_default;
+	config.scratch = true;
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("experimental.arenas_create_ext",
+	                (void *)&arena_ind, &sz, &config, sizeof(config)),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+scratch_arena_reset(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = ARRAY_SIZE(mib);
+	expect_d_eq(mallctlnametomib("arena.0.reset", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	expect_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static unsigned
+ptr_arena_ind(void *ptr) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.lookup", &arena_ind, &sz, &ptr,
+	                sizeof(ptr)),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static size_t
+scratch_arena_stat_get(unsigned arena_ind, const char *name) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(
+	    cmd, sizeof(cmd), "stats.arenas.%u.%s", arena_ind, name);
+	size_t val;
+	size_t sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+TEST_BEGIN(test_scratch_free_noop) {
+	unsigned arena_ind = scratch_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	void *p = mallocx(64, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+	void *q = mallocx(64, flags);
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	expect_ptr_ne(p, q, "Freed scratch object should not be reused");
+
+	scratch_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_scratch_bump) {
+	test_skip_if(opt_prof);
+
+	unsigned arena_ind = scratch_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	/* Consecutive slabs are carved from the same region, back to back. */
+	void *p = mallocx(SC_LARGE_MINCLASS / 2, flags);
+	void *q = mallocx(SC_LARGE_MINCLASS / 4, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	szind_t binind = sz_size2index(SC_LARGE_MINCLASS / 2);
+	expect_ptr_eq((void *)((byte_t *)p + bin_infos[binind].slab_size), q,
+	    "Slabs should be adjacent");
+
+	scratch_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_scratch_tcache_bypass) {
+	test_skip_if(!opt_tcache);
+
+	unsigned arena_ind = scratch_arena_create();
+
+	/* Leave an object of the same size class in the thread cache. */
+	void *p = mallocx(64, 0);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, 0);
+
+	void *q = mallocx(64, MALLOCX_ARENA(arena_ind));
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	expect_u_eq(ptr_arena_ind(q), arena_ind,
+	    "Scratch allocation should not come from the thread cache");
+
+	scratch_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_scratch_free_tcache_bypass) {
+	test_skip_if(!opt_tcache);
+
+	unsigned arena_ind = scratch_arena_create();
+
+	/* Unsized, sized and large frees through the default thread cache. */
+	void *q = mallocx(64, MALLOCX_ARENA(arena_ind));
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	free(q);
+	void *p = malloc(64);
+	expect_ptr_not_null(p, "Unexpected malloc() failure");
+	expect_ptr_ne(p, q, "Freed scratch object should not be reused");
+	free(p);
+
+	q = mallocx(64, MALLOCX_ARENA(arena_ind));
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	sdallocx(q, 64, 0);
+	p = malloc(64);
+	expect_ptr_not_null(p, "Unexpected malloc() failure");
+	expect_ptr_ne(p, q, "Freed scratch object should not be reused");
+	free(p);
+
+	q = mallocx(SC_LARGE_MINCLASS, MALLOCX_ARENA(arena_ind));
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	free(q);
+	p = malloc(SC_LARGE_MINCLASS);
+	expect_ptr_not_null(p, "Unexpected malloc() failure");
+	expect_ptr_ne(p, q, "Freed scratch extent should not be reused");
+	free(p);
+
+	scratch_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_scratch_reset) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind = scratch_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	for (unsigned round = 0; round < 3; round++) {
+		for (size_t size = 8; size <= 4 * SC_LARGE_MINCLASS;
+		    size *= 2) {
+			for (unsigned i = 0; i < 16; i++) {
+				void *p = mallocx(size, flags);
+				expect_ptr_not_null(
+				    p, "Unexpected mallocx() failure");
+				memset(p, 0xa5, size);
+				if (i % 2 == 0) {
+					dallocx(p, flags);
+				}
+			}
+		}
+		expect_zu_gt(scratch_arena_stat_get(arena_ind, "pactive"), 0,
+		    "Expected active pages");
+		expect_zu_gt(
+		    scratch_arena_stat_get(arena_ind, "large.allocated"), 0,
+		    "Expected live large extents");
+		/*
+		 * The extents are dropped wholesale rather than one by one,
+		 * but must be accounted for all the same.
+		 */
+		scratch_arena_reset(arena_ind);
+		expect_zu_eq(scratch_arena_stat_get(arena_ind, "pactive"), 0,
+		    "Reset should release every extent");
+		expect_zu_eq(
+		    scratch_arena_stat_get(arena_ind, "large.allocated"), 0,
+		    "Reset should account for every large extent");
+		expect_zu_eq(
+		    scratch_arena_stat_get(arena_ind, "small.allocated"), 0,
+		    "Reset should account for every small region");
+	}
+}
+TEST_END
+
+TEST_BEGIN(test_scratch_large) {
+	unsigned arena_ind = scratch_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	/* Freed large extents aren't reused either. */
+	size_t size = 4 * SC_LARGE_MINCLASS;
+	void  *p = mallocx(size, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+	void *q = mallocx(size, flags);
+	expect_ptr_not_null(q, "Unexpected mallocx() failure");
+	expect_ptr_ne(p, q, "Freed scratch extent should not be reused");
+
+	/* Alignment is honored by the bump allocator. */
+	size_t alignment = 16 * PAGE;
+	void  *r = mallocx(SC_LARGE_MINCLASS, flags | MALLOCX_ALIGN(alignment));
+	expect_ptr_not_null(r, "Unexpected mallocx() failure");
+	expect_zu_eq((uintptr_t)r & (alignment - 1), 0,
+	    "Misaligned scratch allocation");
+
+	/* Resizing can't happen in place, but copies correctly. */
+	memset(q, 0xa5, size);
+	void *s = rallocx(q, 2 * size, flags);
+	expect_ptr_not_null(s, "Unexpected rallocx() failure");
+	for (size_t i = 0; i < size; i++) {
+		expect_u_eq(((uint8_t *)s)[i], 0xa5, "Lost data on rallocx()");
+	}
+	expect_zu_eq(xallocx(s, 4 * size, 0, flags), 2 * size,
+	    "Scratch extents shouldn't grow in place");
+
+	/* Regions larger than the default granularity. */
+	void *t = mallocx(2 * PA_SCRATCH_REG_SIZE, flags);
+	expect_ptr_not_null(t, "Unexpected mallocx() failure");
+
+	scratch_arena_reset(arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_scratch_free_noop, test_scratch_bump,
+	    test_scratch_tcache_bypass, test_scratch_free_tcache_bypass,
+	    test_scratch_reset, test_scratch_large);
+}
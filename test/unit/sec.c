@@ -37,6 +37,8 @@ TEST_BEGIN(test_max_nshards_option_zero) {
 	opts.nshards = 0;
 	opts.max_alloc = PAGE;
 	opts.max_bytes = 512 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -53,6 +55,8 @@ TEST_BEGIN(test_max_alloc_option_too_small) {
 	opts.nshards = 1;
 	opts.max_alloc = 2 * PAGE;
 	opts.max_bytes = 512 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -69,6 +73,8 @@ TEST_BEGIN(test_sec_fill) {
 	opts.nshards = 1;
 	opts.max_alloc = 2 * PAGE;
 	opts.max_bytes = 4 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -113,6 +119,8 @@ TEST_BEGIN(test_sec_alloc) {
 	opts.nshards = 1;
 	opts.max_alloc = 2 * PAGE;
 	opts.max_bytes = 4 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -166,6 +174,8 @@ TEST_BEGIN(test_sec_dalloc) {
 	opts.nshards = 1;
 	opts.max_alloc = PAGE;
 	opts.max_bytes = 2 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -224,6 +234,8 @@ TEST_BEGIN(test_max_bytes_too_low) {
 	opts.nshards = 1;
 	opts.max_alloc = 4 * PAGE;
 	opts.max_bytes = 2 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -249,6 +261,8 @@ TEST_BEGIN(test_sec_flush) {
 	opts.nshards = 1;
 	opts.max_alloc = 4 * PAGE;
 	opts.max_bytes = 1024 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -294,6 +308,8 @@ TEST_BEGIN(test_sec_stats) {
 	opts.nshards = 1;
 	opts.max_alloc = PAGE;
 	opts.max_bytes = 2 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -419,6 +435,8 @@ TEST_BEGIN(test_sec_multishard) {
 	opts.nshards = NSHARDS;
 	opts.max_alloc = 2 * PAGE;
 	opts.max_bytes = 64 * NTHREADS * PAGE;
+	opts.percpu = false;
+	opts.adaptive = false;
 
 	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
 	test_data_init(tsdn, &tdata, &opts);
@@ -483,10 +501,168 @@ TEST_BEGIN(test_sec_multishard) {
 }
 TEST_END
 
+TEST_BEGIN(test_sec_percpu) {
+	test_data_t tdata;
+	sec_opts_t  opts;
+	opts.nshards = 1;
+	opts.max_alloc = PAGE;
+	opts.max_bytes = 4 * PAGE;
+	opts.percpu = true;
+	opts.adaptive = false;
+
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	test_data_init(tsdn, &tdata, &opts);
+	if (have_percpu_arena) {
+		expect_true(tdata.sec.opts.percpu, "");
+		expect_zu_eq(tdata.sec.opts.nshards,
+		    ncpus < SEC_NSHARDS_MAX ? ncpus : SEC_NSHARDS_MAX,
+		    "Per-CPU mode should size nshards to the CPU count");
+	} else {
+		expect_false(tdata.sec.opts.percpu,
+		    "Per-CPU mode needs a way to get the current CPU");
+		expect_zu_eq(tdata.sec.opts.nshards, opts.nshards, "");
+	}
+
+	edata_list_active_t allocs;
+	edata_list_active_init(&allocs);
+	edata_t edata1;
+	edata_size_set(&edata1, PAGE);
+	edata_list_active_append(&allocs, &edata1);
+	sec_dalloc(tsdn, &tdata.sec, &allocs);
+	expect_true(edata_list_active_empty(&allocs), "");
+
+	/* We may have migrated to another CPU (and shard) in between. */
+	edata_t *edata = sec_alloc(tsdn, &tdata.sec, PAGE);
+	if (edata != NULL) {
+		expect_ptr_eq(edata, &edata1, "");
+	}
+
+	sec_stats_t stats;
+	memset(&stats, 0, sizeof(sec_stats_t));
+	sec_stats_merge(tsdn, &tdata.sec, &stats);
+	expect_zu_eq(stats.total.nhits + stats.total.nmisses, 1, "");
+	expect_zu_eq(stats.total.nlock_contended, 0,
+	    "Nothing else uses the cache");
+	size_t nhits = 0;
+	size_t nmisses = 0;
+	for (unsigned i = 0; i < SEC_NSHARDS_MAX; i++) {
+		if (i >= tdata.sec.opts.nshards) {
+			expect_zu_eq(stats.shards[i].nhits
+			        + stats.shards[i].nmisses,
+			    0, "Unused shards should have no stats");
+		}
+		nhits += stats.shards[i].nhits;
+		nmisses += stats.shards[i].nmisses;
+	}
+	expect_zu_eq(nhits, stats.total.nhits, "");
+	expect_zu_eq(nmisses, stats.total.nmisses, "");
+	destroy_test_data(tsdn, &tdata);
+}
+TEST_END
+
+static void
+sec_adaptive_dalloc(tsdn_t *tsdn, sec_t *sec, edata_t *edata,
+    edata_list_active_t *flushed) {
+	edata_list_active_t allocs;
+	edata_list_active_init(&allocs);
+	edata_list_active_append(&allocs, edata);
+	sec_dalloc(tsdn, sec, &allocs);
+	edata_list_active_concat(flushed, &allocs);
+}
+
+TEST_BEGIN(test_sec_adaptive) {
+	test_data_t tdata;
+	sec_opts_t  opts;
+	enum { NEXTENTS = 16 };
+	opts.nshards = 1;
+	opts.max_alloc = 2 * PAGE;
+	opts.max_bytes = 16 * PAGE;
+	opts.percpu = false;
+	opts.adaptive = true;
+
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	test_data_init(tsdn, &tdata, &opts);
+	sec_t *sec = &tdata.sec;
+	expect_u_eq(sec->npsizes, 2, "Expected one bin per page count");
+	sec_bin_t *hot = &sec->bins[0];
+	sec_bin_t *cold = &sec->bins[1];
+	size_t     budget = sec->npsizes * opts.max_bytes;
+	size_t     initial = opts.max_bytes / 2;
+	expect_zu_eq(hot->bytes_max, initial, "");
+	expect_zu_eq(cold->bytes_max, initial, "");
+
+	/* The two-page bin gets extents back but is never asked for one. */
+	edata_t             cold_edatas[NEXTENTS];
+	edata_list_active_t spare;
+	edata_list_active_init(&spare);
+	for (unsigned i = 0; i < NEXTENTS; i++) {
+		edata_init_test(&cold_edatas[i]);
+		edata_size_set(&cold_edatas[i], 2 * PAGE);
+		edata_list_active_append(&spare, &cold_edatas[i]);
+	}
+	for (unsigned i = 0; i < 8 * SEC_ADAPT_EPOCH_NOPS; i++) {
+		edata_t *edata = edata_list_active_first(&spare);
+		assert_ptr_not_null(edata, "");
+		edata_list_active_remove(&spare, edata);
+		sec_adaptive_dalloc(tsdn, sec, edata, &spare);
+	}
+	expect_zu_lt(cold->bytes_max, initial,
+	    "A bin that never hits should give capacity back");
+	expect_zu_ge(cold->bytes_max, 2 * PAGE,
+	    "A bin should keep room for one extent");
+
+	/*
+	 * The one-page bin cycles through more extents than it can hold, so it
+	 * misses on the ones it flushed.
+	 */
+	edata_t hot_edatas[NEXTENTS];
+	for (unsigned i = 0; i < NEXTENTS; i++) {
+		edata_init_test(&hot_edatas[i]);
+		edata_size_set(&hot_edatas[i], PAGE);
+	}
+	size_t nmisses_first = 0;
+	size_t nmisses_last = 0;
+	for (unsigned round = 0; round < 8 * SEC_ADAPT_EPOCH_NOPS / NEXTENTS;
+	     round++) {
+		edata_list_active_t flushed;
+		edata_list_active_init(&flushed);
+		for (unsigned i = 0; i < NEXTENTS; i++) {
+			sec_adaptive_dalloc(
+			    tsdn, sec, &hot_edatas[i], &flushed);
+		}
+		size_t nmisses = 0;
+		for (unsigned i = 0; i < NEXTENTS; i++) {
+			if (sec_alloc(tsdn, sec, PAGE) == NULL) {
+				nmisses++;
+			}
+		}
+		if (round == 0) {
+			nmisses_first = nmisses;
+		}
+		nmisses_last = nmisses;
+	}
+	expect_zu_gt(hot->bytes_max, initial,
+	    "A bin that misses on flushed extents should grow");
+	expect_zu_lt(nmisses_last, nmisses_first,
+	    "Growing the bin should turn misses into hits");
+
+	size_t unassigned = atomic_load_zu(
+	    &sec->bytes_unassigned, ATOMIC_RELAXED);
+	expect_zu_eq(hot->bytes_max + cold->bytes_max + unassigned, budget,
+	    "Bins should only trade capacity within the budget");
+
+	edata_list_active_t to_flush;
+	edata_list_active_init(&to_flush);
+	sec_flush(tsdn, sec, &to_flush);
+	destroy_test_data(tsdn, &tdata);
+}
+TEST_END
+
 int
 main(void) {
 	return test(test_max_nshards_option_zero,
 	    test_max_alloc_option_too_small, test_sec_fill, test_sec_alloc,
 	    test_sec_dalloc, test_max_bytes_too_low, test_sec_flush,
-	    test_sec_stats, test_sec_multishard);
+	    test_sec_stats, test_sec_multishard, test_sec_percpu,
+	    test_sec_adaptive);
 }
@@ -0,0 +1,134 @@
+#include "test/jemalloc_test.h"
+
+#define SZ 256
+/* Enough regions to go through every slab scale. */
+#define NALLOCS 4096
+/* Regions kept live when fragmenting the bin. */
+#define KEEP_STRIDE 256
+
+static unsigned
+arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+test_arena_reset(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = ARRAY_SIZE(mib);
+	expect_d_eq(mallctlnametomib("arena.0.reset", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	expect_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static uint64_t
+bin_stat_get(unsigned arena_ind, const char *name, size_t sz) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.bins.%u.%s",
+	    arena_ind, (unsigned)sz_size2index(SZ), name);
+	uint64_t val = 0;
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+static size_t
+slab_size_get(unsigned arena_ind) {
+	return (size_t)bin_stat_get(arena_ind, "slab_size", sizeof(size_t));
+}
+
+TEST_BEGIN(test_slab_size_auto_tune) {
+	test_skip_if(!config_stats);
+	test_skip_if(opt_prof);
+
+	const bin_info_t *bin_info = &bin_infos[sz_size2index(SZ)];
+	test_skip_if(bin_info->huge || bin_info->slab_lg_scale_max == 0);
+
+	unsigned arena_ind = arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+	expect_zu_eq(slab_size_get(arena_ind), bin_info->slab_size,
+	    "Slabs should start at the configured size");
+
+	/* Steady growth: every slab fills up before the next one is made. */
+	void **ptrs = mallocx(NALLOCS * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (size_t i = 0; i < NALLOCS; i++) {
+		ptrs[i] = mallocx(SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	expect_zu_eq(slab_size_get(arena_ind),
+	    bin_info->slab_size << bin_info->slab_lg_scale_max,
+	    "Slabs should have grown to the largest scale");
+	expect_u64_eq(bin_stat_get(arena_ind, "nslab_grows", sizeof(uint64_t)),
+	    bin_info->slab_lg_scale_max, "Unexpected number of grows");
+	expect_u64_eq(
+	    bin_stat_get(arena_ind, "nslab_shrinks", sizeof(uint64_t)), 0,
+	    "No shrinks expected while growing");
+
+	/*
+	 * Leave every slab half empty, then empty most of them while a few
+	 * live regions stay scattered over the rest.
+	 */
+	for (size_t i = 1; i < NALLOCS; i += 2) {
+		dallocx(ptrs[i], flags);
+	}
+	for (size_t i = 0; i < NALLOCS; i += 2) {
+		if (i % KEEP_STRIDE != 0) {
+			dallocx(ptrs[i], flags);
+		}
+	}
+	expect_u64_gt(
+	    bin_stat_get(arena_ind, "nslab_shrinks", sizeof(uint64_t)), 0,
+	    "Fragmentation should shrink slabs");
+	expect_zu_lt(slab_size_get(arena_ind),
+	    bin_info->slab_size << bin_info->slab_lg_scale_max,
+	    "Slabs should have shrunk");
+
+	for (size_t i = 0; i < NALLOCS; i += KEEP_STRIDE) {
+		dallocx(ptrs[i], flags);
+	}
+	dallocx(ptrs, 0);
+	test_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_slab_size_auto_regions) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind = arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	/* Regions of scaled slabs stay distinct and usable. */
+	void **ptrs = mallocx(NALLOCS * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (size_t i = 0; i < NALLOCS; i++) {
+		ptrs[i] = mallocx(SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+		memset(ptrs[i], (int)(i & 0xff), SZ);
+	}
+	for (size_t i = 0; i < NALLOCS; i++) {
+		expect_zu_eq(sallocx(ptrs[i], 0), SZ, "Unexpected usable size");
+		expect_u_eq(((uint8_t *)ptrs[i])[SZ - 1], (unsigned)(i & 0xff),
+		    "Region contents were overwritten");
+	}
+	for (size_t i = 0; i < NALLOCS; i++) {
+		dallocx(ptrs[i], flags);
+	}
+	dallocx(ptrs, 0);
+	test_arena_reset(arena_ind);
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_slab_size_auto_tune, test_slab_size_auto_regions);
+}
@@ -0,0 +1,190 @@
+#include "test/jemalloc_test.h"
+
+#define SZ 64
+#define GC_DRIVE_SZ 4096
+
+static tcache_slow_t *
+thread_tcache_slow_get(void) {
+	return tsd_tcache_slowp_get(tsd_fetch());
+}
+
+static cache_bin_sz_t
+ncached_max_get(void) {
+	tcache_t *tcache = tsd_tcachep_get(tsd_fetch());
+	return cache_bin_ncached_max_get(&tcache->bins[sz_size2index(SZ)]);
+}
+
+static void
+adaptive_set(bool adaptive) {
+	expect_d_eq(mallctl("thread.tcache.adaptive", NULL, NULL,
+	                (void *)&adaptive, sizeof(adaptive)),
+	    0, "Unexpected mallctl() failure");
+}
+
+static void
+budget_set(size_t budget) {
+	expect_d_eq(mallctl("thread.tcache.adaptive_budget", NULL, NULL,
+	                (void *)&budget, sizeof(budget)),
+	    0, "Unexpected mallctl() failure");
+}
+
+static void
+thread_tcache_flush(void) {
+	expect_d_eq(mallctl("thread.tcache.flush", NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+}
+
+/*
+ * Allocation traffic in an unrelated size class, enough for every bin to go
+ * through garbage collection a few times.  The time-based GC would make this
+ * depend on how fast the loop runs, so tcache_adaptive.sh turns it off.
+ */
+static void
+gc_drive(void) {
+	for (unsigned i = 0; i < 16 * 1024; i++) {
+		void *p = mallocx(GC_DRIVE_SZ, 0);
+		expect_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, 0);
+	}
+}
+
+static void
+bursts(unsigned nrounds, size_t nobjs) {
+	void **ptrs = mallocx(nobjs * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (unsigned round = 0; round < nrounds; round++) {
+		for (size_t i = 0; i < nobjs; i++) {
+			ptrs[i] = mallocx(SZ, 0);
+			expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+		}
+		for (size_t i = 0; i < nobjs; i++) {
+			dallocx(ptrs[i], 0);
+		}
+	}
+	dallocx(ptrs, 0);
+}
+
+TEST_BEGIN(test_adaptive_ctl) {
+	bool   adaptive;
+	size_t budget;
+	size_t sz;
+
+	sz = sizeof(adaptive);
+	expect_d_eq(mallctl("thread.tcache.adaptive", (void *)&adaptive, &sz,
+	                NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_b_eq(adaptive, opt_tcache_adaptive,
+	    "Threads should start with the global setting");
+	adaptive_set(!adaptive);
+	expect_b_eq(thread_tcache_slow_get()->adaptive, !adaptive,
+	    "Setting did not take effect");
+	adaptive_set(adaptive);
+
+	sz = sizeof(budget);
+	expect_d_eq(mallctl("thread.tcache.adaptive_budget", (void *)&budget,
+	                &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_zu_eq(budget, opt_tcache_adaptive_budget,
+	    "Threads should start with the global budget");
+	budget_set(budget / 2);
+	expect_zu_eq(thread_tcache_slow_get()->adaptive_budget, budget / 2,
+	    "Setting did not take effect");
+	budget_set(budget);
+}
+TEST_END
+
+TEST_BEGIN(test_adaptive_grow_shrink) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(opt_experimental_tcache_gc);
+
+	thread_tcache_flush();
+	adaptive_set(true);
+	/* Only the bin sizes limit growth. */
+	budget_set(SIZE_T_MAX);
+	szind_t        binind = sz_size2index(SZ);
+	tcache_slow_t *tcache_slow = thread_tcache_slow_get();
+	cache_bin_sz_t ncached_max = ncached_max_get();
+	cache_bin_sz_t nfill = tcache_slow->bin_nfill[binind];
+	expect_u_lt(nfill, ncached_max, "Unexpected initial fill count");
+
+	/* Bursts that drain the bin several times per GC window. */
+	bursts(64, 4 * (size_t)ncached_max);
+	gc_drive();
+	bursts(64, 4 * (size_t)ncached_max);
+	cache_bin_sz_t nfill_grown = tcache_slow->bin_nfill[binind];
+	expect_u_gt(nfill_grown, nfill, "Fill count should have grown");
+	expect_u_le(nfill_grown, ncached_max, "Fill count exceeds bin size");
+
+	/* Leave the bin full and idle while other classes are busy. */
+	gc_drive();
+	expect_u_lt(tcache_slow->bin_nfill[binind], nfill_grown,
+	    "Fill count should have shrunk");
+	expect_u_gt(tcache_slow->bin_nfill[binind], 0,
+	    "Fill count should stay positive");
+
+	budget_set(opt_tcache_adaptive_budget);
+	adaptive_set(false);
+}
+TEST_END
+
+TEST_BEGIN(test_adaptive_budget) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(opt_experimental_tcache_gc);
+
+	thread_tcache_flush();
+	adaptive_set(true);
+	tcache_slow_t *tcache_slow = thread_tcache_slow_get();
+	size_t         budget = tcache_slow->adaptive_fill_bytes;
+	budget_set(budget);
+
+	bursts(64, 4 * (size_t)ncached_max_get());
+	gc_drive();
+	bursts(64, 4 * (size_t)ncached_max_get());
+	expect_zu_le(tcache_slow->adaptive_fill_bytes, budget,
+	    "Fill counts should stay within the budget");
+
+	budget_set(opt_tcache_adaptive_budget);
+	adaptive_set(false);
+}
+TEST_END
+
+TEST_BEGIN(test_adaptive_flush_remain) {
+	test_skip_if(!opt_tcache);
+	test_skip_if(opt_experimental_tcache_gc);
+
+	thread_tcache_flush();
+	adaptive_set(true);
+	szind_t        binind = sz_size2index(SZ);
+	tcache_slow_t *tcache_slow = thread_tcache_slow_get();
+	cache_bin_sz_t ncached_max = ncached_max_get();
+	cache_bin_sz_t remain = tcache_slow->bin_flush_remain[binind];
+
+	/* Frees only, so that the bin keeps overflowing without refills. */
+	size_t nobjs = 4 * (size_t)ncached_max;
+	void **ptrs = mallocx(nobjs * sizeof(void *), 0);
+	expect_ptr_not_null(ptrs, "Unexpected mallocx() failure");
+	for (unsigned round = 0; round < 4; round++) {
+		for (size_t i = 0; i < nobjs; i++) {
+			ptrs[i] = mallocx(SZ, MALLOCX_TCACHE_NONE);
+			expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+		}
+		for (size_t i = 0; i < nobjs; i++) {
+			dallocx(ptrs[i], 0);
+		}
+		gc_drive();
+	}
+	dallocx(ptrs, 0);
+	expect_u_lt(tcache_slow->bin_flush_remain[binind], remain,
+	    "Full-bin flushes should keep fewer items");
+	expect_u_lt(tcache_slow->bin_flush_remain[binind], ncached_max,
+	    "Flushes should leave room in the bin");
+
+	adaptive_set(false);
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_adaptive_ctl, test_adaptive_grow_shrink,
+	    test_adaptive_budget, test_adaptive_flush_remain);
+}
@@ -0,0 +1,4 @@
+#!/bin/sh
+
+# Event-driven GC, so that gc_drive() cycles through every bin each time.
+export MALLOC_CONF="experimental_tcache_gc:false"
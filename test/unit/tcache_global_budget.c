@@ -0,0 +1,157 @@
+#include "test/jemalloc_test.h"
+
+#include "jemalloc/internal/spin.h"
+
+#define SZ 64
+#define NALLOCS 16
+
+static void
+tcache_fill(int flags) {
+	void *ptrs[NALLOCS];
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		ptrs[i] = mallocx(SZ, flags);
+		expect_ptr_not_null(ptrs[i], "Unexpected mallocx() failure");
+	}
+	for (unsigned i = 0; i < NALLOCS; i++) {
+		dallocx(ptrs[i], flags);
+	}
+}
+
+/* Enough allocation traffic in another size class for a few GC events. */
+static void
+gc_drive(void) {
+	for (unsigned i = 0; i < 1024; i++) {
+		void *p = mallocx(4096, 0);
+		expect_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, 0);
+	}
+}
+
+static cache_bin_sz_t
+tcache_ncached_get(tcache_t *tcache) {
+	return cache_bin_ncached_get_local(&tcache->bins[sz_size2index(SZ)]);
+}
+
+TEST_BEGIN(test_budget_idle_flush) {
+	test_skip_if(!config_stats || !opt_tcache);
+
+	tsd_t         *tsd = tsd_fetch();
+	tcache_slow_t *tcache_slow = tsd_tcache_slowp_get(tsd);
+	tcache_fill(0);
+	expect_u_gt(tcache_ncached_get(tsd_tcachep_get(tsd)), 0,
+	    "Objects should be cached");
+
+	/* No GC event between the two checks makes the tcache idle. */
+	tcache_budget_enforce(tsd_tsdn(tsd));
+	tcache_budget_enforce(tsd_tsdn(tsd));
+	expect_true(
+	    atomic_load_b(&tcache_slow->reclaim_requested, ATOMIC_RELAXED),
+	    "Idle tcache over budget should be asked to flush");
+	/* The option file turns junk filling off, so the tsd is fast. */
+	expect_true(tsd_fast(tsd), "Unexpected slow tsd");
+	expect_u64_eq(tsd_thread_allocated_next_event_fast_get(tsd), 0,
+	    "Owner should be diverted off the allocation fast path");
+	expect_u64_eq(tsd_thread_deallocated_next_event_fast_get(tsd), 0,
+	    "Owner should be diverted off the deallocation fast path");
+
+	/* Any size class will do; no GC event is needed. */
+	free(malloc(8));
+	expect_false(
+	    atomic_load_b(&tcache_slow->reclaim_requested, ATOMIC_RELAXED),
+	    "Request should have been served");
+	expect_u_eq(tcache_ncached_get(tsd_tcachep_get(tsd)), 0,
+	    "The whole tcache should have been flushed");
+}
+TEST_END
+
+static atomic_u_t idle_thd_phase;
+
+static void *
+idle_thd_start(void *arg) {
+	tsd_t         *tsd = tsd_fetch();
+	tcache_slow_t *tcache_slow = tsd_tcache_slowp_get(tsd);
+	tcache_fill(0);
+	expect_u_gt(tcache_ncached_get(tsd_tcachep_get(tsd)), 0,
+	    "Objects should be cached");
+
+	atomic_store_u(&idle_thd_phase, 1, ATOMIC_RELEASE);
+	spin_t spinner = SPIN_INITIALIZER;
+	while (atomic_load_u(&idle_thd_phase, ATOMIC_ACQUIRE) != 2) {
+		spin_adaptive(&spinner);
+	}
+	free(malloc(8));
+	expect_false(
+	    atomic_load_b(&tcache_slow->reclaim_requested, ATOMIC_RELAXED),
+	    "Request should have been served");
+	expect_u_eq(tcache_ncached_get(tsd_tcachep_get(tsd)), 0,
+	    "The whole tcache should have been flushed");
+	return NULL;
+}
+
+TEST_BEGIN(test_budget_idle_thread) {
+	test_skip_if(!config_stats || !opt_tcache);
+
+	thd_t thd;
+	atomic_store_u(&idle_thd_phase, 0, ATOMIC_RELAXED);
+	thd_create(&thd, idle_thd_start, NULL);
+	spin_t spinner = SPIN_INITIALIZER;
+	while (atomic_load_u(&idle_thd_phase, ATOMIC_ACQUIRE) != 1) {
+		spin_adaptive(&spinner);
+	}
+
+	/* The checks come from elsewhere, as they do in the background. */
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	tcache_budget_enforce(tsdn);
+	tcache_budget_enforce(tsdn);
+	atomic_store_u(&idle_thd_phase, 2, ATOMIC_RELEASE);
+	thd_join(thd, NULL);
+}
+TEST_END
+
+TEST_BEGIN(test_budget_busy_untouched) {
+	test_skip_if(!config_stats || !opt_tcache);
+
+	tsd_t         *tsd = tsd_fetch();
+	tcache_slow_t *tcache_slow = tsd_tcache_slowp_get(tsd);
+	tcache_budget_enforce(tsd_tsdn(tsd));
+	gc_drive();
+	tcache_fill(0);
+	tcache_budget_enforce(tsd_tsdn(tsd));
+	expect_false(
+	    atomic_load_b(&tcache_slow->reclaim_requested, ATOMIC_RELAXED),
+	    "Busy tcache should be left alone");
+	expect_u_gt(tcache_ncached_get(tsd_tcachep_get(tsd)), 0,
+	    "Objects should still be cached");
+}
+TEST_END
+
+TEST_BEGIN(test_budget_explicit_untouched) {
+	test_skip_if(!config_stats);
+
+	unsigned tcache_ind;
+	size_t   sz = sizeof(tcache_ind);
+	expect_d_eq(mallctl("tcache.create", (void *)&tcache_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	tcache_fill(MALLOCX_TCACHE(tcache_ind));
+
+	tsdn_t *tsdn = tsd_tsdn(tsd_fetch());
+	tcache_budget_enforce(tsdn);
+	tcache_budget_enforce(tsdn);
+	tcache_t *tcache = tcaches[tcache_ind].tcache;
+	expect_false(atomic_load_b(&tcache->tcache_slow->reclaim_requested,
+	                 ATOMIC_RELAXED),
+	    "Explicit tcaches have no owner to flush them");
+	expect_u_gt(tcache_ncached_get(tcache), 0,
+	    "Objects should still be cached");
+
+	expect_d_eq(mallctl("tcache.destroy", NULL, NULL, (void *)&tcache_ind,
+	                sizeof(tcache_ind)),
+	    0, "Unexpected mallctl() failure");
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_budget_idle_flush, test_budget_idle_thread,
+	    test_budget_busy_untouched, test_budget_explicit_untouched);
+}
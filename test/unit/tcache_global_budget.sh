@@ -0,0 +1,7 @@
+#!/bin/sh
+
+if [ "x${enable_fill}" = "x1" ] ; then
+  export MALLOC_CONF="tcache_global_budget:1,junk:false"
+else
+  export MALLOC_CONF="tcache_global_budget:1"
+fi
@@ -0,0 +1,148 @@
+#include "test/jemalloc_test.h"
+
+#define SZ SC_LARGE_MINCLASS
+
+static unsigned
+zero_pool_arena_create(void) {
+	unsigned arena_ind;
+	size_t   sz = sizeof(unsigned);
+	expect_d_eq(mallctl("arenas.create", (void *)&arena_ind, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	return arena_ind;
+}
+
+static void
+zero_pool_arena_reset(unsigned arena_ind) {
+	size_t mib[3];
+	size_t miblen = ARRAY_SIZE(mib);
+	expect_d_eq(mallctlnametomib("arena.0.reset", mib, &miblen), 0,
+	    "Unexpected mallctlnametomib() failure");
+	mib[1] = (size_t)arena_ind;
+	expect_d_eq(mallctlbymib(mib, miblen, NULL, NULL, NULL, 0), 0,
+	    "Unexpected mallctlbymib() failure");
+}
+
+static void
+zero_pool_fill(unsigned arena_ind) {
+	tsdn_t  *tsdn = tsd_tsdn(tsd_fetch());
+	arena_t *arena = arena_get(tsdn, arena_ind, false);
+	expect_ptr_not_null(arena, "Unexpected arena_get() failure");
+	pa_shard_zero_pool_fill(tsdn, &arena->pa_shard);
+}
+
+static uint64_t
+zero_pool_stat_get(unsigned arena_ind, const char *name) {
+	uint64_t epoch = 1;
+	expect_d_eq(
+	    mallctl("epoch", NULL, NULL, (void *)&epoch, sizeof(epoch)), 0,
+	    "Unexpected mallctl() failure");
+	char cmd[128];
+	malloc_snprintf(cmd, sizeof(cmd), "stats.arenas.%u.zero_pool_%s",
+	    arena_ind, name);
+	if (strcmp(name, "bytes") == 0) {
+		size_t bytes;
+		size_t sz = sizeof(bytes);
+		expect_d_eq(mallctl(cmd, (void *)&bytes, &sz, NULL, 0), 0,
+		    "Unexpected mallctl() failure");
+		return bytes;
+	}
+	uint64_t val;
+	size_t   sz = sizeof(val);
+	expect_d_eq(mallctl(cmd, (void *)&val, &sz, NULL, 0), 0,
+	    "Unexpected mallctl() failure");
+	return val;
+}
+
+TEST_BEGIN(test_zero_pool_ctl) {
+	size_t max;
+	size_t sz = sizeof(max);
+	expect_d_eq(mallctl("opt.zero_pool_max", (void *)&max, &sz, NULL, 0),
+	    0, "Unexpected mallctl() failure");
+	expect_zu_eq(max, opt_zero_pool_max, "Unexpected opt.zero_pool_max");
+	expect_zu_gt(max, 0, "The pool should be enabled");
+}
+TEST_END
+
+TEST_BEGIN(test_zero_pool_hit) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind = zero_pool_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	/* The first zeroed allocation misses and leaves dirty pages behind. */
+	uint8_t *p = mallocx(SZ, flags | MALLOCX_ZERO);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_u64_ge(zero_pool_stat_get(arena_ind, "misses"), 1,
+	    "Expected a miss in the empty pool");
+	memset(p, 0xa5, SZ);
+	dallocx(p, flags);
+
+	zero_pool_fill(arena_ind);
+	expect_u64_gt(zero_pool_stat_get(arena_ind, "bytes"), 0,
+	    "The miss should have been refilled");
+
+	uint64_t hits = zero_pool_stat_get(arena_ind, "hits");
+	p = mallocx(SZ, flags | MALLOCX_ZERO);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	expect_u64_eq(zero_pool_stat_get(arena_ind, "hits"), hits + 1,
+	    "Expected a hit in the filled pool");
+	for (size_t i = 0; i < SZ; i++) {
+		expect_u_eq(p[i], 0, "Pooled memory should be zeroed");
+		if (p[i] != 0) {
+			break;
+		}
+	}
+	dallocx(p, flags);
+
+	zero_pool_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_zero_pool_unzeroed) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind = zero_pool_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	void *p = mallocx(SZ, flags);
+	expect_ptr_not_null(p, "Unexpected mallocx() failure");
+	dallocx(p, flags);
+	expect_u64_eq(zero_pool_stat_get(arena_ind, "misses"), 0,
+	    "Unzeroed allocations should bypass the pool");
+
+	zero_pool_fill(arena_ind);
+	expect_u64_eq(zero_pool_stat_get(arena_ind, "bytes"), 0,
+	    "Nothing should have been filled without demand");
+
+	zero_pool_arena_reset(arena_ind);
+}
+TEST_END
+
+TEST_BEGIN(test_zero_pool_reset) {
+	test_skip_if(!config_stats);
+
+	unsigned arena_ind = zero_pool_arena_create();
+	int      flags = MALLOCX_ARENA(arena_ind) | MALLOCX_TCACHE_NONE;
+
+	for (unsigned i = 0; i < 4; i++) {
+		void *p = mallocx(SZ, flags | MALLOCX_ZERO);
+		expect_ptr_not_null(p, "Unexpected mallocx() failure");
+		dallocx(p, flags);
+	}
+	zero_pool_fill(arena_ind);
+	expect_u64_gt(zero_pool_stat_get(arena_ind, "bytes"), 0,
+	    "The misses should have been refilled");
+	expect_u64_le(zero_pool_stat_get(arena_ind, "bytes"), opt_zero_pool_max,
+	    "The pool should stay within its budget");
+
+	zero_pool_arena_reset(arena_ind);
+	expect_u64_eq(zero_pool_stat_get(arena_ind, "bytes"), 0,
+	    "Reset should empty the pool");
+}
+TEST_END
+
+int
+main(void) {
+	return test(test_zero_pool_ctl, test_zero_pool_hit,
+	    test_zero_pool_unzeroed, test_zero_pool_reset);
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+export MALLOC_CONF="zero_pool_max:1048576"